@@ -1,7 +1,17 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : enable
 
-layout(binding = 1) uniform sampler2D texSampler;
+// Bindless heap, indexed with the handles pushed per draw(dynamically uniform)
+layout (set = 0, binding = 0) uniform texture2D SA_Textures[];
+layout (set = 0, binding = 1) uniform sampler SA_Samplers[];
+
+layout (push_constant) uniform SADrawConstants
+{
+    uint TextureIndex;
+    uint SamplerIndex;
+    uint InstanceMatrixBufferIndex;
+} SADraw;
 
 layout (location = 0) in vec3 fragColor;
 layout (location = 1) in vec2 fragTexCoord;
@@ -10,5 +20,5 @@ layout (location = 0) out vec4 outColor;
 
 void main()
 {
-    outColor = texture(texSampler, fragTexCoord);
+    outColor = texture(sampler2D(SA_Textures[SADraw.TextureIndex], SA_Samplers[SADraw.SamplerIndex]), fragTexCoord);
 }
\ No newline at end of file
@@ -1,13 +1,24 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : enable
 
-layout (binding = 0) uniform SACommonMatrices
+layout (set = 1, binding = 0) uniform SACommonMatrices
 {
 	mat4 ObjectToWorld;
 	mat4 MatrixV;
     mat4 MatrixP;
 } SACommon;
 
+// Bindless heap, every storage buffer aliases binding 2
+layout (set = 0, binding = 2) readonly buffer SAInstanceMatrixBuffer { mat4 InstanceToWorld[]; } SA_InstanceMatrixBuffers[];
+
+layout (push_constant) uniform SADrawConstants
+{
+    uint TextureIndex;
+    uint SamplerIndex;
+    uint InstanceMatrixBufferIndex;
+} SADraw;
+
 layout (location = 0) in vec3 inPosition;
 layout (location = 1) in vec3 inColor;
 layout (location = 2) in vec2 inTexCoord;
@@ -21,7 +32,9 @@ out gl_PerVertex {
 
 void main()
 {
-    gl_Position = SACommon.MatrixP * SACommon.MatrixV * SACommon.ObjectToWorld * vec4(inPosition, 1.0);
+    // ObjectToWorld places the mesh in its instance, the instance's world matrix places that in the world
+    mat4 instanceToWorld = SA_InstanceMatrixBuffers[SADraw.InstanceMatrixBufferIndex].InstanceToWorld[gl_InstanceIndex];
+    gl_Position = SACommon.MatrixP * SACommon.MatrixV * instanceToWorld * SACommon.ObjectToWorld * vec4(inPosition, 1.0);
     fragColor = inColor;
     fragTexCoord = inTexCoord;
 }
\ No newline at end of file
@@ -0,0 +1,58 @@
+﻿#pragma once
+#include "Engine/Source/Runtime/Core/Base/Common.h"
+#include "Engine/Source/Runtime/Core/Job/JobSystem.h"
+#include "Engine/Source/Runtime/Function/Global/GlobalContextConfig.h"
+
+#include <functional>
+
+namespace Snowy::Ark
+{
+/// <summary>
+/// Wall time of a benchmark case. Every case runs a few times and only the best run is reported,
+/// a run the OS happened to disturb doesn't count. Checks compare a runtime system to a simple
+/// CPU reference, any failed check makes SnowyArkBenchmark exit with an error.
+/// </summary>
+class Benchmark
+{
+public:
+    static constexpr uint32_t DefaultRunCount = 3;
+
+public:
+    // Best of runCount runs in milliseconds, a case does its own setup outside of func
+    static double Measure(In<std::function<void()>> func, uint32_t runCount = DefaultRunCount);
+    // setup runs untimed before every run, for state a run consumes(dirty flags)
+    static double Measure(In<std::function<void()>> setup, In<std::function<void()>> func, uint32_t runCount = DefaultRunCount);
+    static void Report(SStringIn name, double milliseconds);
+    // Keeps the optimizer from dropping work whose result is otherwise unused
+    static void Consume(uint64_t value) noexcept;
+
+    static bool Check(SStringIn name, bool passed);
+    static uint32_t FailureCount() noexcept;
+};
+
+// ObjImporter against a sequential parse and dedup of the same OBJ
+void RunObjImporterChecks();
+// Vertex cache, overdraw and vertex fetch passes on a shuffled grid, measured with AnalyzeVertexCache
+void RunMeshOptimizerChecks();
+// LOD chain of a UV sphere: triangle budgets, seams, closed and outward surfaces, and the runtime selection
+void RunMeshLodChecks();
+// Meshlet building and the sphere/cone cluster cull against the triangles of random views
+void RunMeshletChecks();
+// Texture cook and open round trip of a non power of two image, stale and truncated cooks, the SSE2 mip filters against the scalar ones
+void RunTextureChecks();
+// Block compression of every format against a decoder written from the spec, PSNR bounds and SSE2 against scalar
+void RunTextureEncoderChecks();
+// World bookkeeping against a model, query filters, change versions and command playback from parallel chunks
+void RunEcsChecks(Ref<JobSystem> jobSys);
+
+// Spawn, steal and range claiming overhead of the job system
+void RunJobSystemBenchmarks(Ref<JobSystem> jobSys);
+// TransformHierarchy::Update of a 100k node tree with every kernel the CPU runs
+void RunTransformHierarchyBenchmarks(Ref<JobSystem> jobSys);
+// OBJ parsing against mapping the cooked mesh of the same model
+void RunAssetLoadBenchmarks();
+// Box and Kaiser mip chains of a 4096x4096 image, SSE2 and scalar
+void RunTextureFilterBenchmarks();
+// Scene pass command recording of 10k to 100k draws on 1..N threads, brings up its own headless runtime from config
+void RunDrawRecordingBenchmarks(Ref<RuntimeGlobalContextConfig> config);
+}
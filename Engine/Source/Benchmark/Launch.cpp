@@ -0,0 +1,59 @@
+﻿#include "Engine/Source/Benchmark/Include/Benchmark.h"
+#include "Engine/Source/Runtime/Core/Log/LogSystem.h"
+#include "Engine/Source/Runtime/Function/Global/GlobalContext.h"
+
+#include <string>
+#include <string_view>
+
+#pragma comment(lib, "SnowyArkRuntime.lib")
+#pragma comment(lib, "glfw3.lib")
+#pragma comment(lib, "spdlog.lib")
+
+// SnowyArkBenchmark [workerCount] [--record], workerCount defaults to one worker per hardware thread beside the main thread.
+// The checks run first and the exit code is non-zero if any failed. --record also runs the draw recording benchmarks,
+// they need a Vulkan device
+int main(int argc, char** argv)
+{
+    namespace Ark = Snowy::Ark;
+
+    // Only the systems the benchmarks use, no window or renderer
+    Ark::RuntimeGlobalContextConfig config = {};
+    bool recordDraws = false;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::string_view(argv[i]) == "--record")
+        {
+            recordDraws = true;
+        } else
+        {
+            config.jobSys.workerCount = static_cast<uint32_t>(std::stoul(argv[i]));
+        }
+    }
+    auto& context = Ark::g_RuntimeContext;
+    context.logSys = Snowy::MakeShared<Ark::LogSystem>();
+    context.logSys->Init(config.logSys);
+    context.jobSys = Snowy::MakeShared<Ark::JobSystem>();
+    context.jobSys->Init(config.jobSys);
+
+    Ark::RunObjImporterChecks();
+    Ark::RunMeshOptimizerChecks();
+    Ark::RunMeshLodChecks();
+    Ark::RunMeshletChecks();
+    Ark::RunTextureChecks();
+    Ark::RunTextureEncoderChecks();
+    Ark::RunEcsChecks(*context.jobSys);
+
+    Ark::RunJobSystemBenchmarks(*context.jobSys);
+    Ark::RunTransformHierarchyBenchmarks(*context.jobSys);
+    Ark::RunAssetLoadBenchmarks();
+    Ark::RunTextureFilterBenchmarks();
+
+    context.jobSys->Destory();
+    context.logSys->Destory();
+
+    if (recordDraws)
+    {
+        Ark::RunDrawRecordingBenchmarks(config);
+    }
+    return Ark::Benchmark::FailureCount() == 0 ? 0 : 1;
+}
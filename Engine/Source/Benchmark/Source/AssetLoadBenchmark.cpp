@@ -0,0 +1,59 @@
+﻿#include "Engine/Source/Benchmark/Include/Benchmark.h"
+#include "Engine/Source/Runtime/Core/Log/Logger.h"
+#include "Engine/Source/Runtime/Resource/AssetManager.h"
+#include "Engine/Source/Runtime/Resource/ObjImporter.h"
+
+#include <span>
+#include <vector>
+
+namespace Snowy::Ark
+{
+namespace
+{
+constexpr uint32_t RunCount = 5;
+constexpr size_t PageSize = 4096;
+
+// Reads one byte per page, a mapped load isn't done before its pages are resident
+uint64_t TouchPages(ArrayIn<uint8_t> bytes) noexcept
+{
+    uint64_t sum = 0;
+    for (size_t i = 0; i < bytes.size(); i += PageSize)
+    {
+        sum += bytes[i];
+    }
+    return sum;
+}
+}
+
+void RunAssetLoadBenchmarks()
+{
+    AssetManager assetMgr;
+    assetMgr.Init();
+    std::filesystem::path sourcePath = SA_ENGINE_PATH("Engine/Assets/Model/chalet.obj");
+    if (!std::filesystem::exists(sourcePath))
+    {
+        SA_LOG_WARN("Asset load benchmarks need {}, skipped.", PATH_TO_SSTR(sourcePath));
+        return;
+    }
+    auto cookedPath = assetMgr.CookedMeshPath(sourcePath);
+    if (!MeshCooker::IsUpToDate(sourcePath, cookedPath) && !MeshCooker::CookObj(sourcePath, cookedPath))
+    {
+        SA_LOG_ERROR("Failed to cook model: {}", PATH_TO_SSTR(sourcePath));
+        return;
+    }
+
+    // Both read the same model from the page cache after the first run, the difference is parsing against mapping
+    Benchmark::Report(STEXT("chalet.obj ObjImporter::Import"), Benchmark::Measure([&]() {
+        std::vector<MeshVertex> vertices;
+        std::vector<uint32_t> indices;
+        ObjImporter::Import(sourcePath, &vertices, &indices);
+        Benchmark::Consume(vertices.size() + indices.size());
+    }, RunCount));
+    Benchmark::Report(STEXT("chalet.samesh MeshAsset::Open"), Benchmark::Measure([&]() {
+        MeshAsset mesh;
+        mesh.Open(cookedPath);
+        auto indexBytes = std::span(reinterpret_cast<const uint8_t*>(mesh.Indices().data()), mesh.Indices().size_bytes());
+        Benchmark::Consume(TouchPages(mesh.VertexData()) + TouchPages(indexBytes));
+    }, RunCount));
+}
+}
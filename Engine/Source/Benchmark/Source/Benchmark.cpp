@@ -0,0 +1,63 @@
+﻿#include "Engine/Source/Benchmark/Include/Benchmark.h"
+#include "Engine/Source/Runtime/Core/Log/Logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <limits>
+
+namespace Snowy::Ark
+{
+namespace
+{
+std::atomic<uint64_t> s_Sink = 0;
+std::atomic<uint32_t> s_FailureCount = 0;
+}
+
+double Benchmark::Measure(In<std::function<void()>> func, uint32_t runCount)
+{
+    return Measure([]() {}, func, runCount);
+}
+
+double Benchmark::Measure(In<std::function<void()>> setup, In<std::function<void()>> func, uint32_t runCount)
+{
+    double best = std::numeric_limits<double>::max();
+    for (uint32_t run = 0; run < runCount; run++)
+    {
+        setup();
+        auto begin = std::chrono::steady_clock::now();
+        func();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - begin;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+void Benchmark::Report(SStringIn name, double milliseconds)
+{
+    SA_LOG_INFO("{}: {:.2f} ms", name, milliseconds);
+}
+
+void Benchmark::Consume(uint64_t value) noexcept
+{
+    s_Sink.fetch_add(value, std::memory_order_relaxed);
+}
+
+bool Benchmark::Check(SStringIn name, bool passed)
+{
+    if (passed)
+    {
+        SA_LOG_INFO("{}: passed", name);
+    } else
+    {
+        SA_LOG_ERROR("{}: FAILED", name);
+        s_FailureCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    return passed;
+}
+
+uint32_t Benchmark::FailureCount() noexcept
+{
+    return s_FailureCount.load(std::memory_order_relaxed);
+}
+}
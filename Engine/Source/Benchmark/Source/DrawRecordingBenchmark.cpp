@@ -0,0 +1,70 @@
+﻿#include "Engine/Source/Benchmark/Include/Benchmark.h"
+#include "Engine/Source/Runtime/Core/Log/Logger.h"
+#include "Engine/Source/Runtime/Function/Global/GlobalContext.h"
+#include "Engine/Source/Runtime/Function/Rendering/RenderSystem.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanRHI.h"
+
+#include <format>
+#include <thread>
+#include <vector>
+
+namespace Snowy::Ark
+{
+namespace
+{
+constexpr uint32_t DrawCounts[] = { 10000, 25000, 50000, 100000 };
+constexpr uint32_t RunCount = 10;
+}
+
+void RunDrawRecordingBenchmarks(Ref<RuntimeGlobalContextConfig> config)
+{
+    // A headless renderer on the CPU recorded path, one frame drawn so the scene pass has a render pass and framebuffer.
+    // The job system is sized for every hardware thread first, the per thread command pools are created for that many
+    auto& rhiConfig = config.renderSys.rhi;
+    rhiConfig.headless = true;
+    rhiConfig.gpuDrivenRendering = false;
+    rhiConfig.textureStreaming = false;
+    rhiConfig.gpuProfiling = false;
+    rhiConfig.vkEnableValidationLayers = false;
+    rhiConfig.vkDeviceExtensions = { VK_KHR_MAINTENANCE3_EXTENSION_NAME, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME };
+    config.jobSys.workerCount = JobSystemConfig::AutoWorkerCount;
+    config.profileSys.enabled = false;
+
+    auto& context = g_RuntimeContext;
+    context.Init(config);
+    auto rhi = std::dynamic_pointer_cast<VulkanRHI>(context.renderSys->GetRHIContext());
+    if (!rhi)
+    {
+        SA_LOG_WARN("Draw recording benchmarks need the Vulkan RHI, skipped.");
+        context.Destory();
+        return;
+    }
+    context.renderSys->Tick(SceneRenderState {});
+
+    // The same job system restarted with 0..N-1 workers, recording only runs on the threads it owns
+    uint32_t hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    std::vector<uint32_t> threadCounts;
+    for (uint32_t threadCount = 1; threadCount < hardwareThreads; threadCount *= 2)
+    {
+        threadCounts.emplace_back(threadCount);
+    }
+    threadCounts.emplace_back(hardwareThreads);
+
+    for (uint32_t threadCount : threadCounts)
+    {
+        context.jobSys->Destory();
+        context.jobSys->Init(JobSystemConfig { .workerCount = threadCount - 1, .pinWorkers = config.jobSys.pinWorkers });
+        for (uint32_t drawCount : DrawCounts)
+        {
+            Benchmark::Report(std::format(STEXT("Record {} draws, {} threads"), drawCount, threadCount),
+                              Benchmark::Measure([&]() { rhi->ResetBenchmarkDraws(drawCount); }, [&]() { rhi->RecordBenchmarkDraws(); }, RunCount));
+        }
+    }
+    context.jobSys->Destory();
+    context.jobSys->Init(config.jobSys);
+
+    rhi->ResetBenchmarkDraws(0);
+    rhi.reset();
+    context.Destory();
+}
+}
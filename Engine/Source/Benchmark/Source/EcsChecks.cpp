@@ -0,0 +1,244 @@
+﻿#include "Engine/Source/Benchmark/Include/Benchmark.h"
+#include "Engine/Source/Runtime/Function/Scene/CommandBuffer.h"
+#include "Engine/Source/Runtime/Function/Scene/World.h"
+
+#include <algorithm>
+#include <atomic>
+#include <format>
+#include <optional>
+#include <random>
+#include <unordered_map>
+
+namespace Snowy::Ark
+{
+namespace
+{
+constexpr uint32_t InitialEntityCount = 20000;
+constexpr uint32_t OperationCount = 50000;
+
+struct CheckValue
+{
+    uint32_t value = 0;
+};
+
+struct CheckTag
+{
+    uint32_t id = 0;
+};
+
+// Large enough to change the chunk capacity of the archetypes it is part of
+struct CheckPayload
+{
+    uint64_t words[6] = {};
+};
+
+// What the world should hold for one live entity
+struct ModelEntity
+{
+    Entity entity;
+    std::optional<uint32_t> value;
+    std::optional<uint32_t> tag;
+    std::optional<uint64_t> payload;
+};
+
+using Model = std::unordered_map<uint32_t, ModelEntity>;     // by entity index
+
+Entity CreateEntity(Ref<World> world, Ref<Model> model, uint32_t seed)
+{
+    ModelEntity expected;
+    switch (seed % 4)
+    {
+        case 0: expected.entity = world.CreateEntity(CheckValue{ seed }); expected.value = seed; break;
+        case 1: expected.entity = world.CreateEntity(CheckValue{ seed }, CheckTag{ seed * 3 }); expected.value = seed; expected.tag = seed * 3; break;
+        case 2: expected.entity = world.CreateEntity(CheckTag{ seed * 3 }, CheckPayload{ { seed } }); expected.tag = seed * 3; expected.payload = seed; break;
+        default: expected.entity = world.CreateEntity(CheckValue{ seed }, CheckTag{ seed * 3 }, CheckPayload{ { seed } });
+            expected.value = seed; expected.tag = seed * 3; expected.payload = seed; break;
+    }
+    model[expected.entity.index] = expected;
+    return expected.entity;
+}
+
+bool Matches(In<World> world, In<Model> model, ArrayIn<Entity> destroyed)
+{
+    if (world.EntityCount() != model.size())
+    {
+        return false;
+    }
+    for (auto&& [index, expected] : model)
+    {
+        auto value = world.GetComponent<CheckValue>(expected.entity);
+        auto tag = world.GetComponent<CheckTag>(expected.entity);
+        auto payload = world.GetComponent<CheckPayload>(expected.entity);
+        if (!world.IsAlive(expected.entity) || (value != nullptr) != expected.value.has_value() || (tag != nullptr) != expected.tag.has_value() ||
+            (payload != nullptr) != expected.payload.has_value() || (value && value->value != *expected.value) || (tag && tag->id != *expected.tag) ||
+            (payload && payload->words[0] != *expected.payload))
+        {
+            return false;
+        }
+    }
+    // A handle stays dead when its slot is reused
+    return std::none_of(destroyed.begin(), destroyed.end(), [&](Entity entity) { return world.IsAlive(entity); });
+}
+}
+
+void RunEcsChecks(Ref<JobSystem> jobSys)
+{
+    World world;
+    Model model;
+    std::vector<Entity> destroyed;
+    std::mt19937 random(24);
+    for (uint32_t i = 0; i < InitialEntityCount; i++)
+    {
+        CreateEntity(world, model, i);
+    }
+
+    // Random structural changes against the model, every add and remove moves the entity to another archetype
+    auto randomEntity = [&]() {
+        auto it = model.begin();
+        std::advance(it, random() % std::min<size_t>(model.size(), 64));
+        return it->second.entity;
+    };
+    for (uint32_t i = 0; i < OperationCount; i++)
+    {
+        uint32_t seed = InitialEntityCount + i;
+        switch (random() % 6)
+        {
+            case 0: CreateEntity(world, model, seed); break;
+            case 1:
+            {
+                auto entity = randomEntity();
+                world.DestroyEntity(entity);
+                model.erase(entity.index);
+                destroyed.emplace_back(entity);
+                break;
+            }
+            case 2: { auto entity = randomEntity(); world.AddComponent(entity, CheckValue{ seed }); model[entity.index].value = seed; break; }
+            case 3: { auto entity = randomEntity(); world.RemoveComponent<CheckValue>(entity); model[entity.index].value.reset(); break; }
+            case 4: { auto entity = randomEntity(); world.AddComponent(entity, CheckPayload{ { seed } }); model[entity.index].payload = seed; break; }
+            default: { auto entity = randomEntity(); world.RemoveComponent<CheckTag>(entity); model[entity.index].tag.reset(); break; }
+        }
+    }
+    // Dead handles are ignored
+    world.DestroyEntity(destroyed.front());
+    world.AddComponent(destroyed.front(), CheckTag{});
+    Benchmark::Check(std::format(STEXT("World {} random structural changes, {} entities in {} archetypes match the model"), OperationCount, world.EntityCount(),
+                                 world.ArchetypeCount()),
+                     Matches(world, model, destroyed));
+
+    // Required, With and Without narrow the archetypes, every matching entity is visited once
+    auto expectedCount = [&](bool tag, bool noPayload) {
+        return static_cast<uint32_t>(std::count_if(model.begin(), model.end(), [&](auto&& entry) {
+            return entry.second.value && (!tag || entry.second.tag) && (!noPayload || !entry.second.payload);
+        }));
+    };
+    uint64_t visitedSum = 0, expectedSum = 0;
+    uint32_t visitedCount = 0;
+    world.Query<const CheckValue>().With<CheckTag>().Without<CheckPayload>().ForEach([&](const CheckValue& value) {
+        visitedSum += value.value;
+        visitedCount++;
+    });
+    for (auto&& [index, expected] : model)
+    {
+        expectedSum += expected.value && expected.tag && !expected.payload ? *expected.value : 0;
+    }
+    Benchmark::Check(STEXT("EntityQuery With and Without visit exactly the matching entities"),
+                     world.Query<const CheckValue>().Count() == expectedCount(false, false) &&
+                     world.Query<const CheckValue>().With<CheckTag>().Count() == expectedCount(true, false) &&
+                     visitedCount == expectedCount(true, true) && visitedSum == expectedSum);
+
+    // A system sees the chunks written since its last run and not its own writes, a const query writes nothing
+    uint32_t systemVersion = world.AdvanceVersion();
+    world.Query<CheckValue>().ForEachChunk([](ArrayIn<Entity>, std::span<CheckValue>) {});
+    world.AdvanceVersion();
+    world.Query<const CheckValue>().ForEachChunk([](ArrayIn<Entity>, std::span<const CheckValue>) {});
+    uint32_t quietChunks = 0;
+    world.Query<const CheckValue>().ChangedSince<CheckValue>(systemVersion).ForEachChunk([&](ArrayIn<Entity>, std::span<const CheckValue>) { quietChunks++; });
+    Entity written = randomEntity();
+    while (!model[written.index].value)
+    {
+        written = randomEntity();
+    }
+    world.GetMutableComponent<CheckValue>(written)->value = 7;
+    model[written.index].value = 7;
+    bool writtenSeen = false;
+    uint32_t changedChunks = 0;
+    world.Query<const CheckValue>().ChangedSince<CheckValue>(systemVersion).ForEachChunk([&](ArrayIn<Entity> entities, std::span<const CheckValue>) {
+        changedChunks++;
+        writtenSeen |= std::find(entities.begin(), entities.end(), written) != entities.end();
+    });
+    Benchmark::Check(std::format(STEXT("EntityQuery::ChangedSince skips unchanged chunks, {} after a read, {} after one write"), quietChunks, changedChunks),
+                     quietChunks == 0 && changedChunks == 1 && writtenSeen);
+
+    // Recorded from parallel chunks, per entity commands come from the chunk that holds it so the result doesn't
+    // depend on the order the jobs ran in
+    CommandBuffer commands;
+    std::atomic<uint32_t> createdCount = 0;
+    world.Query<const CheckValue>().ParallelForEachChunk(jobSys, [&](ArrayIn<Entity> entities, std::span<const CheckValue> values) {
+        for (size_t i = 0; i < entities.size(); i++)
+        {
+            uint32_t value = values[i].value;
+            if (value % 5 == 0)
+            {
+                commands.DestroyEntity(entities[i]);
+                commands.AddComponent(entities[i], CheckTag{ 1 });     // dead by the time it plays back, dropped
+            } else if (value % 5 == 1)
+            {
+                commands.AddComponent(entities[i], CheckTag{ value });
+                commands.RemoveComponent<CheckPayload>(entities[i]);
+            } else if (value % 5 == 2)
+            {
+                commands.CreateEntity(CheckTag{ value }, CheckPayload{ { value } });
+                createdCount++;
+            }
+        }
+    });
+    std::vector<ModelEntity> expectedCreated;
+    for (auto it = model.begin(); it != model.end();)
+    {
+        auto& expected = it->second;
+        if (expected.value && *expected.value % 5 == 0)
+        {
+            destroyed.emplace_back(expected.entity);
+            it = model.erase(it);
+            continue;
+        }
+        if (expected.value && *expected.value % 5 == 1)
+        {
+            expected.tag = *expected.value;
+            expected.payload.reset();
+        } else if (expected.value && *expected.value % 5 == 2)
+        {
+            expectedCreated.emplace_back(ModelEntity{ .tag = *expected.value, .payload = *expected.value });
+        }
+        ++it;
+    }
+    commands.Playback(world);
+
+    // The created entities are only known by their components
+    std::vector<uint32_t> createdTags, expectedTags;
+    for (auto&& created : expectedCreated)
+    {
+        expectedTags.emplace_back(*created.tag);
+    }
+    world.Query<const CheckTag, const CheckPayload>().Without<CheckValue>().ForEachChunk([&](ArrayIn<Entity> entities, std::span<const CheckTag> tags, std::span<const CheckPayload> payloads) {
+        for (size_t i = 0; i < entities.size(); i++)
+        {
+            if (!model.contains(entities[i].index) || !(model[entities[i].index].entity == entities[i]))
+            {
+                createdTags.emplace_back(tags[i].id == payloads[i].words[0] ? tags[i].id : UINT32_MAX);
+            }
+        }
+    });
+    std::sort(createdTags.begin(), createdTags.end());
+    std::sort(expectedTags.begin(), expectedTags.end());
+    bool played = createdTags == expectedTags && world.EntityCount() == model.size() + createdCount && commands.Empty();
+    for (auto&& [index, expected] : model)
+    {
+        played &= world.IsAlive(expected.entity) && world.HasComponent<CheckTag>(expected.entity) == expected.tag.has_value() &&
+                  world.HasComponent<CheckPayload>(expected.entity) == expected.payload.has_value() &&
+                  (!expected.tag || world.GetComponent<CheckTag>(expected.entity)->id == *expected.tag);
+    }
+    played &= std::none_of(destroyed.begin(), destroyed.end(), [&](Entity entity) { return world.IsAlive(entity); });
+    Benchmark::Check(std::format(STEXT("CommandBuffer playback of commands recorded from parallel chunks, {} created"), createdTags.size()), played);
+}
+}
@@ -0,0 +1,88 @@
+﻿#include "Engine/Source/Benchmark/Include/Benchmark.h"
+
+#include <vector>
+
+namespace Snowy::Ark
+{
+namespace
+{
+constexpr uint32_t SpawnCount = 100000;
+constexpr uint32_t NestedCount = 256;           // outer jobs, each spawning as many inner ones
+constexpr uint32_t ParallelForCount = 4 * 1024 * 1024;
+constexpr uint32_t ParallelForRepeat = 20;
+constexpr uint32_t ParallelForGrain = 1024;
+
+// The jobs do next to nothing, the time is the cost of submitting, running and completing them
+void SpawnAndGet(Ref<JobSystem> jobSys)
+{
+    std::vector<JobFuture<uint32_t>> futures;
+    futures.reserve(SpawnCount);
+    for (uint32_t i = 0; i < SpawnCount; i++)
+    {
+        futures.emplace_back(jobSys.Async([i]() { return i; }));
+    }
+    uint64_t sum = 0;
+    for (auto&& future : futures)
+    {
+        sum += future.Get();
+    }
+    Benchmark::Consume(sum);
+}
+
+// Inner jobs are spawned on the workers' own deques, idle threads have to steal them
+void NestedSpawn(Ref<JobSystem> jobSys)
+{
+    std::vector<JobFuture<uint64_t>> outer;
+    outer.reserve(NestedCount);
+    for (uint32_t i = 0; i < NestedCount; i++)
+    {
+        outer.emplace_back(jobSys.Async([&jobSys, i]() {
+            std::vector<JobFuture<uint32_t>> inner;
+            inner.reserve(NestedCount);
+            for (uint32_t j = 0; j < NestedCount; j++)
+            {
+                inner.emplace_back(jobSys.Async([i, j]() { return i ^ j; }));
+            }
+            uint64_t sum = 0;
+            for (auto&& future : inner)
+            {
+                sum += future.Get();
+            }
+            return sum;
+        }));
+    }
+    uint64_t sum = 0;
+    for (auto&& future : outer)
+    {
+        sum += future.Get();
+    }
+    Benchmark::Consume(sum);
+}
+
+void RepeatParallelFor(Ref<JobSystem> jobSys, std::vector<float>& data, uint32_t grainSize)
+{
+    for (uint32_t repeat = 0; repeat < ParallelForRepeat; repeat++)
+    {
+        jobSys.ParallelFor(ParallelForCount, grainSize, [&data](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; i++)
+            {
+                data[i] = data[i] * 0.5f + 1.0f;
+            }
+        });
+    }
+    Benchmark::Consume(static_cast<uint64_t>(data[ParallelForCount / 2]));
+}
+}
+
+void RunJobSystemBenchmarks(Ref<JobSystem> jobSys)
+{
+    Benchmark::Report(STEXT("100k Async spawn+get"), Benchmark::Measure([&jobSys]() { SpawnAndGet(jobSys); }));
+    Benchmark::Report(STEXT("256x256 nested Async"), Benchmark::Measure([&jobSys]() { NestedSpawn(jobSys); }));
+
+    std::vector<float> data(ParallelForCount, 1.0f);
+    Benchmark::Report(STEXT("20x ParallelFor over 4M, grain 1024"),
+                      Benchmark::Measure([&]() { RepeatParallelFor(jobSys, data, ParallelForGrain); }));
+    Benchmark::Report(STEXT("20x ParallelFor over 4M, auto grain"),
+                      Benchmark::Measure([&]() { RepeatParallelFor(jobSys, data, JobSystem::AutoGrainSize); }));
+}
+}
@@ -0,0 +1,140 @@
+﻿#include "Engine/Source/Benchmark/Include/Benchmark.h"
+#include "Engine/Source/Runtime/Function/Rendering/Mesh.h"
+#include "Engine/Source/Runtime/Resource/MeshAsset.h"
+#include "Engine/Source/Runtime/Resource/MeshOptimizer.h"
+
+#include <algorithm>
+#include <format>
+#include <map>
+#include <numbers>
+#include <tuple>
+
+namespace Snowy::Ark
+{
+namespace
+{
+constexpr uint32_t RingCount = 200;         // latitude bands
+constexpr uint32_t SegmentCount = 400;      // longitude bands, the seam vertices are duplicated with u = 0 and u = 1
+constexpr float TargetErrorRatio = 0.02f;   // of the bounds diagonal, as the cooker
+
+struct SphereMesh
+{
+    std::vector<glm::vec3> positions;
+    std::vector<float> us;
+    std::vector<uint32_t> indices;
+};
+
+// UV sphere as an OBJ export has it: a seam where u wraps and a vertex per segment at the poles
+SphereMesh MakeUvSphere()
+{
+    SphereMesh mesh;
+    // Seam and pole duplicates share the exact position, that is how the simplifier finds them
+    auto addVertex = [&](float theta, float u) {
+        float phi = u < 1.0f ? u * 2.0f * std::numbers::pi_v<float> : 0.0f;
+        float radius = theta > 0.0f && theta < std::numbers::pi_v<float> ? std::sin(theta) : 0.0f;
+        mesh.positions.emplace_back(radius * std::cos(phi), theta > 0.0f ? std::cos(theta) : 1.0f, radius * std::sin(phi));
+        mesh.us.emplace_back(u);
+        return static_cast<uint32_t>(mesh.positions.size() - 1);
+    };
+    auto addTriangle = [&](uint32_t a, uint32_t b, uint32_t c) {
+        auto normal = glm::cross(mesh.positions[b] - mesh.positions[a], mesh.positions[c] - mesh.positions[a]);
+        mesh.indices.insert(mesh.indices.end(), { a, b, c });
+        if (glm::dot(normal, mesh.positions[a] + mesh.positions[b] + mesh.positions[c]) < 0.0f)
+        {
+            std::swap(mesh.indices[mesh.indices.size() - 1], mesh.indices[mesh.indices.size() - 2]);
+        }
+    };
+
+    std::vector<uint32_t> rings((RingCount - 1) * (SegmentCount + 1));
+    for (uint32_t ring = 1; ring < RingCount; ring++)
+    {
+        for (uint32_t segment = 0; segment <= SegmentCount; segment++)
+        {
+            rings[(ring - 1) * (SegmentCount + 1) + segment] = addVertex(std::numbers::pi_v<float> * ring / RingCount, static_cast<float>(segment) / SegmentCount);
+        }
+    }
+    auto ringVertex = [&](uint32_t ring, uint32_t segment) { return rings[(ring - 1) * (SegmentCount + 1) + segment]; };
+    for (uint32_t segment = 0; segment < SegmentCount; segment++)
+    {
+        float u = (segment + 0.5f) / SegmentCount;
+        addTriangle(addVertex(0.0f, u), ringVertex(1, segment), ringVertex(1, segment + 1));
+        addTriangle(addVertex(std::numbers::pi_v<float>, u), ringVertex(RingCount - 1, segment), ringVertex(RingCount - 1, segment + 1));
+        for (uint32_t ring = 1; ring + 1 < RingCount; ring++)
+        {
+            addTriangle(ringVertex(ring, segment), ringVertex(ring + 1, segment), ringVertex(ring + 1, segment + 1));
+            addTriangle(ringVertex(ring, segment), ringVertex(ring + 1, segment + 1), ringVertex(ring, segment + 1));
+        }
+    }
+    return mesh;
+}
+
+// The surface is closed once the seam and pole duplicates are welded, every edge between two positions
+// is shared by exactly two triangles. Returns the edges that are not
+uint32_t CountOpenEdges(In<SphereMesh> mesh, ArrayIn<uint32_t> indices)
+{
+    auto key = [&](uint32_t index) { auto p = mesh.positions[index]; return std::make_tuple(p.x, p.y, p.z); };
+    std::map<std::pair<std::tuple<float, float, float>, std::tuple<float, float, float>>, uint32_t> edgeCounts;
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        for (size_t corner = 0; corner < 3; corner++)
+        {
+            auto a = key(indices[i + corner]), b = key(indices[i + (corner + 1) % 3]);
+            edgeCounts[std::minmax(a, b)]++;
+        }
+    }
+    return static_cast<uint32_t>(std::count_if(edgeCounts.begin(), edgeCounts.end(), [](auto&& edge) { return edge.second != 2; }));
+}
+
+// Counts faces turned inwards and faces whose corners come from both sides of the seam
+void CountBadTriangles(In<SphereMesh> mesh, ArrayIn<uint32_t> indices, Ref<uint32_t> flipped, Ref<uint32_t> seamCrossing)
+{
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        auto a = mesh.positions[indices[i]], b = mesh.positions[indices[i + 1]], c = mesh.positions[indices[i + 2]];
+        auto normal = glm::cross(b - a, c - a);
+        if (glm::length(normal) > 1e-7f && glm::dot(normal, a + b + c) <= 0.0f)
+        {
+            flipped++;
+        }
+        auto [minU, maxU] = std::minmax({ mesh.us[indices[i]], mesh.us[indices[i + 1]], mesh.us[indices[i + 2]] });
+        seamCrossing += maxU - minU > 0.5f ? 1 : 0;
+    }
+}
+}
+
+void RunMeshLodChecks()
+{
+    auto mesh = MakeUvSphere();
+    auto triangleCount = static_cast<uint32_t>(mesh.indices.size() / 3);
+    float targetError = TargetErrorRatio * glm::length(glm::vec3(2.0f));
+    auto indices = mesh.indices;
+    auto lods = MeshOptimizer::BuildLods(indices, mesh.positions, MeshCooker::LodRatios, targetError);
+
+    Benchmark::Check(std::format(STEXT("MeshOptimizer::BuildLods {} levels of a {} triangle UV sphere"), lods.size(), triangleCount),
+                     lods.size() == MeshCooker::LodRatios.size() + 1);
+    for (uint32_t lod = 1; lod < lods.size(); lod++)
+    {
+        auto& level = lods[lod];
+        auto levelIndices = ArrayIn<uint32_t>(indices).subspan(level.firstIndex, level.indexCount);
+        uint32_t flipped = 0, seamCrossing = 0;
+        CountBadTriangles(mesh, levelIndices, flipped, seamCrossing);
+        uint32_t openEdges = CountOpenEdges(mesh, levelIndices);
+        float ratio = static_cast<float>(level.indexCount / 3) / triangleCount;
+        Benchmark::Check(std::format(STEXT("LOD {}: {:.2f}% triangles(target {:.2f}%), error {:.4f}, {} flipped, {} across the seam, {} open edges"),
+                                     lod, ratio * 100.0f, MeshCooker::LodRatios[lod - 1] * 100.0f, level.error, flipped, seamCrossing, openEdges),
+                         ratio <= MeshCooker::LodRatios[lod - 1] * 1.01f && level.error >= lods[lod - 1].error && level.error <= targetError &&
+                         flipped == 0 && seamCrossing == 0 && openEdges == 0);
+    }
+
+    // Closer means more pixels per unit and a finer level, a level only once its error fits the pixel budget
+    bool selected = Mesh::SelectLod(lods, 1e6f, 1.0f) == 0 && Mesh::SelectLod(lods, 1e-6f, 1.0f) == lods.size() - 1;
+    uint32_t previousLod = static_cast<uint32_t>(lods.size() - 1);
+    for (float pixelsPerUnit = 1.0f; pixelsPerUnit < 1e6f; pixelsPerUnit *= 2.0f)
+    {
+        uint32_t lod = Mesh::SelectLod(lods, pixelsPerUnit, 1.0f);
+        selected &= lod <= previousLod && lods[lod].error * pixelsPerUnit <= 1.0f;
+        previousLod = lod;
+    }
+    Benchmark::Check(STEXT("Mesh::SelectLod picks the coarsest level within the pixel error"), selected);
+}
+}
@@ -0,0 +1,121 @@
+﻿#include "Engine/Source/Benchmark/Include/Benchmark.h"
+#include "Engine/Source/Runtime/Resource/MeshOptimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <format>
+#include <random>
+#include <tuple>
+
+namespace Snowy::Ark
+{
+namespace
+{
+constexpr uint32_t GridSize = 200;  // quads per side
+
+struct CheckMesh
+{
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+};
+
+// A regular grid with its triangles and vertices shuffled, the worst case order for the post-transform cache
+CheckMesh MakeShuffledGrid()
+{
+    CheckMesh mesh;
+    uint32_t rowVertexCount = GridSize + 1;
+    for (uint32_t y = 0; y <= GridSize; y++)
+    {
+        for (uint32_t x = 0; x <= GridSize; x++)
+        {
+            mesh.positions.emplace_back(static_cast<float>(x), static_cast<float>(y), 0.0f);
+        }
+    }
+    std::vector<std::array<uint32_t, 3>> triangles;
+    for (uint32_t y = 0; y < GridSize; y++)
+    {
+        for (uint32_t x = 0; x < GridSize; x++)
+        {
+            uint32_t a = y * rowVertexCount + x;
+            triangles.push_back({ a, a + 1, a + rowVertexCount + 1 });
+            triangles.push_back({ a, a + rowVertexCount + 1, a + rowVertexCount });
+        }
+    }
+    std::mt19937 random(12);
+    std::shuffle(triangles.begin(), triangles.end(), random);
+    std::vector<uint32_t> remap(mesh.positions.size());
+    for (uint32_t i = 0; i < remap.size(); i++)
+    {
+        remap[i] = i;
+    }
+    std::shuffle(remap.begin(), remap.end(), random);
+    MeshOptimizer::RemapVertices(mesh.positions, remap);
+    for (auto&& triangle : triangles)
+    {
+        for (auto index : triangle)
+        {
+            mesh.indices.emplace_back(remap[index]);
+        }
+    }
+    return mesh;
+}
+
+// Triangles by their positions, each rotated to start at its smallest corner so the winding is kept
+std::vector<std::array<float, 9>> SortedTriangles(In<CheckMesh> mesh)
+{
+    std::vector<std::array<float, 9>> triangles;
+    for (size_t i = 0; i < mesh.indices.size(); i += 3)
+    {
+        std::array<glm::vec3, 3> corners = { mesh.positions[mesh.indices[i]], mesh.positions[mesh.indices[i + 1]], mesh.positions[mesh.indices[i + 2]] };
+        auto less = [](glm::vec3 lhs, glm::vec3 rhs) { return std::tie(lhs.x, lhs.y, lhs.z) < std::tie(rhs.x, rhs.y, rhs.z); };
+        std::rotate(corners.begin(), std::min_element(corners.begin(), corners.end(), less), corners.end());
+        triangles.push_back({ corners[0].x, corners[0].y, corners[0].z, corners[1].x, corners[1].y, corners[1].z, corners[2].x, corners[2].y, corners[2].z });
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+bool IsFirstUseOrder(ArrayIn<uint32_t> indices)
+{
+    uint32_t nextVertex = 0;
+    for (auto index : indices)
+    {
+        if (index > nextVertex)
+        {
+            return false;
+        }
+        nextVertex += index == nextVertex ? 1 : 0;
+    }
+    return true;
+}
+}
+
+void RunMeshOptimizerChecks()
+{
+    auto source = MakeShuffledGrid();
+    auto vertexCount = static_cast<uint32_t>(source.positions.size());
+    auto before = MeshOptimizer::AnalyzeVertexCache(source.indices, vertexCount);
+
+    CheckMesh optimized = source;
+    optimized.indices = MeshOptimizer::OptimizeVertexCache(optimized.indices, vertexCount);
+    auto afterCache = MeshOptimizer::AnalyzeVertexCache(optimized.indices, vertexCount);
+    Benchmark::Check(std::format(STEXT("MeshOptimizer::OptimizeVertexCache ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}"),
+                                 before.acmr, afterCache.acmr, before.atvr, afterCache.atvr),
+                     afterCache.acmr < before.acmr && afterCache.atvr < before.atvr && afterCache.acmr < 1.0f);
+
+    optimized.indices = MeshOptimizer::OptimizeOverdraw(optimized.indices, optimized.positions);
+    auto afterOverdraw = MeshOptimizer::AnalyzeVertexCache(optimized.indices, vertexCount);
+    Benchmark::Check(std::format(STEXT("MeshOptimizer::OptimizeOverdraw keeps the ACMR within 5%, {:.3f}"), afterOverdraw.acmr),
+                     afterOverdraw.acmr <= afterCache.acmr * 1.05f);
+
+    // Vertex fetch only renames vertices, the cache behaviour stays and the vertices follow the index stream
+    auto remap = MeshOptimizer::BuildVertexFetchRemap(optimized.indices, vertexCount);
+    MeshOptimizer::RemapIndices(optimized.indices, remap);
+    MeshOptimizer::RemapVertices(optimized.positions, remap);
+    auto afterFetch = MeshOptimizer::AnalyzeVertexCache(optimized.indices, vertexCount);
+    Benchmark::Check(STEXT("MeshOptimizer::BuildVertexFetchRemap stores vertices in first-use order"),
+                     IsFirstUseOrder(optimized.indices) && afterFetch.transformedCount == afterOverdraw.transformedCount);
+
+    Benchmark::Check(STEXT("MeshOptimizer passes keep the triangles and their winding"), SortedTriangles(optimized) == SortedTriangles(source));
+}
+}
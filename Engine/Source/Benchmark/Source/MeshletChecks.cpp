@@ -0,0 +1,168 @@
+﻿#include "Engine/Source/Benchmark/Include/Benchmark.h"
+#include "Engine/Source/Runtime/Resource/MeshOptimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <format>
+#include <numbers>
+#include <random>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace Snowy::Ark
+{
+namespace
+{
+constexpr uint32_t RingCount = 150;
+constexpr uint32_t SegmentCount = 300;
+constexpr uint32_t ViewCount = 200;     // random cameras outside the sphere looking at it
+constexpr float SphereEpsilon = 1e-5f;
+
+struct MeshletCheckMesh
+{
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+};
+
+// Closed unit sphere with shared vertices, wound counter clockwise seen from outside
+MeshletCheckMesh MakeSphere()
+{
+    MeshletCheckMesh mesh;
+    mesh.positions.emplace_back(0.0f, 1.0f, 0.0f);
+    for (uint32_t ring = 1; ring < RingCount; ring++)
+    {
+        float theta = std::numbers::pi_v<float> * ring / RingCount;
+        for (uint32_t segment = 0; segment < SegmentCount; segment++)
+        {
+            float phi = 2.0f * std::numbers::pi_v<float> * segment / SegmentCount;
+            mesh.positions.emplace_back(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+        }
+    }
+    mesh.positions.emplace_back(0.0f, -1.0f, 0.0f);
+    uint32_t bottom = static_cast<uint32_t>(mesh.positions.size() - 1);
+    auto ringVertex = [](uint32_t ring, uint32_t segment) { return 1 + (ring - 1) * SegmentCount + segment % SegmentCount; };
+    for (uint32_t segment = 0; segment < SegmentCount; segment++)
+    {
+        mesh.indices.insert(mesh.indices.end(), { 0, ringVertex(1, segment + 1), ringVertex(1, segment) });
+        mesh.indices.insert(mesh.indices.end(), { bottom, ringVertex(RingCount - 1, segment), ringVertex(RingCount - 1, segment + 1) });
+        for (uint32_t ring = 1; ring + 1 < RingCount; ring++)
+        {
+            mesh.indices.insert(mesh.indices.end(), { ringVertex(ring, segment), ringVertex(ring, segment + 1), ringVertex(ring + 1, segment + 1) });
+            mesh.indices.insert(mesh.indices.end(), { ringVertex(ring, segment), ringVertex(ring + 1, segment + 1), ringVertex(ring + 1, segment) });
+        }
+    }
+    return mesh;
+}
+
+std::array<uint32_t, 3> MeshletTriangle(In<MeshletData> data, In<Meshlet> meshlet, uint32_t triangle)
+{
+    uint32_t packed = data.triangles[meshlet.triangleOffset + triangle];
+    std::array<uint32_t, 3> corners;
+    for (uint32_t corner = 0; corner < 3; corner++)
+    {
+        corners[corner] = data.vertices[meshlet.vertexOffset + ((packed >> (corner * 8)) & 0xFF)];
+    }
+    return corners;
+}
+
+// Rotated to start at the smallest index so the winding is kept
+std::array<uint32_t, 3> Canonical(std::array<uint32_t, 3> triangle)
+{
+    std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+    return triangle;
+}
+
+// Gribb/Hartmann, clip space depth in [0, 1] as the cull shaders take them
+std::array<glm::vec4, 6> FrustumPlanes(In<glm::mat4> objectToClip)
+{
+    auto row = [&](int i) { return glm::vec4(objectToClip[0][i], objectToClip[1][i], objectToClip[2][i], objectToClip[3][i]); };
+    std::array<glm::vec4, 6> planes = { row(3) + row(0), row(3) - row(0), row(3) + row(1), row(3) - row(1), row(2), row(3) - row(2) };
+    for (auto&& plane : planes)
+    {
+        plane /= glm::length(glm::vec3(plane));
+    }
+    return planes;
+}
+
+bool IsInside(In<std::array<glm::vec4, 6>> planes, glm::vec3 point, float radius)
+{
+    return std::all_of(planes.begin(), planes.end(), [&](In<glm::vec4> plane) { return glm::dot(glm::vec3(plane), point) + plane.w >= -radius; });
+}
+}
+
+void RunMeshletChecks()
+{
+    auto mesh = MakeSphere();
+    MeshletData data;
+    MeshOptimizer::BuildMeshlets(mesh.indices, mesh.positions, MeshOptimizer::MeshletMaxVertices, MeshOptimizer::MeshletMaxTriangles, &data);
+    auto triangleCount = static_cast<uint32_t>(mesh.indices.size() / 3);
+
+    // Every triangle exactly once, within the limits and inside the bounding sphere
+    std::vector<std::array<uint32_t, 3>> expected, emitted;
+    for (uint32_t i = 0; i < triangleCount; i++)
+    {
+        expected.emplace_back(Canonical({ mesh.indices[i * 3], mesh.indices[i * 3 + 1], mesh.indices[i * 3 + 2] }));
+    }
+    bool bounded = true;
+    for (auto&& meshlet : data.meshlets)
+    {
+        bounded &= meshlet.vertexCount <= MeshOptimizer::MeshletMaxVertices && meshlet.triangleCount <= MeshOptimizer::MeshletMaxTriangles;
+        for (uint32_t vertex = 0; vertex < meshlet.vertexCount; vertex++)
+        {
+            auto position = mesh.positions[data.vertices[meshlet.vertexOffset + vertex]];
+            bounded &= glm::length(position - glm::vec3(meshlet.boundingSphere)) <= meshlet.boundingSphere.w * (1.0f + SphereEpsilon) + SphereEpsilon;
+        }
+        for (uint32_t triangle = 0; triangle < meshlet.triangleCount; triangle++)
+        {
+            emitted.emplace_back(Canonical(MeshletTriangle(data, meshlet, triangle)));
+        }
+    }
+    std::sort(expected.begin(), expected.end());
+    std::sort(emitted.begin(), emitted.end());
+    Benchmark::Check(std::format(STEXT("MeshOptimizer::BuildMeshlets {} meshlets, {:.1f} triangles each, every triangle once and bounded"),
+                                 data.meshlets.size(), static_cast<float>(triangleCount) / data.meshlets.size()),
+                     bounded && emitted == expected);
+
+    // The cluster cull is conservative: a meshlet it drops, by sphere or cone, has no triangle that is both in the
+    // frustum and front facing. The cone must still drop a fair share of the far side
+    std::mt19937 random(14);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f), distance(1.5f, 6.0f), fov(0.3f, 1.2f);
+    uint32_t wronglyCulled = 0, coneCulled = 0, sphereCulled = 0, tested = 0;
+    for (uint32_t view = 0; view < ViewCount; view++)
+    {
+        glm::vec3 direction;
+        do
+        {
+            direction = glm::vec3(unit(random), unit(random), unit(random));
+        } while (glm::length(direction) < 0.1f || glm::length(direction) > 1.0f);
+        glm::vec3 cameraPosition = glm::normalize(direction) * distance(random);
+        glm::vec3 target = glm::vec3(unit(random), unit(random), unit(random)) * 0.5f;
+        auto objectToClip = glm::perspectiveRH_ZO(fov(random), 1.5f, 0.1f, 100.0f) * glm::lookAtRH(cameraPosition, target, glm::vec3(0.0f, 1.0f, 0.0f));
+        auto planes = FrustumPlanes(objectToClip);
+
+        for (auto&& meshlet : data.meshlets)
+        {
+            bool inFrustum = IsInside(planes, glm::vec3(meshlet.boundingSphere), meshlet.boundingSphere.w);
+            bool backFacing = MeshOptimizer::IsMeshletBackFacing(meshlet, cameraPosition);
+            tested++;
+            sphereCulled += inFrustum ? 0 : 1;
+            coneCulled += inFrustum && backFacing ? 1 : 0;
+            if (inFrustum && !backFacing)
+            {
+                continue;
+            }
+            for (uint32_t triangle = 0; triangle < meshlet.triangleCount; triangle++)
+            {
+                auto corners = MeshletTriangle(data, meshlet, triangle);
+                auto a = mesh.positions[corners[0]], b = mesh.positions[corners[1]], c = mesh.positions[corners[2]];
+                bool frontFacing = glm::dot(glm::cross(b - a, c - a), cameraPosition - a) > 0.0f;
+                bool visible = IsInside(planes, a, 0.0f) || IsInside(planes, b, 0.0f) || IsInside(planes, c, 0.0f);
+                wronglyCulled += frontFacing && (backFacing || visible) ? 1 : 0;
+            }
+        }
+    }
+    Benchmark::Check(std::format(STEXT("Meshlet cluster cull over {} views: {:.1f}% culled by sphere, {:.1f}% by cone, {} visible triangles culled"),
+                                 ViewCount, 100.0f * sphereCulled / tested, 100.0f * coneCulled / tested, wronglyCulled),
+                     wronglyCulled == 0 && coneCulled * 10 > tested);
+}
+}
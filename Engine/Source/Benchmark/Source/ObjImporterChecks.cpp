@@ -0,0 +1,211 @@
+﻿#include "Engine/Source/Benchmark/Include/Benchmark.h"
+#include "Engine/Source/Runtime/Resource/ObjImporter.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace Snowy::Ark
+{
+namespace
+{
+constexpr uint32_t GridSize = 300;          // quads per side, the OBJ is a few MB so it spans several import chunks
+constexpr uint32_t GroupRowCount = 40;      // rows of quads per "g" group
+constexpr uint32_t HashVertexCount = 200000;
+
+// A grid of quads with every kind of line the importer has to get through: CRLF rows, comments, groups,
+// normals, negative indices, faces without texcoords and polygons of up to 5 corners
+AnsiString MakeObj()
+{
+    AnsiString obj = "# SnowyArk ObjImporter check\nmtllib none.mtl\no Grid\n";
+    uint32_t rowVertexCount = GridSize + 1;
+    for (uint32_t y = 0; y <= GridSize; y++)
+    {
+        const char* lineEnd = y % 2 == 0 ? "\r\n" : "\n";
+        for (uint32_t x = 0; x <= GridSize; x++)
+        {
+            obj += std::format("v {} {:.6f} {}{}", x * 0.25f, static_cast<float>((x * 7 + y * 13) % 17) * 0.01f, y * -0.25f, lineEnd);
+            obj += std::format("vt {:.5f} {:.5f}{}", static_cast<float>(x) / GridSize, static_cast<float>(y) / GridSize, lineEnd);
+        }
+        obj += "vn 0 1 0\n";
+    }
+    uint32_t vertexCount = rowVertexCount * rowVertexCount;
+    for (uint32_t y = 0; y < GridSize; y++)
+    {
+        if (y % GroupRowCount == 0)
+        {
+            obj += std::format("g Rows{}\nusemtl Material{}\ns off\n\n", y, y / GroupRowCount);
+        }
+        for (uint32_t x = 0; x < GridSize; x++)
+        {
+            uint32_t a = y * rowVertexCount + x + 1;
+            uint32_t b = a + 1, c = a + rowVertexCount + 1, d = a + rowVertexCount;
+            switch ((x + y) % 4)
+            {
+            case 0:
+                obj += std::format("f {0}/{0}/1 {1}/{1}/1 {2}/{2}/1 {3}/{3}/1\n", a, b, c, d);
+                break;
+            case 1:
+                // Relative to the vertices defined so far, all of them precede the faces
+                obj += std::format("f {}/{} {}/{} {}/{}\r\n", static_cast<int64_t>(a) - vertexCount - 1, static_cast<int64_t>(a) - vertexCount - 1,
+                                   static_cast<int64_t>(b) - vertexCount - 1, static_cast<int64_t>(b) - vertexCount - 1,
+                                   static_cast<int64_t>(c) - vertexCount - 1, static_cast<int64_t>(c) - vertexCount - 1);
+                obj += std::format("f\t{0}/{0}  {1}/{1}\t{2}/{2}\n", a, c, d);
+                break;
+            case 2:
+                obj += std::format("f {}//1 {}//1 {}//1 {}//1\n", a, b, c, d);
+                break;
+            default:
+                // A pentagon through the quad's centre edge, fan triangulated
+                obj += std::format("f {0}/{0} {1}/{1} {2}/{2} {3}/{3} {0}/{4}\n", a, b, c, d, c);
+                break;
+            }
+        }
+    }
+    return obj;
+}
+
+int64_t ParseIndex(std::string_view token, uint32_t definedCount)
+{
+    int64_t index = std::strtoll(AnsiString(token).c_str(), nullptr, 10);
+    return index > 0 ? index - 1 : static_cast<int64_t>(definedCount) + index;
+}
+
+// Line by line in file order, the same output the importer documents: fan triangulation,
+// v flipped, white color and unique vertices in the order of their first corner
+void ReferenceImport(In<AnsiString> obj, Ref<std::vector<MeshVertex>> vertices, Ref<std::vector<uint32_t>> indices)
+{
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> texcoords;
+    std::vector<MeshVertex> corners;
+    size_t begin = 0;
+    while (begin < obj.size())
+    {
+        size_t end = obj.find('\n', begin);
+        end = end == AnsiString::npos ? obj.size() : end;
+        AnsiString line = obj.substr(begin, end - begin);
+        begin = end + 1;
+        std::replace(line.begin(), line.end(), '\t', ' ');
+        std::erase(line, '\r');
+
+        std::vector<std::string_view> tokens;
+        std::string_view rest = line;
+        while (!rest.empty())
+        {
+            size_t tokenEnd = rest.find(' ');
+            if (tokenEnd != 0)
+            {
+                tokens.emplace_back(rest.substr(0, tokenEnd));
+            }
+            rest = tokenEnd == std::string_view::npos ? std::string_view() : rest.substr(tokenEnd + 1);
+        }
+        if (tokens.empty())
+        {
+            continue;
+        }
+        auto toFloat = [&](size_t i) { return std::strtof(AnsiString(tokens[i]).c_str(), nullptr); };
+        if (tokens[0] == "v")
+        {
+            positions.emplace_back(toFloat(1), toFloat(2), toFloat(3));
+        } else if (tokens[0] == "vt")
+        {
+            texcoords.emplace_back(toFloat(1), 1.0f - toFloat(2));
+        } else if (tokens[0] == "f")
+        {
+            std::vector<MeshVertex> polygon;
+            for (size_t i = 1; i < tokens.size(); i++)
+            {
+                auto slash = tokens[i].find('/');
+                MeshVertex vertex = {};
+                vertex.position = positions[ParseIndex(tokens[i].substr(0, slash), static_cast<uint32_t>(positions.size()))];
+                vertex.color = glm::vec3(1.0f);
+                if (slash != std::string_view::npos && slash + 1 < tokens[i].size() && tokens[i][slash + 1] != '/')
+                {
+                    auto texcoord = tokens[i].substr(slash + 1, tokens[i].find('/', slash + 1) - slash - 1);
+                    vertex.texcoord = texcoords[ParseIndex(texcoord, static_cast<uint32_t>(texcoords.size()))];
+                }
+                polygon.emplace_back(vertex);
+            }
+            for (size_t i = 2; i < polygon.size(); i++)
+            {
+                corners.insert(corners.end(), { polygon[0], polygon[i - 1], polygon[i] });
+            }
+        }
+    }
+
+    std::unordered_map<AnsiString, uint32_t> uniqueVertices;
+    for (auto&& corner : corners)
+    {
+        AnsiString key(reinterpret_cast<const char*>(&corner), sizeof(MeshVertex));
+        auto [it, inserted] = uniqueVertices.try_emplace(key, static_cast<uint32_t>(vertices.size()));
+        if (inserted)
+        {
+            vertices.emplace_back(corner);
+        }
+        indices.emplace_back(it->second);
+    }
+}
+
+bool SameVertices(ArrayIn<MeshVertex> lhs, ArrayIn<MeshVertex> rhs)
+{
+    return lhs.size() == rhs.size() && std::memcmp(lhs.data(), rhs.data(), lhs.size_bytes()) == 0;
+}
+}
+
+void RunObjImporterChecks()
+{
+    auto obj = MakeObj();
+    auto path = std::filesystem::temp_directory_path() / "SnowyArkObjImporterCheck.obj";
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(obj.data(), static_cast<std::streamsize>(obj.size()));
+    }
+
+    std::vector<MeshVertex> expectedVertices, vertices;
+    std::vector<uint32_t> expectedIndices, indices;
+    ReferenceImport(obj, expectedVertices, expectedIndices);
+    bool imported = ObjImporter::Import(path, &vertices, &indices);
+    std::filesystem::remove(path);
+    Benchmark::Check(std::format(STEXT("ObjImporter {} MB OBJ, {} chunks, matches the sequential import"), obj.size() >> 20,
+                                 (obj.size() + ObjImporter::ChunkSize - 1) / ObjImporter::ChunkSize),
+                     imported && SameVertices(vertices, expectedVertices) && indices == expectedIndices);
+
+    // The same corners in another order dedup to the first-use order of that order
+    std::vector<MeshVertex> corners(expectedIndices.size());
+    for (size_t i = 0; i < corners.size(); i++)
+    {
+        corners[i] = expectedVertices[expectedIndices[i]];
+    }
+    std::shuffle(corners.begin(), corners.end(), std::mt19937(7));
+    std::vector<MeshVertex> shuffledVertices;
+    std::vector<uint32_t> shuffledIndices;
+    ObjImporter::Deduplicate(corners, &shuffledVertices, &shuffledIndices);
+    bool remapped = shuffledIndices.size() == corners.size() && shuffledVertices.size() == expectedVertices.size();
+    uint32_t nextVertex = 0;
+    for (size_t i = 0; remapped && i < corners.size(); i++)
+    {
+        remapped = shuffledIndices[i] <= nextVertex && std::memcmp(&shuffledVertices[shuffledIndices[i]], &corners[i], sizeof(MeshVertex)) == 0;
+        nextVertex += shuffledIndices[i] == nextVertex ? 1 : 0;
+    }
+    Benchmark::Check(STEXT("ObjImporter::Deduplicate of shuffled corners, first-use order"), remapped);
+
+    // Neighbouring grid vertices differ in a few low bits, a weak hash collides on them
+    std::unordered_set<uint64_t> hashes;
+    for (uint32_t i = 0; i < HashVertexCount; i++)
+    {
+        MeshVertex vertex = {};
+        vertex.position = glm::vec3(static_cast<float>(i % 1000), static_cast<float>(i / 1000), 0.0f);
+        vertex.color = glm::vec3(1.0f);
+        vertex.texcoord = glm::vec2(static_cast<float>(i % 1000) / 1000.0f, static_cast<float>(i / 1000) / 1000.0f);
+        hashes.emplace(ObjImporter::HashVertex(vertex));
+    }
+    Benchmark::Check(STEXT("ObjImporter::HashVertex has no collision on 200k grid vertices"), hashes.size() == HashVertexCount);
+}
+}
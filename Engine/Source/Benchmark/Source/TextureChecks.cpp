@@ -0,0 +1,148 @@
+﻿#include "Engine/Source/Benchmark/Include/Benchmark.h"
+#include "Engine/Source/Runtime/Resource/AssetManager.h"
+#include "Engine/Source/Runtime/Resource/TextureAsset.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <format>
+#include <random>
+
+namespace Snowy::Ark
+{
+namespace
+{
+constexpr uint32_t ImageWidth = 300;    // not a power of two, the chain has odd sizes and a non-square tail
+constexpr uint32_t ImageHeight = 76;
+// Square, odd, non-square and 1 texel wide, the SSE2 box path covers 4 destination texels and leaves the rest to scalar
+constexpr std::array<std::array<uint32_t, 2>, 7> FilterSizes = { { { 64, 64 }, { 37, 23 }, { 128, 32 }, { 5, 130 }, { 1, 9 }, { 255, 1 }, { 3, 3 } } };
+
+// Smooth gradients with a hard edge and a checker, every mip differs from the next
+std::vector<uint8_t> MakeImage(uint32_t width, uint32_t height)
+{
+    std::vector<uint8_t> texels(size_t(width) * height * TextureFilter::BytesPerTexel);
+    for (uint32_t y = 0; y < height; y++)
+    {
+        for (uint32_t x = 0; x < width; x++)
+        {
+            auto texel = &texels[(size_t(y) * width + x) * TextureFilter::BytesPerTexel];
+            texel[0] = static_cast<uint8_t>(x * 255 / std::max(width - 1, 1u));
+            texel[1] = static_cast<uint8_t>(y * 255 / std::max(height - 1, 1u));
+            texel[2] = x < width / 3 ? 255 : ((x / 4 + y / 4) % 2 ? 200 : 40);
+            texel[3] = static_cast<uint8_t>(255 - (x + y) % 64);
+        }
+    }
+    return texels;
+}
+
+bool SameBytes(ArrayIn<uint8_t> lhs, ArrayIn<uint8_t> rhs)
+{
+    return lhs.size() == rhs.size() && std::memcmp(lhs.data(), rhs.data(), lhs.size()) == 0;
+}
+
+// Every level of the chain from both paths, each from the previous level of its own path
+bool MatchesScalar(ETextureMipFilter filter, ArrayIn<uint8_t> image, uint32_t width, uint32_t height)
+{
+    auto chain = TextureFilter::BuildMipChain(filter, image, width, height);
+    std::vector<uint8_t> level(image.begin(), image.end()), next;
+    for (auto&& mip : chain)
+    {
+        TextureFilter::DownsampleScalar(filter, level, width, height, &next);
+        if (!SameBytes(mip, next))
+        {
+            return false;
+        }
+        level.swap(next);
+        width = TextureFilter::HalfSize(width);
+        height = TextureFilter::HalfSize(height);
+    }
+    return width == 1 && height == 1;
+}
+
+bool PreservesConstant(ETextureMipFilter filter, uint32_t width, uint32_t height)
+{
+    constexpr std::array<uint8_t, TextureFilter::BytesPerTexel> Texel = { 0, 91, 200, 255 };
+    std::vector<uint8_t> image(size_t(width) * height * TextureFilter::BytesPerTexel);
+    for (size_t i = 0; i < image.size(); i++)
+    {
+        image[i] = Texel[i % TextureFilter::BytesPerTexel];
+    }
+    for (auto&& mip : TextureFilter::BuildMipChain(filter, image, width, height))
+    {
+        for (size_t i = 0; i < mip.size(); i++)
+        {
+            if (mip[i] != Texel[i % TextureFilter::BytesPerTexel])
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+}
+
+void RunTextureChecks()
+{
+    AssetManager assetMgr;
+    auto directory = std::filesystem::temp_directory_path() / "SnowyArkTextureChecks";
+    auto sourcePath = directory / "Source.png";
+    auto cookedPath = directory / "Source.rgba8.satex";
+    auto image = MakeImage(ImageWidth, ImageHeight);
+    assetMgr.SaveImage(sourcePath, image, ImageWidth, ImageHeight);
+
+    // The cooked chain is the source followed by the cooker's filter, each mip aligned for a straight copy
+    bool cooked = TextureCooker::Cook(sourcePath, cookedPath, ETextureFormat::RGBA8) && TextureCooker::IsUpToDate(sourcePath, cookedPath, ETextureFormat::RGBA8);
+    TextureAsset texture;
+    bool opened = cooked && texture.Open(cookedPath);
+    bool roundTrip = opened && texture.Format() == ETextureFormat::RGBA8 && texture.MipCount() == TextureFilter::MipCount(ImageWidth, ImageHeight) &&
+                     SameBytes(texture.MipData(0), image);
+    if (roundTrip)
+    {
+        auto chain = TextureFilter::BuildMipChain(TextureCooker::MipFilter, image, ImageWidth, ImageHeight);
+        uint32_t width = ImageWidth, height = ImageHeight;
+        uint64_t chainSize = 0;
+        for (uint32_t mip = 0; mip < texture.MipCount(); mip++)
+        {
+            auto& entry = texture.Mip(mip);
+            roundTrip &= entry.width == width && entry.height == height && entry.dataOffset % TextureFileHeader::MipAlignment == 0 &&
+                         (mip == 0 || SameBytes(texture.MipData(mip), chain[mip - 1]));
+            chainSize += entry.dataSize;
+            width = TextureFilter::HalfSize(width);
+            height = TextureFilter::HalfSize(height);
+        }
+        roundTrip &= width == 1 && height == 1 && texture.MipChainSize(0) == chainSize &&
+                     texture.MipChainSize(texture.MipCount() - 1) == TextureFilter::BytesPerTexel;
+    }
+    Benchmark::Check(std::format(STEXT("TextureCooker {}x{} RGBA8 cook and TextureAsset::Open round trip, {} mips"), ImageWidth, ImageHeight, texture.MipCount()),
+                     roundTrip);
+
+    // A changed source makes the cook stale, a truncated cook never opens
+    auto smaller = MakeImage(ImageWidth / 2, ImageHeight);
+    assetMgr.SaveImage(sourcePath, smaller, ImageWidth / 2, ImageHeight);
+    bool stale = !TextureCooker::IsUpToDate(sourcePath, cookedPath, ETextureFormat::RGBA8);
+    std::filesystem::resize_file(cookedPath, sizeof(TextureFileHeader) + 8);
+    TextureAsset truncated;
+    Benchmark::Check(STEXT("TextureCooker detects a stale cook, TextureAsset::Open rejects a truncated one"), stale && !truncated.Open(cookedPath));
+
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+
+    // Noise is the hardest input for the rounding, the SSE2 and scalar paths must still agree on every byte
+    std::mt19937 random(17);
+    std::uniform_int_distribution<uint32_t> byte(0, 255);
+    for (auto filter : { ETextureMipFilter::Box, ETextureMipFilter::Kaiser })
+    {
+        bool matches = true, constant = true;
+        for (auto [width, height] : FilterSizes)
+        {
+            std::vector<uint8_t> noise(size_t(width) * height * TextureFilter::BytesPerTexel);
+            std::generate(noise.begin(), noise.end(), [&]() { return static_cast<uint8_t>(byte(random)); });
+            matches &= MatchesScalar(filter, noise, width, height);
+            constant &= PreservesConstant(filter, width, height);
+        }
+        auto name = filter == ETextureMipFilter::Box ? STEXT("Box") : STEXT("Kaiser");
+        Benchmark::Check(std::format(STEXT("TextureFilter {} SSE2 chain matches the scalar one over {} sizes"), name, FilterSizes.size()), matches);
+        Benchmark::Check(std::format(STEXT("TextureFilter {} keeps a constant image"), name), constant);
+    }
+}
+}
@@ -0,0 +1,53 @@
+﻿#include "Engine/Source/Benchmark/Include/Benchmark.h"
+#include "Engine/Source/Runtime/Resource/TextureFilter.h"
+
+#include <format>
+#include <random>
+#include <vector>
+
+namespace Snowy::Ark
+{
+namespace
+{
+constexpr uint32_t ImageSize = 4096;
+
+uint64_t ChainBytes(In<std::vector<std::vector<uint8_t>>> chain) noexcept
+{
+    uint64_t size = 0;
+    for (auto&& mip : chain)
+    {
+        size += mip.size() + mip.back();
+    }
+    return size;
+}
+}
+
+void RunTextureFilterBenchmarks()
+{
+    std::vector<uint8_t> image(size_t(ImageSize) * ImageSize * TextureFilter::BytesPerTexel);
+    std::mt19937 random(4096);
+    for (auto&& value : image)
+    {
+        value = static_cast<uint8_t>(random());
+    }
+
+    // The whole chain of a texture the size the cooker sees, SSE2 against the scalar path it falls back to
+    for (auto filter : { ETextureMipFilter::Box, ETextureMipFilter::Kaiser })
+    {
+        auto name = filter == ETextureMipFilter::Box ? STEXT("Box") : STEXT("Kaiser");
+        Benchmark::Report(std::format(STEXT("TextureFilter {} {}x{} chain SSE2"), name, ImageSize, ImageSize), Benchmark::Measure([&]() {
+            Benchmark::Consume(ChainBytes(TextureFilter::BuildMipChain(filter, image, ImageSize, ImageSize)));
+        }));
+        Benchmark::Report(std::format(STEXT("TextureFilter {} {}x{} chain scalar"), name, ImageSize, ImageSize), Benchmark::Measure([&]() {
+            std::vector<std::vector<uint8_t>> chain;
+            uint32_t size = ImageSize;
+            for (ArrayIn<uint8_t> level = image; size > 1; size = TextureFilter::HalfSize(size))
+            {
+                TextureFilter::DownsampleScalar(filter, level, size, size, &chain.emplace_back());
+                level = chain.back();
+            }
+            Benchmark::Consume(ChainBytes(chain));
+        }));
+    }
+}
+}
@@ -0,0 +1,83 @@
+﻿#include "Engine/Source/Benchmark/Include/Benchmark.h"
+#include "Engine/Source/Runtime/Function/Scene/TransformHierarchy.h"
+
+#include <vector>
+
+namespace Snowy::Ark
+{
+namespace
+{
+constexpr uint32_t NodeCount = 100000;
+constexpr uint32_t GroupSize = 4;           // a root with a chain of children, like the groups Scene spawns
+constexpr uint32_t DirtyRootStride = 10;    // every 10th root is dirty in the partial case
+constexpr uint32_t RunCount = 20;
+
+struct HierarchyFixture
+{
+    TransformHierarchy hierarchy;
+    std::vector<TransformHierarchy::NodeId> nodes;
+    std::vector<glm::mat4> instances;
+
+    void SetLocal(uint32_t i)
+    {
+        glm::vec3 position = i % GroupSize == 0 ? glm::vec3(static_cast<float>(i), 0.0f, 0.0f) : glm::vec3(0.6f, 0.0f, 0.0f);
+        glm::quat rotation = glm::angleAxis(static_cast<float>(i) * 0.001f, glm::vec3(0.0f, 0.0f, 1.0f));
+        hierarchy.SetLocalTransform(nodes[i], position, rotation, i % GroupSize == 0 ? 1.0f : 0.8f);
+    }
+};
+
+void Build(Ref<HierarchyFixture> fixture, Ref<JobSystem> jobSys)
+{
+    fixture.nodes.resize(NodeCount);
+    fixture.instances.resize(NodeCount);
+    TransformHierarchy::NodeId parent = TransformHierarchy::NoNode;
+    for (uint32_t i = 0; i < NodeCount; i++)
+    {
+        parent = fixture.hierarchy.CreateNode(i % GroupSize == 0 ? TransformHierarchy::NoNode : parent);
+        fixture.nodes[i] = parent;
+        fixture.hierarchy.SetInstance(parent, i);
+        fixture.SetLocal(i);
+    }
+    // Sorts the nodes once, the cases only measure the transform passes
+    fixture.hierarchy.Update(jobSys);
+}
+}
+
+void RunTransformHierarchyBenchmarks(Ref<JobSystem> jobSys)
+{
+    const SString kernelNames[] = { STEXT("Scalar"), STEXT("SSE2"), STEXT("AVX") };
+    for (uint32_t kernelIndex = 0; kernelIndex < static_cast<uint32_t>(ETransformKernel::Count); kernelIndex++)
+    {
+        auto kernel = static_cast<ETransformKernel>(kernelIndex);
+        if (!TransformHierarchy::IsKernelSupported(kernel))
+        {
+            continue;
+        }
+
+        auto fixture = MakeUnique<HierarchyFixture>();
+        fixture->hierarchy.SetKernel(kernel);
+        Build(*fixture, jobSys);
+        auto update = [&]() { fixture->hierarchy.Update(jobSys); };
+        auto dirtyAll = [&]() {
+            for (uint32_t i = 0; i < NodeCount; i++)
+            {
+                fixture->SetLocal(i);
+            }
+        };
+        // Dirty roots take their whole group along
+        auto dirtySomeRoots = [&]() {
+            for (uint32_t i = 0; i < NodeCount; i += GroupSize * DirtyRootStride)
+            {
+                fixture->SetLocal(i);
+            }
+        };
+
+        const SString& name = kernelNames[kernelIndex];
+        Benchmark::Report(name + STEXT(" 100k nodes, all dirty"), Benchmark::Measure(dirtyAll, update, RunCount));
+        Benchmark::Report(name + STEXT(" 100k nodes, 10% roots dirty"), Benchmark::Measure(dirtySomeRoots, update, RunCount));
+        Benchmark::Report(name + STEXT(" 100k nodes, clean"), Benchmark::Measure(update, RunCount));
+        Benchmark::Report(name + STEXT(" 100k nodes, all dirty + instances"),
+                          Benchmark::Measure(dirtyAll, [&]() { fixture->hierarchy.Update(jobSys, fixture->instances); }, RunCount));
+    }
+}
+}
@@ -31,7 +31,7 @@ int main()
                     .frameCountInFlight = 2,
                     .vkEnableValidationLayers = true,
                     .vkValidationLayers = { "VK_LAYER_KHRONOS_validation" },
-                    .vkDeviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME },
+                    .vkDeviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME, VK_KHR_MAINTENANCE3_EXTENSION_NAME, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME },
                 },
             },
         },
@@ -4,6 +4,8 @@
 /* ---------------------------------------------------- */
 // RHI
 #define SNOWY_ARK_RHI_VULKAN
+// Profiler zones, undefine to compile every SA_PROFILE_* macro away
+#define SNOWY_ARK_PROFILE
 
 
 /* ---------------------------------------------------- */
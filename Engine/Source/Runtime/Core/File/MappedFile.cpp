@@ -0,0 +1,94 @@
+﻿#include "MappedFile.h"
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <Windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace Snowy::Ark
+{
+bool MappedFile::Open(In<std::filesystem::path> path)
+{
+    Close();
+#if defined(_WIN32)
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    LARGE_INTEGER fileSize = {};
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping)
+    {
+        CloseHandle(file);
+        return false;
+    }
+    auto data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!data)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    m_File = file;
+    m_Mapping = mapping;
+    m_Size = static_cast<size_t>(fileSize.QuadPart);
+#else
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        return false;
+    }
+    struct stat fileStat = {};
+    if (fstat(file, &fileStat) != 0 || fileStat.st_size == 0)
+    {
+        close(file);
+        return false;
+    }
+    auto data = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+    if (data == MAP_FAILED)
+    {
+        close(file);
+        return false;
+    }
+    // Read front to back by the uploads
+    madvise(data, static_cast<size_t>(fileStat.st_size), MADV_SEQUENTIAL);
+    m_File = file;
+    m_Size = static_cast<size_t>(fileStat.st_size);
+#endif
+    m_Data = static_cast<const uint8_t*>(data);
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (!m_Data)
+    {
+        return;
+    }
+#if defined(_WIN32)
+    UnmapViewOfFile(m_Data);
+    CloseHandle(m_Mapping);
+    CloseHandle(m_File);
+    m_Mapping = nullptr;
+    m_File = nullptr;
+#else
+    munmap(const_cast<uint8_t*>(m_Data), m_Size);
+    close(m_File);
+    m_File = -1;
+#endif
+    m_Data = nullptr;
+    m_Size = 0;
+}
+}
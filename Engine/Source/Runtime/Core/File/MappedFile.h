@@ -0,0 +1,39 @@
+﻿#pragma once
+#include "Engine/Source/Runtime/Core/Base/Common.h"
+
+#include <filesystem>
+
+namespace Snowy::Ark
+{
+/// <summary>
+/// Read-only memory mapping of a whole file, pages are faulted in by the OS on first access
+/// so nothing is copied until the data is actually read.
+/// </summary>
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile() { Close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile(MappedFile&&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile& operator=(MappedFile&&) = delete;
+
+    bool Open(In<std::filesystem::path> path);
+    void Close();
+
+    bool IsOpen() const noexcept { return m_Data != nullptr; }
+    const uint8_t* Data() const noexcept { return m_Data; }
+    size_t Size() const noexcept { return m_Size; }
+
+private:
+    const uint8_t* m_Data = nullptr;
+    size_t m_Size = 0;
+#if defined(_WIN32)
+    void* m_File = nullptr;
+    void* m_Mapping = nullptr;
+#else
+    int m_File = -1;
+#endif
+};
+}
@@ -0,0 +1,130 @@
+﻿#pragma once
+#include "Engine/Source/Runtime/Core/Base/Common.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace Snowy::Ark
+{
+/// <summary>
+/// Chase-Lev work stealing deque of pointers. The owning thread pushes and pops at the bottom(LIFO, what it just
+/// spawned is still in its cache), any other thread steals from the top(FIFO, the oldest and usually biggest work).
+/// A pop and a steal only contend for the last item. The ring doubles when full, the old rings are kept until the
+/// deque is destroyed since a thief may still be reading one.
+/// </summary>
+template<typename T>
+class JobDeque
+{
+    static_assert(std::is_pointer_v<T>);
+
+public:
+    static constexpr int64_t DefaultCapacity = 1024;
+
+public:
+    JobDeque() { m_Ring.store(AddRing(DefaultCapacity), std::memory_order_relaxed); }
+    ~JobDeque() = default;
+    JobDeque(const JobDeque&) = delete;
+    JobDeque(JobDeque&&) = delete;
+    JobDeque& operator=(const JobDeque&) = delete;
+    JobDeque& operator=(JobDeque&&) = delete;
+
+    // Owner thread only
+    void Push(T item)
+    {
+        int64_t bottom = m_Bottom.load(std::memory_order_relaxed);
+        int64_t top = m_Top.load(std::memory_order_acquire);
+        Ring* ring = m_Ring.load(std::memory_order_relaxed);
+        if (bottom - top >= ring->capacity)
+        {
+            ring = Grow(ring, top, bottom);
+        }
+        ring->Store(bottom, item);
+        m_Bottom.store(bottom + 1, std::memory_order_release);
+    }
+
+    // Owner thread only, null when empty
+    T Pop()
+    {
+        int64_t bottom = m_Bottom.load(std::memory_order_relaxed) - 1;
+        Ring* ring = m_Ring.load(std::memory_order_relaxed);
+        // Both seq_cst, a thief must either see the bottom taken back or lose the race for the top
+        m_Bottom.store(bottom, std::memory_order_seq_cst);
+        int64_t top = m_Top.load(std::memory_order_seq_cst);
+        if (top > bottom)
+        {
+            m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        T item = ring->Load(bottom);
+        if (top == bottom)
+        {
+            // The last item, a thief may be taking it as well
+            if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            {
+                item = nullptr;
+            }
+            m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    // Any thread, null when empty or when another thread took the item first
+    T Steal()
+    {
+        int64_t top = m_Top.load(std::memory_order_seq_cst);
+        int64_t bottom = m_Bottom.load(std::memory_order_seq_cst);
+        if (top >= bottom)
+        {
+            return nullptr;
+        }
+
+        Ring* ring = m_Ring.load(std::memory_order_acquire);
+        T item = ring->Load(top);
+        if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            return nullptr;
+        }
+        return item;
+    }
+
+    bool Empty() const noexcept
+    {
+        return m_Top.load(std::memory_order_relaxed) >= m_Bottom.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Ring
+    {
+        int64_t capacity;   // power of two
+        std::unique_ptr<std::atomic<T>[]> items;
+
+        explicit Ring(int64_t size) : capacity(size), items(new std::atomic<T>[size]) {}
+        T Load(int64_t index) const noexcept { return items[index & (capacity - 1)].load(std::memory_order_relaxed); }
+        void Store(int64_t index, T item) noexcept { items[index & (capacity - 1)].store(item, std::memory_order_relaxed); }
+    };
+
+    Ring* AddRing(int64_t capacity)
+    {
+        return m_Rings.emplace_back(MakeUnique<Ring>(capacity)).get();
+    }
+
+    Ring* Grow(Ring* ring, int64_t top, int64_t bottom)
+    {
+        Ring* bigger = AddRing(ring->capacity * 2);
+        for (int64_t i = top; i < bottom; i++)
+        {
+            bigger->Store(i, ring->Load(i));
+        }
+        m_Ring.store(bigger, std::memory_order_release);
+        return bigger;
+    }
+
+private:
+    alignas(64) std::atomic<int64_t> m_Top = 0;
+    alignas(64) std::atomic<int64_t> m_Bottom = 0;
+    std::atomic<Ring*> m_Ring = nullptr;
+    std::vector<UniqueHandle<Ring>> m_Rings;    // owner only, the current ring is the last one
+};
+}
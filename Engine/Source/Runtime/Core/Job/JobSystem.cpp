@@ -0,0 +1,380 @@
+﻿#include "Engine/Source/Runtime/Core/Job/JobSystem.h"
+#include "Engine/Source/Runtime/Core/Log/Logger.h"
+#include "Engine/Source/Runtime/Core/Profile/Profiler.h"
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <Windows.h>
+#elif defined(__linux__)
+    #include <pthread.h>
+    #include <sched.h>
+#endif
+
+#include <atomic>
+
+namespace Snowy::Ark
+{
+struct Job
+{
+    JobSystem::Task task;
+    ObserverHandle<JobCounter> counter = nullptr;
+};
+
+static thread_local uint32_t s_ThreadIndex = JobSystem::NoThreadIndex;
+// Deque of the calling thread, null on threads the job system doesn't own
+static thread_local JobDeque<Job*>* s_Deque = nullptr;
+static thread_local uint32_t s_StealSeed = 0;
+
+static void SetCurrentThreadName(In<std::string> name)
+{
+#if defined(_WIN32)
+    SetThreadDescription(GetCurrentThread(), std::wstring(name.begin(), name.end()).c_str());
+#elif defined(__linux__)
+    pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+#endif
+}
+
+static void PinCurrentThread(uint32_t hardwareThread)
+{
+#if defined(_WIN32)
+    SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << hardwareThread);
+#elif defined(__linux__)
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(hardwareThread, &cpuSet);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+#endif
+}
+
+void JobSystem::Init(In<JobSystemConfig> config)
+{
+    uint32_t hardwareThreads = std::max(std::thread::hardware_concurrency(), 2u);
+    uint32_t workerCount = config.workerCount;
+    if (workerCount == JobSystemConfig::AutoWorkerCount)
+    {
+        workerCount = hardwareThreads - 1;
+    }
+    // Beyond 64 the affinity masks run out of bits
+    m_PinWorkers = config.pinWorkers && workerCount < std::min(hardwareThreads, 64u);
+    m_ProfileJobs = config.profileJobs;
+
+    m_Stop.store(false, std::memory_order_relaxed);
+    m_Deques.reserve(workerCount + 1);
+    for (uint32_t i = 0; i <= workerCount; i++)
+    {
+        m_Deques.emplace_back(MakeUnique<JobDeque<Job*>>());
+    }
+    s_ThreadIndex = 0;
+    s_Deque = m_Deques.front().get();
+
+    m_Workers.reserve(workerCount);
+    for (uint32_t i = 0; i < workerCount; i++)
+    {
+        m_Workers.emplace_back(&JobSystem::WorkerLoop, this, i + 1);
+    }
+    SA_LOG_INFO("Job System Initialized, {} worker threads{}.", workerCount, m_PinWorkers ? ", pinned" : "");
+}
+
+void JobSystem::Destory()
+{
+    {
+        std::scoped_lock lock(m_Mutex);
+        m_Stop.store(true, std::memory_order_relaxed);
+    }
+    m_WorkerCondition.notify_all();
+    for (auto&& worker : m_Workers)
+    {
+        worker.join();
+    }
+    m_Workers.clear();
+    m_Deques.clear();
+    s_ThreadIndex = NoThreadIndex;
+    s_Deque = nullptr;
+}
+
+uint32_t JobSystem::ThreadIndex() noexcept
+{
+    return s_ThreadIndex;
+}
+
+void JobSystem::Submit(Task task, ObserverHandle<JobCounter> counter)
+{
+    if (counter)
+    {
+        counter->m_Pending.fetch_add(1, std::memory_order_relaxed);
+    }
+    Push(MakeUnique<Job>(Job{ std::move(task), counter }).release());
+}
+
+void JobSystem::SubmitAfter(Ref<JobCounter> dependency, Task task, ObserverHandle<JobCounter> counter)
+{
+    if (counter)
+    {
+        counter->m_Pending.fetch_add(1, std::memory_order_relaxed);
+    }
+    Job* job = MakeUnique<Job>(Job{ std::move(task), counter }).release();
+    {
+        std::scoped_lock lock(dependency.m_Mutex);
+        if (dependency.m_Pending.load(std::memory_order_acquire) > 0)
+        {
+            dependency.m_Dependents.emplace_back(job);
+            return;
+        }
+    }
+    Push(job);
+}
+
+void JobSystem::Wait(Ref<JobCounter> counter)
+{
+    WaitUntil([&counter]() { return counter.IsDone(); });
+    // The last job may still be releasing the dependents, the counter can go once it has
+    std::scoped_lock lock(counter.m_Mutex);
+}
+
+void JobSystem::ParallelFor(uint32_t count, uint32_t grainSize, In<RangeTask> func)
+{
+    if (grainSize == AutoGrainSize)
+    {
+        grainSize = count / (ThreadCount() * RangesPerThread);
+    }
+    grainSize = std::max(grainSize, 1u);
+    uint32_t rangeCount = (count + grainSize - 1) / grainSize;
+    if (rangeCount <= 1 || m_Workers.empty())
+    {
+        for (uint32_t i = 0; i < rangeCount; i++)
+        {
+            func(i * grainSize, std::min(count, (i + 1) * grainSize));
+        }
+        return;
+    }
+
+    // Ranges are claimed as threads free up instead of being dealt out up front, a thread
+    // slowed down by other work just claims fewer of them
+    std::atomic<uint32_t> nextRange = 0;
+    auto runRanges = [&]() {
+        for (uint32_t i = nextRange.fetch_add(1, std::memory_order_relaxed); i < rangeCount; i = nextRange.fetch_add(1, std::memory_order_relaxed))
+        {
+            func(i * grainSize, std::min(count, (i + 1) * grainSize));
+        }
+    };
+    JobCounter helpers;
+    uint32_t helperCount = std::min(rangeCount - 1, static_cast<uint32_t>(m_Workers.size()));
+    for (uint32_t i = 0; i < helperCount; i++)
+    {
+        Submit(runRanges, &helpers);
+    }
+    runRanges();
+    Wait(helpers);
+}
+
+void JobSystem::Push(Job* job)
+{
+    // Counted first, a thread that finds the count raised keeps searching until the job shows up
+    m_QueuedJobs.fetch_add(1, std::memory_order_seq_cst);
+    if (s_Deque && s_ThreadIndex < m_Deques.size() && s_Deque == m_Deques[s_ThreadIndex].get())
+    {
+        s_Deque->Push(job);
+    } else
+    {
+        std::scoped_lock lock(m_Mutex);
+        m_SharedJobs.emplace_back(job);
+        m_SharedJobCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Taking the lock orders the push against a sleeper checking its predicate. Any worker can run the job, the
+    // waiters only need it when every worker is busy and may be waiting itself
+    if (m_SleepingWorkers.load(std::memory_order_seq_cst) > 0)
+    {
+        {
+            std::scoped_lock lock(m_Mutex);
+        }
+        m_WorkerCondition.notify_one();
+    } else if (m_SleepingWaiters.load(std::memory_order_seq_cst) > 0)
+    {
+        {
+            std::scoped_lock lock(m_Mutex);
+        }
+        m_WaiterCondition.notify_all();
+    }
+}
+
+Job* JobSystem::FindJob()
+{
+    Job* job = nullptr;
+    if (s_Deque && s_ThreadIndex < m_Deques.size() && s_Deque == m_Deques[s_ThreadIndex].get())
+    {
+        job = s_Deque->Pop();
+    }
+    if (!job && m_SharedJobCount.load(std::memory_order_relaxed) > 0)
+    {
+        std::scoped_lock lock(m_Mutex);
+        if (!m_SharedJobs.empty())
+        {
+            job = m_SharedJobs.front();
+            m_SharedJobs.pop_front();
+            m_SharedJobCount.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+    if (!job && s_Deque)
+    {
+        job = StealJob();
+    }
+    if (job)
+    {
+        m_QueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+Job* JobSystem::StealJob()
+{
+    // Victims start at a random deque so thieves spread out
+    uint32_t dequeCount = static_cast<uint32_t>(m_Deques.size());
+    s_StealSeed = s_StealSeed * 1664525u + 1013904223u + s_ThreadIndex;
+    uint32_t first = (s_StealSeed >> 16) % dequeCount;
+    for (uint32_t i = 0; i < dequeCount; i++)
+    {
+        auto& victim = *m_Deques[(first + i) % dequeCount];
+        if (&victim == s_Deque || victim.Empty())
+        {
+            continue;
+        }
+        if (Job* job = victim.Steal())
+        {
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+void JobSystem::RunJob(Job* job)
+{
+    UniqueHandle<Job> ownedJob(job);
+    if (m_ProfileJobs)
+    {
+        SA_PROFILE_SCOPE("Job");
+        ownedJob->task();
+    } else
+    {
+        ownedJob->task();
+    }
+    if (ownedJob->counter)
+    {
+        FinishJob(*ownedJob->counter);
+    }
+}
+
+void JobSystem::FinishJob(Ref<JobCounter> counter)
+{
+    uint32_t pending = counter.m_Pending.load(std::memory_order_relaxed);
+    while (pending > 1)
+    {
+        if (counter.m_Pending.compare_exchange_weak(pending, pending - 1, std::memory_order_acq_rel, std::memory_order_relaxed))
+        {
+            return;
+        }
+    }
+
+    std::vector<Job*> dependents;
+    bool done = false;
+    {
+        std::scoped_lock lock(counter.m_Mutex);
+        if (counter.m_Pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            dependents.swap(counter.m_Dependents);
+            done = true;
+        }
+    }
+    for (auto&& dependent : dependents)
+    {
+        Push(dependent);
+    }
+    if (done)
+    {
+        WakeWaiters();
+    }
+}
+
+bool JobSystem::TryRunJob()
+{
+    if (Job* job = FindJob())
+    {
+        RunJob(job);
+        return true;
+    }
+    return false;
+}
+
+void JobSystem::WaitUntil(In<std::function<bool()>> isReady)
+{
+    // Jobs queued on the deques don't wake a thread that can't steal them
+    const auto& runnableJobs = s_Deque ? m_QueuedJobs : m_SharedJobCount;
+    while (!isReady())
+    {
+        if (TryRunJob())
+        {
+            continue;
+        }
+        std::unique_lock lock(m_Mutex);
+        m_SleepingWaiters.fetch_add(1, std::memory_order_seq_cst);
+        // Pairs with the fence in WakeWaiters, either the completion is seen here or the sleeper there
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        m_WaiterCondition.wait(lock, [&]() { return isReady() || runnableJobs.load(std::memory_order_seq_cst) > 0; });
+        m_SleepingWaiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+void JobSystem::WakeWaiters()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_SleepingWaiters.load(std::memory_order_seq_cst) == 0)
+    {
+        return;
+    }
+    // Taking the lock orders the completion against a waiter checking its predicate
+    {
+        std::scoped_lock lock(m_Mutex);
+    }
+    m_WaiterCondition.notify_all();
+}
+
+void JobSystem::WorkerLoop(uint32_t threadIndex)
+{
+    s_ThreadIndex = threadIndex;
+    s_Deque = m_Deques[threadIndex].get();
+    s_StealSeed = threadIndex;
+    SetCurrentThreadName(std::format("Worker {}", threadIndex));
+    if (m_PinWorkers)
+    {
+        PinCurrentThread(threadIndex);
+    }
+
+    uint32_t idleCount = 0;
+    while (true)
+    {
+        if (TryRunJob())
+        {
+            idleCount = 0;
+            continue;
+        }
+        if (++idleCount < IdleSpinCount)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        idleCount = 0;
+        std::unique_lock lock(m_Mutex);
+        m_SleepingWorkers.fetch_add(1, std::memory_order_seq_cst);
+        m_WorkerCondition.wait(lock, [this]() {
+            return m_Stop.load(std::memory_order_relaxed) || m_QueuedJobs.load(std::memory_order_seq_cst) > 0;
+        });
+        m_SleepingWorkers.fetch_sub(1, std::memory_order_relaxed);
+        if (m_Stop.load(std::memory_order_relaxed) && m_QueuedJobs.load(std::memory_order_relaxed) == 0)
+        {
+            return;
+        }
+    }
+}
+}
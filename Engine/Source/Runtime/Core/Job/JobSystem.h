@@ -0,0 +1,246 @@
+﻿#pragma once
+#include "Engine/Source/Runtime/Core/Base/Common.h"
+#include "Engine/Source/Runtime/Function/Global/GlobalContextConfig.h"
+#include "Engine/Source/Runtime/Core/Job/JobDeque.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <variant>
+
+namespace Snowy::Ark
+{
+template<typename T>
+class JobFuture;
+
+/// <summary>
+/// Result of a job shared with its futures. The value is written once before ready is set,
+/// continuations registered before that are submitted by whichever thread completes the job.
+/// </summary>
+template<typename T>
+struct JobState
+{
+    using ValueType = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+    std::optional<ValueType> value;
+    std::atomic<bool> ready = false;
+    std::mutex mutex;   // guards continuations against the completion
+    std::vector<std::function<void()>> continuations;
+};
+
+struct Job;
+
+/// <summary>
+/// Counts the jobs submitted with it that haven't finished. Jobs submitted after a counter start once it
+/// drops to zero, so counters chain jobs into a graph without anyone blocking on them.
+/// A counter must outlive its jobs, its dependents and the waits on it.
+/// </summary>
+class JobCounter
+{
+    friend class JobSystem;
+
+public:
+    JobCounter() = default;
+    ~JobCounter() = default;
+    JobCounter(const JobCounter&) = delete;
+    JobCounter(JobCounter&&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+    JobCounter& operator=(JobCounter&&) = delete;
+
+    bool IsDone() const noexcept { return m_Pending.load(std::memory_order_acquire) == 0; }
+
+private:
+    std::atomic<uint32_t> m_Pending = 0;
+    std::mutex m_Mutex;     // the last decrement happens under it, ordered against new dependents and the end of waits
+    std::vector<Job*> m_Dependents;
+};
+
+/// <summary>
+/// Work stealing scheduler. The main thread and every worker own a Chase-Lev deque, jobs spawned on them go
+/// to their own deque and idle threads steal from the others. Threads the system doesn't own(the logic thread)
+/// submit into a shared queue. Waits run other jobs meanwhile instead of blocking the thread, and continuations
+/// (JobFuture::Then, SubmitAfter) start work once its inputs are done without any thread waiting for them.
+/// </summary>
+class JobSystem
+{
+    template<typename T>
+    friend class JobFuture;
+
+public:
+    using Task = std::function<void()>;
+    using RangeTask = std::function<void(uint32_t begin, uint32_t end)>;
+
+    static constexpr uint32_t NoThreadIndex = UINT32_MAX;
+    static constexpr uint32_t AutoGrainSize = 0;
+    static constexpr uint32_t RangesPerThread = 4;  // ranges of an automatic grain size for each thread
+    static constexpr uint32_t IdleSpinCount = 64;   // empty searches before a worker sleeps
+
+public:
+    void Init(In<JobSystemConfig> config);
+    void Destory();
+
+    // Worker threads plus the main thread, thread index 0 is always the main thread
+    uint32_t ThreadCount() const noexcept { return static_cast<uint32_t>(m_Workers.size()) + 1; }
+    // NoThreadIndex on threads the system doesn't own, they must not touch per thread resources(command pools).
+    // Such threads only run jobs from the shared queue while they wait, never the ones spawned on the owned threads
+    static uint32_t ThreadIndex() noexcept;
+    static bool IsOwnedThread() noexcept { return ThreadIndex() != NoThreadIndex; }
+
+    // counter, when given, counts the job until it has run
+    void Submit(Task task, ObserverHandle<JobCounter> counter = nullptr);
+    // Starts task once dependency drops to zero, right away when it already is
+    void SubmitAfter(Ref<JobCounter> dependency, Task task, ObserverHandle<JobCounter> counter = nullptr);
+    // Runs other jobs until counter drops to zero
+    void Wait(Ref<JobCounter> counter);
+    // Splits [0, count) into ranges of grainSize(every begin is a multiple of it) and blocks until all of
+    // them are done. Free threads claim the ranges one at a time, the calling thread runs ranges too.
+    // AutoGrainSize gives each thread RangesPerThread ranges
+    void ParallelFor(uint32_t count, uint32_t grainSize, In<RangeTask> func);
+    // Runs func on a worker, the future holds its result. func must be copyable like any task
+    template<typename F>
+    auto Async(F&& func) -> JobFuture<std::decay_t<std::invoke_result_t<std::decay_t<F>&>>>;
+
+private:
+    void WorkerLoop(uint32_t threadIndex);
+    void Push(Job* job);
+    Job* FindJob();
+    Job* StealJob();
+    void RunJob(Job* job);
+    void FinishJob(Ref<JobCounter> counter);
+    bool TryRunJob();
+    // Runs queued jobs until isReady, sleeps only while there are none so waiting from a worker can't stall the pool.
+    // Threads without a deque only run shared jobs, the ones spawned on owned threads may use per thread resources
+    void WaitUntil(In<std::function<bool()>> isReady);
+    // After a counter dropped to zero or a future got its result, only wakes threads sleeping in WaitUntil
+    void WakeWaiters();
+    // Stores the result of func, then releases the continuations and the waiters
+    template<typename T, typename F>
+    void Complete(In<SharedHandle<JobState<T>>> state, F&& func);
+
+private:
+    std::vector<std::thread> m_Workers;
+    std::vector<UniqueHandle<JobDeque<Job*>>> m_Deques;    // [0] the main thread, [i] worker i
+    bool m_PinWorkers = false;
+    bool m_ProfileJobs = false;
+
+    // Idle workers and waiting threads sleep apart, a push wakes a worker that can run any job and a
+    // completion wakes only the waiters
+    std::mutex m_Mutex;     // guards the shared queue and the sleeps
+    std::condition_variable m_WorkerCondition;
+    std::condition_variable m_WaiterCondition;
+    std::deque<Job*> m_SharedJobs;                  // from threads without a deque
+    std::atomic<uint32_t> m_SharedJobCount = 0;
+    std::atomic<uint32_t> m_QueuedJobs = 0;         // counted before the push, so it may briefly run ahead of the queues
+    std::atomic<uint32_t> m_SleepingWorkers = 0;
+    std::atomic<uint32_t> m_SleepingWaiters = 0;
+    std::atomic<bool> m_Stop = false;
+};
+
+/// <summary>
+/// Handle to the result of a job, copies share the result. Waiting runs other jobs meanwhile,
+/// so futures can be waited on from inside jobs as well as from the main thread.
+/// </summary>
+template<typename T>
+class JobFuture
+{
+public:
+    JobFuture() = default;
+    JobFuture(ObserverHandle<JobSystem> jobSys, SharedHandle<JobState<T>> state) noexcept : m_JobSys(jobSys), m_State(std::move(state)) {}
+
+    bool Valid() const noexcept { return m_State != nullptr; }
+    bool IsReady() const noexcept { return m_State->ready.load(std::memory_order_acquire); }
+
+    void Wait() const
+    {
+        if (!IsReady())
+        {
+            m_JobSys->WaitUntil([this]() { return IsReady(); });
+        }
+    }
+
+    // Waits for the result, it can be moved out
+    auto& Get() const requires (!std::is_void_v<T>)
+    {
+        Wait();
+        return *m_State->value;
+    }
+
+    // Runs func with the result(nothing for void) on a worker once it is ready
+    template<typename F>
+    auto Then(F&& func) const
+    {
+        using ResultType = std::decay_t<decltype(InvokeWithResult(func, std::declval<Ref<JobState<T>>>()))>;
+        auto next = MakeShared<JobState<ResultType>>();
+        JobSystem::Task task = [jobSys = m_JobSys, state = m_State, next, func = std::forward<F>(func)]() mutable {
+            jobSys->Complete(next, [&]() -> decltype(auto) { return InvokeWithResult(func, *state); });
+        };
+        {
+            std::scoped_lock lock(m_State->mutex);
+            if (!m_State->ready.load(std::memory_order_relaxed))
+            {
+                m_State->continuations.emplace_back(std::move(task));
+                return JobFuture<ResultType>(m_JobSys, std::move(next));
+            }
+        }
+        m_JobSys->Submit(std::move(task));
+        return JobFuture<ResultType>(m_JobSys, std::move(next));
+    }
+
+private:
+    template<typename F>
+    static decltype(auto) InvokeWithResult(Ref<F> func, Ref<JobState<T>> state)
+    {
+        if constexpr (std::is_void_v<T>)
+        {
+            return func();
+        } else
+        {
+            return func(*state.value);
+        }
+    }
+
+private:
+    ObserverHandle<JobSystem> m_JobSys = nullptr;
+    SharedHandle<JobState<T>> m_State;
+};
+
+template<typename F>
+auto JobSystem::Async(F&& func) -> JobFuture<std::decay_t<std::invoke_result_t<std::decay_t<F>&>>>
+{
+    using ResultType = std::decay_t<std::invoke_result_t<std::decay_t<F>&>>;
+    auto state = MakeShared<JobState<ResultType>>();
+    Submit([this, state, func = std::forward<F>(func)]() mutable {
+        Complete(state, func);
+    });
+    return JobFuture<ResultType>(this, std::move(state));
+}
+
+template<typename T, typename F>
+void JobSystem::Complete(In<SharedHandle<JobState<T>>> state, F&& func)
+{
+    if constexpr (std::is_void_v<T>)
+    {
+        func();
+        state->value.emplace();
+    } else
+    {
+        state->value.emplace(func());
+    }
+
+    std::vector<Task> continuations;
+    {
+        std::scoped_lock lock(state->mutex);
+        state->ready.store(true, std::memory_order_release);
+        continuations.swap(state->continuations);
+    }
+    for (auto&& continuation : continuations)
+    {
+        Submit(std::move(continuation));
+    }
+    WakeWaiters();
+}
+}
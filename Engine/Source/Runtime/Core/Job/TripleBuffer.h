@@ -0,0 +1,45 @@
+﻿#pragma once
+#include "Engine/Source/Runtime/Core/Base/Common.h"
+
+#include <array>
+#include <atomic>
+
+namespace Snowy::Ark
+{
+/// <summary>
+/// Hands the latest value from one writer thread to one reader thread without locks or waiting. The writer
+/// fills its own slot and swaps it with the middle one on Publish, the reader swaps the middle slot in
+/// when it holds something newer, so neither side ever touches the slot the other is using.
+/// Values published between two reads are skipped, the reader only sees the newest one.
+/// </summary>
+template<typename T>
+class TripleBuffer
+{
+public:
+    // Writer thread, the slot is the writer's own until Publish
+    T& WriteSlot() noexcept { return m_Slots[m_WriteIndex]; }
+    void Publish() noexcept
+    {
+        m_WriteIndex = m_Middle.exchange(m_WriteIndex | FreshBit, std::memory_order_acq_rel) & IndexMask;
+    }
+
+    // Reader thread, the value stays untouched until the next Read
+    const T& Read() noexcept
+    {
+        if (m_Middle.load(std::memory_order_relaxed) & FreshBit)
+        {
+            m_ReadIndex = m_Middle.exchange(m_ReadIndex, std::memory_order_acq_rel) & IndexMask;
+        }
+        return m_Slots[m_ReadIndex];
+    }
+
+private:
+    static constexpr uint32_t IndexMask = 0x3;
+    static constexpr uint32_t FreshBit = 0x4;   // the middle slot was published after the last read
+
+    std::array<T, 3> m_Slots = {};
+    alignas(64) std::atomic<uint32_t> m_Middle = 1;
+    alignas(64) uint32_t m_WriteIndex = 0;
+    alignas(64) uint32_t m_ReadIndex = 2;
+};
+}
@@ -0,0 +1,337 @@
+﻿#include "Engine/Source/Runtime/Core/Profile/ProfileSystem.h"
+#include "Engine/Source/Runtime/Core/Log/Logger.h"
+#include "Engine/Source/Runtime/Core/Job/JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <fstream>
+
+namespace Snowy::Ark
+{
+void ProfileSystem::Init(In<ProfileSystemConfig> config)
+{
+    m_MainThread = std::this_thread::get_id();
+    m_StatsFrameWindow = std::max(config.statsFrameWindow, 1u);
+    m_LastFrameEnd = Now();
+    m_Enabled.store(config.enabled, std::memory_order_relaxed);
+    if (!config.enabled)
+    {
+        SA_LOG_INFO("Profile System Initialized, disabled.");
+        return;
+    }
+
+    if (!config.traceFile.empty())
+    {
+        StartTrace(config.traceFile, config.traceFrameCount);
+    }
+    SA_LOG_INFO("Profile System Initialized, stats over {} frames, trace {}.", m_StatsFrameWindow,
+                m_TraceFramesLeft > 0 ? "on" : "off");
+}
+
+void ProfileSystem::Destory()
+{
+    if (!m_Enabled.exchange(false, std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    if (m_TraceFramesLeft > 0)
+    {
+        WriteTrace();
+    }
+    LogZoneStats();
+
+    // The buffers stay alive, a thread still inside a zone may hold on to its buffer
+    std::scoped_lock lock(m_TrackMutex);
+    for (auto&& buffer : m_ThreadBuffers)
+    {
+        if (uint64_t dropped = buffer->dropped.load(std::memory_order_relaxed); dropped > 0)
+        {
+            SA_LOG_WARN("Profiler track {} dropped {} zones, the thread buffer is full.", ANSI_TO_SSTR(m_TrackNames[buffer->track]), dropped);
+        }
+    }
+}
+
+uint64_t ProfileSystem::Now() noexcept
+{
+    using namespace std::chrono;
+    return static_cast<uint64_t>(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+void ProfileSystem::RecordZone(const char* name, uint64_t begin, uint64_t end) noexcept
+{
+    if (!IsEnabled())
+    {
+        return;
+    }
+
+    ThreadBuffer* buffer = AcquireThreadBuffer();
+    uint32_t write = buffer->write.load(std::memory_order_relaxed);
+    if (write - buffer->read.load(std::memory_order_acquire) >= ThreadBufferCapacity)
+    {
+        buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    buffer->zones[write % ThreadBufferCapacity] = { name, begin, end };
+    buffer->write.store(write + 1, std::memory_order_release);
+}
+
+uint32_t ProfileSystem::RegisterTrack(std::string_view name)
+{
+    std::scoped_lock lock(m_TrackMutex);
+    m_TrackNames.emplace_back(name);
+    return static_cast<uint32_t>(m_TrackNames.size()) - 1;
+}
+
+void ProfileSystem::NameThread(std::string_view name)
+{
+    if (!IsEnabled())
+    {
+        return;
+    }
+    ThreadBuffer* buffer = AcquireThreadBuffer();
+    std::scoped_lock lock(m_TrackMutex);
+    m_TrackNames[buffer->track] = name;
+}
+
+void ProfileSystem::SubmitZones(uint32_t track, ArrayIn<ProfileZone> zones)
+{
+    for (auto&& zone : zones)
+    {
+        m_SubmittedZones.push_back({ track, zone });
+    }
+}
+
+const char* ProfileSystem::InternName(std::string_view name)
+{
+    std::scoped_lock lock(m_NameMutex);
+    return m_Names.emplace(name).first->c_str();
+}
+
+void ProfileSystem::EndFrame()
+{
+    if (!IsEnabled())
+    {
+        return;
+    }
+
+    uint64_t frameEnd = Now();
+    {
+        std::scoped_lock lock(m_TrackMutex);
+        for (auto&& buffer : m_ThreadBuffers)
+        {
+            uint32_t read = buffer->read.load(std::memory_order_relaxed);
+            uint32_t write = buffer->write.load(std::memory_order_acquire);
+            for (; read != write; read++)
+            {
+                AddZone(buffer->track, buffer->zones[read % ThreadBufferCapacity]);
+            }
+            buffer->read.store(read, std::memory_order_release);
+
+            if (!buffer->dropReported && buffer->dropped.load(std::memory_order_relaxed) > 0)
+            {
+                SA_LOG_WARN("Profiler track {} recorded more than {} zones in a frame and drops the rest.", ANSI_TO_SSTR(m_TrackNames[buffer->track]),
+                            ThreadBufferCapacity);
+                buffer->dropReported = true;
+            }
+        }
+    }
+    for (auto&& event : m_SubmittedZones)
+    {
+        AddZone(event.track, event.zone);
+    }
+    m_SubmittedZones.clear();
+
+    for (auto&& [name, total] : m_FrameTotals)
+    {
+        AddSample(name.data(), total);
+    }
+    m_FrameTotals.clear();
+    AddSample(FrameZoneName, frameEnd - m_LastFrameEnd);
+    m_LastFrameEnd = frameEnd;
+
+    if (m_TraceFramesLeft > 0 && --m_TraceFramesLeft == 0)
+    {
+        WriteTrace();
+    }
+}
+
+void ProfileSystem::StartTrace(In<std::filesystem::path> path, uint32_t frameCount)
+{
+    m_TracePath = path;
+    m_TraceFramesLeft = frameCount;
+    m_TraceStart = Now();
+    m_TraceEvents.clear();
+}
+
+std::vector<ProfileZoneStats> ProfileSystem::ZoneStats() const
+{
+    std::vector<ProfileZoneStats> stats;
+    stats.reserve(m_History.size());
+    std::vector<uint64_t> samples;
+    for (auto&& [name, history] : m_History)
+    {
+        samples.assign(history.samples.begin(), history.samples.begin() + history.count);
+        uint64_t minSample = std::ranges::min(samples);
+        uint64_t sum = 0;
+        for (auto sample : samples)
+        {
+            sum += sample;
+        }
+        // Nearest rank, the slowest sample until the window holds 100 frames
+        auto p99 = samples.begin() + (samples.size() * 99 + 99) / 100 - 1;
+        std::ranges::nth_element(samples, p99);
+
+        constexpr double NsToMs = 1e-6;
+        stats.push_back({
+            .name = name.data(),
+            .frameCount = history.count,
+            .minMs = minSample * NsToMs,
+            .avgMs = static_cast<double>(sum) / history.count * NsToMs,
+            .p99Ms = *p99 * NsToMs,
+        });
+    }
+    std::ranges::sort(stats, std::ranges::greater{}, &ProfileZoneStats::avgMs);
+    return stats;
+}
+
+uint64_t ProfileSystem::DroppedZoneCount() const
+{
+    std::scoped_lock lock(m_TrackMutex);
+    uint64_t dropped = 0;
+    for (auto&& buffer : m_ThreadBuffers)
+    {
+        dropped += buffer->dropped.load(std::memory_order_relaxed);
+    }
+    return dropped;
+}
+
+void ProfileSystem::LogZoneStats() const
+{
+    auto stats = ZoneStats();
+    if (stats.empty())
+    {
+        return;
+    }
+
+    SA_LOG_INFO("Profiler zones over the last {} frames(min / avg / p99 per frame), {} zones dropped:", m_StatsFrameWindow, DroppedZoneCount());
+    for (auto&& stat : stats)
+    {
+        SA_LOG_INFO("  {}: {:.3f} / {:.3f} / {:.3f} ms in {} frames", ANSI_TO_SSTR(std::string(stat.name)), stat.minMs, stat.avgMs, stat.p99Ms,
+                    stat.frameCount);
+    }
+}
+
+ProfileSystem::ThreadBuffer* ProfileSystem::AcquireThreadBuffer()
+{
+    // Checked against the owner so a thread outliving a profiler doesn't write into the old one
+    static thread_local ThreadBuffer* buffer = nullptr;
+    static thread_local const ProfileSystem* owner = nullptr;
+    if (owner == this)
+    {
+        return buffer;
+    }
+
+    std::string trackName;
+    if (std::this_thread::get_id() == m_MainThread)
+    {
+        trackName = "Main";
+    }
+    else if (uint32_t threadIndex = JobSystem::ThreadIndex(); threadIndex > 0 && threadIndex != JobSystem::NoThreadIndex)
+    {
+        trackName = std::format("Worker {}", threadIndex);
+    }
+
+    std::scoped_lock lock(m_TrackMutex);
+    auto& newBuffer = m_ThreadBuffers.emplace_back(MakeUnique<ThreadBuffer>());
+    newBuffer->track = static_cast<uint32_t>(m_TrackNames.size());
+    m_TrackNames.push_back(trackName.empty() ? std::format("Thread {}", newBuffer->track) : std::move(trackName));
+
+    buffer = newBuffer.get();
+    owner = this;
+    return buffer;
+}
+
+void ProfileSystem::AddZone(uint32_t track, In<ProfileZone> zone)
+{
+    m_FrameTotals[zone.name] += zone.end - zone.begin;
+    if (m_TraceFramesLeft > 0 && zone.begin >= m_TraceStart)
+    {
+        m_TraceEvents.push_back({ track, zone });
+    }
+}
+
+void ProfileSystem::AddSample(const char* name, uint64_t duration)
+{
+    // Frames a zone didn't run in are left out instead of counting as zero
+    auto& history = m_History[name];
+    if (history.samples.empty())
+    {
+        history.samples.resize(m_StatsFrameWindow);
+    }
+    history.samples[history.next] = duration;
+    history.next = (history.next + 1) % m_StatsFrameWindow;
+    history.count = std::min(history.count + 1, m_StatsFrameWindow);
+}
+
+void ProfileSystem::WriteTrace()
+{
+    m_TraceFramesLeft = 0;
+    std::error_code ec;
+    std::filesystem::create_directories(m_TracePath.parent_path(), ec);
+    std::ofstream file(m_TracePath, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        SA_LOG_WARN("Failed to write profiler trace: {}", PATH_TO_SSTR(m_TracePath));
+        m_TraceEvents.clear();
+        return;
+    }
+
+    auto writeEscaped = [&file](std::string_view text) {
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                file << '\\' << c;
+            }
+            else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                file << std::format("\\u{:04x}", static_cast<uint32_t>(c));
+            }
+            else
+            {
+                file << c;
+            }
+        }
+    };
+
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    {
+        // Names the track rows and keeps them in registration order
+        std::scoped_lock lock(m_TrackMutex);
+        for (uint32_t track = 0; track < m_TrackNames.size(); track++)
+        {
+            file << std::format("{{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":0,\"tid\":{},\"args\":{{\"sort_index\":{}}}}},\n", track, track);
+            file << std::format("{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":{},\"args\":{{\"name\":\"", track);
+            writeEscaped(m_TrackNames[track]);
+            file << (track + 1 < m_TrackNames.size() || !m_TraceEvents.empty() ? "\"}},\n" : "\"}}\n");
+        }
+    }
+    // Chrome nests the complete events of a track by time, timestamps are in microseconds
+    for (size_t i = 0; i < m_TraceEvents.size(); i++)
+    {
+        auto& event = m_TraceEvents[i];
+        file << "{\"name\":\"";
+        writeEscaped(event.zone.name);
+        file << std::format("\",\"ph\":\"X\",\"pid\":0,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}{}\n", event.track,
+                            (event.zone.begin - m_TraceStart) / 1000.0, (event.zone.end - event.zone.begin) / 1000.0,
+                            i + 1 < m_TraceEvents.size() ? "," : "");
+    }
+    file << "]}\n";
+
+    SA_LOG_INFO("Profiler trace written, {} zones: {}", m_TraceEvents.size(), PATH_TO_SSTR(m_TracePath));
+    m_TraceEvents.clear();
+    m_TraceEvents.shrink_to_fit();
+}
+}
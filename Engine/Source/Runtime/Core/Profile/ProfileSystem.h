@@ -0,0 +1,127 @@
+﻿#pragma once
+#include "Engine/Source/Runtime/Core/Base/Common.h"
+#include "Engine/Source/Runtime/Function/Global/GlobalContextConfig.h"
+
+#include <array>
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace Snowy::Ark
+{
+// Times in nanoseconds of the steady clock, name must outlive the profiler(a literal or an interned name)
+struct ProfileZone
+{
+    const char* name;
+    uint64_t begin;
+    uint64_t end;
+};
+
+struct ProfileZoneStats
+{
+    const char* name;
+    uint32_t frameCount;    // frames of the window the zone ran in
+    double minMs;
+    double avgMs;
+    double p99Ms;
+};
+
+/// <summary>
+/// Frame profiler. Every thread records its zones into its own ring buffer without locks, the main thread
+/// drains all of them at the end of the frame. Zones nest by time on their track, so a zone opened inside
+/// another shows up as its child in the trace. Tracks that aren't threads(the GPU queue) are registered by
+/// name and submit their zones from the main thread.
+/// The time each zone name took over the frame is kept for the last statsFrameWindow frames, the first
+/// traceFrameCount frames can be written as a Chrome trace(chrome://tracing or ui.perfetto.dev).
+/// </summary>
+class ProfileSystem
+{
+public:
+    static constexpr uint32_t ThreadBufferCapacity = 16384;    // zones a thread can record between two frame ends
+    static constexpr const char* FrameZoneName = "Frame";      // stat of the time between two frame ends
+
+public:
+    void Init(In<ProfileSystemConfig> config);
+    void Destory();
+
+    bool IsEnabled() const noexcept { return m_Enabled.load(std::memory_order_relaxed); }
+    static uint64_t Now() noexcept;
+
+    // Any thread, the zone is dropped when the buffer of the thread is full. EndFrame warns the first time
+    // a track drops, the stats and Destory report how many
+    void RecordZone(const char* name, uint64_t begin, uint64_t end) noexcept;
+    uint32_t RegisterTrack(std::string_view name);
+    // Names the track of the calling thread
+    void NameThread(std::string_view name);
+    // Main thread only, for the zones of a registered track
+    void SubmitZones(uint32_t track, ArrayIn<ProfileZone> zones);
+    // Returns a name that lives as long as the profiler, equal names share the pointer
+    const char* InternName(std::string_view name);
+
+    // Main thread, once per frame
+    void EndFrame();
+    // Traces the next frameCount frames, the file is written once they are done or on Destory
+    void StartTrace(In<std::filesystem::path> path, uint32_t frameCount);
+
+    std::vector<ProfileZoneStats> ZoneStats() const;
+    // Zones all threads dropped since Init, the stats are short of them
+    uint64_t DroppedZoneCount() const;
+    void LogZoneStats() const;
+
+private:
+    // Single producer ring, only the thread that owns it writes and only EndFrame reads
+    struct ThreadBuffer
+    {
+        uint32_t track = 0;
+        std::array<ProfileZone, ThreadBufferCapacity> zones;
+        std::atomic<uint32_t> write = 0;
+        std::atomic<uint32_t> read = 0;
+        std::atomic<uint64_t> dropped = 0;
+        bool dropReported = false;      // main thread
+    };
+
+    struct ZoneHistory
+    {
+        std::vector<uint64_t> samples;  // ring of frame totals
+        uint32_t next = 0;
+        uint32_t count = 0;
+    };
+
+    struct TraceEvent
+    {
+        uint32_t track;
+        ProfileZone zone;
+    };
+
+    ThreadBuffer* AcquireThreadBuffer();
+    void AddZone(uint32_t track, In<ProfileZone> zone);
+    void AddSample(const char* name, uint64_t duration);
+    void WriteTrace();
+
+private:
+    std::atomic<bool> m_Enabled = false;
+    std::thread::id m_MainThread;
+    uint32_t m_StatsFrameWindow = 0;
+
+    mutable std::mutex m_TrackMutex;   // guards the buffers and tracks against threads registering
+    std::vector<UniqueHandle<ThreadBuffer>> m_ThreadBuffers;
+    std::vector<std::string> m_TrackNames;
+
+    std::mutex m_NameMutex;
+    std::unordered_set<std::string> m_Names;
+
+    std::vector<TraceEvent> m_SubmittedZones;
+    std::unordered_map<std::string_view, uint64_t> m_FrameTotals;
+    std::unordered_map<std::string_view, ZoneHistory> m_History;
+    uint64_t m_LastFrameEnd = 0;
+
+    std::filesystem::path m_TracePath;
+    uint32_t m_TraceFramesLeft = 0;
+    uint64_t m_TraceStart = 0;
+    std::vector<TraceEvent> m_TraceEvents;
+};
+}
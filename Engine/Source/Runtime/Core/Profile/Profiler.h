@@ -0,0 +1,53 @@
+﻿#pragma once
+#include "Engine/Source/Runtime/Core/Base/Common.h"
+#include "Engine/Source/Runtime/Function/Global/GlobalContext.h"
+#include "Engine/Source/Runtime/Core/Profile/ProfileSystem.h"
+
+namespace Snowy::Ark
+{
+// Records the time between its construction and destruction as a zone of the calling thread
+class ProfileScope
+{
+public:
+    explicit ProfileScope(const char* name) noexcept
+        : m_Name(name)
+    {
+        ProfileSystem* profileSys = g_RuntimeContext.profileSys.get();
+        if (profileSys && profileSys->IsEnabled())
+        {
+            m_ProfileSys = profileSys;
+            m_Begin = ProfileSystem::Now();
+        }
+    }
+    ~ProfileScope()
+    {
+        if (m_ProfileSys)
+        {
+            m_ProfileSys->RecordZone(m_Name, m_Begin, ProfileSystem::Now());
+        }
+    }
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope(ProfileScope&&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+    ProfileScope& operator=(ProfileScope&&) = delete;
+
+private:
+    const char* m_Name;
+    ProfileSystem* m_ProfileSys = nullptr;
+    uint64_t m_Begin = 0;
+};
+}
+
+#if defined(SNOWY_ARK_PROFILE)
+    #define SA_PROFILE_CONCAT_INNER(a, b)   a##b
+    #define SA_PROFILE_CONCAT(a, b)         SA_PROFILE_CONCAT_INNER(a, b)
+
+    // name must be a literal or an interned name
+    #define SA_PROFILE_SCOPE(name)  ::Snowy::Ark::ProfileScope SA_PROFILE_CONCAT(saProfileScope, __LINE__)(name)
+
+    #define SA_PROFILE_FUNCTION()   SA_PROFILE_SCOPE(__FUNCTION__)
+#else
+    #define SA_PROFILE_SCOPE(name)
+
+    #define SA_PROFILE_FUNCTION()
+#endif  // defined(SNOWY_ARK_PROFILE)
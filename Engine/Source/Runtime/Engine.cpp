@@ -1,5 +1,6 @@
 ﻿#include "Engine.h"
 #include "Engine/Source/Runtime/Core/Log/Logger.h"
+#include "Engine/Source/Runtime/Core/Profile/Profiler.h"
 #include "Engine/Source/Runtime/Function/Global/GlobalContext.h"
 #include "Engine/Source/Runtime/Function/Window/WindowSystem.h"
 #include "Engine/Source/Runtime/Function/Rendering/RenderSystem.h"
@@ -8,17 +9,43 @@ namespace Snowy::Ark
 void Engine::Init(Ref<EngineConfig> config)
 {
     g_RuntimeContext.Init(config.runtimeGlobalContext);
+    m_Scene.Init(config.scene);
+
+    // Headless steps in lockstep with the frames, a logic thread would make the captures timing dependent
+    m_Headless = g_RuntimeContext.windowSys->IsHeadless();
+    m_LoopMode = m_Headless ? EEngineLoopMode::FixedStep : config.loopMode;
+    m_FixedDeltaTime = config.fixedDeltaTime;
+    m_FixedStepTime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<float>(config.fixedDeltaTime)).count();
+    m_MaxCatchUpSteps = std::max(config.maxCatchUpSteps, 1u);
+
+    constexpr const char* LoopModeNames[] = { "Variable", "FixedStep", "FixedStepThreaded" };
+    SA_LOG_INFO("Engine Initialized, {} loop, logic step {:.2f} ms.", LoopModeNames[static_cast<size_t>(m_LoopMode)], m_FixedDeltaTime * 1000.0f);
 }
 
 void Engine::Run()
 {
     SharedHandle windowSys = g_RuntimeContext.windowSys;
     SAssert(windowSys);
+
+    m_LogicClock = LogicClockNow();
+    PublishLogic(m_LogicState, m_LogicClock);
+    if (m_LoopMode == EEngineLoopMode::FixedStepThreaded)
+    {
+        m_LogicStop.store(false, std::memory_order_relaxed);
+        m_LogicThread = std::thread(&Engine::LogicLoop, this);
+    }
+
     while (!windowSys->ShouldClose())
     {
         const float deltaTime = CalculateDeltaTime();
         Tick(deltaTime);
     }
+
+    if (m_LogicThread.joinable())
+    {
+        m_LogicStop.store(true, std::memory_order_relaxed);
+        m_LogicThread.join();
+    }
 }
 
 void Engine::Destroy()
@@ -28,19 +55,43 @@ void Engine::Destroy()
 
 void Engine::Tick(float deltaTime)
 {
-    LogicTick(deltaTime);
+    if (m_Headless)
+    {
+        m_HeadlessClock += m_FixedStepTime;
+    }
+    int64_t now = LogicClockNow();
 
-    RenderingTick(deltaTime);
+    switch (m_LoopMode)
+    {
+        case EEngineLoopMode::Variable:
+            LogicTick(deltaTime);
+            PublishLogic(m_LogicState, now);
+            break;
+        case EEngineLoopMode::FixedStep:
+            StepLogic(now);
+            break;
+        default:
+            // The logic thread publishes on its own
+            break;
+    }
+
+    RenderingTick(SampleScene(now));
     g_RuntimeContext.windowSys->PollEvents();
+    g_RuntimeContext.profileSys->EndFrame();
 }
 
 void Engine::LogicTick(float deltaTime)
 {
+    SA_PROFILE_FUNCTION();
+    m_LogicState.Step(deltaTime);
+    std::scoped_lock lock(m_SceneMutex);
+    m_Scene.Tick(deltaTime);
 }
 
-void Engine::RenderingTick(float deltaTime)
+void Engine::RenderingTick(In<SceneRenderState> scene)
 {
-    g_RuntimeContext.renderSys->Tick();
+    SA_PROFILE_FUNCTION();
+    g_RuntimeContext.renderSys->Tick(scene);
 }
 
 float Engine::CalculateDeltaTime()
@@ -57,4 +108,67 @@ float Engine::CalculateDeltaTime()
     }
     return deltaTime;
 }
+
+void Engine::StepLogic(int64_t now)
+{
+    // Past the cap the late time is dropped, the simulation slows down instead of
+    // spiraling into ever longer catch-ups when a step costs more than it simulates
+    int64_t maxLag = m_FixedStepTime * m_MaxCatchUpSteps;
+    if (now - m_LogicClock > maxLag)
+    {
+        m_LogicClock = now - maxLag;
+    }
+    while (now - m_LogicClock >= m_FixedStepTime)
+    {
+        LogicState previous = m_LogicState;
+        LogicTick(m_FixedDeltaTime);
+        m_LogicClock += m_FixedStepTime;
+        PublishLogic(previous, m_LogicClock);
+    }
+}
+
+void Engine::PublishLogic(In<LogicState> previous, int64_t time)
+{
+    auto& snapshot = m_LogicSnapshots.WriteSlot();
+    snapshot.previous = previous;
+    snapshot.current = m_LogicState;
+    snapshot.currentTime = time;
+    m_LogicSnapshots.Publish();
+}
+
+SceneRenderState Engine::SampleScene(int64_t now)
+{
+    // One step behind the logic, so there is always a newer state to interpolate towards
+    auto& snapshot = m_LogicSnapshots.Read();
+    float alpha = std::clamp(static_cast<float>(now - snapshot.currentTime) / static_cast<float>(m_FixedStepTime), 0.0f, 1.0f);
+    auto state = SceneRenderState::Interpolate(snapshot.previous, snapshot.current, alpha);
+
+    // The instances are the newest step's, the hierarchy keeps no previous state to interpolate from
+    state.writeInstances = [this](std::span<glm::mat4> instances) {
+        std::scoped_lock lock(m_SceneMutex);
+        return m_Scene.WriteInstances(instances);
+    };
+    std::scoped_lock lock(m_SceneMutex);
+    state.instanceCount = m_Scene.InstanceCount();
+    return state;
+}
+
+void Engine::LogicLoop()
+{
+    g_RuntimeContext.profileSys->NameThread("Logic");
+    while (!m_LogicStop.load(std::memory_order_relaxed))
+    {
+        StepLogic(LogicClockNow());
+        std::this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::nanoseconds(m_LogicClock + m_FixedStepTime)));
+    }
+}
+
+int64_t Engine::LogicClockNow() const noexcept
+{
+    if (m_Headless)
+    {
+        return m_HeadlessClock;
+    }
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
 }
@@ -1,11 +1,17 @@
 ﻿#pragma once
 #include "Engine/Source/Runtime/Core/Base/Common.h"
 #include "Engine/Source/Runtime/Core/Log/LogSystem.h"
+#include "Engine/Source/Runtime/Core/Job/TripleBuffer.h"
 #include "Engine/Source/Runtime/Function/Global/GlobalContext.h"
 #include "Engine/Source/Runtime/Function/Window/WindowSystem.h"
 #include "Engine/Source/Runtime/Function/Rendering/RenderSystem.h"
+#include "Engine/Source/Runtime/Function/Logic/LogicState.h"
+#include "Engine/Source/Runtime/Function/Scene/Scene.h"
 
+#include <atomic>
 #include <chrono>
+#include <mutex>
+#include <thread>
 
 namespace Snowy::Ark
 {
@@ -18,10 +24,38 @@ public:
 private:
     void Tick(float deltaTime);
     void LogicTick(float deltaTime);
-    void RenderingTick(float deltaTime);
+    void RenderingTick(In<SceneRenderState> scene);
     float CalculateDeltaTime();
 
+    // Runs the fixed steps the logic clock is behind now, each one is published as a snapshot
+    void StepLogic(int64_t now);
+    void PublishLogic(In<LogicState> previous, int64_t time);
+    // Interpolated between the last two published states, at where now falls past the newest one
+    SceneRenderState SampleScene(int64_t now);
+    void LogicLoop();
+    int64_t LogicClockNow() const noexcept;
+
     std::chrono::steady_clock::time_point m_LastTickTimePoint = std::chrono::steady_clock::now();
+
+    EEngineLoopMode m_LoopMode = EEngineLoopMode::Variable;
+    float m_FixedDeltaTime = 0.0f;
+    int64_t m_FixedStepTime = 0;            // ns
+    uint32_t m_MaxCatchUpSteps = 0;
+
+    // Owned by whichever thread runs the logic, rendering only reads snapshots
+    LogicState m_LogicState;
+    Scene m_Scene;
+    std::mutex m_SceneMutex;                // held by a logic step and by rendering writing the scene instances
+    int64_t m_LogicClock = 0;               // ns the simulation has been stepped up to
+    TripleBuffer<LogicSnapshot> m_LogicSnapshots;
+
+    // Not a job system thread(JobSystem::NoThreadIndex), the logic may run jobs but must not touch
+    // per thread resources like the frame command pools
+    std::thread m_LogicThread;
+    std::atomic<bool> m_LogicStop = false;
+    // Headless frames advance the clock by exactly one step, the captured frames are reproducible
+    bool m_Headless = false;
+    int64_t m_HeadlessClock = 0;
 };
 }
 
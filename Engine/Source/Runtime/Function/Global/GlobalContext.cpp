@@ -1,5 +1,7 @@
 ﻿#include "GlobalContext.h"
 #include "Engine/Source/Runtime/Core/Log/LogSystem.h"
+#include "Engine/Source/Runtime/Core/Job/JobSystem.h"
+#include "Engine/Source/Runtime/Core/Profile/ProfileSystem.h"
 #include "Engine/Source/Runtime/Resource/AssetManager.h"
 #include "Engine/Source/Runtime/Function/Window/WindowSystem.h"
 #include "Engine/Source/Runtime/Function/Rendering/RenderSystem.h"
@@ -12,11 +14,24 @@ void RuntimeGlobalContext::Init(Ref<RuntimeGlobalContextConfig> config)
     logSys = MakeShared<LogSystem>();
     logSys->Init(config.logSys);
 
+    jobSys = MakeShared<JobSystem>();
+    jobSys->Init(config.jobSys);
+
     assetMgr = MakeShared<AssetManager>();
     assetMgr->Init();
 
+    // The core systems don't know the engine root
+    auto& profileSysConfig = config.profileSys;
+    if (!profileSysConfig.traceFile.empty() && std::filesystem::path(profileSysConfig.traceFile).is_relative())
+    {
+        profileSysConfig.traceFile = SA_ENGINE_PATH(profileSysConfig.traceFile);
+    }
+    profileSys = MakeShared<ProfileSystem>();
+    profileSys->Init(profileSysConfig);
+
     auto& windowSysConfig = config.windowSys;
     windowSysConfig.rhiBackend = config.renderSys.rhi.backend;
+    windowSysConfig.headless = config.renderSys.rhi.headless;
     windowSys = MakeShared<WindowSystem>();
     windowSys->Init(windowSysConfig);
 
@@ -29,7 +44,9 @@ void RuntimeGlobalContext::Destory()
 {
     renderSys->Destory();
     windowSys->Destory();
+    profileSys->Destory();
     assetMgr->Destory();
+    jobSys->Destory();
     logSys->Destory();
 }
 }
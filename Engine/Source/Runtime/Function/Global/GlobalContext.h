@@ -6,6 +6,8 @@ namespace Snowy::Ark
 class WindowSystem;
 class RenderSystem;
 class LogSystem;
+class ProfileSystem;
+class JobSystem;
 class AssetManager;
 
 struct RuntimeGlobalContext
@@ -14,6 +16,8 @@ struct RuntimeGlobalContext
     void Destory();
 
     SharedHandle<LogSystem> logSys;
+    SharedHandle<ProfileSystem> profileSys;
+    SharedHandle<JobSystem> jobSys;
     SharedHandle<AssetManager> assetMgr;
     SharedHandle<WindowSystem> windowSys;
     SharedHandle<RenderSystem> renderSys;
@@ -13,6 +13,26 @@ struct LogSystemConfig
     ELogOutputTarget outputTarget = ELogOutputTarget::Console;
 };
 
+// ProfileSystem Config
+struct ProfileSystemConfig
+{
+    bool       enabled          = true;
+    uint32_t   statsFrameWindow = 240;  // frames the min/avg/p99 of each zone are taken over
+    AnsiString traceFile;               // Chrome trace JSON of the first traceFrameCount frames, empty disables. A relative path is taken
+                                        // from the engine root, RuntimeGlobalContext resolves it before the profiler starts
+    uint32_t   traceFrameCount  = 300;
+};
+
+// JobSystem Config
+struct JobSystemConfig
+{
+    static constexpr uint32_t AutoWorkerCount = ~0u;
+
+    uint32_t workerCount = AutoWorkerCount; // one worker per hardware thread beside the main thread, 0 runs every job on the main thread
+    bool     pinWorkers  = false;           // worker i only runs on hardware thread i, the main thread is left to the OS
+    bool     profileJobs = false;           // a profiler zone per job, a frame of small jobs outgrows the profiler's thread buffers
+};
+
 // WindowSystem Config
 struct WindowSystemConfig
 {
@@ -21,6 +41,7 @@ struct WindowSystemConfig
     SString     title        = STEXT("SnowyArk");
     bool        isFullscreen = false;
     ERHIBackend rhiBackend   = ERHIBackend::Vulkan;
+    bool        headless     = false;   // no window, the framebuffer is width x height
 };
 
 // RHI Context Config
@@ -29,6 +50,25 @@ struct RHIConfig
     ERHIBackend           backend          = ERHIBackend::Vulkan;
     RawHandle<GLFWwindow> windowHandle     = nullptr;
     uint32_t              frameCountInFlight = 2;
+    uint64_t              transientBufferBudget = 4 * 1024 * 1024;   // bytes per frame in flight
+    uint64_t              uploadStagingBudget   = 32 * 1024 * 1024;  // bytes of the transfer queue staging ring
+    AnsiString            pipelineCacheFile     = "Engine/Intermediate/PipelineCache.bin"; // relative to the engine root, empty keeps it in memory
+    uint32_t              bindlessSampledImageCount  = 16384;   // descriptor capacities of the bindless heap
+    uint32_t              bindlessSamplerCount       = 256;
+    uint32_t              bindlessStorageBufferCount = 4096;
+    bool                  gpuDrivenRendering    = true;   // cull on compute and draw the scene with one indirect call
+    bool                  gpuCullingValidation  = false;  // read back the GPU visible count and compare it to the CPU reference
+    bool                  meshletCulling        = true;   // the GPU driven path culls meshlets instead of draw chunks
+    bool                  occlusionCulling      = true;   // two phase Hi-Z occlusion culling on the GPU driven path
+    float                 lodPixelError         = 1.0f;   // screen space error allowed when picking a mesh LOD, in pixels
+    bool                  textureStreaming         = true;  // stream cooked mips, otherwise the source is decoded and its mips generated at load
+    bool                  textureCompression       = true;  // cook streamed textures to BC7, or BC1 where BC7 can't be sampled
+    uint64_t              textureStreamingBudget   = 256 * 1024 * 1024; // bytes of texture mips kept resident, mip tails included
+    uint32_t              textureStreamingTailSize = 128;   // mips up to this size are loaded up front and never evicted
+    bool                  gpuProfiling             = true;  // timestamp queries around the render graph passes, on the GPU track of the profiler
+    bool                  headless                 = false; // render to offscreen images of the window size, no window, surface or swapchain
+    uint32_t              headlessFrameCount       = 0;     // frames drawn before the engine closes, 0 runs until it is closed
+    AnsiString            headlessCaptureDir;               // relative to the engine root, frames are read back and saved there as PNG, empty skips the readback
 
     // Vulkan Context Config
     bool vkEnableValidationLayers = true;
@@ -45,13 +85,25 @@ struct RenderSystemConfig
 // RuntimeGlobalContext Config
 struct RuntimeGlobalContextConfig
 {
-    LogSystemConfig    logSys;
-    WindowSystemConfig windowSys;
-    RenderSystemConfig renderSys;
+    LogSystemConfig     logSys;
+    ProfileSystemConfig profileSys;
+    JobSystemConfig     jobSys;
+    WindowSystemConfig  windowSys;
+    RenderSystemConfig  renderSys;
+};
+
+// Scene Config
+struct SceneConfig
+{
+    uint32_t entityCount = 16;      // entities with a transform and a mesh renderer drawing the whole mesh, in groups of a static root on a grid and a chain of 3 spinning children
 };
 
 struct EngineConfig
 {
     RuntimeGlobalContextConfig runtimeGlobalContext;
+    SceneConfig                scene;
+    EEngineLoopMode            loopMode        = EEngineLoopMode::FixedStepThreaded;   // headless always runs FixedStep, one step per frame
+    float                      fixedDeltaTime  = 1.0f / 60.0f;  // seconds of a logic step
+    uint32_t                   maxCatchUpSteps = 5;             // logic steps run back to back before the late time is dropped
 };
 }
@@ -27,6 +27,18 @@ enum class ELogOutputTarget : uint8_t
     Count,
 };
 
+/// <summary>
+/// How the engine loop runs logic against rendering
+/// </summary>
+enum class EEngineLoopMode : uint8_t
+{
+    Variable = 0,       // one logic tick of the frame time per frame
+    FixedStep,          // fixed logic steps on the main thread, rendering interpolates between the last two states
+    FixedStepThreaded,  // the fixed steps run on a logic thread, pipelined ahead of rendering
+    // ========
+    Count,
+};
+
 /// <summary>
 /// RHI type
 /// </summary>
@@ -86,6 +98,53 @@ enum class EVertexAttribute : uint8_t
 /// </summary>
 enum class EVertexAttributeFormat : uint8_t
 {
+    Float32x2 = 0,
+    Float32x3,
+    Float32x4,
+    Float16x2,
+    Float16x4,
+    Snorm16x2,  // octahedral normal/tangent, the tangent sign lives in the lowest bit of x
+    Unorm16x4,  // quantized position, dequantized by the mesh's position transform, w unused
+    Unorm8x4,
+    // ========
+    Count,
+};
 
+/// <summary>
+/// Texel format of cooked textures, BC formats are 4x4 blocks
+/// </summary>
+enum class ETextureFormat : uint8_t
+{
+    RGBA8 = 0,
+    BC1,    // RGB, 8 bytes per block, alpha dropped
+    BC3,    // RGBA, BC1 color and BC4 alpha, 16 bytes per block
+    BC4,    // R, 8 bytes per block
+    BC5,    // RG, two BC4 blocks, for normal maps
+    BC7,    // RGBA, 16 bytes per block
+    // ========
+    Count,
+};
+
+/// <summary>
+/// Mesh vertex stream layout
+/// </summary>
+enum class EVertexStreamLayout : uint8_t
+{
+    PositionInterleaved = 0,    // position alone in binding 0(depth/shadow passes), the rest interleaved in binding 1
+    Separate,                   // one binding per attribute
+    // ========
+    Count,
+};
+
+/// <summary>
+/// Instruction set the transform hierarchy computes world matrices with
+/// </summary>
+enum class ETransformKernel : uint8_t
+{
+    Scalar = 0,
+    SSE2,   // 4 nodes per step
+    AVX,    // 8 nodes per step, two matrix columns per instruction
+    // ========
+    Count,
 };
 }
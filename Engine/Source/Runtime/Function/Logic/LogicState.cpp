@@ -0,0 +1,35 @@
+﻿#include "Engine/Source/Runtime/Function/Logic/LogicState.h"
+
+#include <cmath>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace Snowy::Ark
+{
+static constexpr double ObjectAngularSpeed = glm::half_pi<double>();     // radians per second
+
+void LogicState::Step(float deltaTime) noexcept
+{
+    tick++;
+    time += deltaTime;
+    objectAngle = std::fmod(objectAngle + ObjectAngularSpeed * deltaTime, glm::two_pi<double>());
+}
+
+SceneRenderState SceneRenderState::Interpolate(In<LogicState> previous, In<LogicState> current, float alpha) noexcept
+{
+    // The angle wraps, interpolate the short way around
+    double angleDelta = current.objectAngle - previous.objectAngle;
+    if (angleDelta < -glm::pi<double>())
+    {
+        angleDelta += glm::two_pi<double>();
+    } else if (angleDelta > glm::pi<double>())
+    {
+        angleDelta -= glm::two_pi<double>();
+    }
+    double angle = previous.objectAngle + angleDelta * alpha;
+
+    SceneRenderState state;
+    state.objectToWorld = glm::rotate(glm::mat4(1.0f), static_cast<float>(angle), glm::vec3(0.0f, 0.0f, 1.0f));
+    return state;
+}
+}
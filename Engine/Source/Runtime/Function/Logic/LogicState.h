@@ -0,0 +1,42 @@
+﻿#pragma once
+#include "Engine/Source/Runtime/Core/Base/Common.h"
+
+#include <glm/glm.hpp>
+
+#include <functional>
+#include <span>
+
+namespace Snowy::Ark
+{
+// Everything the simulation owns. Only Step changes it, so the same steps always give the same state
+struct LogicState
+{
+    uint64_t tick = 0;
+    double time = 0.0;          // simulated seconds
+    double objectAngle = 0.0;   // radians around z, in [0, 2pi)
+
+    void Step(float deltaTime) noexcept;
+};
+
+// What rendering reads of the simulation
+struct SceneRenderState
+{
+    glm::mat4 objectToWorld = glm::mat4(1.0f);
+    // The mesh is drawn once per instance, placed by the instance's world matrix on top of objectToWorld.
+    // The renderer hands writeInstances the frame's instance range once the GPU is done with it, false when
+    // the instances no longer fit. Without it a single instance is drawn where objectToWorld puts it
+    uint32_t instanceCount = 0;
+    std::function<bool(std::span<glm::mat4>)> writeInstances;
+
+    // alpha 0 is previous, 1 is current
+    static SceneRenderState Interpolate(In<LogicState> previous, In<LogicState> current, float alpha) noexcept;
+};
+
+// Published after every logic step, rendering interpolates from previous to current
+struct LogicSnapshot
+{
+    LogicState previous;
+    LogicState current;
+    int64_t currentTime = 0;    // ns of the logic clock current belongs to
+};
+}
@@ -1,6 +1,7 @@
 ﻿#pragma once
 #include "Engine/Source/Runtime/Core/Base/Common.h"
 #include "Engine/Source/Runtime/Function/Global/GlobalContextConfig.h"
+#include "Engine/Source/Runtime/Function/Logic/LogicState.h"
 
 #if defined(SNOWY_ARK_RHI_VULKAN)
 #define SA_RHI_TRUE     VK_TRUE
@@ -25,7 +26,7 @@ public:
     RHI& operator=(RHI&&) = default;
 
     virtual void Init(In<RHIConfig> config) = 0;
-    virtual void Run() = 0;
+    virtual void Run(In<SceneRenderState> scene) = 0;
     virtual void Destory() = 0;
 
 public:
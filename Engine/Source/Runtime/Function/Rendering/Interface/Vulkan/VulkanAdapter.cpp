@@ -13,7 +13,12 @@ void VulkanAdapter::Init(ObserverHandle<OwnerType> owner, NativeType native) noe
 
 void VulkanAdapter::QueryProperties() noexcept
 {
+    m_Properties.pNext = &m_IDProperties;
+    m_IDProperties.pNext = &m_DescriptorIndexingProperties;
     m_Native.getProperties2(&m_Properties);
+    // Adapter is copied around, don't keep pointers into this instance
+    m_Properties.pNext = nullptr;
+    m_IDProperties.pNext = nullptr;
 }
 
 void VulkanAdapter::QueryQueueFamilyIndices() noexcept
@@ -22,23 +27,43 @@ void VulkanAdapter::QueryQueueFamilyIndices() noexcept
     int idx = 0;
     for (const auto& queueFamily : queueFamilies)
     {
-        if (queueFamily.queueCount > 0 && queueFamily.queueFlags & vk::QueueFlagBits::eGraphics)
+        if (queueFamily.queueCount > 0 && queueFamily.queueFlags & vk::QueueFlagBits::eGraphics && !m_QueueFamilyIndices.graphics)
         {
             m_QueueFamilyIndices.graphics = idx;
         }
 
-        vk::Bool32 presentSupport = m_Native.getSurfaceSupportKHR(idx, m_Owner->Surface()).value;
-        if (queueFamily.queueCount > 0 && presentSupport)
+        if (m_Owner->Surface())
         {
-            m_QueueFamilyIndices.present = idx;
+            vk::Bool32 presentSupport = m_Native.getSurfaceSupportKHR(idx, m_Owner->Surface()).value;
+            if (queueFamily.queueCount > 0 && presentSupport && !m_QueueFamilyIndices.present)
+            {
+                m_QueueFamilyIndices.present = idx;
+            }
         }
 
-        if (m_QueueFamilyIndices.IsComplete())
+        // Prefer the family with the fewest capabilities beside transfer, usually the DMA engine
+        constexpr auto transferExclusiveFlags = vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute;
+        if (queueFamily.queueCount > 0 && queueFamily.queueFlags & vk::QueueFlagBits::eTransfer)
         {
-            break;
+            bool isDedicated = !(queueFamily.queueFlags & transferExclusiveFlags);
+            bool isAsync = !(queueFamily.queueFlags & vk::QueueFlagBits::eGraphics);
+            auto& current = m_QueueFamilyIndices.transfer;
+            bool currentIsDedicated = current && !(queueFamilies[*current].queueFlags & transferExclusiveFlags);
+            if ((isDedicated && !currentIsDedicated) || (isAsync && !current))
+            {
+                current = idx;
+            }
         }
         idx++;
     }
+    if (!m_QueueFamilyIndices.transfer)
+    {
+        m_QueueFamilyIndices.transfer = m_QueueFamilyIndices.graphics;
+    }
+    if (!m_Owner->Surface())
+    {
+        m_QueueFamilyIndices.present = m_QueueFamilyIndices.graphics;
+    }
 }
 
 SwapchainSupportDetails VulkanAdapter::QuerySwapchainSupportDetails() const noexcept
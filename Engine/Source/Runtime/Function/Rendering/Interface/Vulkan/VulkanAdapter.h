@@ -6,7 +6,8 @@ namespace Snowy::Ark
 struct QueueFamilyIndices
 {
     std::optional<uint32_t> graphics;
-    std::optional<uint32_t> present;
+    std::optional<uint32_t> present;    // graphics when headless, nothing is presented
+    std::optional<uint32_t> transfer;   // dedicated transfer family if any, falls back to graphics
 
     bool IsComplete() const noexcept
     {
@@ -51,6 +52,8 @@ public:
 
     auto& Properties(this auto&& self) noexcept { return self.m_Properties.properties; }
     auto& Properties2(this auto&& self) noexcept { return self.m_Properties; }
+    auto& IDProperties(this auto&& self) noexcept { return self.m_IDProperties; }
+    auto& DescriptorIndexingProperties(this auto&& self) noexcept { return self.m_DescriptorIndexingProperties; }
     auto& GetQueueFamilyIndices(this auto&& self) noexcept { return self.m_QueueFamilyIndices; }
 
     SwapchainSupportDetails QuerySwapchainSupportDetails() const noexcept;
@@ -66,6 +69,8 @@ private:
     ObserverHandle<VulkanRHI> m_Ctx;
 
     vk::PhysicalDeviceProperties2 m_Properties;
+    vk::PhysicalDeviceIDProperties m_IDProperties;
+    vk::PhysicalDeviceDescriptorIndexingPropertiesEXT m_DescriptorIndexingProperties;
     QueueFamilyIndices m_QueueFamilyIndices;
 };
 }
@@ -0,0 +1,185 @@
+﻿#include "VulkanBindlessHeap.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanRHI.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanDevice.h"
+
+namespace Snowy::Ark
+{
+using Utils = VulkanUtils;
+
+void VulkanBindlessHeap::Init(ObserverHandle<OwnerType> owner, uint32_t sampledImageCount, uint32_t samplerCount, uint32_t storageBufferCount, uint32_t frameCount)
+{
+    m_Owner = owner;
+    m_Ctx = owner->Context();
+
+    auto& limits = m_Owner->Adapter().DescriptorIndexingProperties();
+    auto& sampledImages = m_Arrays[static_cast<size_t>(EVulkanBindlessType::SampledImage)];
+    sampledImages.descriptorType = vk::DescriptorType::eSampledImage;
+    sampledImages.capacity = std::min({ sampledImageCount, limits.maxDescriptorSetUpdateAfterBindSampledImages, limits.maxPerStageDescriptorUpdateAfterBindSampledImages });
+    auto& samplers = m_Arrays[static_cast<size_t>(EVulkanBindlessType::Sampler)];
+    samplers.descriptorType = vk::DescriptorType::eSampler;
+    samplers.capacity = std::min({ samplerCount, limits.maxDescriptorSetUpdateAfterBindSamplers, limits.maxPerStageDescriptorUpdateAfterBindSamplers });
+    auto& storageBuffers = m_Arrays[static_cast<size_t>(EVulkanBindlessType::StorageBuffer)];
+    storageBuffers.descriptorType = vk::DescriptorType::eStorageBuffer;
+    storageBuffers.capacity = std::min({ storageBufferCount, limits.maxDescriptorSetUpdateAfterBindStorageBuffers, limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers });
+
+    std::array<vk::DescriptorSetLayoutBinding, static_cast<size_t>(EVulkanBindlessType::Count)> bindings = {};
+    std::array<vk::DescriptorPoolSize, static_cast<size_t>(EVulkanBindlessType::Count)> poolSizes = {};
+    std::array<vk::DescriptorBindingFlags, static_cast<size_t>(EVulkanBindlessType::Count)> bindingFlags = {};
+    for (uint32_t i = 0; i < m_Arrays.size(); i++)
+    {
+        bindings[i] = vk::DescriptorSetLayoutBinding {
+            .binding = i,
+            .descriptorType = m_Arrays[i].descriptorType,
+            .descriptorCount = m_Arrays[i].capacity,
+            .stageFlags = vk::ShaderStageFlagBits::eAll,
+            .pImmutableSamplers = SA_RHI_NULL,
+        };
+        poolSizes[i] = vk::DescriptorPoolSize {
+            .type = m_Arrays[i].descriptorType,
+            .descriptorCount = m_Arrays[i].capacity,
+        };
+        // Unused slots are never valid, slots are written while the set is bound by in-flight frames
+        bindingFlags[i] = vk::DescriptorBindingFlagBits::ePartiallyBound | vk::DescriptorBindingFlagBits::eUpdateAfterBind |
+                          vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending;
+    }
+
+    vk::DescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo = {
+        .bindingCount = SA_VK_NUM(bindingFlags.size()),
+        .pBindingFlags = bindingFlags.data(),
+    };
+    vk::DescriptorSetLayoutCreateInfo layoutInfo = {
+        .pNext = &bindingFlagsInfo,
+        .flags = vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool,
+    };
+    layoutInfo.setBindings(bindings);
+    Utils::VerifyResult(m_Owner->Native().createDescriptorSetLayout(layoutInfo), STEXT("Failed to create bindless descriptor set layout!"), &m_SetLayout);
+
+    vk::DescriptorPoolCreateInfo poolInfo = {
+        .flags = vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind,
+        .maxSets = 1,
+        .poolSizeCount = SA_VK_NUM(poolSizes.size()),
+        .pPoolSizes = poolSizes.data(),
+    };
+    Utils::VerifyResult(m_Owner->Native().createDescriptorPool(poolInfo), STEXT("Failed to create bindless descriptor pool!"), &m_Pool);
+
+    vk::DescriptorSetAllocateInfo allocInfo = {
+        .descriptorPool = m_Pool,
+        .descriptorSetCount = 1,
+        .pSetLayouts = &m_SetLayout,
+    };
+    std::vector<vk::DescriptorSet> descriptorSets;
+    Utils::VerifyResult(m_Owner->Native().allocateDescriptorSets(allocInfo), STEXT("Failed to alloc bindless descriptor set!"), &descriptorSets);
+    m_Native = descriptorSets.front();
+
+    m_PendingReleases.resize(frameCount);
+    SA_LOG_INFO("Bindless Heap Initialized, {} sampled images, {} samplers, {} storage buffers.",
+                sampledImages.capacity, samplers.capacity, storageBuffers.capacity);
+}
+
+void VulkanBindlessHeap::Destroy()
+{
+    m_Owner->Native().destroyDescriptorPool(m_Pool);
+    m_Owner->Native().destroyDescriptorSetLayout(m_SetLayout);
+    m_PendingReleases.clear();
+    for (auto&& descriptorArray : m_Arrays)
+    {
+        descriptorArray.next = 0;
+        descriptorArray.freeIndices.clear();
+    }
+}
+
+uint32_t VulkanBindlessHeap::RegisterSampledImage(vk::ImageView view, vk::ImageLayout layout)
+{
+    auto index = AllocateIndex(EVulkanBindlessType::SampledImage);
+    vk::DescriptorImageInfo imageInfo = {
+        .sampler = SA_RHI_NULL,
+        .imageView = view,
+        .imageLayout = layout,
+    };
+    Write(EVulkanBindlessType::SampledImage, index, &imageInfo, nullptr);
+    return index;
+}
+
+uint32_t VulkanBindlessHeap::RegisterSampler(vk::Sampler sampler)
+{
+    auto index = AllocateIndex(EVulkanBindlessType::Sampler);
+    vk::DescriptorImageInfo imageInfo = {
+        .sampler = sampler,
+    };
+    Write(EVulkanBindlessType::Sampler, index, &imageInfo, nullptr);
+    return index;
+}
+
+uint32_t VulkanBindlessHeap::RegisterStorageBuffer(vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize range)
+{
+    auto index = AllocateIndex(EVulkanBindlessType::StorageBuffer);
+    vk::DescriptorBufferInfo bufferInfo = {
+        .buffer = buffer,
+        .offset = offset,
+        .range = range,
+    };
+    Write(EVulkanBindlessType::StorageBuffer, index, nullptr, &bufferInfo);
+    return index;
+}
+
+void VulkanBindlessHeap::Release(EVulkanBindlessType type, uint32_t index)
+{
+    if (index == InvalidIndex)
+    {
+        return;
+    }
+    std::scoped_lock lock(m_Mutex);
+    m_PendingReleases[m_FrameIndex].emplace_back(PendingRelease{ type, index });
+}
+
+void VulkanBindlessHeap::BeginFrame(uint32_t frameIndex)
+{
+    std::scoped_lock lock(m_Mutex);
+    m_FrameIndex = frameIndex;
+    // Released while this frame slot was last recorded, every frame that could read them has completed
+    for (auto&& release : m_PendingReleases[frameIndex])
+    {
+        m_Arrays[static_cast<size_t>(release.type)].freeIndices.emplace_back(release.index);
+    }
+    m_PendingReleases[frameIndex].clear();
+}
+
+uint32_t VulkanBindlessHeap::AllocateIndex(EVulkanBindlessType type)
+{
+    std::scoped_lock lock(m_Mutex);
+    auto& descriptorArray = m_Arrays[static_cast<size_t>(type)];
+    if (!descriptorArray.freeIndices.empty())
+    {
+        auto index = descriptorArray.freeIndices.back();
+        descriptorArray.freeIndices.pop_back();
+        return index;
+    }
+    if (descriptorArray.next == descriptorArray.capacity)
+    {
+        SA_LOG_ERROR("Bindless heap is full, capacity {}!", descriptorArray.capacity);
+        return InvalidIndex;
+    }
+    return descriptorArray.next++;
+}
+
+void VulkanBindlessHeap::Write(EVulkanBindlessType type, uint32_t index, const vk::DescriptorImageInfo* imageInfo, const vk::DescriptorBufferInfo* bufferInfo)
+{
+    if (index == InvalidIndex)
+    {
+        return;
+    }
+    vk::WriteDescriptorSet descriptorWrite = {
+        .dstSet = m_Native,
+        .dstBinding = static_cast<uint32_t>(type),
+        .dstArrayElement = index,
+        .descriptorCount = 1,
+        .descriptorType = m_Arrays[static_cast<size_t>(type)].descriptorType,
+        .pImageInfo = imageInfo,
+        .pBufferInfo = bufferInfo,
+        .pTexelBufferView = SA_RHI_NULL,
+    };
+    // Updates of the same set have to be externally synchronized
+    std::scoped_lock lock(m_Mutex);
+    m_Owner->Native().updateDescriptorSets(descriptorWrite, nullptr);
+}
+}
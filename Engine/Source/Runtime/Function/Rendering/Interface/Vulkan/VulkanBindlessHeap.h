@@ -0,0 +1,97 @@
+﻿#pragma once
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanUtils.h"
+
+#include <mutex>
+
+namespace Snowy::Ark
+{
+/// <summary>
+/// Descriptor arrays of the bindless heap, the value is the binding in the heap set
+/// </summary>
+enum class EVulkanBindlessType : uint8_t
+{
+    SampledImage = 0,
+    Sampler,
+    StorageBuffer,
+    // ========
+    Count,
+};
+
+class VulkanDevice;
+
+/// <summary>
+/// Global descriptor heap built on descriptor indexing, one update-after-bind set holding large
+/// partially bound arrays of sampled images, samplers and storage buffers.
+/// Resources are registered once and referenced by their array index(usually through push constants),
+/// the set is bound once per command buffer whatever the number of materials.
+/// Released indices are only reused once the frames that may still read them have completed.
+/// </summary>
+class VulkanBindlessHeap
+{
+public:
+    using NativeType = vk::DescriptorSet;
+    using OwnerType  = VulkanDevice;
+
+    static constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+public:
+    VulkanBindlessHeap() = default;
+    ~VulkanBindlessHeap() = default;
+    VulkanBindlessHeap(const VulkanBindlessHeap&) = delete;
+    VulkanBindlessHeap(VulkanBindlessHeap&&) = delete;
+    VulkanBindlessHeap& operator=(const VulkanBindlessHeap&) = delete;
+    VulkanBindlessHeap& operator=(VulkanBindlessHeap&&) = delete;
+
+    // Capacities are clamped to the update-after-bind limits of the device
+    void Init(ObserverHandle<OwnerType> owner, uint32_t sampledImageCount, uint32_t samplerCount, uint32_t storageBufferCount, uint32_t frameCount);
+    void Destroy();
+
+    auto& Native    () noexcept { return m_Native; }
+    auto& Native    () const noexcept { return m_Native; }
+    operator NativeType() const noexcept { return m_Native; }
+    ObserverHandle<OwnerType> Owner() const noexcept { return m_Owner; }
+    ObserverHandle<VulkanRHI> Context() const noexcept { return m_Ctx; }
+
+    vk::DescriptorSetLayout SetLayout() const noexcept { return m_SetLayout; }
+    uint32_t Capacity(EVulkanBindlessType type) const noexcept { return m_Arrays[static_cast<size_t>(type)].capacity; }
+
+    uint32_t RegisterSampledImage(vk::ImageView view, vk::ImageLayout layout = vk::ImageLayout::eShaderReadOnlyOptimal);
+    uint32_t RegisterSampler(vk::Sampler sampler);
+    uint32_t RegisterStorageBuffer(vk::Buffer buffer, vk::DeviceSize offset = 0, vk::DeviceSize range = VK_WHOLE_SIZE);
+    void Release(EVulkanBindlessType type, uint32_t index);
+
+    // Called once the fence of frameIndex has been waited on
+    void BeginFrame(uint32_t frameIndex);
+
+private:
+    struct DescriptorArray
+    {
+        vk::DescriptorType descriptorType;
+        uint32_t capacity = 0;
+        uint32_t next = 0;
+        std::vector<uint32_t> freeIndices;
+    };
+    struct PendingRelease
+    {
+        EVulkanBindlessType type;
+        uint32_t index;
+    };
+
+    uint32_t AllocateIndex(EVulkanBindlessType type);
+    void Write(EVulkanBindlessType type, uint32_t index, const vk::DescriptorImageInfo* imageInfo, const vk::DescriptorBufferInfo* bufferInfo);
+
+private:
+    NativeType m_Native;
+    ObserverHandle<OwnerType> m_Owner;
+    ObserverHandle<VulkanRHI> m_Ctx;
+
+    vk::DescriptorPool m_Pool;
+    vk::DescriptorSetLayout m_SetLayout;
+
+    std::array<DescriptorArray, static_cast<size_t>(EVulkanBindlessType::Count)> m_Arrays;
+    std::vector<std::vector<PendingRelease>> m_PendingReleases;    // per frame in flight
+    uint32_t m_FrameIndex = 0;
+
+    std::mutex m_Mutex;
+};
+}
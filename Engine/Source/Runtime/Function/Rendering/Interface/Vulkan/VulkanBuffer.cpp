@@ -6,10 +6,12 @@ namespace Snowy::Ark
 {
 using Utils = VulkanUtils;
 
-void VulkanBuffer::Init(ObserverHandle<OwnerType> owner, vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties)
+void VulkanBuffer::Init(ObserverHandle<OwnerType> owner, vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties,
+                        EVulkanAllocationStrategy strategy)
 {
     m_Owner = owner;
     m_Ctx = owner->Context();
+    m_Size = size;
 
     vk::BufferCreateInfo bufferInfo = {
         .size = size,
@@ -20,16 +22,12 @@ void VulkanBuffer::Init(ObserverHandle<OwnerType> owner, vk::DeviceSize size, vk
 
     vk::MemoryRequirements memRequirements;
     m_Owner->Native().getBufferMemoryRequirements(m_Native, &memRequirements);
-    vk::MemoryAllocateInfo allocInfo = {
-        .allocationSize = memRequirements.size,
-        .memoryTypeIndex = m_Owner->FindMemoryType(memRequirements.memoryTypeBits, properties),
-    };
-    Utils::VerifyResult(m_Owner->Native().allocateMemory(allocInfo), STEXT("Failed to allocate vertex buffer memory!"), &m_Memory);
-    Utils::VerifyResult(m_Owner->Native().bindBufferMemory(m_Native, m_Memory, 0), STEXT("Failed to bind vertex buffer memory!"));
+    m_Allocation = m_Owner->Allocator().Allocate(memRequirements, properties, EVulkanResourceKind::Linear, strategy);
+    Utils::VerifyResult(m_Owner->Native().bindBufferMemory(m_Native, m_Allocation.memory, m_Allocation.offset), STEXT("Failed to bind buffer memory!"));
 }
 void VulkanBuffer::Destroy()
 {
     m_Owner->Native().destroyBuffer(m_Native);
-    m_Owner->Native().freeMemory(m_Memory);
+    m_Owner->Allocator().Free(m_Allocation);
 }
 }
@@ -1,5 +1,6 @@
 ﻿#pragma once
 #include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanUtils.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanMemoryAllocator.h"
 
 namespace Snowy::Ark
 {
@@ -19,7 +20,8 @@ public:
     VulkanBuffer& operator=(const VulkanBuffer&) = default;
     VulkanBuffer& operator=(VulkanBuffer&&) = default;
 
-    void Init(ObserverHandle<OwnerType> owner, vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties);
+    void Init(ObserverHandle<OwnerType> owner, vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties,
+              EVulkanAllocationStrategy strategy = EVulkanAllocationStrategy::TLSF);
     void Destroy();
 
     auto& Native    () noexcept { return m_Native; }
@@ -33,15 +35,17 @@ public:
     ObserverHandle<OwnerType> Owner() const noexcept { return m_Owner; }
     ObserverHandle<VulkanRHI> Context() const noexcept { return m_Ctx; }
 
-    const vk::DeviceMemory& Memory() const noexcept { return m_Memory; }
-
-private:
+    const vk::DeviceMemory& Memory() const noexcept { return m_Allocation.memory; }
+    vk::DeviceSize MemoryOffset() const noexcept { return m_Allocation.offset; }
+    vk::DeviceSize Size() const noexcept { return m_Size; }
+    void* MappedData() const noexcept { return m_Allocation.mappedData; }
 
 private:
     NativeType m_Native;
     ObserverHandle<OwnerType> m_Owner;
     ObserverHandle<VulkanRHI> m_Ctx;
 
-    vk::DeviceMemory m_Memory;
+    vk::DeviceSize m_Size = 0;
+    VulkanAllocation m_Allocation;
 };
 }
@@ -0,0 +1,292 @@
+﻿#include "VulkanClusterCulling.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanRHI.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanDevice.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanBindlessHeap.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanPipelineCache.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanUploadManager.h"
+#include "Engine/Source/Runtime/Resource/MeshOptimizer.h"
+
+#include <cstring>
+
+namespace Snowy::Ark
+{
+using Utils = VulkanUtils;
+
+void VulkanClusterCulling::Init(ObserverHandle<OwnerType> owner, Ref<VulkanBindlessHeap> bindlessHeap, Ref<VulkanPipelineCache> pipelineCache,
+                                Ref<VulkanUploadManager> uploadManager, vk::ShaderModule cullShader, ArrayIn<SAMeshletData> meshlets,
+                                ArrayIn<uint32_t> meshletData, uint32_t maxIndexCount, uint32_t frameCount, bool occlusion, bool validate)
+{
+    m_Owner = owner;
+    m_Ctx = owner->Context();
+    m_BindlessHeap = &bindlessHeap;
+    m_Meshlets.assign(meshlets.begin(), meshlets.end());
+    m_Occlusion = occlusion;
+    m_Validate = validate;
+
+    vk::DeviceSize meshletBufferSize = std::max<vk::DeviceSize>(sizeof(SAMeshletData) * m_Meshlets.size(), sizeof(SAMeshletData));
+    m_MeshletBuffer = m_Owner->CreateBuffer(meshletBufferSize, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                                            vk::MemoryPropertyFlagBits::eDeviceLocal);
+    vk::DeviceSize meshletDataBufferSize = std::max<vk::DeviceSize>(sizeof(uint32_t) * meshletData.size(), sizeof(uint32_t));
+    m_MeshletDataBuffer = m_Owner->CreateBuffer(meshletDataBufferSize, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                                                vk::MemoryPropertyFlagBits::eDeviceLocal);
+    if (!m_Meshlets.empty())
+    {
+        uploadManager.UploadBuffer(*m_MeshletBuffer, m_Meshlets.data(), sizeof(SAMeshletData) * m_Meshlets.size(), 0,
+                                   vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderRead);
+        uploadManager.UploadBuffer(*m_MeshletDataBuffer, meshletData.data(), sizeof(uint32_t) * meshletData.size(), 0,
+                                   vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderRead);
+    }
+
+    m_OutputBuffer = m_Owner->CreateBuffer(IndexDataOffset + sizeof(uint32_t) * maxIndexCount,
+                                           vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer |
+                                           vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst |
+                                           vk::BufferUsageFlagBits::eTransferSrc,
+                                           vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+    m_MeshletBufferIndex = bindlessHeap.RegisterStorageBuffer(*m_MeshletBuffer);
+    m_MeshletDataBufferIndex = bindlessHeap.RegisterStorageBuffer(*m_MeshletDataBuffer);
+    m_OutputBufferIndex = bindlessHeap.RegisterStorageBuffer(*m_OutputBuffer);
+
+    // Each slice is registered on its own, the shader keeps reading a single view
+    vk::DeviceSize storageAlignment = std::max<vk::DeviceSize>(m_Owner->Adapter().Properties().limits.minStorageBufferOffsetAlignment, 16);
+    m_ViewStride = (sizeof(SACullView) + storageAlignment - 1) & ~(storageAlignment - 1);
+    m_ViewBuffers.resize(frameCount);
+    m_ViewBufferIndices.resize(frameCount * MaxCullsPerFrame);
+    m_CullCounts.assign(frameCount, 0);
+    for (uint32_t i = 0; i < frameCount; i++)
+    {
+        m_ViewBuffers[i] = m_Owner->CreateBuffer(m_ViewStride * MaxCullsPerFrame, vk::BufferUsageFlagBits::eStorageBuffer,
+                                                 vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+        for (uint32_t cull = 0; cull < MaxCullsPerFrame; cull++)
+        {
+            m_ViewBufferIndices[i * MaxCullsPerFrame + cull] = bindlessHeap.RegisterStorageBuffer(*m_ViewBuffers[i], m_ViewStride * cull, sizeof(SACullView));
+        }
+    }
+
+    if (m_Occlusion)
+    {
+        // Nothing was visible before the first frame, its late phase tests and draws everything
+        std::vector<uint32_t> visibility(m_Meshlets.size(), 0);
+        vk::DeviceSize visibilityBufferSize = std::max<vk::DeviceSize>(sizeof(uint32_t) * visibility.size(), sizeof(uint32_t));
+        m_VisibilityBuffer = m_Owner->CreateBuffer(visibilityBufferSize, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                                                   vk::MemoryPropertyFlagBits::eDeviceLocal);
+        if (!visibility.empty())
+        {
+            uploadManager.UploadBuffer(*m_VisibilityBuffer, visibility.data(), sizeof(uint32_t) * visibility.size(), 0,
+                                       vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+        }
+        m_VisibilityBufferIndex = bindlessHeap.RegisterStorageBuffer(*m_VisibilityBuffer);
+    }
+
+    if (m_Validate)
+    {
+        m_ReadbackBuffers.resize(frameCount);
+        for (auto&& readbackBuffer : m_ReadbackBuffers)
+        {
+            // An index count per cull
+            readbackBuffer = m_Owner->CreateBuffer(sizeof(uint32_t) * MaxCullsPerFrame, vk::BufferUsageFlagBits::eTransferDst,
+                                                   vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+            std::memset(readbackBuffer->MappedData(), 0, sizeof(uint32_t) * MaxCullsPerFrame);
+        }
+        m_CullChecks.resize(frameCount);
+    }
+
+    vk::DescriptorSetLayout setLayout = bindlessHeap.SetLayout();
+    vk::PushConstantRange pushConstantRange = {
+        .stageFlags = vk::ShaderStageFlagBits::eCompute,
+        .offset = 0,
+        .size = sizeof(SAClusterCullConstants),
+    };
+    vk::PipelineLayoutCreateInfo pipelineLayoutInfo = {
+        .setLayoutCount = 1,
+        .pSetLayouts = &setLayout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &pushConstantRange,
+    };
+    Utils::VerifyResult(m_Owner->Native().createPipelineLayout(pipelineLayoutInfo), STEXT("Failed to create cluster culling pipeline layout!"), &m_PipelineLayout);
+    m_Pipeline = pipelineCache.GetComputePipeline(VulkanComputePipelineDesc{ .shader = cullShader, .layout = m_PipelineLayout });
+
+    SA_LOG_INFO("Cluster Culling Initialized, {} meshlets, occlusion {}.", m_Meshlets.size(), m_Occlusion ? "on" : "off");
+}
+
+void VulkanClusterCulling::Destroy()
+{
+    // The pipeline belongs to the pipeline cache
+    m_Owner->Native().destroyPipelineLayout(m_PipelineLayout);
+
+    m_BindlessHeap->Release(EVulkanBindlessType::StorageBuffer, m_MeshletBufferIndex);
+    m_BindlessHeap->Release(EVulkanBindlessType::StorageBuffer, m_MeshletDataBufferIndex);
+    m_BindlessHeap->Release(EVulkanBindlessType::StorageBuffer, m_OutputBufferIndex);
+    for (auto viewBufferIndex : m_ViewBufferIndices)
+    {
+        m_BindlessHeap->Release(EVulkanBindlessType::StorageBuffer, viewBufferIndex);
+    }
+
+    m_MeshletBuffer->Destroy();
+    m_MeshletDataBuffer->Destroy();
+    m_OutputBuffer->Destroy();
+    for (auto&& viewBuffer : m_ViewBuffers)
+    {
+        viewBuffer->Destroy();
+    }
+    m_ViewBuffers.clear();
+    m_ViewBufferIndices.clear();
+    if (m_VisibilityBuffer)
+    {
+        m_BindlessHeap->Release(EVulkanBindlessType::StorageBuffer, m_VisibilityBufferIndex);
+        m_VisibilityBuffer->Destroy();
+    }
+    for (auto&& readbackBuffer : m_ReadbackBuffers)
+    {
+        readbackBuffer->Destroy();
+    }
+    m_ReadbackBuffers.clear();
+}
+
+void VulkanClusterCulling::BeginFrame(uint32_t frameIndex)
+{
+    m_CullCounts[frameIndex] = 0;
+    if (!m_Validate)
+    {
+        return;
+    }
+
+    auto cullCounts = static_cast<const uint32_t*>(m_ReadbackBuffers[frameIndex]->MappedData());
+    auto& checks = m_CullChecks[frameIndex];
+    uint32_t earlyCount = 0;
+    uint32_t earlyFirstMeshlet = UINT32_MAX;
+    for (uint32_t cull = 0; cull < checks.size(); cull++)
+    {
+        auto& check = checks[cull];
+        uint32_t gpuCount = cullCounts[cull];
+        // Occlusion only removes meshlets from the frustum and cone visible ones of the reference,
+        // the early and late phases of a range together keep at most that many indices
+        if (check.phase == ECullPhase::Late && check.firstMeshlet == earlyFirstMeshlet)
+        {
+            gpuCount += earlyCount;
+        }
+        if (check.phase == ECullPhase::Single ? gpuCount != check.referenceCount : gpuCount > check.referenceCount)
+        {
+            SA_LOG_WARN("Cluster culling mismatch in cull {}, {} indices on GPU, {} on CPU reference.", cull, gpuCount, check.referenceCount);
+        }
+        if (check.phase == ECullPhase::Early)
+        {
+            earlyCount = cullCounts[cull];
+            earlyFirstMeshlet = check.firstMeshlet;
+        }
+    }
+    checks.clear();
+}
+
+void VulkanClusterCulling::RecordCull(vk::CommandBuffer cmd, uint32_t frameIndex, In<SACullView> view, ECullPhase phase,
+                                      uint32_t firstMeshlet, uint32_t meshletCount)
+{
+    uint32_t cull = m_CullCounts[frameIndex];
+    if (cull >= MaxCullsPerFrame)
+    {
+        SA_LOG_ERROR("More than {} cluster culls in a frame, the previous result is drawn again!", MaxCullsPerFrame);
+        return;
+    }
+    m_CullCounts[frameIndex]++;
+
+    // Host coherent and the fence of the frame has been waited on. A slice per call, the
+    // dispatches of the frame only run once everything has been recorded
+    std::memcpy(static_cast<std::byte*>(m_ViewBuffers[frameIndex]->MappedData()) + m_ViewStride * cull, &view, sizeof(SACullView));
+    SAClusterCullConstants constants = {
+        .SA_FirstMeshlet = firstMeshlet,
+        .SA_MeshletCount = meshletCount,
+        .SA_MeshletBufferIndex = m_MeshletBufferIndex,
+        .SA_MeshletDataBufferIndex = m_MeshletDataBufferIndex,
+        .SA_OutputBufferIndex = m_OutputBufferIndex,
+        .SA_ViewBufferIndex = m_ViewBufferIndices[frameIndex * MaxCullsPerFrame + cull],
+        .SA_VisibilityBufferIndex = m_VisibilityBufferIndex,
+        .SA_Phase = phase,
+    };
+
+    // The previous phase's draw may still read the command and the indices
+    vk::MemoryBarrier resetBarrier = {
+        .srcAccessMask = vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eIndexRead | vk::AccessFlagBits::eTransferRead,
+        .dstAccessMask = vk::AccessFlagBits::eTransferWrite,
+    };
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexInput | vk::PipelineStageFlagBits::eTransfer,
+                        vk::PipelineStageFlagBits::eTransfer, {}, resetBarrier, nullptr, nullptr);
+    vk::DrawIndexedIndirectCommand emptyDraw = {
+        .indexCount = 0,
+        .instanceCount = 1,
+        .firstIndex = IndexDataOffset / sizeof(uint32_t),
+        .vertexOffset = 0,
+        .firstInstance = 0,
+    };
+    cmd.updateBuffer<vk::DrawIndexedIndirectCommand>(*m_OutputBuffer, 0, emptyDraw);
+
+    // The late phase of the previous frame wrote the visibility
+    vk::MemoryBarrier cullBarrier = {
+        .srcAccessMask = vk::AccessFlagBits::eTransferWrite | vk::AccessFlagBits::eShaderWrite,
+        .dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+    };
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eVertexInput | vk::PipelineStageFlagBits::eComputeShader,
+                        vk::PipelineStageFlagBits::eComputeShader, {}, cullBarrier, nullptr, nullptr);
+
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, m_Pipeline);
+    cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_PipelineLayout, 0, m_BindlessHeap->Native(), nullptr);
+    cmd.pushConstants<SAClusterCullConstants>(m_PipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, constants);
+    // A workgroup per meshlet, its invocations write the triangles
+    if (meshletCount > 0)
+    {
+        cmd.dispatch(meshletCount, 1, 1);
+    }
+
+    vk::MemoryBarrier drawBarrier = {
+        .srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+        .dstAccessMask = vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eIndexRead | vk::AccessFlagBits::eTransferRead,
+    };
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                        vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexInput | vk::PipelineStageFlagBits::eTransfer,
+                        {}, drawBarrier, nullptr, nullptr);
+
+    if (m_Validate)
+    {
+        vk::BufferCopy copyRegion = {
+            .srcOffset = 0,
+            .dstOffset = sizeof(uint32_t) * cull,
+            .size = sizeof(uint32_t),
+        };
+        cmd.copyBuffer(*m_OutputBuffer, *m_ReadbackBuffers[frameIndex], copyRegion);
+        vk::MemoryBarrier readbackBarrier = {
+            .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+            .dstAccessMask = vk::AccessFlagBits::eHostRead,
+        };
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, {}, readbackBarrier, nullptr, nullptr);
+        m_CullChecks[frameIndex].emplace_back(CullCheck {
+            .phase = phase,
+            .firstMeshlet = firstMeshlet,
+            .referenceCount = CullReference(ArrayIn<SAMeshletData>(m_Meshlets).subspan(firstMeshlet, meshletCount),
+                                            view.SA_FrustumPlanes, view.SA_CameraPosition),
+        });
+    }
+}
+
+void VulkanClusterCulling::RecordDraw(vk::CommandBuffer cmd) const
+{
+    // firstIndex of the command skips the header, the buffer is bound from its start
+    cmd.bindIndexBuffer(*m_OutputBuffer, 0, vk::IndexType::eUint32);
+    cmd.drawIndexedIndirect(*m_OutputBuffer, 0, 1, sizeof(vk::DrawIndexedIndirectCommand));
+}
+
+uint32_t VulkanClusterCulling::CullReference(ArrayIn<SAMeshletData> meshlets, In<std::array<glm::vec4, 6>> planes, glm::vec3 cameraPosition) noexcept
+{
+    uint32_t indexCount = 0;
+    for (auto&& meshlet : meshlets)
+    {
+        glm::vec3 center = glm::vec3(meshlet.SA_BoundingSphere);
+        float radius = meshlet.SA_BoundingSphere.w;
+        bool visible = std::ranges::all_of(planes, [&](const auto& plane) {
+            return glm::dot(glm::vec3(plane), center) + plane.w >= -radius;
+        });
+        // The same cone test SnowyArkBenchmark checks against the triangles
+        bool backFacing = MeshOptimizer::IsMeshletBackFacing(Meshlet { .boundingSphere = meshlet.SA_BoundingSphere, .cone = meshlet.SA_Cone }, cameraPosition);
+        indexCount += visible && !backFacing ? meshlet.SA_TriangleCount * 3 : 0;
+    }
+    return indexCount;
+}
+}
@@ -0,0 +1,122 @@
+﻿#pragma once
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanUtils.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanBuffer.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanGpuCulling.h"
+
+#include <glm/glm.hpp>
+
+namespace Snowy::Ark
+{
+// Mirrors SAMeshletData of cluster_cull.comp(std430)
+struct SAMeshletData
+{
+    glm::vec4 SA_BoundingSphere;    // mesh space center, radius in w
+    glm::vec4 SA_Cone;              // axis, cos of the cutoff in w
+    uint32_t SA_VertexOffset;       // in the meshlet data buffer
+    uint32_t SA_TriangleOffset;     // in the meshlet data buffer
+    uint32_t SA_VertexCount;
+    uint32_t SA_TriangleCount;
+};
+
+// Mirrors SAClusterCullConstants of cluster_cull.comp, the view lives in a storage buffer
+struct SAClusterCullConstants
+{
+    uint32_t SA_FirstMeshlet;
+    uint32_t SA_MeshletCount;
+    uint32_t SA_MeshletBufferIndex;
+    uint32_t SA_MeshletDataBufferIndex;
+    uint32_t SA_OutputBufferIndex;
+    uint32_t SA_ViewBufferIndex;
+    uint32_t SA_VisibilityBufferIndex;
+    ECullPhase SA_Phase;
+};
+
+class VulkanDevice;
+class VulkanBindlessHeap;
+class VulkanPipelineCache;
+class VulkanUploadManager;
+
+/// <summary>
+/// Cluster culling of the GPU driven path: a workgroup per meshlet tests its sphere against the
+/// frustum and its normal cone against the camera, the surviving triangles are compacted into an
+/// index buffer drawn by a single drawIndexedIndirect with the regular vertex/fragment pipeline.
+/// The output buffer starts with the indirect command, the indices follow at IndexDataOffset.
+/// With occlusion on, every phase rewrites the output, the draw of a phase is recorded before the next one.
+/// </summary>
+class VulkanClusterCulling
+{
+public:
+    using OwnerType = VulkanDevice;
+
+    static constexpr uint32_t GroupSize = 64;                 // local_size_x of cluster_cull.comp
+    static constexpr vk::DeviceSize IndexDataOffset = 32;     // after the DrawIndexedIndirectCommand
+    static constexpr uint32_t MaxCullsPerFrame = VulkanGpuCulling::MaxCullsPerFrame;
+
+public:
+    VulkanClusterCulling() = default;
+    ~VulkanClusterCulling() = default;
+    VulkanClusterCulling(const VulkanClusterCulling&) = delete;
+    VulkanClusterCulling(VulkanClusterCulling&&) = delete;
+    VulkanClusterCulling& operator=(const VulkanClusterCulling&) = delete;
+    VulkanClusterCulling& operator=(VulkanClusterCulling&&) = delete;
+
+    // meshletData holds the meshlet vertex indices and packed triangles the meshlets point into,
+    // maxIndexCount bounds the output, the largest LOD
+    void Init(ObserverHandle<OwnerType> owner, Ref<VulkanBindlessHeap> bindlessHeap, Ref<VulkanPipelineCache> pipelineCache,
+              Ref<VulkanUploadManager> uploadManager, vk::ShaderModule cullShader, ArrayIn<SAMeshletData> meshlets,
+              ArrayIn<uint32_t> meshletData, uint32_t maxIndexCount, uint32_t frameCount, bool occlusion, bool validate);
+    void Destroy();
+
+    ObserverHandle<OwnerType> Owner() const noexcept { return m_Owner; }
+    ObserverHandle<VulkanRHI> Context() const noexcept { return m_Ctx; }
+
+    uint32_t MeshletCount() const noexcept { return SA_VK_NUM(m_Meshlets.size()); }
+
+    // Called once the fence of frameIndex has been waited on, checks the readback of every cull of that frame
+    void BeginFrame(uint32_t frameIndex);
+    // Outside of a render pass, the view in mesh space. Each call reads its own view slice, at most MaxCullsPerFrame calls per frame.
+    // Only the meshlets of [firstMeshlet, firstMeshlet + meshletCount) are tested, e.g. those of one LOD
+    void RecordCull(vk::CommandBuffer cmd, uint32_t frameIndex, In<SACullView> view, ECullPhase phase,
+                    uint32_t firstMeshlet, uint32_t meshletCount);
+    // Inside the render pass, pipeline, vertex buffers and descriptor sets already bound, binds the compacted indices
+    void RecordDraw(vk::CommandBuffer cmd) const;
+
+    // CPU reference of cluster_cull.comp without occlusion, returns the surviving index count
+    static uint32_t CullReference(ArrayIn<SAMeshletData> meshlets, In<std::array<glm::vec4, 6>> planes, glm::vec3 cameraPosition) noexcept;
+
+private:
+    struct CullCheck
+    {
+        ECullPhase phase;
+        uint32_t firstMeshlet;
+        uint32_t referenceCount;    // surviving indices on the CPU, without occlusion
+    };
+
+    ObserverHandle<OwnerType> m_Owner;
+    ObserverHandle<VulkanRHI> m_Ctx;
+    ObserverHandle<VulkanBindlessHeap> m_BindlessHeap;
+
+    std::vector<SAMeshletData> m_Meshlets;  // kept for the CPU reference
+    UniqueHandle<VulkanBuffer> m_MeshletBuffer;
+    UniqueHandle<VulkanBuffer> m_MeshletDataBuffer;
+    UniqueHandle<VulkanBuffer> m_OutputBuffer;
+    uint32_t m_MeshletBufferIndex = UINT32_MAX;
+    uint32_t m_MeshletDataBufferIndex = UINT32_MAX;
+    uint32_t m_OutputBufferIndex = UINT32_MAX;
+
+    std::vector<UniqueHandle<VulkanBuffer>> m_ViewBuffers;      // per frame in flight, host visible, MaxCullsPerFrame slices
+    std::vector<uint32_t> m_ViewBufferIndices;                  // a slice each, frameIndex * MaxCullsPerFrame + cull
+    vk::DeviceSize m_ViewStride = 0;
+    std::vector<uint32_t> m_CullCounts;                         // per frame in flight, calls recorded so far
+    bool m_Occlusion = false;
+    UniqueHandle<VulkanBuffer> m_VisibilityBuffer;              // a uint per meshlet, kept across frames
+    uint32_t m_VisibilityBufferIndex = UINT32_MAX;
+
+    vk::PipelineLayout m_PipelineLayout;
+    vk::Pipeline m_Pipeline;
+
+    bool m_Validate = false;
+    std::vector<UniqueHandle<VulkanBuffer>> m_ReadbackBuffers;  // per frame in flight, the index count of each cull
+    std::vector<std::vector<CullCheck>> m_CullChecks;           // per frame in flight, one per cull
+};
+}
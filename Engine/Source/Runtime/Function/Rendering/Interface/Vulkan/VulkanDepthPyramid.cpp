@@ -0,0 +1,287 @@
+﻿#include "VulkanDepthPyramid.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanRHI.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanDevice.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanBindlessHeap.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanPipelineCache.h"
+
+#include <bit>
+
+namespace Snowy::Ark
+{
+using Utils = VulkanUtils;
+
+void VulkanDepthPyramid::Init(ObserverHandle<OwnerType> owner, Ref<VulkanBindlessHeap> bindlessHeap, Ref<VulkanPipelineCache> pipelineCache,
+                              vk::ShaderModule reduceShader)
+{
+    m_Owner = owner;
+    m_Ctx = owner->Context();
+    m_BindlessHeap = &bindlessHeap;
+    auto& device = m_Owner->Native();
+
+    vk::SamplerCreateInfo samplerInfo = {
+        .magFilter = vk::Filter::eNearest,
+        .minFilter = vk::Filter::eNearest,
+        .mipmapMode = vk::SamplerMipmapMode::eNearest,
+        .addressModeU = vk::SamplerAddressMode::eClampToEdge,
+        .addressModeV = vk::SamplerAddressMode::eClampToEdge,
+        .addressModeW = vk::SamplerAddressMode::eClampToEdge,
+        .mipLodBias = 0.0f,
+        .anisotropyEnable = SA_RHI_FALSE,
+        .maxAnisotropy = 1.0f,
+        .compareEnable = SA_RHI_FALSE,
+        .compareOp = vk::CompareOp::eAlways,
+        .minLod = 0.0f,
+        .maxLod = VK_LOD_CLAMP_NONE,
+        .borderColor = vk::BorderColor::eFloatOpaqueWhite,
+        .unnormalizedCoordinates = SA_RHI_FALSE,
+    };
+    Utils::VerifyResult(device.createSampler(samplerInfo), STEXT("Failed to create depth pyramid sampler!"), &m_Sampler);
+    m_SamplerIndex = bindlessHeap.RegisterSampler(m_Sampler);
+
+    std::array bindings = {
+        vk::DescriptorSetLayoutBinding {
+            .binding = 0,
+            .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+            .descriptorCount = 1,
+            .stageFlags = vk::ShaderStageFlagBits::eCompute,
+        },
+        vk::DescriptorSetLayoutBinding {
+            .binding = 1,
+            .descriptorType = vk::DescriptorType::eStorageImage,
+            .descriptorCount = 1,
+            .stageFlags = vk::ShaderStageFlagBits::eCompute,
+        },
+    };
+    vk::DescriptorSetLayoutCreateInfo setLayoutInfo = {};
+    setLayoutInfo.setBindings(bindings);
+    Utils::VerifyResult(device.createDescriptorSetLayout(setLayoutInfo), STEXT("Failed to create depth pyramid set layout!"), &m_SetLayout);
+
+    vk::PushConstantRange pushConstantRange = {
+        .stageFlags = vk::ShaderStageFlagBits::eCompute,
+        .offset = 0,
+        .size = sizeof(SADepthPyramidConstants),
+    };
+    vk::PipelineLayoutCreateInfo pipelineLayoutInfo = {
+        .setLayoutCount = 1,
+        .pSetLayouts = &m_SetLayout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &pushConstantRange,
+    };
+    Utils::VerifyResult(device.createPipelineLayout(pipelineLayoutInfo), STEXT("Failed to create depth pyramid pipeline layout!"), &m_PipelineLayout);
+    m_Pipeline = pipelineCache.GetComputePipeline(VulkanComputePipelineDesc{ .shader = reduceShader, .layout = m_PipelineLayout });
+}
+
+void VulkanDepthPyramid::Destroy()
+{
+    DestroyPyramid();
+
+    // The pipeline belongs to the pipeline cache
+    auto& device = m_Owner->Native();
+    device.destroyPipelineLayout(m_PipelineLayout);
+    device.destroyDescriptorSetLayout(m_SetLayout);
+    m_BindlessHeap->Release(EVulkanBindlessType::Sampler, m_SamplerIndex);
+    device.destroySampler(m_Sampler);
+}
+
+void VulkanDepthPyramid::Resize(vk::Extent2D depthExtent, vk::ImageView depthView)
+{
+    DestroyPyramid();
+    auto& device = m_Owner->Native();
+
+    // Power of two, every further mip is exactly half of the previous one
+    m_DepthExtent = depthExtent;
+    m_Extent = vk::Extent2D {
+        .width = std::bit_floor(std::max(depthExtent.width, 1u)),
+        .height = std::bit_floor(std::max(depthExtent.height, 1u)),
+    };
+    uint32_t mipCount = std::min(SA_VK_NUM(std::bit_width(std::max(m_Extent.width, m_Extent.height))), MaxMipCount);
+
+    vk::ImageCreateInfo imageInfo = {
+        .flags = {},
+        .imageType = vk::ImageType::e2D,
+        .format = vk::Format::eR32Sfloat,
+        .extent = vk::Extent3D {
+            .width = m_Extent.width,
+            .height = m_Extent.height,
+            .depth = 1
+        },
+        .mipLevels = mipCount,
+        .arrayLayers = 1,
+        .samples = vk::SampleCountFlagBits::e1,
+        .tiling = vk::ImageTiling::eOptimal,
+        .usage = vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled,
+        .sharingMode = vk::SharingMode::eExclusive,
+        .initialLayout = vk::ImageLayout::eUndefined,
+    };
+    Utils::VerifyResult(device.createImage(imageInfo), STEXT("Failed to create depth pyramid!"), &m_Image);
+    m_Allocation = m_Owner->Allocator().Allocate(device.getImageMemoryRequirements(m_Image), vk::MemoryPropertyFlagBits::eDeviceLocal,
+                                                 EVulkanResourceKind::Optimal);
+    Utils::VerifyResult(device.bindImageMemory(m_Image, m_Allocation.memory, m_Allocation.offset), STEXT("Failed to bind depth pyramid memory!"));
+
+    vk::ImageViewCreateInfo viewInfo = {
+        .image = m_Image,
+        .viewType = vk::ImageViewType::e2D,
+        .format = vk::Format::eR32Sfloat,
+        .subresourceRange = {
+            .aspectMask = vk::ImageAspectFlagBits::eColor,
+            .baseMipLevel = 0,
+            .levelCount = mipCount,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        },
+    };
+    Utils::VerifyResult(device.createImageView(viewInfo), STEXT("Failed to create depth pyramid view!"), &m_View);
+    m_ImageIndex = m_BindlessHeap->RegisterSampledImage(m_View, vk::ImageLayout::eGeneral);
+
+    m_MipViews.resize(mipCount);
+    for (uint32_t mip = 0; mip < mipCount; mip++)
+    {
+        viewInfo.subresourceRange.baseMipLevel = mip;
+        viewInfo.subresourceRange.levelCount = 1;
+        Utils::VerifyResult(device.createImageView(viewInfo), STEXT("Failed to create depth pyramid view!"), &m_MipViews[mip]);
+    }
+
+    // A set per reduction, the pool is recreated with the pyramid
+    std::array poolSizes = {
+        vk::DescriptorPoolSize {
+            .type = vk::DescriptorType::eCombinedImageSampler,
+            .descriptorCount = mipCount,
+        },
+        vk::DescriptorPoolSize {
+            .type = vk::DescriptorType::eStorageImage,
+            .descriptorCount = mipCount,
+        },
+    };
+    vk::DescriptorPoolCreateInfo poolInfo = {
+        .maxSets = mipCount,
+        .poolSizeCount = SA_VK_NUM(poolSizes.size()),
+        .pPoolSizes = poolSizes.data(),
+    };
+    Utils::VerifyResult(device.createDescriptorPool(poolInfo), STEXT("Failed to create depth pyramid descriptor pool!"), &m_DescriptorPool);
+
+    std::vector<vk::DescriptorSetLayout> setLayouts(mipCount, m_SetLayout);
+    vk::DescriptorSetAllocateInfo allocInfo = {
+        .descriptorPool = m_DescriptorPool,
+        .descriptorSetCount = mipCount,
+        .pSetLayouts = setLayouts.data(),
+    };
+    Utils::VerifyResult(device.allocateDescriptorSets(allocInfo), STEXT("Failed to alloc depth pyramid descriptor sets!"), &m_DescriptorSets);
+
+    std::vector<vk::DescriptorImageInfo> sourceInfos(mipCount);
+    std::vector<vk::DescriptorImageInfo> destinationInfos(mipCount);
+    std::vector<vk::WriteDescriptorSet> descriptorWrites;
+    for (uint32_t mip = 0; mip < mipCount; mip++)
+    {
+        sourceInfos[mip] = vk::DescriptorImageInfo {
+            .sampler = m_Sampler,
+            .imageView = mip == 0 ? depthView : m_MipViews[mip - 1],
+            .imageLayout = mip == 0 ? vk::ImageLayout::eShaderReadOnlyOptimal : vk::ImageLayout::eGeneral,
+        };
+        destinationInfos[mip] = vk::DescriptorImageInfo {
+            .sampler = SA_RHI_NULL,
+            .imageView = m_MipViews[mip],
+            .imageLayout = vk::ImageLayout::eGeneral,
+        };
+        descriptorWrites.emplace_back(vk::WriteDescriptorSet {
+            .dstSet = m_DescriptorSets[mip],
+            .dstBinding = 0,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+            .pImageInfo = &sourceInfos[mip],
+        });
+        descriptorWrites.emplace_back(vk::WriteDescriptorSet {
+            .dstSet = m_DescriptorSets[mip],
+            .dstBinding = 1,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = vk::DescriptorType::eStorageImage,
+            .pImageInfo = &destinationInfos[mip],
+        });
+    }
+    device.updateDescriptorSets(descriptorWrites, nullptr);
+
+    SA_LOG_INFO("Depth Pyramid Resized, {}x{} with {} mips.", m_Extent.width, m_Extent.height, mipCount);
+}
+
+void VulkanDepthPyramid::DestroyPyramid()
+{
+    if (!m_Image)
+    {
+        return;
+    }
+
+    auto& device = m_Owner->Native();
+    device.destroyDescriptorPool(m_DescriptorPool);
+    m_DescriptorPool = SA_RHI_NULL;
+    m_DescriptorSets.clear();
+
+    m_BindlessHeap->Release(EVulkanBindlessType::SampledImage, m_ImageIndex);
+    m_ImageIndex = UINT32_MAX;
+    for (auto&& mipView : m_MipViews)
+    {
+        device.destroyImageView(mipView);
+    }
+    m_MipViews.clear();
+    device.destroyImageView(m_View);
+    device.destroyImage(m_Image);
+    m_Owner->Allocator().Free(m_Allocation);
+    m_View = SA_RHI_NULL;
+    m_Image = SA_RHI_NULL;
+}
+
+void VulkanDepthPyramid::RecordBuild(vk::CommandBuffer cmd) const
+{
+    // Every mip is rewritten, the previous content is dropped once the last frame's late cull is done with it
+    vk::ImageMemoryBarrier writeBarrier = {
+        .srcAccessMask = vk::AccessFlagBits::eShaderRead,
+        .dstAccessMask = vk::AccessFlagBits::eShaderWrite,
+        .oldLayout = vk::ImageLayout::eUndefined,
+        .newLayout = vk::ImageLayout::eGeneral,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = m_Image,
+        .subresourceRange = vk::ImageSubresourceRange {
+            .aspectMask = vk::ImageAspectFlagBits::eColor,
+            .baseMipLevel = 0,
+            .levelCount = VK_REMAINING_MIP_LEVELS,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        },
+    };
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, {}, nullptr, nullptr, writeBarrier);
+
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, m_Pipeline);
+    vk::Extent2D sourceExtent = m_DepthExtent;
+    for (uint32_t mip = 0; mip < m_MipViews.size(); mip++)
+    {
+        vk::Extent2D mipExtent = {
+            .width = std::max(m_Extent.width >> mip, 1u),
+            .height = std::max(m_Extent.height >> mip, 1u),
+        };
+        SADepthPyramidConstants constants = {
+            .SA_SourceSize = glm::uvec2(sourceExtent.width, sourceExtent.height),
+            .SA_DestinationSize = glm::uvec2(mipExtent.width, mipExtent.height),
+        };
+        cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_PipelineLayout, 0, m_DescriptorSets[mip], nullptr);
+        cmd.pushConstants<SADepthPyramidConstants>(m_PipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, constants);
+        cmd.dispatch((mipExtent.width + GroupSize - 1) / GroupSize, (mipExtent.height + GroupSize - 1) / GroupSize, 1);
+
+        // The next reduction, or the late cull after the last one, reads this mip
+        vk::MemoryBarrier reduceBarrier = {
+            .srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+            .dstAccessMask = vk::AccessFlagBits::eShaderRead,
+        };
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, {}, reduceBarrier, nullptr, nullptr);
+        sourceExtent = mipExtent;
+    }
+}
+
+void VulkanDepthPyramid::FillCullView(Out<SACullView> view) const noexcept
+{
+    view->SA_PyramidIndex = m_ImageIndex;
+    view->SA_PyramidSize = glm::vec2(static_cast<float>(m_Extent.width), static_cast<float>(m_Extent.height));
+    view->SA_PyramidMipCount = MipCount();
+    view->SA_PyramidSamplerIndex = m_SamplerIndex;
+}
+}
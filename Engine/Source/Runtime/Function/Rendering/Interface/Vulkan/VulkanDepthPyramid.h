@@ -0,0 +1,87 @@
+﻿#pragma once
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanUtils.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanMemoryAllocator.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanGpuCulling.h"
+
+#include <glm/glm.hpp>
+
+namespace Snowy::Ark
+{
+// Mirrors SADepthPyramidConstants of depth_pyramid.comp
+struct SADepthPyramidConstants
+{
+    glm::uvec2 SA_SourceSize;
+    glm::uvec2 SA_DestinationSize;
+};
+
+class VulkanDevice;
+class VulkanBindlessHeap;
+class VulkanPipelineCache;
+
+/// <summary>
+/// Hierarchical depth of the occlusion culling. Mip 0 is the scene depth reduced to the previous power of two,
+/// every texel of a mip keeps the farthest depth of the texels it covers, so a 2x2 fetch at the mip matching
+/// a screen rect bounds the depth of whatever is already drawn there. Built by a compute dispatch per mip,
+/// the image stays in the general layout and the culling samples it through the bindless heap.
+/// </summary>
+class VulkanDepthPyramid
+{
+public:
+    using OwnerType = VulkanDevice;
+
+    static constexpr uint32_t GroupSize = 8;        // local_size_x/y of depth_pyramid.comp
+    static constexpr uint32_t MaxMipCount = 16;
+
+public:
+    VulkanDepthPyramid() = default;
+    ~VulkanDepthPyramid() = default;
+    VulkanDepthPyramid(const VulkanDepthPyramid&) = delete;
+    VulkanDepthPyramid(VulkanDepthPyramid&&) = delete;
+    VulkanDepthPyramid& operator=(const VulkanDepthPyramid&) = delete;
+    VulkanDepthPyramid& operator=(VulkanDepthPyramid&&) = delete;
+
+    void Init(ObserverHandle<OwnerType> owner, Ref<VulkanBindlessHeap> bindlessHeap, Ref<VulkanPipelineCache> pipelineCache,
+              vk::ShaderModule reduceShader);
+    void Destroy();
+
+    ObserverHandle<OwnerType> Owner() const noexcept { return m_Owner; }
+    ObserverHandle<VulkanRHI> Context() const noexcept { return m_Ctx; }
+
+    // Recreates the pyramid for a depth buffer of depthExtent, the device must be idle.
+    // depthView is sampled in shader read layout and must stay valid until the next Resize
+    void Resize(vk::Extent2D depthExtent, vk::ImageView depthView);
+
+    vk::Extent2D Extent() const noexcept { return m_Extent; }
+    uint32_t MipCount() const noexcept { return SA_VK_NUM(m_MipViews.size()); }
+
+    // Outside of a render pass, once the depth is in shader read layout. Leaves every mip readable by compute shaders
+    void RecordBuild(vk::CommandBuffer cmd) const;
+    // Points the occlusion test of the late cull phase to the pyramid
+    void FillCullView(Out<SACullView> view) const noexcept;
+
+private:
+    void DestroyPyramid();
+
+private:
+    ObserverHandle<OwnerType> m_Owner;
+    ObserverHandle<VulkanRHI> m_Ctx;
+    ObserverHandle<VulkanBindlessHeap> m_BindlessHeap;
+
+    vk::Extent2D m_DepthExtent = {};
+    vk::Extent2D m_Extent = {};
+    vk::Image m_Image;
+    VulkanAllocation m_Allocation;
+    vk::ImageView m_View;                   // every mip, registered in the bindless heap
+    std::vector<vk::ImageView> m_MipViews;  // storage image of each reduction
+    uint32_t m_ImageIndex = UINT32_MAX;
+
+    vk::Sampler m_Sampler;                  // nearest, only texelFetch reads the pyramid
+    uint32_t m_SamplerIndex = UINT32_MAX;
+
+    vk::DescriptorSetLayout m_SetLayout;
+    vk::DescriptorPool m_DescriptorPool;
+    std::vector<vk::DescriptorSet> m_DescriptorSets;   // per mip, reads the previous mip(or the depth) and writes the mip
+    vk::PipelineLayout m_PipelineLayout;
+    vk::Pipeline m_Pipeline;
+};
+}
@@ -5,6 +5,7 @@
 
 #include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanInstance.h"
 
+#include <cstring>
 #include <set>
 
 
@@ -34,10 +35,25 @@ void VulkanDevice::Init(ObserverHandle<OwnerType> owner) noexcept
             SA_LOG_ERROR("Failed to find a suitable GPU!");
         }
     }
+    // A CPU type is a software rasterizer(lavapipe, SwiftShader), what headless build machines run on
+    auto& adapterProperties = Adapter().Properties();
+    SA_LOG_INFO("Vulkan Adapter {}, {}.", adapterProperties.deviceName.data(), vk::to_string(adapterProperties.deviceType));
+
+    auto supportedExtensions = SupportedExtensions(Adapter());
+    for (auto&& extension : m_OptionalExtensions)
+    {
+        if (supportedExtensions.contains(extension))
+        {
+            m_RequiredExtensions.emplace_back(extension);
+        } else
+        {
+            SA_LOG_WARN("Optional device extension {} isn't supported.", extension);
+        }
+    }
 
     auto& indices = Adapter().GetQueueFamilyIndices();
     std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos;
-    std::set<uint32_t> uniqueQueueFamilies = { *indices.graphics, *indices.present };
+    std::set<uint32_t> uniqueQueueFamilies = { *indices.graphics, *indices.present, *indices.transfer };
     float queuePriority = 1.0f;
     for (auto queueFamily : uniqueQueueFamilies)
     {
@@ -50,10 +66,22 @@ void VulkanDevice::Init(ObserverHandle<OwnerType> owner) noexcept
     }
 
     vk::PhysicalDeviceFeatures deviceFeatures = {
+        .multiDrawIndirect = SA_RHI_TRUE,
         .samplerAnisotropy = SA_RHI_TRUE,
     };
+    // Bindless heap
+    vk::PhysicalDeviceDescriptorIndexingFeaturesEXT descriptorIndexingFeatures = {
+        .shaderSampledImageArrayNonUniformIndexing = SA_RHI_TRUE,
+        .shaderStorageBufferArrayNonUniformIndexing = SA_RHI_TRUE,
+        .descriptorBindingSampledImageUpdateAfterBind = SA_RHI_TRUE,
+        .descriptorBindingStorageBufferUpdateAfterBind = SA_RHI_TRUE,
+        .descriptorBindingUpdateUnusedWhilePending = SA_RHI_TRUE,
+        .descriptorBindingPartiallyBound = SA_RHI_TRUE,
+        .runtimeDescriptorArray = SA_RHI_TRUE,
+    };
 
     vk::DeviceCreateInfo createInfo = {
+        .pNext = &descriptorIndexingFeatures,
         .queueCreateInfoCount = Utils::CastNumType(queueCreateInfos.size()),
         .pQueueCreateInfos = queueCreateInfos.data(),
         .enabledExtensionCount = Utils::CastNumType(m_RequiredExtensions.size()),
@@ -72,13 +100,40 @@ void VulkanDevice::Init(ObserverHandle<OwnerType> owner) noexcept
 
     VULKAN_HPP_DEFAULT_DISPATCHER.init(m_Native);
 
-    m_Queues.resize(2);
+    m_Queues.resize(static_cast<size_t>(ERHIQueue::Count));
     m_Queues[static_cast<size_t>(ERHIQueue::Present)] = m_Native.getQueue(indices.present.value(), 0);
     m_Queues[static_cast<size_t>(ERHIQueue::Graphics)] = m_Native.getQueue(indices.graphics.value(), 0);
+    m_Queues[static_cast<size_t>(ERHIQueue::Transfer)] = m_Native.getQueue(indices.transfer.value(), 0);
+    // Without a dedicated transfer family the upload workers submit to the graphics queue itself
+    m_QueueMutexes.resize(m_Queues.size());
+    for (size_t i = 0; i < m_Queues.size(); i++)
+    {
+        auto same = std::ranges::find(m_Queues.begin(), m_Queues.begin() + i, m_Queues[i]);
+        m_QueueMutexes[i] = same != m_Queues.begin() + i ? m_QueueMutexes[same - m_Queues.begin()] : MakeShared<std::mutex>();
+    }
+
+    m_Allocator = MakeUnique<VulkanMemoryAllocator>();
+    m_Allocator->Init(m_Native, Adapter());
+}
+
+void VulkanDevice::WaitIdle() noexcept
+{
+    // Always locked in queue order, nothing else holds more than one queue mutex
+    std::vector<std::unique_lock<std::mutex>> locks;
+    for (size_t i = 0; i < m_QueueMutexes.size(); i++)
+    {
+        if (std::ranges::find(m_QueueMutexes.begin(), m_QueueMutexes.begin() + i, m_QueueMutexes[i]) == m_QueueMutexes.begin() + i)
+        {
+            locks.emplace_back(*m_QueueMutexes[i]);
+        }
+    }
+    Utils::VerifyResult(m_Native.waitIdle(), STEXT("Failed to Wait Idle!"));
 }
 
 void VulkanDevice::Destroy() noexcept
 {
+    m_Allocator->LogStatistics();
+    m_Allocator->Destroy();
     m_Native.destroy();
 }
 
@@ -90,10 +145,11 @@ VulkanSwapchain VulkanDevice::CreateSwapchain() noexcept
     return swapchain;
 }
 
-UniqueHandle<VulkanBuffer> VulkanDevice::CreateBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties) noexcept
+UniqueHandle<VulkanBuffer> VulkanDevice::CreateBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties,
+                                                      EVulkanAllocationStrategy strategy) noexcept
 {
     auto buffer = MakeUnique<VulkanBuffer>();
-    buffer->Init(this, size, usage, properties);
+    buffer->Init(this, size, usage, properties, strategy);
     return buffer;
 }
 
@@ -120,49 +176,66 @@ vk::ShaderModule VulkanDevice::CreateShaderModule(ArrayIn<char> code) noexcept
 
 uint32_t VulkanDevice::FindMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) noexcept
 {
-    vk::PhysicalDeviceMemoryProperties props = m_Adapter->Native().getMemoryProperties();
-    for (uint32_t i = 0; i < props.memoryTypeCount; i++)
-    {
-        if ((typeFilter & (1 << i)) && (props.memoryTypes[i].propertyFlags & properties) == properties)
-        {
-            return i;
-        }
-    }
-    SA_LOG_ERROR("Failed to find suitable memory type!");
-    return 0;
+    return m_Allocator->FindMemoryType(typeFilter, properties);
 }
 
-bool VulkanDevice::CheckDeviceExtensionSupport(In<VulkanAdapter> adapter) noexcept
+bool VulkanDevice::IsExtensionEnabled(const AnsiChar* name) const noexcept
 {
-    std::set<std::string> requiredExtensions(m_RequiredExtensions.begin(), m_RequiredExtensions.end());
+    return std::ranges::any_of(m_RequiredExtensions, [name](const AnsiChar* extension) { return std::strcmp(extension, name) == 0; });
+}
+
+std::set<std::string> VulkanDevice::SupportedExtensions(In<VulkanAdapter> adapter) noexcept
+{
+    std::set<std::string> supportedExtensions;
     Utils::VerifyResult(adapter->enumerateDeviceExtensionProperties(nullptr),
                         [&](const auto& result) {
                             auto& [r, extensions] = result;
                             if (r != vk::Result::eSuccess)
                             {
-                                SA_LOG_ERROR("Failed to enumerate instance layer properties!");
+                                SA_LOG_ERROR("Failed to enumerate device extension properties!");
                             } else
                             {
                                 for (const auto& extension : extensions)
                                 {
-                                    requiredExtensions.erase(extension.extensionName);
+                                    supportedExtensions.emplace(extension.extensionName.data());
                                 }
                             }
                         });
-    return requiredExtensions.empty();
+    return supportedExtensions;
+}
+
+bool VulkanDevice::CheckDeviceExtensionSupport(In<VulkanAdapter> adapter) noexcept
+{
+    auto supportedExtensions = SupportedExtensions(adapter);
+    return std::ranges::all_of(m_RequiredExtensions, [&](const AnsiChar* extension) { return supportedExtensions.contains(extension); });
 }
 
 bool VulkanDevice::IsDeviceSuitable(In<VulkanAdapter> adapter) noexcept
 {
     auto&& indices = adapter.GetQueueFamilyIndices();
     bool extensionsSupported = CheckDeviceExtensionSupport(adapter);
-    bool swapchainAdequate = false;
-    if (extensionsSupported)
+    bool swapchainAdequate = !m_Owner->Surface();
+    if (extensionsSupported && !swapchainAdequate)
     {
         auto&& swapChainSupport = adapter.QuerySwapchainSupportDetails();
         swapchainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
     }
     auto supportedFeatures = adapter->getFeatures();
-    return indices.IsComplete() && extensionsSupported && swapchainAdequate && supportedFeatures.samplerAnisotropy;
+
+    vk::PhysicalDeviceDescriptorIndexingFeaturesEXT descriptorIndexingFeatures = {};
+    vk::PhysicalDeviceFeatures2 supportedFeatures2 = {
+        .pNext = &descriptorIndexingFeatures,
+    };
+    adapter->getFeatures2(&supportedFeatures2);
+    bool bindlessSupported = descriptorIndexingFeatures.shaderSampledImageArrayNonUniformIndexing &&
+                             descriptorIndexingFeatures.shaderStorageBufferArrayNonUniformIndexing &&
+                             descriptorIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind &&
+                             descriptorIndexingFeatures.descriptorBindingStorageBufferUpdateAfterBind &&
+                             descriptorIndexingFeatures.descriptorBindingUpdateUnusedWhilePending &&
+                             descriptorIndexingFeatures.descriptorBindingPartiallyBound &&
+                             descriptorIndexingFeatures.runtimeDescriptorArray;
+
+    return indices.IsComplete() && extensionsSupported && swapchainAdequate && supportedFeatures.samplerAnisotropy &&
+           supportedFeatures.multiDrawIndirect && bindlessSupported;
 }
 }
@@ -4,8 +4,12 @@
 #include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanSwapchain.h"
 #include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanBuffer.h"
 #include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanTexture.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanMemoryAllocator.h"
 
 #include <filesystem>
+#include <mutex>
+#include <set>
+#include <string>
 
 namespace Snowy::Ark
 {
@@ -39,17 +43,27 @@ public:
 
     VulkanAdapter& Adapter() const noexcept { return *m_Adapter; }
     vk::Queue& Queue(ERHIQueue type) { return m_Queues[static_cast<size_t>(type)]; }
+    // Queue types resolving to the same VkQueue share a mutex, every submit, present or waitIdle on the queue must hold it
+    std::mutex& QueueMutex(ERHIQueue type) noexcept { return *m_QueueMutexes[static_cast<size_t>(type)]; }
+    // vkDeviceWaitIdle with every queue mutex held
+    void WaitIdle() noexcept;
+    VulkanMemoryAllocator& Allocator() noexcept { return *m_Allocator; }
     std::vector<const AnsiChar*>& RequiredExtensions() noexcept { return m_RequiredExtensions; }
+    std::vector<const AnsiChar*>& OptionalExtensions() noexcept { return m_OptionalExtensions; }
+    // Required extensions and the optional ones the adapter supports, valid after Init
+    bool IsExtensionEnabled(const AnsiChar* name) const noexcept;
 
     VulkanSwapchain CreateSwapchain() noexcept;
 
-    UniqueHandle<VulkanBuffer> CreateBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties) noexcept;
+    UniqueHandle<VulkanBuffer> CreateBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties,
+                                            EVulkanAllocationStrategy strategy = EVulkanAllocationStrategy::TLSF) noexcept;
     UniqueHandle<VulkanTexture> CreateTexture(In<TextureData> data, In<VulkanTextureParams> params);
     vk::ShaderModule CreateShaderModule(ArrayIn<char> code) noexcept;
 
     uint32_t FindMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) noexcept;
 
 private:
+    std::set<std::string> SupportedExtensions(In<VulkanAdapter> adapter) noexcept;
     bool CheckDeviceExtensionSupport(In<VulkanAdapter> adapter) noexcept;
     bool IsDeviceSuitable(In<VulkanAdapter> adapter) noexcept;
 
@@ -60,7 +74,10 @@ private:
 
     ObserverHandle<VulkanAdapter> m_Adapter;
     std::vector<vk::Queue> m_Queues;
+    std::vector<SharedHandle<std::mutex>> m_QueueMutexes;
+    UniqueHandle<VulkanMemoryAllocator> m_Allocator;
 
     std::vector<const AnsiChar*> m_RequiredExtensions;
+    std::vector<const AnsiChar*> m_OptionalExtensions;
 };
 }
@@ -0,0 +1,76 @@
+﻿#include "VulkanFrameCommandPool.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanRHI.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanDevice.h"
+#include "Engine/Source/Runtime/Core/Job/JobSystem.h"
+
+namespace Snowy::Ark
+{
+using Utils = VulkanUtils;
+
+void VulkanFrameCommandPool::Init(ObserverHandle<OwnerType> owner, uint32_t queueFamilyIndex, uint32_t threadCount)
+{
+    m_Owner = owner;
+    m_Ctx = owner->Context();
+
+    // No eResetCommandBuffer, buffers are only recycled by resetting the whole pool
+    vk::CommandPoolCreateInfo createInfo = {
+        .flags = vk::CommandPoolCreateFlagBits::eTransient,
+        .queueFamilyIndex = queueFamilyIndex,
+    };
+    m_ThreadPools.resize(threadCount);
+    for (auto&& threadPool : m_ThreadPools)
+    {
+        Utils::VerifyResult(m_Owner->Native().createCommandPool(createInfo), STEXT("Failed to create frame command pool!"), &threadPool.pool);
+    }
+}
+
+void VulkanFrameCommandPool::Destroy()
+{
+    for (auto&& threadPool : m_ThreadPools)
+    {
+        m_Owner->Native().destroyCommandPool(threadPool.pool);
+    }
+    m_ThreadPools.clear();
+}
+
+void VulkanFrameCommandPool::Reset()
+{
+    for (auto&& threadPool : m_ThreadPools)
+    {
+        Utils::VerifyResult(m_Owner->Native().resetCommandPool(threadPool.pool), STEXT("Failed to reset frame command pool!"));
+        threadPool.primaryCursor = 0;
+        threadPool.secondaryCursor = 0;
+    }
+}
+
+vk::CommandBuffer VulkanFrameCommandPool::AllocatePrimary(uint32_t threadIndex)
+{
+    SAssert(threadIndex == JobSystem::ThreadIndex() && JobSystem::IsOwnedThread() && "Only job system threads have a pool, each its own");
+    return Allocate(m_ThreadPools[threadIndex], vk::CommandBufferLevel::ePrimary);
+}
+
+vk::CommandBuffer VulkanFrameCommandPool::AllocateSecondary(uint32_t threadIndex)
+{
+    SAssert(threadIndex == JobSystem::ThreadIndex() && JobSystem::IsOwnedThread() && "Only job system threads have a pool, each its own");
+    return Allocate(m_ThreadPools[threadIndex], vk::CommandBufferLevel::eSecondary);
+}
+
+vk::CommandBuffer VulkanFrameCommandPool::Allocate(Ref<ThreadPool> threadPool, vk::CommandBufferLevel level)
+{
+    bool isPrimary = level == vk::CommandBufferLevel::ePrimary;
+    auto& buffers = isPrimary ? threadPool.primaries : threadPool.secondaries;
+    auto& cursor = isPrimary ? threadPool.primaryCursor : threadPool.secondaryCursor;
+    if (cursor == buffers.size())
+    {
+        vk::CommandBufferAllocateInfo allocInfo = {
+            .commandPool = threadPool.pool,
+            .level = level,
+            .commandBufferCount = 1,
+        };
+        std::vector<vk::CommandBuffer> cmds;
+        Utils::VerifyResult(m_Owner->Native().allocateCommandBuffers(allocInfo), STEXT("Failed to allocate frame command buffer!"), &cmds);
+        buffers.emplace_back(cmds.front());
+    }
+    return buffers[cursor++];
+}
+}
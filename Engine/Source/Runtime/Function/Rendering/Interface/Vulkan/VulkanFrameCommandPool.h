@@ -0,0 +1,55 @@
+﻿#pragma once
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanUtils.h"
+
+namespace Snowy::Ark
+{
+class VulkanDevice;
+
+/// <summary>
+/// Command pools of one frame in flight, one pool per job thread so recording never contends.
+/// Command buffers are recycled all at once by resetting the pools after the frame's fence.
+/// </summary>
+class VulkanFrameCommandPool
+{
+public:
+    using NativeType = vk::CommandPool;
+    using OwnerType  = VulkanDevice;
+
+public:
+    VulkanFrameCommandPool() = default;
+    ~VulkanFrameCommandPool() = default;
+    VulkanFrameCommandPool(const VulkanFrameCommandPool&) = default;
+    VulkanFrameCommandPool(VulkanFrameCommandPool&&) = default;
+    VulkanFrameCommandPool& operator=(const VulkanFrameCommandPool&) = default;
+    VulkanFrameCommandPool& operator=(VulkanFrameCommandPool&&) = default;
+
+    void Init(ObserverHandle<OwnerType> owner, uint32_t queueFamilyIndex, uint32_t threadCount);
+    void Destroy();
+
+    ObserverHandle<OwnerType> Owner() const noexcept { return m_Owner; }
+    ObserverHandle<VulkanRHI> Context() const noexcept { return m_Ctx; }
+
+    void Reset();
+    // Each thread must only allocate from its own thread index, threads outside the job system(the logic thread) can't allocate
+    vk::CommandBuffer AllocatePrimary(uint32_t threadIndex);
+    vk::CommandBuffer AllocateSecondary(uint32_t threadIndex);
+
+private:
+    struct ThreadPool
+    {
+        vk::CommandPool pool;
+        std::vector<vk::CommandBuffer> primaries;
+        std::vector<vk::CommandBuffer> secondaries;
+        uint32_t primaryCursor = 0;
+        uint32_t secondaryCursor = 0;
+    };
+
+    vk::CommandBuffer Allocate(Ref<ThreadPool> threadPool, vk::CommandBufferLevel level);
+
+private:
+    ObserverHandle<OwnerType> m_Owner;
+    ObserverHandle<VulkanRHI> m_Ctx;
+
+    std::vector<ThreadPool> m_ThreadPools;
+};
+}
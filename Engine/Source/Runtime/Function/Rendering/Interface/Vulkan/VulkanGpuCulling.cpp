@@ -0,0 +1,302 @@
+﻿#include "VulkanGpuCulling.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanRHI.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanDevice.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanBindlessHeap.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanPipelineCache.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanUploadManager.h"
+
+#include <cstring>
+
+namespace Snowy::Ark
+{
+using Utils = VulkanUtils;
+
+void VulkanGpuCulling::Init(ObserverHandle<OwnerType> owner, Ref<VulkanBindlessHeap> bindlessHeap, Ref<VulkanPipelineCache> pipelineCache,
+                            Ref<VulkanUploadManager> uploadManager, vk::ShaderModule cullShader, ArrayIn<SAInstanceData> instances,
+                            uint32_t frameCount, bool occlusion, bool validate)
+{
+    m_Owner = owner;
+    m_Ctx = owner->Context();
+    m_BindlessHeap = &bindlessHeap;
+    m_Instances.assign(instances.begin(), instances.end());
+    m_Occlusion = occlusion;
+    m_Validate = validate;
+
+    vk::DeviceSize instanceBufferSize = std::max<vk::DeviceSize>(sizeof(SAInstanceData) * m_Instances.size(), sizeof(SAInstanceData));
+    m_InstanceBuffer = m_Owner->CreateBuffer(instanceBufferSize, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                                             vk::MemoryPropertyFlagBits::eDeviceLocal);
+    if (!m_Instances.empty())
+    {
+        uploadManager.UploadBuffer(*m_InstanceBuffer, m_Instances.data(), sizeof(SAInstanceData) * m_Instances.size(), 0,
+                                   vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderRead);
+    }
+
+    vk::DeviceSize drawBufferSize = std::max<vk::DeviceSize>(sizeof(vk::DrawIndexedIndirectCommand) * m_Instances.size(), sizeof(vk::DrawIndexedIndirectCommand));
+    m_DrawBuffer = m_Owner->CreateBuffer(drawBufferSize, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer,
+                                         vk::MemoryPropertyFlagBits::eDeviceLocal);
+    m_CountBuffer = m_Owner->CreateBuffer(sizeof(uint32_t), vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer |
+                                          vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eTransferSrc,
+                                          vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+    m_InstanceBufferIndex = bindlessHeap.RegisterStorageBuffer(*m_InstanceBuffer);
+    m_DrawBufferIndex = bindlessHeap.RegisterStorageBuffer(*m_DrawBuffer);
+    m_CountBufferIndex = bindlessHeap.RegisterStorageBuffer(*m_CountBuffer);
+
+    // Each slice is registered on its own, the shader keeps reading a single view
+    vk::DeviceSize storageAlignment = std::max<vk::DeviceSize>(m_Owner->Adapter().Properties().limits.minStorageBufferOffsetAlignment, 16);
+    m_ViewStride = (sizeof(SACullView) + storageAlignment - 1) & ~(storageAlignment - 1);
+    m_ViewBuffers.resize(frameCount);
+    m_ViewBufferIndices.resize(frameCount * MaxCullsPerFrame);
+    m_CullCounts.assign(frameCount, 0);
+    for (uint32_t i = 0; i < frameCount; i++)
+    {
+        m_ViewBuffers[i] = m_Owner->CreateBuffer(m_ViewStride * MaxCullsPerFrame, vk::BufferUsageFlagBits::eStorageBuffer,
+                                                 vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+        for (uint32_t cull = 0; cull < MaxCullsPerFrame; cull++)
+        {
+            m_ViewBufferIndices[i * MaxCullsPerFrame + cull] = bindlessHeap.RegisterStorageBuffer(*m_ViewBuffers[i], m_ViewStride * cull, sizeof(SACullView));
+        }
+    }
+
+    if (m_Occlusion)
+    {
+        // Nothing was visible before the first frame, its late phase tests and draws everything
+        std::vector<uint32_t> visibility(m_Instances.size(), 0);
+        vk::DeviceSize visibilityBufferSize = std::max<vk::DeviceSize>(sizeof(uint32_t) * visibility.size(), sizeof(uint32_t));
+        m_VisibilityBuffer = m_Owner->CreateBuffer(visibilityBufferSize, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                                                   vk::MemoryPropertyFlagBits::eDeviceLocal);
+        if (!visibility.empty())
+        {
+            uploadManager.UploadBuffer(*m_VisibilityBuffer, visibility.data(), sizeof(uint32_t) * visibility.size(), 0,
+                                       vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+        }
+        m_VisibilityBufferIndex = bindlessHeap.RegisterStorageBuffer(*m_VisibilityBuffer);
+    }
+
+    if (m_Validate)
+    {
+        m_ReadbackBuffers.resize(frameCount);
+        for (auto&& readbackBuffer : m_ReadbackBuffers)
+        {
+            // A count per cull
+            readbackBuffer = m_Owner->CreateBuffer(sizeof(uint32_t) * MaxCullsPerFrame, vk::BufferUsageFlagBits::eTransferDst,
+                                                   vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+            std::memset(readbackBuffer->MappedData(), 0, sizeof(uint32_t) * MaxCullsPerFrame);
+        }
+        m_CullChecks.resize(frameCount);
+    }
+
+    vk::DescriptorSetLayout setLayout = bindlessHeap.SetLayout();
+    vk::PushConstantRange pushConstantRange = {
+        .stageFlags = vk::ShaderStageFlagBits::eCompute,
+        .offset = 0,
+        .size = sizeof(SACullConstants),
+    };
+    vk::PipelineLayoutCreateInfo pipelineLayoutInfo = {
+        .setLayoutCount = 1,
+        .pSetLayouts = &setLayout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &pushConstantRange,
+    };
+    Utils::VerifyResult(m_Owner->Native().createPipelineLayout(pipelineLayoutInfo), STEXT("Failed to create culling pipeline layout!"), &m_PipelineLayout);
+    m_Pipeline = pipelineCache.GetComputePipeline(VulkanComputePipelineDesc{ .shader = cullShader, .layout = m_PipelineLayout });
+
+    SA_LOG_INFO("GPU Culling Initialized, {} instances, occlusion {}.", m_Instances.size(), m_Occlusion ? "on" : "off");
+}
+
+void VulkanGpuCulling::Destroy()
+{
+    // The pipeline belongs to the pipeline cache
+    m_Owner->Native().destroyPipelineLayout(m_PipelineLayout);
+
+    m_BindlessHeap->Release(EVulkanBindlessType::StorageBuffer, m_InstanceBufferIndex);
+    m_BindlessHeap->Release(EVulkanBindlessType::StorageBuffer, m_DrawBufferIndex);
+    m_BindlessHeap->Release(EVulkanBindlessType::StorageBuffer, m_CountBufferIndex);
+    for (auto viewBufferIndex : m_ViewBufferIndices)
+    {
+        m_BindlessHeap->Release(EVulkanBindlessType::StorageBuffer, viewBufferIndex);
+    }
+
+    m_InstanceBuffer->Destroy();
+    m_DrawBuffer->Destroy();
+    m_CountBuffer->Destroy();
+    for (auto&& viewBuffer : m_ViewBuffers)
+    {
+        viewBuffer->Destroy();
+    }
+    m_ViewBuffers.clear();
+    m_ViewBufferIndices.clear();
+    if (m_VisibilityBuffer)
+    {
+        m_BindlessHeap->Release(EVulkanBindlessType::StorageBuffer, m_VisibilityBufferIndex);
+        m_VisibilityBuffer->Destroy();
+    }
+    for (auto&& readbackBuffer : m_ReadbackBuffers)
+    {
+        readbackBuffer->Destroy();
+    }
+    m_ReadbackBuffers.clear();
+}
+
+void VulkanGpuCulling::BeginFrame(uint32_t frameIndex)
+{
+    m_CullCounts[frameIndex] = 0;
+    if (!m_Validate)
+    {
+        return;
+    }
+
+    auto cullCounts = static_cast<const uint32_t*>(m_ReadbackBuffers[frameIndex]->MappedData());
+    auto& checks = m_CullChecks[frameIndex];
+    uint32_t earlyCount = 0;
+    uint32_t earlyFirstInstance = UINT32_MAX;
+    for (uint32_t cull = 0; cull < checks.size(); cull++)
+    {
+        auto& check = checks[cull];
+        uint32_t gpuCount = cullCounts[cull];
+        // Occlusion only removes instances from the frustum visible ones of the reference,
+        // the early and late phases of a range together draw at most that many
+        if (check.phase == ECullPhase::Late && check.firstInstance == earlyFirstInstance)
+        {
+            gpuCount += earlyCount;
+        }
+        if (check.phase == ECullPhase::Single ? gpuCount != check.referenceCount : gpuCount > check.referenceCount)
+        {
+            SA_LOG_WARN("GPU culling mismatch in cull {}, {} visible on GPU, {} on CPU reference.", cull, gpuCount, check.referenceCount);
+        }
+        if (check.phase == ECullPhase::Early)
+        {
+            earlyCount = cullCounts[cull];
+            earlyFirstInstance = check.firstInstance;
+        }
+    }
+    checks.clear();
+}
+
+void VulkanGpuCulling::RecordCull(vk::CommandBuffer cmd, uint32_t frameIndex, In<SACullView> view, ECullPhase phase,
+                                  uint32_t firstInstance, uint32_t instanceCount)
+{
+    uint32_t cull = m_CullCounts[frameIndex];
+    if (cull >= MaxCullsPerFrame)
+    {
+        SA_LOG_ERROR("More than {} culls in a frame, the previous result is drawn again!", MaxCullsPerFrame);
+        return;
+    }
+    m_CullCounts[frameIndex]++;
+
+    // Host coherent and the fence of the frame has been waited on. A slice per call, the
+    // dispatches of the frame only run once everything has been recorded
+    std::memcpy(static_cast<std::byte*>(m_ViewBuffers[frameIndex]->MappedData()) + m_ViewStride * cull, &view, sizeof(SACullView));
+    SACullConstants constants = {
+        .SA_InstanceCount = instanceCount,
+        .SA_InstanceBufferIndex = m_InstanceBufferIndex,
+        .SA_DrawBufferIndex = m_DrawBufferIndex,
+        .SA_CountBufferIndex = m_CountBufferIndex,
+        .SA_FirstInstance = firstInstance,
+        .SA_ViewBufferIndex = m_ViewBufferIndices[frameIndex * MaxCullsPerFrame + cull],
+        .SA_VisibilityBufferIndex = m_VisibilityBufferIndex,
+        .SA_Phase = phase,
+    };
+
+    // The previous phase's indirect draw may still read the buffers
+    vk::MemoryBarrier resetBarrier = {
+        .srcAccessMask = vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eTransferRead,
+        .dstAccessMask = vk::AccessFlagBits::eTransferWrite,
+    };
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer,
+                        {}, resetBarrier, nullptr, nullptr);
+    cmd.fillBuffer(*m_CountBuffer, 0, sizeof(uint32_t), 0);
+
+    // The late phase of the previous frame wrote the visibility
+    vk::MemoryBarrier cullBarrier = {
+        .srcAccessMask = vk::AccessFlagBits::eTransferWrite | vk::AccessFlagBits::eShaderWrite,
+        .dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+    };
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eComputeShader,
+                        vk::PipelineStageFlagBits::eComputeShader, {}, cullBarrier, nullptr, nullptr);
+
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, m_Pipeline);
+    cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_PipelineLayout, 0, m_BindlessHeap->Native(), nullptr);
+    cmd.pushConstants<SACullConstants>(m_PipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, constants);
+    cmd.dispatch((instanceCount + GroupSize - 1) / GroupSize, 1, 1);
+
+    vk::MemoryBarrier drawBarrier = {
+        .srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+        .dstAccessMask = vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eTransferRead,
+    };
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eTransfer,
+                        {}, drawBarrier, nullptr, nullptr);
+
+    if (m_Validate)
+    {
+        vk::BufferCopy copyRegion = {
+            .srcOffset = 0,
+            .dstOffset = sizeof(uint32_t) * cull,
+            .size = sizeof(uint32_t),
+        };
+        cmd.copyBuffer(*m_CountBuffer, *m_ReadbackBuffers[frameIndex], copyRegion);
+        vk::MemoryBarrier readbackBarrier = {
+            .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+            .dstAccessMask = vk::AccessFlagBits::eHostRead,
+        };
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, {}, readbackBarrier, nullptr, nullptr);
+        m_CullChecks[frameIndex].emplace_back(CullCheck {
+            .phase = phase,
+            .firstInstance = firstInstance,
+            .referenceCount = CullReference(ArrayIn<SAInstanceData>(m_Instances).subspan(firstInstance, instanceCount), view.SA_FrustumPlanes),
+        });
+    }
+}
+
+void VulkanGpuCulling::RecordDraw(vk::CommandBuffer cmd) const
+{
+    cmd.drawIndexedIndirectCountKHR(*m_DrawBuffer, 0, *m_CountBuffer, 0, InstanceCount(), sizeof(vk::DrawIndexedIndirectCommand));
+}
+
+std::array<glm::vec4, 6> VulkanGpuCulling::ExtractFrustumPlanes(In<glm::mat4> objectToClip) noexcept
+{
+    // Gribb/Hartmann, clip space depth is [0, 1]
+    auto row = [&](int i) { return glm::vec4(objectToClip[0][i], objectToClip[1][i], objectToClip[2][i], objectToClip[3][i]); };
+    std::array<glm::vec4, 6> planes = {
+        row(3) + row(0),    // left
+        row(3) - row(0),    // right
+        row(3) + row(1),    // bottom
+        row(3) - row(1),    // top
+        row(2),             // near
+        row(3) - row(2),    // far
+    };
+    for (auto&& plane : planes)
+    {
+        plane /= glm::length(glm::vec3(plane));
+    }
+    return planes;
+}
+
+SACullView VulkanGpuCulling::MakeCullView(In<glm::mat4> objectToClip, glm::vec3 cameraPosition) noexcept
+{
+    return SACullView {
+        .SA_ObjectToClip = objectToClip,
+        .SA_FrustumPlanes = ExtractFrustumPlanes(objectToClip),
+        .SA_CameraPosition = cameraPosition,
+        .SA_PyramidIndex = UINT32_MAX,
+        .SA_PyramidSize = glm::vec2(0.0f),
+        .SA_PyramidMipCount = 0,
+        .SA_PyramidSamplerIndex = UINT32_MAX,
+    };
+}
+
+uint32_t VulkanGpuCulling::CullReference(ArrayIn<SAInstanceData> instances, In<std::array<glm::vec4, 6>> planes) noexcept
+{
+    uint32_t visibleCount = 0;
+    for (auto&& instance : instances)
+    {
+        glm::vec3 center = glm::vec3(instance.SA_BoundingSphere);
+        float radius = instance.SA_BoundingSphere.w;
+        bool visible = std::ranges::all_of(planes, [&](const auto& plane) {
+            return glm::dot(glm::vec3(plane), center) + plane.w >= -radius;
+        });
+        visibleCount += visible ? 1 : 0;
+    }
+    return visibleCount;
+}
+}
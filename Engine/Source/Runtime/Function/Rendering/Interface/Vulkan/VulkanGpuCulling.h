@@ -0,0 +1,144 @@
+﻿#pragma once
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanUtils.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanBuffer.h"
+
+#include <glm/glm.hpp>
+
+namespace Snowy::Ark
+{
+// Mirrors SAInstanceData of cull.comp(std430)
+struct SAInstanceData
+{
+    glm::vec4 SA_BoundingSphere;    // object space center, radius in w
+    uint32_t SA_FirstIndex;
+    uint32_t SA_IndexCount;
+    int32_t SA_VertexOffset;
+    uint32_t SA_Padding;
+};
+
+// Mirrors SACullView of cull.comp and cluster_cull.comp(std430), written once per cull, too large for push constants
+struct SACullView
+{
+    glm::mat4 SA_ObjectToClip;
+    std::array<glm::vec4, 6> SA_FrustumPlanes;
+    glm::vec3 SA_CameraPosition;    // mesh space
+    uint32_t SA_PyramidIndex;       // bindless sampled image of the depth pyramid
+    glm::vec2 SA_PyramidSize;       // mip 0, in texels
+    uint32_t SA_PyramidMipCount;
+    uint32_t SA_PyramidSamplerIndex;
+};
+
+/// <summary>
+/// Two phase occlusion culling: the early phase draws what was visible last frame, the depth pyramid is
+/// built from that depth, the late phase tests everything against it, draws what became visible and
+/// records the visibility for the next frame. Single is frustum culling only.
+/// </summary>
+enum class ECullPhase : uint32_t
+{
+    Single = 0,
+    Early,
+    Late,
+};
+
+// Mirrors SACullConstants of cull.comp
+struct SACullConstants
+{
+    uint32_t SA_InstanceCount;
+    uint32_t SA_InstanceBufferIndex;
+    uint32_t SA_DrawBufferIndex;
+    uint32_t SA_CountBufferIndex;
+    uint32_t SA_FirstInstance;
+    uint32_t SA_ViewBufferIndex;
+    uint32_t SA_VisibilityBufferIndex;
+    ECullPhase SA_Phase;
+};
+
+class VulkanDevice;
+class VulkanBindlessHeap;
+class VulkanPipelineCache;
+class VulkanUploadManager;
+
+/// <summary>
+/// GPU driven scene path: per-instance data lives in a storage buffer, a compute pass tests every
+/// instance against the frustum and appends a DrawIndexedIndirectCommand for the visible ones,
+/// the scene is then drawn with a single drawIndexedIndirectCount. CPU cost doesn't depend on the
+/// instance count. With occlusion on, a visibility buffer keeps the result of the late phase.
+/// With validation on, the GPU visible count is read back and compared to CullReference.
+/// </summary>
+class VulkanGpuCulling
+{
+public:
+    using OwnerType = VulkanDevice;
+
+    static constexpr uint32_t GroupSize = 64;  // local_size_x of cull.comp
+    static constexpr uint32_t MaxCullsPerFrame = 8;
+
+public:
+    VulkanGpuCulling() = default;
+    ~VulkanGpuCulling() = default;
+    VulkanGpuCulling(const VulkanGpuCulling&) = delete;
+    VulkanGpuCulling(VulkanGpuCulling&&) = delete;
+    VulkanGpuCulling& operator=(const VulkanGpuCulling&) = delete;
+    VulkanGpuCulling& operator=(VulkanGpuCulling&&) = delete;
+
+    void Init(ObserverHandle<OwnerType> owner, Ref<VulkanBindlessHeap> bindlessHeap, Ref<VulkanPipelineCache> pipelineCache,
+              Ref<VulkanUploadManager> uploadManager, vk::ShaderModule cullShader, ArrayIn<SAInstanceData> instances,
+              uint32_t frameCount, bool occlusion, bool validate);
+    void Destroy();
+
+    ObserverHandle<OwnerType> Owner() const noexcept { return m_Owner; }
+    ObserverHandle<VulkanRHI> Context() const noexcept { return m_Ctx; }
+
+    uint32_t InstanceCount() const noexcept { return SA_VK_NUM(m_Instances.size()); }
+
+    // Called once the fence of frameIndex has been waited on, checks the readback of every cull of that frame
+    void BeginFrame(uint32_t frameIndex);
+    // Outside of a render pass. Each call reads its own view slice, at most MaxCullsPerFrame calls per frame.
+    // Only the instances of [firstInstance, firstInstance + instanceCount) are tested, e.g. the chunks of one LOD
+    void RecordCull(vk::CommandBuffer cmd, uint32_t frameIndex, In<SACullView> view, ECullPhase phase, uint32_t firstInstance, uint32_t instanceCount);
+    // Inside the render pass, pipeline, vertex/index buffers and descriptor sets already bound
+    void RecordDraw(vk::CommandBuffer cmd) const;
+
+    // Normalized planes(inside is dot(n, p) + d >= 0) in the space objectToClip transforms from
+    static std::array<glm::vec4, 6> ExtractFrustumPlanes(In<glm::mat4> objectToClip) noexcept;
+    // objectToClip is P * V * ObjectToWorld, cameraPosition in the same object space. No depth pyramid yet
+    static SACullView MakeCullView(In<glm::mat4> objectToClip, glm::vec3 cameraPosition) noexcept;
+    // CPU reference of cull.comp without occlusion, returns the visible count
+    static uint32_t CullReference(ArrayIn<SAInstanceData> instances, In<std::array<glm::vec4, 6>> planes) noexcept;
+
+private:
+    struct CullCheck
+    {
+        ECullPhase phase;
+        uint32_t firstInstance;
+        uint32_t referenceCount;    // frustum visible on the CPU
+    };
+
+    ObserverHandle<OwnerType> m_Owner;
+    ObserverHandle<VulkanRHI> m_Ctx;
+    ObserverHandle<VulkanBindlessHeap> m_BindlessHeap;
+
+    std::vector<SAInstanceData> m_Instances;    // kept for the CPU reference
+    UniqueHandle<VulkanBuffer> m_InstanceBuffer;
+    UniqueHandle<VulkanBuffer> m_DrawBuffer;
+    UniqueHandle<VulkanBuffer> m_CountBuffer;
+    uint32_t m_InstanceBufferIndex = UINT32_MAX;
+    uint32_t m_DrawBufferIndex = UINT32_MAX;
+    uint32_t m_CountBufferIndex = UINT32_MAX;
+
+    std::vector<UniqueHandle<VulkanBuffer>> m_ViewBuffers;      // per frame in flight, host visible, MaxCullsPerFrame slices
+    std::vector<uint32_t> m_ViewBufferIndices;                  // a slice each, frameIndex * MaxCullsPerFrame + cull
+    vk::DeviceSize m_ViewStride = 0;
+    std::vector<uint32_t> m_CullCounts;                         // per frame in flight, calls recorded so far
+    bool m_Occlusion = false;
+    UniqueHandle<VulkanBuffer> m_VisibilityBuffer;              // a uint per instance, kept across frames
+    uint32_t m_VisibilityBufferIndex = UINT32_MAX;
+
+    vk::PipelineLayout m_PipelineLayout;
+    vk::Pipeline m_Pipeline;
+
+    bool m_Validate = false;
+    std::vector<UniqueHandle<VulkanBuffer>> m_ReadbackBuffers;  // per frame in flight, the count of each cull
+    std::vector<std::vector<CullCheck>> m_CullChecks;           // per frame in flight, one per cull
+};
+}
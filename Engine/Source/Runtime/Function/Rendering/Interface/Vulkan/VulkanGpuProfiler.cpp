@@ -0,0 +1,182 @@
+﻿#include "VulkanGpuProfiler.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanRHI.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanDevice.h"
+#include "Engine/Source/Runtime/Core/Profile/ProfileSystem.h"
+
+namespace Snowy::Ark
+{
+using Utils = VulkanUtils;
+
+void VulkanGpuProfiler::Init(ObserverHandle<OwnerType> owner, ObserverHandle<ProfileSystem> profileSys, uint32_t frameCount)
+{
+    m_Owner = owner;
+    m_Ctx = owner->Context();
+    m_ProfileSys = profileSys;
+    auto& device = m_Owner->Native();
+
+    uint32_t graphicsFamily = *m_Owner->Adapter().GetQueueFamilyIndices().graphics;
+    uint32_t validBits = m_Owner->Adapter()->getQueueFamilyProperties()[graphicsFamily].timestampValidBits;
+    if (validBits == 0)
+    {
+        SA_LOG_WARN("Graphics queue has no timestamps, GPU profiling is disabled.");
+        return;
+    }
+    m_TimestampMask = validBits >= 64 ? UINT64_MAX : (uint64_t(1) << validBits) - 1;
+    m_TimestampPeriod = m_Owner->Adapter().Properties().limits.timestampPeriod;
+
+    vk::QueryPoolCreateInfo poolInfo = {
+        .queryType = vk::QueryType::eTimestamp,
+        .queryCount = MaxZonesPerFrame * 2,
+    };
+    m_Frames.resize(frameCount);
+    for (uint32_t i = 0; i < frameCount; i++)
+    {
+        Utils::VerifyResult(device.createQueryPool(poolInfo), std::format(STEXT("Failed to create timestamp query pool[{}]!"), i), &m_Frames[i].pool);
+        m_Frames[i].names.reserve(MaxZonesPerFrame);
+    }
+    m_Timestamps.resize(MaxZonesPerFrame * 2);
+    m_Track = m_ProfileSys->RegisterTrack("GPU");
+
+    Calibrate();
+}
+
+void VulkanGpuProfiler::Destroy()
+{
+    for (auto&& frame : m_Frames)
+    {
+        m_Owner->Native().destroyQueryPool(frame.pool);
+    }
+    m_Frames.clear();
+}
+
+const char* VulkanGpuProfiler::InternName(std::string_view name)
+{
+    return m_ProfileSys->InternName(name);
+}
+
+void VulkanGpuProfiler::BeginFrame(uint32_t frameIndex)
+{
+    auto& frame = m_Frames[frameIndex];
+    if (!std::exchange(frame.recorded, false) || frame.names.empty())
+    {
+        return;
+    }
+
+    // The fence of the slot has been waited on, every query of it is available
+    uint32_t queryCount = SA_VK_NUM(frame.names.size()) * 2;
+    auto result = m_Owner->Native().getQueryPoolResults(frame.pool, 0, queryCount, queryCount * sizeof(uint64_t), m_Timestamps.data(),
+                                                        sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+    if (result != vk::Result::eSuccess)
+    {
+        SA_LOG_WARN("Failed to read GPU timestamps!");
+        return;
+    }
+
+    std::vector<ProfileZone> zones;
+    zones.reserve(frame.names.size());
+    for (size_t i = 0; i < frame.names.size(); i++)
+    {
+        uint64_t begin = m_Timestamps[i * 2] & m_TimestampMask;
+        uint64_t end = m_Timestamps[i * 2 + 1] & m_TimestampMask;
+        // A zone across a wrap of the valid bits is dropped
+        if (end >= begin)
+        {
+            zones.push_back({ frame.names[i], ToProfileTime(begin), ToProfileTime(end) });
+        }
+    }
+    m_ProfileSys->SubmitZones(m_Track, zones);
+}
+
+void VulkanGpuProfiler::RecordReset(vk::CommandBuffer cmd, uint32_t frameIndex)
+{
+    auto& frame = m_Frames[frameIndex];
+    cmd.resetQueryPool(frame.pool, 0, MaxZonesPerFrame * 2);
+    frame.names.clear();
+    frame.recorded = true;
+    m_RecordingFrame = frameIndex;
+}
+
+uint32_t VulkanGpuProfiler::BeginZone(vk::CommandBuffer cmd, const char* name)
+{
+    auto& frame = m_Frames[m_RecordingFrame];
+    if (frame.names.size() >= MaxZonesPerFrame)
+    {
+        return InvalidZone;
+    }
+    uint32_t zone = SA_VK_NUM(frame.names.size());
+    frame.names.emplace_back(name);
+    cmd.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, frame.pool, zone * 2);
+    return zone;
+}
+
+void VulkanGpuProfiler::EndZone(vk::CommandBuffer cmd, uint32_t zone)
+{
+    if (zone != InvalidZone)
+    {
+        cmd.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, m_Frames[m_RecordingFrame].pool, zone * 2 + 1);
+    }
+}
+
+void VulkanGpuProfiler::Calibrate()
+{
+    auto& device = m_Owner->Native();
+    vk::CommandPoolCreateInfo commandPoolInfo = {
+        .flags = vk::CommandPoolCreateFlagBits::eTransient,
+        .queueFamilyIndex = *m_Owner->Adapter().GetQueueFamilyIndices().graphics,
+    };
+    vk::CommandPool commandPool;
+    Utils::VerifyResult(device.createCommandPool(commandPoolInfo), STEXT("Failed to create calibration command pool!"), &commandPool);
+    vk::CommandBufferAllocateInfo allocInfo = {
+        .commandPool = commandPool,
+        .level = vk::CommandBufferLevel::ePrimary,
+        .commandBufferCount = 1,
+    };
+    std::vector<vk::CommandBuffer> cmds;
+    Utils::VerifyResult(device.allocateCommandBuffers(allocInfo), STEXT("Failed to allocate calibration command buffer!"), &cmds);
+    vk::Fence fence;
+    Utils::VerifyResult(device.createFence(vk::FenceCreateInfo{}), STEXT("Failed to create calibration fence!"), &fence);
+
+    auto cmd = cmds.front();
+    auto pool = m_Frames.front().pool;
+    vk::CommandBufferBeginInfo beginInfo = {
+        .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
+    };
+    Utils::VerifyResult(cmd.begin(beginInfo), STEXT("Failed to begin recording calibration command buffer!"));
+    cmd.resetQueryPool(pool, 0, 1);
+    cmd.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, pool, 0);
+    Utils::VerifyResult(cmd.end(), STEXT("Failed to end recording calibration command buffer!"));
+
+    vk::SubmitInfo submitInfo = {
+        .commandBufferCount = 1,
+        .pCommandBuffers = &cmd,
+    };
+    uint64_t cpuBefore = ProfileSystem::Now();
+    {
+        std::scoped_lock queueLock(m_Owner->QueueMutex(ERHIQueue::Graphics));
+        Utils::VerifyResult(m_Owner->Queue(ERHIQueue::Graphics).submit(submitInfo, fence), STEXT("Failed to submit calibration command buffer!"));
+    }
+    Utils::VerifyResult(device.waitForFences(fence, SA_RHI_TRUE, std::numeric_limits<uint64_t>::max()), STEXT("Failed to wait for calibration fence!"));
+    uint64_t cpuAfter = ProfileSystem::Now();
+
+    uint64_t timestamp = 0;
+    auto result = device.getQueryPoolResults(pool, 0, 1, sizeof(uint64_t), &timestamp, sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+    if (result == vk::Result::eSuccess)
+    {
+        double gpuNs = static_cast<double>(timestamp & m_TimestampMask) * m_TimestampPeriod;
+        m_ClockOffset = static_cast<int64_t>(cpuBefore + (cpuAfter - cpuBefore) / 2) - static_cast<int64_t>(gpuNs);
+        SA_LOG_INFO("GPU Profiler Initialized, {} query pools, {:.2f} ns per tick, clocks matched to +-{:.3f} ms.", m_Frames.size(),
+                    m_TimestampPeriod, (cpuAfter - cpuBefore) * 0.5e-6);
+    } else
+    {
+        SA_LOG_WARN("Failed to read the calibration timestamp, GPU zones are not aligned with CPU zones.");
+    }
+
+    device.destroyFence(fence);
+    device.destroyCommandPool(commandPool);
+}
+
+uint64_t VulkanGpuProfiler::ToProfileTime(uint64_t timestamp) const noexcept
+{
+    return static_cast<uint64_t>(static_cast<int64_t>(static_cast<double>(timestamp) * m_TimestampPeriod) + m_ClockOffset);
+}
+}
@@ -0,0 +1,79 @@
+﻿#pragma once
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanUtils.h"
+
+#include <string_view>
+
+namespace Snowy::Ark
+{
+class VulkanDevice;
+class ProfileSystem;
+
+/// <summary>
+/// GPU zones of the graphics queue, timestamps written around the recorded work into a query pool per frame
+/// in flight. Once the fence of a frame slot is waited on its timestamps are read back, moved to the clock of
+/// the CPU zones and handed to the profiler on a "GPU" track, a frame in flight behind the CPU.
+/// The two clocks are matched once at Init by a timestamp submitted alone, the middle of the CPU time around
+/// the submit and the wait is taken as the GPU time, so the tracks line up to about half that round trip.
+/// </summary>
+class VulkanGpuProfiler
+{
+public:
+    using OwnerType = VulkanDevice;
+
+    static constexpr uint32_t MaxZonesPerFrame = 256;
+    static constexpr uint32_t InvalidZone = UINT32_MAX;
+
+public:
+    VulkanGpuProfiler() = default;
+    ~VulkanGpuProfiler() = default;
+    VulkanGpuProfiler(const VulkanGpuProfiler&) = delete;
+    VulkanGpuProfiler(VulkanGpuProfiler&&) = delete;
+    VulkanGpuProfiler& operator=(const VulkanGpuProfiler&) = delete;
+    VulkanGpuProfiler& operator=(VulkanGpuProfiler&&) = delete;
+
+    // Stays disabled when the graphics queue has no timestamps
+    void Init(ObserverHandle<OwnerType> owner, ObserverHandle<ProfileSystem> profileSys, uint32_t frameCount);
+    void Destroy();
+
+    ObserverHandle<OwnerType> Owner() const noexcept { return m_Owner; }
+    ObserverHandle<VulkanRHI> Context() const noexcept { return m_Ctx; }
+
+    bool IsEnabled() const noexcept { return !m_Frames.empty(); }
+    // Zone names must outlive the profiler, this one does
+    const char* InternName(std::string_view name);
+
+    // Called once the fence of frameIndex has been waited on, submits the zones recorded in that slot
+    void BeginFrame(uint32_t frameIndex);
+    // First command of the frame, outside of a render pass
+    void RecordReset(vk::CommandBuffer cmd, uint32_t frameIndex);
+    // Returns InvalidZone once the frame is full, EndZone ignores it.
+    // Not inside a subpass whose contents are secondary command buffers
+    uint32_t BeginZone(vk::CommandBuffer cmd, const char* name);
+    void EndZone(vk::CommandBuffer cmd, uint32_t zone);
+
+private:
+    struct FrameQueries
+    {
+        vk::QueryPool pool;
+        std::vector<const char*> names;     // zone i owns queries 2i and 2i + 1
+        bool recorded = false;
+    };
+
+    void Calibrate();
+    uint64_t ToProfileTime(uint64_t timestamp) const noexcept;
+
+private:
+    ObserverHandle<OwnerType> m_Owner;
+    ObserverHandle<VulkanRHI> m_Ctx;
+    ObserverHandle<ProfileSystem> m_ProfileSys;
+
+    std::vector<FrameQueries> m_Frames;
+    uint32_t m_RecordingFrame = 0;
+    uint32_t m_Track = 0;
+    std::vector<uint64_t> m_Timestamps;
+
+    double m_TimestampPeriod = 1.0;         // ns per tick
+    uint64_t m_TimestampMask = UINT64_MAX;  // timestampValidBits of the graphics queue
+    int64_t m_ClockOffset = 0;              // CPU ns minus GPU ns
+};
+}
@@ -51,7 +51,10 @@ void VulkanInstance::Init(ObserverHandle<OwnerType> owner) noexcept
     {
         SetupDebugCallback();
     }
-    CreateSurface();
+    if (!m_Headless)
+    {
+        CreateSurface();
+    }
     CollectAdapters();
 }
 
@@ -69,6 +72,7 @@ VulkanDevice VulkanInstance::CreateDevice() noexcept
 {
     VulkanDevice device;
     device.RequiredExtensions().append_range(m_RequiredDeviceExtensions);
+    device.OptionalExtensions().append_range(m_OptionalDeviceExtensions);
     device.Init(this);
     SA_LOG_INFO("Vulkan Device Initialized.");
     return device;
@@ -37,9 +37,13 @@ public:
     uint32_t AdapterCount() const noexcept { return static_cast<uint32_t>(m_Adapters.size()); }
 
     bool& EnableValidationLayers() noexcept { return m_EnableValidationLayers; }
+    // No surface is created, adapters are picked without present support
+    bool& Headless() noexcept { return m_Headless; }
     std::vector<const AnsiChar*>& ValidationLayers() noexcept { return m_ValidationLayers; }
     std::vector<const AnsiChar*>& RequiredExtensions() noexcept { return m_RequiredExtensions; }
     std::vector<const AnsiChar*>& RequiredDeviceExtensions() noexcept { return m_RequiredDeviceExtensions; }
+    // Enabled when the picked adapter has them, they don't take part in the adapter selection
+    std::vector<const AnsiChar*>& OptionalDeviceExtensions() noexcept { return m_OptionalDeviceExtensions; }
     
     uint32_t GetFrameCountInFlight() const noexcept { return m_FrameCountInFlight; }
     void SetFrameCountInFlight(uint32_t count) noexcept { m_FrameCountInFlight = count; }
@@ -63,9 +67,11 @@ private:
     std::vector<VulkanAdapter> m_Adapters;
 
     bool m_EnableValidationLayers;
+    bool m_Headless = false;
     std::vector<const AnsiChar*> m_ValidationLayers;
     std::vector<const AnsiChar*> m_RequiredExtensions;
     std::vector<const AnsiChar*> m_RequiredDeviceExtensions;
+    std::vector<const AnsiChar*> m_OptionalDeviceExtensions;
 
     uint32_t m_FrameCountInFlight;
 };
@@ -0,0 +1,590 @@
+﻿#include "VulkanMemoryAllocator.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanAdapter.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace Snowy::Ark
+{
+using Utils = VulkanUtils;
+
+static vk::DeviceSize AlignUp(vk::DeviceSize value, vk::DeviceSize alignment) noexcept
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+/*----------------------------------------------------------*/
+// Linear
+/*----------------------------------------------------------*/
+bool VulkanLinearAllocator::Allocate(vk::DeviceSize size, vk::DeviceSize alignment, Out<vk::DeviceSize> offset, Out<uint64_t> handle) noexcept
+{
+    vk::DeviceSize alignedOffset = AlignUp(m_Cursor, alignment);
+    if (alignedOffset + size > m_Size)
+    {
+        return false;
+    }
+    m_Cursor = alignedOffset + size;
+    m_AllocationCount++;
+
+    *offset = alignedOffset;
+    *handle = alignedOffset;
+    return true;
+}
+
+void VulkanLinearAllocator::Free(uint64_t handle) noexcept
+{
+    // Memory is only reclaimed once every allocation of the block is released.
+    if (--m_AllocationCount == 0)
+    {
+        m_Cursor = 0;
+    }
+}
+
+/*----------------------------------------------------------*/
+// Buddy
+/*----------------------------------------------------------*/
+VulkanBuddyAllocator::VulkanBuddyAllocator(vk::DeviceSize size)
+    : VulkanSubAllocator(std::bit_floor(size))
+{
+    uint32_t orderCount = std::countr_zero(m_Size / MinBlockSize) + 1;
+    m_FreeLists.resize(orderCount);
+    m_FreeLists.back().emplace_back(0);
+}
+
+bool VulkanBuddyAllocator::Allocate(vk::DeviceSize size, vk::DeviceSize alignment, Out<vk::DeviceSize> offset, Out<uint64_t> handle) noexcept
+{
+    // Nodes of order k always start at a multiple of their own size, so rounding
+    // the request up to the alignment is enough to satisfy it.
+    vk::DeviceSize blockSize = std::bit_ceil(std::max({ size, alignment, MinBlockSize }));
+    if (blockSize > m_Size)
+    {
+        return false;
+    }
+    uint32_t order = std::countr_zero(blockSize / MinBlockSize);
+
+    uint32_t freeOrder = order;
+    while (freeOrder < m_FreeLists.size() && m_FreeLists[freeOrder].empty())
+    {
+        freeOrder++;
+    }
+    if (freeOrder == m_FreeLists.size())
+    {
+        return false;
+    }
+
+    vk::DeviceSize nodeOffset = m_FreeLists[freeOrder].back();
+    m_FreeLists[freeOrder].pop_back();
+    // Split down, keeping the upper halves free
+    while (freeOrder > order)
+    {
+        freeOrder--;
+        m_FreeLists[freeOrder].emplace_back(nodeOffset + (MinBlockSize << freeOrder));
+    }
+    m_AllocationCount++;
+
+    *offset = nodeOffset;
+    *handle = (static_cast<uint64_t>(order) << 56) | nodeOffset;
+    return true;
+}
+
+void VulkanBuddyAllocator::Free(uint64_t handle) noexcept
+{
+    uint32_t order = static_cast<uint32_t>(handle >> 56);
+    vk::DeviceSize nodeOffset = handle & ((1ull << 56) - 1);
+
+    while (order + 1 < m_FreeLists.size())
+    {
+        vk::DeviceSize buddyOffset = nodeOffset ^ (MinBlockSize << order);
+        auto& freeList = m_FreeLists[order];
+        auto iter = std::find(freeList.begin(), freeList.end(), buddyOffset);
+        if (iter == freeList.end())
+        {
+            break;
+        }
+        *iter = freeList.back();
+        freeList.pop_back();
+        nodeOffset = std::min(nodeOffset, buddyOffset);
+        order++;
+    }
+    m_FreeLists[order].emplace_back(nodeOffset);
+    m_AllocationCount--;
+}
+
+/*----------------------------------------------------------*/
+// TLSF
+/*----------------------------------------------------------*/
+VulkanTLSFAllocator::VulkanTLSFAllocator(vk::DeviceSize size)
+    : VulkanSubAllocator(size)
+{
+    for (auto& heads : m_FreeHeads)
+    {
+        heads.fill(NullNode);
+    }
+    uint32_t node = NewNode();
+    m_Nodes[node].offset = 0;
+    m_Nodes[node].size = size;
+    InsertFreeNode(node);
+}
+
+void VulkanTLSFAllocator::MappingInsert(vk::DeviceSize size, Out<uint32_t> fl, Out<uint32_t> sl) noexcept
+{
+    if (size < SmallBlockSize)
+    {
+        *fl = 0;
+        *sl = static_cast<uint32_t>(size / (SmallBlockSize / SLCount));
+    } else
+    {
+        uint32_t bit = 63 - std::countl_zero(size);
+        *sl = static_cast<uint32_t>(size >> (bit - SLCountLog2)) ^ SLCount;
+        *fl = bit - (FLShift - 1);
+    }
+}
+
+void VulkanTLSFAllocator::MappingSearch(vk::DeviceSize size, Out<uint32_t> fl, Out<uint32_t> sl) noexcept
+{
+    // Round up to the next second-level bucket so that any block found there fits
+    if (size >= SmallBlockSize)
+    {
+        uint32_t bit = 63 - std::countl_zero(size);
+        size += (1ull << (bit - SLCountLog2)) - 1;
+    } else
+    {
+        size = AlignUp(size, SmallBlockSize / SLCount);
+    }
+    MappingInsert(size, fl, sl);
+}
+
+uint32_t VulkanTLSFAllocator::FindSuitableNode(Ref<uint32_t> fl, Ref<uint32_t> sl) const noexcept
+{
+    if (fl >= FLCount)
+    {
+        return NullNode;
+    }
+    uint32_t slMap = sl < SLCount ? m_SLBitmaps[fl] & (~0u << sl) : 0;
+    if (slMap == 0)
+    {
+        uint64_t flMap = fl + 1 < 64 ? m_FLBitmap & (~0ull << (fl + 1)) : 0;
+        if (flMap == 0)
+        {
+            return NullNode;
+        }
+        fl = std::countr_zero(flMap);
+        slMap = m_SLBitmaps[fl];
+    }
+    sl = std::countr_zero(slMap);
+    return m_FreeHeads[fl][sl];
+}
+
+void VulkanTLSFAllocator::InsertFreeNode(uint32_t node) noexcept
+{
+    uint32_t fl, sl;
+    MappingInsert(m_Nodes[node].size, &fl, &sl);
+
+    uint32_t head = m_FreeHeads[fl][sl];
+    m_Nodes[node].isFree = true;
+    m_Nodes[node].prevFree = NullNode;
+    m_Nodes[node].nextFree = head;
+    if (head != NullNode)
+    {
+        m_Nodes[head].prevFree = node;
+    }
+    m_FreeHeads[fl][sl] = node;
+    m_FLBitmap |= 1ull << fl;
+    m_SLBitmaps[fl] |= 1u << sl;
+}
+
+void VulkanTLSFAllocator::RemoveFreeNode(uint32_t node) noexcept
+{
+    uint32_t fl, sl;
+    MappingInsert(m_Nodes[node].size, &fl, &sl);
+
+    auto& n = m_Nodes[node];
+    if (n.prevFree != NullNode)
+    {
+        m_Nodes[n.prevFree].nextFree = n.nextFree;
+    }
+    if (n.nextFree != NullNode)
+    {
+        m_Nodes[n.nextFree].prevFree = n.prevFree;
+    }
+    if (m_FreeHeads[fl][sl] == node)
+    {
+        m_FreeHeads[fl][sl] = n.nextFree;
+        if (n.nextFree == NullNode)
+        {
+            m_SLBitmaps[fl] &= ~(1u << sl);
+            if (m_SLBitmaps[fl] == 0)
+            {
+                m_FLBitmap &= ~(1ull << fl);
+            }
+        }
+    }
+    n.isFree = false;
+    n.prevFree = n.nextFree = NullNode;
+}
+
+uint32_t VulkanTLSFAllocator::SplitNode(uint32_t node, vk::DeviceSize size) noexcept
+{
+    // Splits [node] into [node: size][remainder], returns the remainder
+    uint32_t remainder = NewNode();
+    auto& n = m_Nodes[node];
+    auto& r = m_Nodes[remainder];
+    r.offset = n.offset + size;
+    r.size = n.size - size;
+    r.prevPhysical = node;
+    r.nextPhysical = n.nextPhysical;
+    if (n.nextPhysical != NullNode)
+    {
+        m_Nodes[n.nextPhysical].prevPhysical = remainder;
+    }
+    n.nextPhysical = remainder;
+    n.size = size;
+    return remainder;
+}
+
+uint32_t VulkanTLSFAllocator::NewNode() noexcept
+{
+    if (!m_RecycledNodes.empty())
+    {
+        uint32_t node = m_RecycledNodes.back();
+        m_RecycledNodes.pop_back();
+        m_Nodes[node] = Node{};
+        return node;
+    }
+    m_Nodes.emplace_back();
+    return static_cast<uint32_t>(m_Nodes.size() - 1);
+}
+
+void VulkanTLSFAllocator::ReleaseNode(uint32_t node) noexcept
+{
+    m_RecycledNodes.emplace_back(node);
+}
+
+bool VulkanTLSFAllocator::Allocate(vk::DeviceSize size, vk::DeviceSize alignment, Out<vk::DeviceSize> offset, Out<uint64_t> handle) noexcept
+{
+    // Worst case front padding is (alignment - 1)
+    vk::DeviceSize searchSize = size + alignment - 1;
+    uint32_t fl, sl;
+    MappingSearch(searchSize, &fl, &sl);
+    uint32_t node = FindSuitableNode(fl, sl);
+    if (node == NullNode)
+    {
+        return false;
+    }
+    RemoveFreeNode(node);
+
+    vk::DeviceSize padding = AlignUp(m_Nodes[node].offset, alignment) - m_Nodes[node].offset;
+    if (padding > 0)
+    {
+        uint32_t aligned = SplitNode(node, padding);
+        InsertFreeNode(node);
+        node = aligned;
+    }
+    if (m_Nodes[node].size > size)
+    {
+        uint32_t remainder = SplitNode(node, size);
+        InsertFreeNode(remainder);
+    }
+    m_AllocationCount++;
+
+    *offset = m_Nodes[node].offset;
+    *handle = node;
+    return true;
+}
+
+void VulkanTLSFAllocator::Free(uint64_t handle) noexcept
+{
+    uint32_t node = static_cast<uint32_t>(handle);
+
+    // Merge with previous physical neighbour
+    uint32_t prev = m_Nodes[node].prevPhysical;
+    if (prev != NullNode && m_Nodes[prev].isFree)
+    {
+        RemoveFreeNode(prev);
+        m_Nodes[prev].size += m_Nodes[node].size;
+        m_Nodes[prev].nextPhysical = m_Nodes[node].nextPhysical;
+        if (m_Nodes[node].nextPhysical != NullNode)
+        {
+            m_Nodes[m_Nodes[node].nextPhysical].prevPhysical = prev;
+        }
+        ReleaseNode(node);
+        node = prev;
+    }
+    // Merge with next physical neighbour
+    uint32_t next = m_Nodes[node].nextPhysical;
+    if (next != NullNode && m_Nodes[next].isFree)
+    {
+        RemoveFreeNode(next);
+        m_Nodes[node].size += m_Nodes[next].size;
+        m_Nodes[node].nextPhysical = m_Nodes[next].nextPhysical;
+        if (m_Nodes[next].nextPhysical != NullNode)
+        {
+            m_Nodes[m_Nodes[next].nextPhysical].prevPhysical = node;
+        }
+        ReleaseNode(next);
+    }
+    InsertFreeNode(node);
+    m_AllocationCount--;
+}
+
+/*----------------------------------------------------------*/
+// Memory Allocator
+/*----------------------------------------------------------*/
+void VulkanMemoryAllocator::Init(vk::Device device, In<VulkanAdapter> adapter) noexcept
+{
+    m_Device = device;
+    m_MemoryProperties = adapter->getMemoryProperties();
+
+    auto& limits = adapter.Properties().limits;
+    m_BufferImageGranularity = limits.bufferImageGranularity;
+    m_MaxAllocationCount = limits.maxMemoryAllocationCount;
+
+    m_Pools.resize(m_MemoryProperties.memoryTypeCount * SA_VK_NUM(EVulkanResourceKind::Count) * SA_VK_NUM(EVulkanAllocationStrategy::Count));
+    m_HeapStats.resize(m_MemoryProperties.memoryHeapCount);
+    for (uint32_t i = 0; i < m_MemoryProperties.memoryHeapCount; i++)
+    {
+        m_HeapStats[i].heapSize = m_MemoryProperties.memoryHeaps[i].size;
+    }
+}
+
+void VulkanMemoryAllocator::Destroy() noexcept
+{
+    std::scoped_lock lock(m_Mutex);
+    for (auto& pool : m_Pools)
+    {
+        for (auto& block : pool.blocks)
+        {
+            if (!block.allocator->IsEmpty())
+            {
+                SA_LOG_WARN("Memory block destroyed with {} live allocations!", block.allocator->AllocationCount());
+            }
+            FreeDeviceMemory(block.memory, block.mappedData != nullptr);
+        }
+        pool.blocks.clear();
+    }
+}
+
+VulkanAllocation VulkanMemoryAllocator::Allocate(In<vk::MemoryRequirements> requirements, vk::MemoryPropertyFlags properties,
+                                                 EVulkanResourceKind kind, EVulkanAllocationStrategy strategy) noexcept
+{
+    uint32_t memoryTypeIndex = FindMemoryType(requirements.memoryTypeBits, properties);
+
+    std::scoped_lock lock(m_Mutex);
+
+    vk::DeviceSize blockSize = PreferredBlockSize(memoryTypeIndex);
+    if (requirements.size > blockSize / 2)
+    {
+        return AllocateDedicated(requirements, memoryTypeIndex);
+    }
+
+    uint32_t poolIndex = PoolIndex(memoryTypeIndex, kind, strategy);
+    auto& pool = m_Pools[poolIndex];
+    pool.memoryTypeIndex = memoryTypeIndex;
+    pool.strategy = strategy;
+    pool.blockSize = blockSize;
+
+    VulkanAllocation allocation = {
+        .size = requirements.size,
+        .poolIndex = poolIndex,
+    };
+    auto tryAllocate = [&](uint32_t blockIndex) {
+        auto& block = pool.blocks[blockIndex];
+        if (block.allocator->Allocate(requirements.size, requirements.alignment, &allocation.offset, &allocation.handle))
+        {
+            allocation.memory = block.memory;
+            allocation.blockIndex = blockIndex;
+            allocation.mappedData = block.mappedData ? static_cast<std::byte*>(block.mappedData) + allocation.offset : nullptr;
+            return true;
+        }
+        return false;
+    };
+
+    bool allocated = false;
+    for (uint32_t i = 0; i < pool.blocks.size() && !allocated; i++)
+    {
+        allocated = tryAllocate(i);
+    }
+    if (!allocated)
+    {
+        MemoryBlock block;
+        if (!AllocateDeviceMemory(blockSize, memoryTypeIndex, &block.memory, &block.mappedData))
+        {
+            // Heap exhausted for a whole block, fall back to an exact sized allocation.
+            return AllocateDedicated(requirements, memoryTypeIndex);
+        }
+        switch (strategy)
+        {
+        case EVulkanAllocationStrategy::Linear:
+            block.allocator = MakeUnique<VulkanLinearAllocator>(blockSize);
+            break;
+        case EVulkanAllocationStrategy::Buddy:
+            block.allocator = MakeUnique<VulkanBuddyAllocator>(blockSize);
+            break;
+        default:
+            block.allocator = MakeUnique<VulkanTLSFAllocator>(blockSize);
+            break;
+        }
+        pool.blocks.emplace_back(std::move(block));
+
+        auto& stats = m_HeapStats[m_MemoryProperties.memoryTypes[memoryTypeIndex].heapIndex];
+        stats.blockCount++;
+        stats.blockBytes += blockSize;
+
+        allocated = tryAllocate(SA_VK_NUM(pool.blocks.size() - 1));
+    }
+    if (!allocated)
+    {
+        SA_LOG_ERROR("Failed to sub-allocate {} bytes from memory type {}!", requirements.size, memoryTypeIndex);
+        return {};
+    }
+
+    auto& stats = m_HeapStats[m_MemoryProperties.memoryTypes[memoryTypeIndex].heapIndex];
+    stats.allocationCount++;
+    stats.allocationBytes += allocation.size;
+    return allocation;
+}
+
+void VulkanMemoryAllocator::Free(Ref<VulkanAllocation> allocation) noexcept
+{
+    if (!allocation.IsValid())
+    {
+        return;
+    }
+
+    std::scoped_lock lock(m_Mutex);
+
+    if (allocation.IsDedicated())
+    {
+        uint32_t memoryTypeIndex = static_cast<uint32_t>(allocation.handle);
+        auto& stats = m_HeapStats[m_MemoryProperties.memoryTypes[memoryTypeIndex].heapIndex];
+        stats.dedicatedCount--;
+        stats.allocationCount--;
+        stats.allocationBytes -= allocation.size;
+        stats.blockBytes -= allocation.size;
+        FreeDeviceMemory(allocation.memory, allocation.mappedData != nullptr);
+        allocation = {};
+        return;
+    }
+
+    auto& pool = m_Pools[allocation.poolIndex];
+    auto& stats = m_HeapStats[m_MemoryProperties.memoryTypes[pool.memoryTypeIndex].heapIndex];
+    pool.blocks[allocation.blockIndex].allocator->Free(allocation.handle);
+    stats.allocationCount--;
+    stats.allocationBytes -= allocation.size;
+
+    // Keep a single empty block around per pool to avoid allocation ping-pong,
+    // release the trailing ones so block indices of live allocations stay valid.
+    while (pool.blocks.size() > 1 && pool.blocks.back().allocator->IsEmpty() && pool.blocks[pool.blocks.size() - 2].allocator->IsEmpty())
+    {
+        FreeDeviceMemory(pool.blocks.back().memory, pool.blocks.back().mappedData != nullptr);
+        pool.blocks.pop_back();
+        stats.blockCount--;
+        stats.blockBytes -= pool.blockSize;
+    }
+    allocation = {};
+}
+
+uint32_t VulkanMemoryAllocator::FindMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) const noexcept
+{
+    for (uint32_t i = 0; i < m_MemoryProperties.memoryTypeCount; i++)
+    {
+        if ((typeFilter & (1 << i)) && (m_MemoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+        {
+            return i;
+        }
+    }
+    SA_LOG_ERROR("Failed to find suitable memory type!");
+    return 0;
+}
+
+VulkanMemoryHeapStats VulkanMemoryAllocator::HeapStats(uint32_t heapIndex) const noexcept
+{
+    std::scoped_lock lock(m_Mutex);
+    return m_HeapStats[heapIndex];
+}
+
+void VulkanMemoryAllocator::LogStatistics() const noexcept
+{
+    std::scoped_lock lock(m_Mutex);
+    SA_LOG_INFO("Vulkan Memory: {} device allocations (limit {}).", m_DeviceAllocationCount, m_MaxAllocationCount);
+    for (uint32_t i = 0; i < m_HeapStats.size(); i++)
+    {
+        auto& stats = m_HeapStats[i];
+        SA_LOG_INFO("  Heap[{}]: {} blocks + {} dedicated, {} allocations, {}/{} KB used, heap {} MB.", i,
+                    stats.blockCount, stats.dedicatedCount, stats.allocationCount,
+                    stats.allocationBytes / 1024, stats.blockBytes / 1024, stats.heapSize / (1024 * 1024));
+    }
+}
+
+uint32_t VulkanMemoryAllocator::PoolIndex(uint32_t memoryTypeIndex, EVulkanResourceKind kind, EVulkanAllocationStrategy strategy) const noexcept
+{
+    // When the granularity is 1 linear and optimal resources may share blocks freely.
+    uint32_t kindIndex = m_BufferImageGranularity > 1 ? SA_VK_NUM(kind) : 0;
+    return (memoryTypeIndex * SA_VK_NUM(EVulkanResourceKind::Count) + kindIndex) * SA_VK_NUM(EVulkanAllocationStrategy::Count) + SA_VK_NUM(strategy);
+}
+
+vk::DeviceSize VulkanMemoryAllocator::PreferredBlockSize(uint32_t memoryTypeIndex) const noexcept
+{
+    auto heapSize = m_MemoryProperties.memoryHeaps[m_MemoryProperties.memoryTypes[memoryTypeIndex].heapIndex].size;
+    return heapSize <= SmallHeapMaxSize ? std::bit_floor(heapSize / 8) : LargeHeapBlockSize;
+}
+
+bool VulkanMemoryAllocator::AllocateDeviceMemory(vk::DeviceSize size, uint32_t memoryTypeIndex, Out<vk::DeviceMemory> memory, Out<void*> mappedData) noexcept
+{
+    if (m_DeviceAllocationCount >= m_MaxAllocationCount)
+    {
+        SA_LOG_ERROR("Reached maxMemoryAllocationCount({})!", m_MaxAllocationCount);
+        return false;
+    }
+
+    vk::MemoryAllocateInfo allocInfo = {
+        .allocationSize = size,
+        .memoryTypeIndex = memoryTypeIndex,
+    };
+    auto result = m_Device.allocateMemory(allocInfo);
+    if (result.result != vk::Result::eSuccess)
+    {
+        return false;
+    }
+    *memory = result.value;
+    m_DeviceAllocationCount++;
+
+    // Host visible blocks stay persistently mapped for their whole lifetime
+    *mappedData = nullptr;
+    if (m_MemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible)
+    {
+        Utils::VerifyResult(m_Device.mapMemory(*memory, 0, VK_WHOLE_SIZE, {}), STEXT("Failed to map memory block!"), mappedData);
+    }
+    return true;
+}
+
+void VulkanMemoryAllocator::FreeDeviceMemory(vk::DeviceMemory memory, bool mapped) noexcept
+{
+    if (mapped)
+    {
+        m_Device.unmapMemory(memory);
+    }
+    m_Device.freeMemory(memory);
+    m_DeviceAllocationCount--;
+}
+
+VulkanAllocation VulkanMemoryAllocator::AllocateDedicated(In<vk::MemoryRequirements> requirements, uint32_t memoryTypeIndex) noexcept
+{
+    VulkanAllocation allocation = {
+        .size = requirements.size,
+        .handle = memoryTypeIndex,
+    };
+    if (!AllocateDeviceMemory(requirements.size, memoryTypeIndex, &allocation.memory, &allocation.mappedData))
+    {
+        SA_LOG_ERROR("Failed to allocate {} bytes of dedicated memory!", requirements.size);
+        return {};
+    }
+
+    auto& stats = m_HeapStats[m_MemoryProperties.memoryTypes[memoryTypeIndex].heapIndex];
+    stats.dedicatedCount++;
+    stats.allocationCount++;
+    stats.allocationBytes += allocation.size;
+    stats.blockBytes += allocation.size;
+    return allocation;
+}
+}
@@ -0,0 +1,213 @@
+﻿#pragma once
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanUtils.h"
+
+#include <mutex>
+
+namespace Snowy::Ark
+{
+/// <summary>
+/// Sub-allocation strategy of a memory block
+/// </summary>
+enum class EVulkanAllocationStrategy : uint8_t
+{
+    Linear = 0, // bump pointer, reset when the block becomes empty
+    Buddy,      // power-of-two splitting, cheap merge
+    TLSF,       // two-level segregated fit, general purpose
+    // ========
+    Count,
+};
+
+/// <summary>
+/// Resource kind of an allocation, linear(buffer) and optimal(image) resources
+/// never share a block so that bufferImageGranularity can't be violated.
+/// </summary>
+enum class EVulkanResourceKind : uint8_t
+{
+    Linear = 0,
+    Optimal,
+    // ========
+    Count,
+};
+
+struct VulkanAllocation
+{
+    vk::DeviceMemory memory;
+    vk::DeviceSize offset = 0;
+    vk::DeviceSize size = 0;
+    void* mappedData = nullptr;
+
+    uint32_t poolIndex = UINT32_MAX;    // UINT32_MAX means dedicated allocation
+    uint32_t blockIndex = UINT32_MAX;
+    uint64_t handle = 0;
+
+    bool IsValid() const noexcept { return memory != SA_RHI_NULL; }
+    bool IsDedicated() const noexcept { return poolIndex == UINT32_MAX; }
+};
+
+struct VulkanMemoryHeapStats
+{
+    vk::DeviceSize heapSize = 0;
+    uint32_t blockCount = 0;
+    uint32_t dedicatedCount = 0;
+    uint32_t allocationCount = 0;
+    vk::DeviceSize blockBytes = 0;
+    vk::DeviceSize allocationBytes = 0;
+};
+
+/*----------------------------------------------------------*/
+// Block Sub-Allocators
+/*----------------------------------------------------------*/
+class VulkanSubAllocator
+{
+public:
+    VulkanSubAllocator(vk::DeviceSize size) : m_Size(size) {}
+    virtual ~VulkanSubAllocator() = default;
+
+    virtual bool Allocate(vk::DeviceSize size, vk::DeviceSize alignment, Out<vk::DeviceSize> offset, Out<uint64_t> handle) noexcept = 0;
+    virtual void Free(uint64_t handle) noexcept = 0;
+
+    vk::DeviceSize Size() const noexcept { return m_Size; }
+    uint32_t AllocationCount() const noexcept { return m_AllocationCount; }
+    bool IsEmpty() const noexcept { return m_AllocationCount == 0; }
+
+protected:
+    vk::DeviceSize m_Size;
+    uint32_t m_AllocationCount = 0;
+};
+
+class VulkanLinearAllocator final : public VulkanSubAllocator
+{
+public:
+    using VulkanSubAllocator::VulkanSubAllocator;
+
+    bool Allocate(vk::DeviceSize size, vk::DeviceSize alignment, Out<vk::DeviceSize> offset, Out<uint64_t> handle) noexcept override;
+    void Free(uint64_t handle) noexcept override;
+
+private:
+    vk::DeviceSize m_Cursor = 0;
+};
+
+class VulkanBuddyAllocator final : public VulkanSubAllocator
+{
+public:
+    static constexpr vk::DeviceSize MinBlockSize = 256;
+
+    VulkanBuddyAllocator(vk::DeviceSize size);
+
+    bool Allocate(vk::DeviceSize size, vk::DeviceSize alignment, Out<vk::DeviceSize> offset, Out<uint64_t> handle) noexcept override;
+    void Free(uint64_t handle) noexcept override;
+
+private:
+    std::vector<std::vector<vk::DeviceSize>> m_FreeLists;   // indexed by order, order 0 is MinBlockSize
+};
+
+class VulkanTLSFAllocator final : public VulkanSubAllocator
+{
+public:
+    static constexpr uint32_t SLCountLog2   = 5;
+    static constexpr uint32_t SLCount       = 1u << SLCountLog2;
+    static constexpr uint32_t FLShift       = SLCountLog2 + 3;
+    static constexpr uint32_t FLCount       = 48 - FLShift + 1;
+    static constexpr vk::DeviceSize SmallBlockSize = 1ull << FLShift;
+
+    VulkanTLSFAllocator(vk::DeviceSize size);
+
+    bool Allocate(vk::DeviceSize size, vk::DeviceSize alignment, Out<vk::DeviceSize> offset, Out<uint64_t> handle) noexcept override;
+    void Free(uint64_t handle) noexcept override;
+
+private:
+    static constexpr uint32_t NullNode = UINT32_MAX;
+    struct Node
+    {
+        vk::DeviceSize offset = 0;
+        vk::DeviceSize size = 0;
+        uint32_t prevPhysical = NullNode;
+        uint32_t nextPhysical = NullNode;
+        uint32_t prevFree = NullNode;
+        uint32_t nextFree = NullNode;
+        bool isFree = false;
+    };
+
+    static void MappingInsert(vk::DeviceSize size, Out<uint32_t> fl, Out<uint32_t> sl) noexcept;
+    static void MappingSearch(vk::DeviceSize size, Out<uint32_t> fl, Out<uint32_t> sl) noexcept;
+
+    uint32_t FindSuitableNode(Ref<uint32_t> fl, Ref<uint32_t> sl) const noexcept;
+    void InsertFreeNode(uint32_t node) noexcept;
+    void RemoveFreeNode(uint32_t node) noexcept;
+    uint32_t SplitNode(uint32_t node, vk::DeviceSize size) noexcept;
+    uint32_t NewNode() noexcept;
+    void ReleaseNode(uint32_t node) noexcept;
+
+private:
+    std::vector<Node> m_Nodes;
+    std::vector<uint32_t> m_RecycledNodes;
+
+    uint64_t m_FLBitmap = 0;
+    std::array<uint32_t, FLCount> m_SLBitmaps = {};
+    std::array<std::array<uint32_t, SLCount>, FLCount> m_FreeHeads;
+};
+
+/*----------------------------------------------------------*/
+// Memory Allocator
+/*----------------------------------------------------------*/
+class VulkanAdapter;
+
+class VulkanMemoryAllocator
+{
+public:
+    static constexpr vk::DeviceSize LargeHeapBlockSize = 64ull * 1024 * 1024;
+    static constexpr vk::DeviceSize SmallHeapMaxSize   = 1024ull * 1024 * 1024;
+
+    VulkanMemoryAllocator() = default;
+    ~VulkanMemoryAllocator() = default;
+    VulkanMemoryAllocator(const VulkanMemoryAllocator&) = delete;
+    VulkanMemoryAllocator(VulkanMemoryAllocator&&) = delete;
+    VulkanMemoryAllocator& operator=(const VulkanMemoryAllocator&) = delete;
+    VulkanMemoryAllocator& operator=(VulkanMemoryAllocator&&) = delete;
+
+    void Init(vk::Device device, In<VulkanAdapter> adapter) noexcept;
+    void Destroy() noexcept;
+
+    VulkanAllocation Allocate(In<vk::MemoryRequirements> requirements, vk::MemoryPropertyFlags properties,
+                              EVulkanResourceKind kind, EVulkanAllocationStrategy strategy = EVulkanAllocationStrategy::TLSF) noexcept;
+    void Free(Ref<VulkanAllocation> allocation) noexcept;
+
+    uint32_t FindMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) const noexcept;
+
+    uint32_t HeapCount() const noexcept { return m_MemoryProperties.memoryHeapCount; }
+    VulkanMemoryHeapStats HeapStats(uint32_t heapIndex) const noexcept;
+    void LogStatistics() const noexcept;
+
+private:
+    struct MemoryBlock
+    {
+        vk::DeviceMemory memory;
+        void* mappedData = nullptr;
+        UniqueHandle<VulkanSubAllocator> allocator;
+    };
+    struct MemoryPool
+    {
+        uint32_t memoryTypeIndex = 0;
+        EVulkanAllocationStrategy strategy = EVulkanAllocationStrategy::TLSF;
+        vk::DeviceSize blockSize = 0;
+        std::vector<MemoryBlock> blocks;
+    };
+
+    uint32_t PoolIndex(uint32_t memoryTypeIndex, EVulkanResourceKind kind, EVulkanAllocationStrategy strategy) const noexcept;
+    vk::DeviceSize PreferredBlockSize(uint32_t memoryTypeIndex) const noexcept;
+    bool AllocateDeviceMemory(vk::DeviceSize size, uint32_t memoryTypeIndex, Out<vk::DeviceMemory> memory, Out<void*> mappedData) noexcept;
+    void FreeDeviceMemory(vk::DeviceMemory memory, bool mapped) noexcept;
+    VulkanAllocation AllocateDedicated(In<vk::MemoryRequirements> requirements, uint32_t memoryTypeIndex) noexcept;
+
+private:
+    vk::Device m_Device;
+    vk::PhysicalDeviceMemoryProperties m_MemoryProperties;
+    vk::DeviceSize m_BufferImageGranularity = 1;
+    uint32_t m_MaxAllocationCount = 4096;
+    uint32_t m_DeviceAllocationCount = 0;
+
+    std::vector<MemoryPool> m_Pools;
+    std::vector<VulkanMemoryHeapStats> m_HeapStats;
+    mutable std::mutex m_Mutex;
+};
+}
@@ -0,0 +1,175 @@
+﻿#include "VulkanOffscreenTarget.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanRHI.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanDevice.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace Snowy::Ark
+{
+using Utils = VulkanUtils;
+
+void VulkanOffscreenTarget::Init(ObserverHandle<OwnerType> owner, vk::Extent2D extent, vk::Format format, uint32_t frameCount, ReadbackFunc readback)
+{
+    m_Owner = owner;
+    m_Ctx = owner->Context();
+    m_Format = format;
+    m_Extent = extent;
+    m_Readback = std::move(readback);
+    auto& device = m_Owner->Native();
+
+    vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eColorAttachment;
+    if (m_Readback)
+    {
+        usage |= vk::ImageUsageFlagBits::eTransferSrc;
+    }
+    vk::ImageCreateInfo imageInfo = {
+        .flags = {},
+        .imageType = vk::ImageType::e2D,
+        .format = m_Format,
+        .extent = vk::Extent3D {
+            .width = m_Extent.width,
+            .height = m_Extent.height,
+            .depth = 1
+        },
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .samples = vk::SampleCountFlagBits::e1,
+        .tiling = vk::ImageTiling::eOptimal,
+        .usage = usage,
+        .sharingMode = vk::SharingMode::eExclusive,
+        .initialLayout = vk::ImageLayout::eUndefined,
+    };
+    m_Images.resize(frameCount);
+    m_Allocations.resize(frameCount);
+    m_Views.resize(frameCount);
+    for (uint32_t i = 0; i < frameCount; i++)
+    {
+        Utils::VerifyResult(device.createImage(imageInfo), std::format(STEXT("Failed to create offscreen image[{}]!"), i), &m_Images[i]);
+        m_Allocations[i] = m_Owner->Allocator().Allocate(device.getImageMemoryRequirements(m_Images[i]), vk::MemoryPropertyFlagBits::eDeviceLocal,
+                                                         EVulkanResourceKind::Optimal);
+        Utils::VerifyResult(device.bindImageMemory(m_Images[i], m_Allocations[i].memory, m_Allocations[i].offset),
+                            STEXT("Failed to bind offscreen image memory!"));
+
+        vk::ImageViewCreateInfo viewInfo = {
+            .image = m_Images[i],
+            .viewType = vk::ImageViewType::e2D,
+            .format = m_Format,
+            .components = vk::ComponentMapping{},
+            .subresourceRange = vk::ImageSubresourceRange
+            {
+                .aspectMask = vk::ImageAspectFlagBits::eColor,
+                .baseMipLevel = 0,
+                .levelCount = 1,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+        };
+        Utils::VerifyResult(device.createImageView(viewInfo), std::format(STEXT("Failed to create offscreen image view[{}]!"), i), &m_Views[i]);
+    }
+
+    if (m_Readback)
+    {
+        vk::DeviceSize readbackSize = vk::DeviceSize(m_Extent.width) * m_Extent.height * BytesPerTexel;
+        m_ReadbackBuffers.resize(frameCount);
+        for (auto&& readbackBuffer : m_ReadbackBuffers)
+        {
+            readbackBuffer = m_Owner->CreateBuffer(readbackSize, vk::BufferUsageFlagBits::eTransferDst,
+                                                   vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+        }
+        m_ReadbackFrames.assign(frameCount, UINT64_MAX);
+    }
+
+    SA_LOG_INFO("Offscreen Target Initialized, {} images of {}x{}, readback {}.", frameCount, m_Extent.width, m_Extent.height,
+                m_Readback ? "on" : "off");
+}
+
+void VulkanOffscreenTarget::Destroy()
+{
+    auto& device = m_Owner->Native();
+    for (size_t i = 0; i < m_Images.size(); i++)
+    {
+        device.destroyImageView(m_Views[i]);
+        device.destroyImage(m_Images[i]);
+        m_Owner->Allocator().Free(m_Allocations[i]);
+    }
+    m_Views.clear();
+    m_Images.clear();
+    m_Allocations.clear();
+
+    for (auto&& readbackBuffer : m_ReadbackBuffers)
+    {
+        readbackBuffer->Destroy();
+    }
+    m_ReadbackBuffers.clear();
+    m_ReadbackFrames.clear();
+}
+
+vk::ImageLayout VulkanOffscreenTarget::FinalLayout() const noexcept
+{
+    // The readback copy leaves it as a transfer source, otherwise nothing reads the image after the scene
+    return m_Readback ? vk::ImageLayout::eTransferSrcOptimal : vk::ImageLayout::eColorAttachmentOptimal;
+}
+
+void VulkanOffscreenTarget::BeginFrame(uint32_t frameIndex)
+{
+    if (m_Readback)
+    {
+        DeliverReadback(frameIndex);
+    }
+}
+
+void VulkanOffscreenTarget::RecordReadback(vk::CommandBuffer cmd, uint32_t frameIndex, uint64_t frameNumber)
+{
+    vk::BufferImageCopy copyRegion = {
+        .bufferOffset = 0,
+        .bufferRowLength = 0,
+        .bufferImageHeight = 0,
+        .imageSubresource = vk::ImageSubresourceLayers
+        {
+            .aspectMask = vk::ImageAspectFlagBits::eColor,
+            .mipLevel = 0,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        },
+        .imageOffset = { 0, 0, 0 },
+        .imageExtent = { m_Extent.width, m_Extent.height, 1 },
+    };
+    cmd.copyImageToBuffer(m_Images[frameIndex], vk::ImageLayout::eTransferSrcOptimal, *m_ReadbackBuffers[frameIndex], copyRegion);
+
+    // The fence wait of the frame makes the host see the copy
+    vk::MemoryBarrier readbackBarrier = {
+        .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+        .dstAccessMask = vk::AccessFlagBits::eHostRead,
+    };
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, {}, readbackBarrier, nullptr, nullptr);
+    m_ReadbackFrames[frameIndex] = frameNumber;
+}
+
+void VulkanOffscreenTarget::FlushReadbacks()
+{
+    if (!m_Readback)
+    {
+        return;
+    }
+
+    std::vector<uint32_t> order(m_ReadbackFrames.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::ranges::sort(order, {}, [this](uint32_t frameIndex) { return m_ReadbackFrames[frameIndex]; });
+    for (auto frameIndex : order)
+    {
+        DeliverReadback(frameIndex);
+    }
+}
+
+void VulkanOffscreenTarget::DeliverReadback(uint32_t frameIndex)
+{
+    uint64_t frameNumber = std::exchange(m_ReadbackFrames[frameIndex], UINT64_MAX);
+    if (frameNumber == UINT64_MAX)
+    {
+        return;
+    }
+    auto& readbackBuffer = *m_ReadbackBuffers[frameIndex];
+    m_Readback(frameNumber, ArrayIn<uint8_t>(static_cast<const uint8_t*>(readbackBuffer.MappedData()), readbackBuffer.Size()));
+}
+}
@@ -0,0 +1,75 @@
+﻿#pragma once
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanUtils.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanMemoryAllocator.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanBuffer.h"
+
+#include <functional>
+
+namespace Snowy::Ark
+{
+class VulkanDevice;
+
+/// <summary>
+/// Back buffers of the headless mode, drawn like swapchain images but never presented. There is an image
+/// per frame in flight, so the image of a frame is free again once its fence is waited on and nothing has
+/// to be acquired. With readback on, each image is copied into a persistently mapped buffer of the same
+/// frame slot, the pool is reused every frame and the texels reach the callback when the slot comes around.
+/// </summary>
+class VulkanOffscreenTarget
+{
+public:
+    using OwnerType = VulkanDevice;
+    // Tightly packed rows of the image format, only valid during the call
+    using ReadbackFunc = std::function<void(uint64_t frameNumber, ArrayIn<uint8_t> texels)>;
+
+    static constexpr uint32_t BytesPerTexel = 4;    // 8 bit RGBA or BGRA formats only
+
+public:
+    VulkanOffscreenTarget() = default;
+    ~VulkanOffscreenTarget() = default;
+    VulkanOffscreenTarget(const VulkanOffscreenTarget&) = delete;
+    VulkanOffscreenTarget(VulkanOffscreenTarget&&) = delete;
+    VulkanOffscreenTarget& operator=(const VulkanOffscreenTarget&) = delete;
+    VulkanOffscreenTarget& operator=(VulkanOffscreenTarget&&) = delete;
+
+    // A null readback skips the pool, the images then only need to be color attachments
+    void Init(ObserverHandle<OwnerType> owner, vk::Extent2D extent, vk::Format format, uint32_t frameCount, ReadbackFunc readback = {});
+    void Destroy();
+
+    ObserverHandle<OwnerType> Owner() const noexcept { return m_Owner; }
+    ObserverHandle<VulkanRHI> Context() const noexcept { return m_Ctx; }
+
+    vk::Format Format() const noexcept { return m_Format; }
+    vk::Extent2D Extent() const noexcept { return m_Extent; }
+    uint32_t Count() const noexcept { return SA_VK_NUM(m_Images.size()); }
+    const vk::Image& Image(size_t idx) const noexcept { return m_Images[idx]; }
+    const vk::ImageView& View(size_t idx) const noexcept { return m_Views[idx]; }
+    bool HasReadback() const noexcept { return static_cast<bool>(m_Readback); }
+    // Layout the frame graph leaves the image in
+    vk::ImageLayout FinalLayout() const noexcept;
+
+    // Called once the fence of frameIndex has been waited on, hands the readback of that slot to the callback
+    void BeginFrame(uint32_t frameIndex);
+    // Outside of a render pass, with the image of frameIndex in transfer src layout
+    void RecordReadback(vk::CommandBuffer cmd, uint32_t frameIndex, uint64_t frameNumber);
+    // Hands every readback still in flight to the callback in frame order, the device must be idle
+    void FlushReadbacks();
+
+private:
+    void DeliverReadback(uint32_t frameIndex);
+
+private:
+    ObserverHandle<OwnerType> m_Owner;
+    ObserverHandle<VulkanRHI> m_Ctx;
+
+    vk::Format m_Format = vk::Format::eUndefined;
+    vk::Extent2D m_Extent = {};
+    std::vector<vk::Image> m_Images;
+    std::vector<VulkanAllocation> m_Allocations;
+    std::vector<vk::ImageView> m_Views;
+
+    ReadbackFunc m_Readback;
+    std::vector<UniqueHandle<VulkanBuffer>> m_ReadbackBuffers;     // per frame in flight, host visible
+    std::vector<uint64_t> m_ReadbackFrames;                         // frame number copied into each buffer, UINT64_MAX when empty
+};
+}
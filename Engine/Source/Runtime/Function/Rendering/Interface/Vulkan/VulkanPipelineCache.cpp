@@ -0,0 +1,423 @@
+﻿#include "VulkanPipelineCache.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanRHI.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanDevice.h"
+#include "Engine/Source/Runtime/Core/Job/JobSystem.h"
+#include "Engine/Source/Runtime/Function/Global/GlobalContext.h"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+namespace Snowy::Ark
+{
+using Utils = VulkanUtils;
+
+// FNV-1a
+static void HashBytes(Ref<uint64_t> hash, const void* data, size_t size) noexcept
+{
+    auto bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+}
+
+template<typename T>
+static void HashValue(Ref<uint64_t> hash, In<T> value) noexcept
+{
+    HashBytes(hash, &value, sizeof(T));
+}
+
+uint64_t VulkanGraphicsPipelineDesc::Hash() const noexcept
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    HashValue(hash, static_cast<VkShaderModule>(vertexShader));
+    HashValue(hash, static_cast<VkShaderModule>(fragmentShader));
+    HashBytes(hash, vertexBindings.data(), vertexBindings.size() * sizeof(vk::VertexInputBindingDescription));
+    HashBytes(hash, vertexAttributes.data(), vertexAttributes.size() * sizeof(vk::VertexInputAttributeDescription));
+    HashValue(hash, topology);
+    HashValue(hash, polygonMode);
+    HashValue(hash, static_cast<VkCullModeFlags>(cullMode));
+    HashValue(hash, frontFace);
+    HashValue(hash, depthTest);
+    HashValue(hash, depthWrite);
+    HashValue(hash, depthCompareOp);
+    HashValue(hash, blendEnable);
+    HashValue(hash, static_cast<VkPipelineLayout>(layout));
+    HashValue(hash, subpass);
+    HashBytes(hash, colorFormats.data(), colorFormats.size() * sizeof(vk::Format));
+    HashValue(hash, depthFormat);
+    return hash;
+}
+
+bool VulkanGraphicsPipelineDesc::operator==(In<VulkanGraphicsPipelineDesc> other) const noexcept
+{
+    return vertexShader == other.vertexShader && fragmentShader == other.fragmentShader &&
+           vertexBindings == other.vertexBindings && vertexAttributes == other.vertexAttributes &&
+           topology == other.topology && polygonMode == other.polygonMode && cullMode == other.cullMode && frontFace == other.frontFace &&
+           depthTest == other.depthTest && depthWrite == other.depthWrite && depthCompareOp == other.depthCompareOp &&
+           blendEnable == other.blendEnable && layout == other.layout &&
+           subpass == other.subpass && colorFormats == other.colorFormats && depthFormat == other.depthFormat;
+}
+
+uint64_t VulkanComputePipelineDesc::Hash() const noexcept
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    HashValue(hash, vk::PipelineBindPoint::eCompute);
+    HashValue(hash, static_cast<VkShaderModule>(shader));
+    HashValue(hash, static_cast<VkPipelineLayout>(layout));
+    return hash;
+}
+
+bool VulkanComputePipelineDesc::operator==(In<VulkanComputePipelineDesc> other) const noexcept
+{
+    return shader == other.shader && layout == other.layout;
+}
+
+void VulkanPipelineCache::Init(ObserverHandle<OwnerType> owner, In<std::filesystem::path> path)
+{
+    m_Owner = owner;
+    m_Ctx = owner->Context();
+    m_Path = path;
+
+    auto initialData = LoadFromDisk();
+    vk::PipelineCacheCreateInfo createInfo = {
+        .initialDataSize = initialData.size(),
+        .pInitialData = initialData.data(),
+    };
+    Utils::VerifyResult(m_Owner->Native().createPipelineCache(createInfo), STEXT("Failed to create pipeline cache!"), &m_Native);
+    SA_LOG_INFO("Create Pipeline Cache, {} bytes loaded from disk.", initialData.size());
+}
+
+void VulkanPipelineCache::Destroy()
+{
+    WaitIdle();
+    Save();
+    for (auto&& [desc, entry] : m_GraphicsPipelines)
+    {
+        m_Owner->Native().destroyPipeline(entry.pipeline);
+    }
+    for (auto&& [desc, entry] : m_ComputePipelines)
+    {
+        m_Owner->Native().destroyPipeline(entry.pipeline);
+    }
+    m_GraphicsPipelines.clear();
+    m_ComputePipelines.clear();
+    m_Owner->Native().destroyPipelineCache(m_Native);
+}
+
+void VulkanPipelineCache::RequestGraphicsPipeline(In<VulkanGraphicsPipelineDesc> desc)
+{
+    ObserverHandle<Entry> entry;
+    {
+        std::scoped_lock lock(m_Mutex);
+        auto [it, inserted] = m_GraphicsPipelines.try_emplace(desc);
+        if (!inserted)
+        {
+            return;
+        }
+        entry = &it->second;
+        m_PendingCount++;
+    }
+    g_RuntimeContext.jobSys->Submit([this, entry, desc] {
+        Publish(*entry, CreateGraphicsPipeline(desc));
+    });
+}
+
+vk::Pipeline VulkanPipelineCache::GetGraphicsPipeline(In<VulkanGraphicsPipelineDesc> desc)
+{
+    ObserverHandle<Entry> entry;
+    {
+        std::unique_lock lock(m_Mutex);
+        auto [it, inserted] = m_GraphicsPipelines.try_emplace(desc);
+        if (!inserted)
+        {
+            m_ReadyCondition.wait(lock, [&] { return it->second.ready; });
+            return it->second.pipeline;
+        }
+        entry = &it->second;
+        m_PendingCount++;
+    }
+
+    auto pipeline = CreateGraphicsPipeline(desc);
+    Publish(*entry, pipeline);
+    return pipeline;
+}
+
+vk::Pipeline VulkanPipelineCache::GetComputePipeline(In<VulkanComputePipelineDesc> desc)
+{
+    ObserverHandle<Entry> entry;
+    {
+        std::unique_lock lock(m_Mutex);
+        auto [it, inserted] = m_ComputePipelines.try_emplace(desc);
+        if (!inserted)
+        {
+            m_ReadyCondition.wait(lock, [&] { return it->second.ready; });
+            return it->second.pipeline;
+        }
+        entry = &it->second;
+        m_PendingCount++;
+    }
+
+    auto pipeline = CreateComputePipeline(desc);
+    Publish(*entry, pipeline);
+    return pipeline;
+}
+
+void VulkanPipelineCache::WaitIdle()
+{
+    std::unique_lock lock(m_Mutex);
+    m_ReadyCondition.wait(lock, [this] { return m_PendingCount == 0; });
+}
+
+void VulkanPipelineCache::Save()
+{
+    if (m_Path.empty())
+    {
+        return;
+    }
+
+    std::vector<uint8_t> data;
+    Utils::VerifyResult(m_Owner->Native().getPipelineCacheData(m_Native), STEXT("Failed to get pipeline cache data!"), &data);
+
+    auto header = MakeFileHeader();
+    header.dataSize = data.size();
+    header.dataHash = 0xcbf29ce484222325ull;
+    HashBytes(header.dataHash, data.data(), data.size());
+
+    // Written aside and renamed so a crash never leaves a truncated cache behind
+    std::error_code error;
+    std::filesystem::create_directories(m_Path.parent_path(), error);
+    auto tempPath = m_Path;
+    tempPath += ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            SA_LOG_WARN("Failed to write pipeline cache: {}", PATH_TO_SSTR(tempPath));
+            return;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    }
+    std::filesystem::rename(tempPath, m_Path, error);
+    if (error)
+    {
+        SA_LOG_WARN("Failed to write pipeline cache: {}", PATH_TO_SSTR(m_Path));
+        return;
+    }
+    SA_LOG_INFO("Save Pipeline Cache, {} bytes.", data.size());
+}
+
+VulkanPipelineCache::FileHeader VulkanPipelineCache::MakeFileHeader() const noexcept
+{
+    auto& properties = m_Owner->Adapter().Properties();
+    auto& idProperties = m_Owner->Adapter().IDProperties();
+
+    FileHeader header = {
+        .magic = FileMagic,
+        .version = FileVersion,
+        .vendorID = properties.vendorID,
+        .deviceID = properties.deviceID,
+        .driverVersion = properties.driverVersion,
+    };
+    std::memcpy(header.driverUUID, idProperties.driverUUID.data(), VK_UUID_SIZE);
+    std::memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID.data(), VK_UUID_SIZE);
+    return header;
+}
+
+std::vector<uint8_t> VulkanPipelineCache::LoadFromDisk() const
+{
+    if (m_Path.empty())
+    {
+        return {};
+    }
+    std::ifstream file(m_Path, std::ios::binary);
+    if (!file.is_open())
+    {
+        return {};
+    }
+
+    FileHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+    {
+        SA_LOG_WARN("Pipeline cache is truncated, discarded.");
+        return {};
+    }
+
+    // Driver caches are only portable to the exact same device and driver build
+    auto expected = MakeFileHeader();
+    if (header.magic != expected.magic || header.version != expected.version ||
+        header.vendorID != expected.vendorID || header.deviceID != expected.deviceID || header.driverVersion != expected.driverVersion ||
+        std::memcmp(header.driverUUID, expected.driverUUID, VK_UUID_SIZE) != 0 ||
+        std::memcmp(header.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+    {
+        SA_LOG_INFO("Pipeline cache was written by another device or driver, discarded.");
+        return {};
+    }
+
+    std::vector<uint8_t> data(header.dataSize);
+    uint64_t dataHash = 0xcbf29ce484222325ull;
+    if (file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size())))
+    {
+        HashBytes(dataHash, data.data(), data.size());
+    }
+    if (!file || dataHash != header.dataHash)
+    {
+        SA_LOG_WARN("Pipeline cache is corrupted, discarded.");
+        return {};
+    }
+    return data;
+}
+
+vk::Pipeline VulkanPipelineCache::CreateGraphicsPipeline(In<VulkanGraphicsPipelineDesc> desc)
+{
+    auto startTime = std::chrono::steady_clock::now();
+
+    std::array<vk::PipelineShaderStageCreateInfo, 2> shaderStages = {};
+    shaderStages[0] = {
+        .stage = vk::ShaderStageFlagBits::eVertex,
+        .module = desc.vertexShader,
+        .pName = "main",
+    };
+    shaderStages[1] = {
+        .stage = vk::ShaderStageFlagBits::eFragment,
+        .module = desc.fragmentShader,
+        .pName = "main",
+    };
+
+    vk::PipelineVertexInputStateCreateInfo vertexInputInfo = {
+        .vertexBindingDescriptionCount = SA_VK_NUM(desc.vertexBindings.size()),
+        .pVertexBindingDescriptions = desc.vertexBindings.data(),
+        .vertexAttributeDescriptionCount = SA_VK_NUM(desc.vertexAttributes.size()),
+        .pVertexAttributeDescriptions = desc.vertexAttributes.data(),
+    };
+
+    vk::PipelineInputAssemblyStateCreateInfo inputAssembly = {
+        .topology = desc.topology,
+        .primitiveRestartEnable = SA_RHI_FALSE,
+    };
+
+    // Viewport and scissor are dynamic
+    vk::PipelineViewportStateCreateInfo viewportState = {
+        .viewportCount = 1,
+        .pViewports = nullptr,
+        .scissorCount = 1,
+        .pScissors = nullptr,
+    };
+
+    vk::PipelineRasterizationStateCreateInfo rasterizer = {
+        .depthClampEnable = SA_RHI_FALSE,
+        .rasterizerDiscardEnable = SA_RHI_FALSE,
+        .polygonMode = desc.polygonMode,
+        .cullMode = desc.cullMode,
+        .frontFace = desc.frontFace,
+        .depthBiasEnable = SA_RHI_FALSE,
+        .depthBiasConstantFactor = 0.0f,
+        .depthBiasClamp = 0.0f,
+        .depthBiasSlopeFactor = 0.0f,
+        .lineWidth = 1.0f,
+    };
+
+    vk::PipelineMultisampleStateCreateInfo multisampling = {
+        .rasterizationSamples = vk::SampleCountFlagBits::e1,
+        .sampleShadingEnable = SA_RHI_FALSE,
+        .minSampleShading = 1,
+        .pSampleMask = nullptr,
+        .alphaToCoverageEnable = SA_RHI_FALSE,
+        .alphaToOneEnable = SA_RHI_FALSE,
+    };
+
+    vk::PipelineDepthStencilStateCreateInfo depthStencil = {
+        .depthTestEnable = desc.depthTest,
+        .depthWriteEnable = desc.depthWrite,
+        .depthCompareOp = desc.depthCompareOp,
+        .depthBoundsTestEnable = SA_RHI_FALSE,
+        .stencilTestEnable = SA_RHI_FALSE,
+        .front = {},
+        .back = {},
+        .minDepthBounds = 0.0f,
+        .maxDepthBounds = 1.0f,
+    };
+
+    std::vector<vk::PipelineColorBlendAttachmentState> colorBlendAttachments(desc.colorFormats.size(), vk::PipelineColorBlendAttachmentState {
+        .blendEnable = desc.blendEnable,
+        .srcColorBlendFactor = desc.blendEnable ? vk::BlendFactor::eSrcAlpha : vk::BlendFactor::eOne,
+        .dstColorBlendFactor = desc.blendEnable ? vk::BlendFactor::eOneMinusSrcAlpha : vk::BlendFactor::eZero,
+        .colorBlendOp = vk::BlendOp::eAdd,
+        .srcAlphaBlendFactor = vk::BlendFactor::eOne,
+        .dstAlphaBlendFactor = vk::BlendFactor::eZero,
+        .alphaBlendOp = vk::BlendOp::eAdd,
+        .colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA,
+    });
+
+    vk::PipelineColorBlendStateCreateInfo colorBlending = {
+        .logicOpEnable = SA_RHI_FALSE,
+        .logicOp = vk::LogicOp::eCopy,
+        .attachmentCount = SA_VK_NUM(colorBlendAttachments.size()),
+        .pAttachments = colorBlendAttachments.data(),
+        .blendConstants = std::array{0.0f, 0.0f, 0.0f, 0.0f},
+    };
+
+    std::array<vk::DynamicState, 2> dynamicStates = { vk::DynamicState::eViewport, vk::DynamicState::eScissor };
+
+    vk::PipelineDynamicStateCreateInfo dynamicStateCreateInfo = {
+        .dynamicStateCount = SA_VK_NUM(dynamicStates.size()),
+        .pDynamicStates = dynamicStates.data(),
+    };
+
+    vk::GraphicsPipelineCreateInfo graphicsPipelineInfo = {
+        .stageCount = SA_VK_NUM(shaderStages.size()),
+        .pStages = shaderStages.data(),
+        .pVertexInputState = &vertexInputInfo,
+        .pInputAssemblyState = &inputAssembly,
+        .pViewportState = &viewportState,
+        .pRasterizationState = &rasterizer,
+        .pMultisampleState = &multisampling,
+        .pDepthStencilState = &depthStencil,
+        .pColorBlendState = &colorBlending,
+        .pDynamicState = &dynamicStateCreateInfo,
+        .layout = desc.layout,
+        .renderPass = desc.renderPass,
+        .subpass = desc.subpass,
+        .basePipelineHandle = SA_RHI_NULL,
+        .basePipelineIndex = -1,
+    };
+
+    vk::Pipeline pipeline;
+    Utils::VerifyResult(m_Owner->Native().createGraphicsPipeline(m_Native, graphicsPipelineInfo), STEXT("Failed to create graphics pipeline!"), &pipeline);
+
+    auto duration = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    SA_LOG_INFO("Create Graphics Pipeline {:016x}, {:.2f} ms.", desc.Hash(), duration);
+    return pipeline;
+}
+
+vk::Pipeline VulkanPipelineCache::CreateComputePipeline(In<VulkanComputePipelineDesc> desc)
+{
+    vk::ComputePipelineCreateInfo computePipelineInfo = {
+        .stage = vk::PipelineShaderStageCreateInfo {
+            .stage = vk::ShaderStageFlagBits::eCompute,
+            .module = desc.shader,
+            .pName = "main",
+        },
+        .layout = desc.layout,
+        .basePipelineHandle = SA_RHI_NULL,
+        .basePipelineIndex = -1,
+    };
+
+    vk::Pipeline pipeline;
+    Utils::VerifyResult(m_Owner->Native().createComputePipeline(m_Native, computePipelineInfo), STEXT("Failed to create compute pipeline!"), &pipeline);
+    return pipeline;
+}
+
+void VulkanPipelineCache::Publish(Ref<Entry> entry, vk::Pipeline pipeline)
+{
+    {
+        std::scoped_lock lock(m_Mutex);
+        entry.pipeline = pipeline;
+        entry.ready = true;
+        m_PendingCount--;
+    }
+    m_ReadyCondition.notify_all();
+}
+}
@@ -0,0 +1,142 @@
+﻿#pragma once
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanUtils.h"
+
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <unordered_map>
+
+namespace Snowy::Ark
+{
+/// <summary>
+/// Everything a graphics pipeline is built from, viewport and scissor are always dynamic.
+/// The render pass only has to be compatible, it is keyed by its attachment formats and subpass
+/// so a pipeline survives the render pass being recreated, e.g. on swapchain resize.
+/// </summary>
+struct VulkanGraphicsPipelineDesc
+{
+    vk::ShaderModule vertexShader;
+    vk::ShaderModule fragmentShader;
+    std::vector<vk::VertexInputBindingDescription> vertexBindings;
+    std::vector<vk::VertexInputAttributeDescription> vertexAttributes;
+
+    vk::PrimitiveTopology topology = vk::PrimitiveTopology::eTriangleList;
+    vk::PolygonMode polygonMode = vk::PolygonMode::eFill;
+    vk::CullModeFlags cullMode = vk::CullModeFlagBits::eBack;
+    vk::FrontFace frontFace = vk::FrontFace::eCounterClockwise;
+    bool depthTest = true;
+    bool depthWrite = true;
+    vk::CompareOp depthCompareOp = vk::CompareOp::eLess;
+    bool blendEnable = false;
+
+    vk::PipelineLayout layout;
+    vk::RenderPass renderPass;          // not part of the hash or equality, see colorFormats/depthFormat/subpass
+    uint32_t subpass = 0;
+    std::vector<vk::Format> colorFormats;
+    vk::Format depthFormat = vk::Format::eUndefined;
+
+    uint64_t Hash() const noexcept;
+    bool operator==(In<VulkanGraphicsPipelineDesc> other) const noexcept;
+};
+
+struct VulkanComputePipelineDesc
+{
+    vk::ShaderModule shader;
+    vk::PipelineLayout layout;
+
+    uint64_t Hash() const noexcept;
+    bool operator==(In<VulkanComputePipelineDesc> other) const noexcept;
+};
+
+class VulkanDevice;
+
+/// <summary>
+/// Owns the vk::PipelineCache and every graphics pipeline created through it.
+/// The driver cache is loaded from/saved to disk and discarded when it was written by another
+/// vendor, device or driver. Pipelines are deduplicated by their whole description, not only its hash, and
+/// can be compiled ahead of use on the job system.
+/// </summary>
+class VulkanPipelineCache
+{
+public:
+    using NativeType = vk::PipelineCache;
+    using OwnerType  = VulkanDevice;
+
+public:
+    VulkanPipelineCache() = default;
+    ~VulkanPipelineCache() = default;
+    VulkanPipelineCache(const VulkanPipelineCache&) = delete;
+    VulkanPipelineCache(VulkanPipelineCache&&) = delete;
+    VulkanPipelineCache& operator=(const VulkanPipelineCache&) = delete;
+    VulkanPipelineCache& operator=(VulkanPipelineCache&&) = delete;
+
+    // An empty path keeps the cache in memory only
+    void Init(ObserverHandle<OwnerType> owner, In<std::filesystem::path> path);
+    void Destroy();
+
+    auto& Native    () noexcept { return m_Native; }
+    auto& Native    () const noexcept { return m_Native; }
+    operator NativeType() const noexcept { return m_Native; }
+    ObserverHandle<OwnerType> Owner() const noexcept { return m_Owner; }
+    ObserverHandle<VulkanRHI> Context() const noexcept { return m_Ctx; }
+
+    // Starts compiling on a worker thread if the pipeline isn't known yet
+    void RequestGraphicsPipeline(In<VulkanGraphicsPipelineDesc> desc);
+    // Returns the cached pipeline, waits for a pending compilation or compiles inline
+    vk::Pipeline GetGraphicsPipeline(In<VulkanGraphicsPipelineDesc> desc);
+    // Compute pipelines are small, always compiled inline
+    vk::Pipeline GetComputePipeline(In<VulkanComputePipelineDesc> desc);
+    // Waits for every background compilation, the objects they reference can be destroyed afterwards
+    void WaitIdle();
+
+    void Save();
+
+private:
+    struct FileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint32_t driverVersion;
+        uint8_t driverUUID[VK_UUID_SIZE];
+        uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+        uint64_t dataSize;
+        uint64_t dataHash;
+    };
+    struct Entry
+    {
+        vk::Pipeline pipeline;
+        bool ready = false;
+    };
+    // The hash only picks the bucket, a lookup compares the whole description
+    struct DescHasher
+    {
+        size_t operator()(In<VulkanGraphicsPipelineDesc> desc) const noexcept { return static_cast<size_t>(desc.Hash()); }
+        size_t operator()(In<VulkanComputePipelineDesc> desc) const noexcept { return static_cast<size_t>(desc.Hash()); }
+    };
+
+    static constexpr uint32_t FileMagic = 0x43505341;   // "ASPC"
+    static constexpr uint32_t FileVersion = 1;
+
+    FileHeader MakeFileHeader() const noexcept;
+    std::vector<uint8_t> LoadFromDisk() const;
+    vk::Pipeline CreateGraphicsPipeline(In<VulkanGraphicsPipelineDesc> desc);
+    vk::Pipeline CreateComputePipeline(In<VulkanComputePipelineDesc> desc);
+    void Publish(Ref<Entry> entry, vk::Pipeline pipeline);
+
+private:
+    NativeType m_Native;
+    ObserverHandle<OwnerType> m_Owner;
+    ObserverHandle<VulkanRHI> m_Ctx;
+
+    std::filesystem::path m_Path;
+
+    // Nodes never move, an Entry stays valid for the compilation publishing into it
+    std::unordered_map<VulkanGraphicsPipelineDesc, Entry, DescHasher> m_GraphicsPipelines;
+    std::unordered_map<VulkanComputePipelineDesc, Entry, DescHasher> m_ComputePipelines;
+    uint32_t m_PendingCount = 0;
+    std::mutex m_Mutex;
+    std::condition_variable m_ReadyCondition;
+};
+}
@@ -1,14 +1,15 @@
 ﻿#include "VulkanRHI.h"
 #include "Engine/Source/Runtime/Core/Log/Logger.h"
+#include "Engine/Source/Runtime/Core/Job/JobSystem.h"
+#include "Engine/Source/Runtime/Core/Profile/Profiler.h"
 #include "Engine/Source/Runtime/Function/Global/GlobalContext.h"
 #include "Engine/Source/Runtime/Function/Window/WindowSystem.h"
 #include "Engine/Source/Runtime/Resource/AssetManager.h"
+#include "Engine/Source/Runtime/Resource/TextureFilter.h"
 
+#include <cstring>
 #include <set>
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include<tinyobjloader/tiny_obj_loader.h>
-
 namespace Snowy::Ark
 {
 using Utils = VulkanUtils;
@@ -31,61 +32,144 @@ void VulkanRHI::Init(In<RHIConfig> config)
     PostInit_Internal();
 }
 
-void VulkanRHI::Run()
+void VulkanRHI::Run(In<SceneRenderState> scene)
 {
+    m_SceneState = scene;
     DrawFrame();
 }
 
 void VulkanRHI::Init_Internal(In<RHIConfig> config)
 {
     SetWindowHandle(config.windowHandle);
+    m_TransientBufferBudget = config.transientBufferBudget;
+    m_UploadStagingBudget = config.uploadStagingBudget;
+    m_PipelineCacheFile = config.pipelineCacheFile;
+    m_BindlessSampledImageCount = config.bindlessSampledImageCount;
+    m_BindlessSamplerCount = config.bindlessSamplerCount;
+    m_BindlessStorageBufferCount = config.bindlessStorageBufferCount;
+    m_GpuDrivenRendering = config.gpuDrivenRendering;
+    m_GpuCullingValidation = config.gpuCullingValidation;
+    m_MeshletCulling = config.meshletCulling;
+    m_OcclusionCulling = config.occlusionCulling;
+    m_LodPixelError = config.lodPixelError;
+    m_TextureStreaming = config.textureStreaming;
+    m_TextureCompression = config.textureCompression;
+    m_TextureStreamingBudget = config.textureStreamingBudget;
+    m_TextureStreamingTailSize = config.textureStreamingTailSize;
+    m_Headless = config.headless;
+    m_HeadlessFrameCount = config.headlessFrameCount;
+    m_HeadlessCaptureDir = config.headlessCaptureDir;
+    m_GpuProfiling = config.gpuProfiling;
 
     CreateInstance(&m_Instance, config);
 
     m_Device = m_Instance.CreateDevice();
-    m_Swapchain = m_Device.CreateSwapchain();
+    // Only the per instance culling draws with a GPU written count, meshlet culling writes a single indirect draw
+    if (m_GpuDrivenRendering && !m_MeshletCulling && !m_Device.IsExtensionEnabled(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME))
+    {
+        SA_LOG_WARN("drawIndexedIndirectCount isn't supported, culling meshlets instead.");
+        m_MeshletCulling = true;
+    }
+    if (m_Headless)
+    {
+        CreateOffscreenTarget();
+    } else
+    {
+        m_Swapchain = m_Device.CreateSwapchain();
+    }
 }
 
 void VulkanRHI::PostInit_Internal()
 {
-    CreateCommandPool();
-
-    CreateDepthAttachment();
-
-    CreateRenderPass();
+    CreateFrameCommandPools();
+    CreateGpuProfiler();
+    CreateUploadManager();
+    CreatePipelineCache();
+    CreateBindlessHeap();
+    CreateTextureStreamer();
+    LoadAssetsAsync();
+
+    CreateSampledTexture();
+
+    // The vertex layout comes from the mesh streams, the pipeline then compiles
+    // on a worker while the rest of the scene is set up
+    LoadModel();
+    CreateVertexBuffer(*m_Mesh);
+    CreateDepthPyramid();
+    CreateRenderGraph();
     CreateDescriptorSetLayout();
     CreateGraphicsPipeline();
-    CreateFramebuffers();
 
-    LoadModel(SA_ENGINE_PATH("Engine/Assets/Model/chalet.obj"));
-    CreateVertexBuffer(g_TriangleVertices);
-    CreateIndexBuffer(g_TriangleIndices);
-    CreateUniformBuffer();
-    
-    CreateSampledTexture(SA_ENGINE_PATH("Engine/Assets/Texture/chalet.jpg"));
+    CreateIndexBuffer(m_Mesh->Indices(), m_Mesh->Lods());
+    CreateTransientBuffer();
+    CreateGpuCulling();
+    CreateClusterCulling();
 
     CreateDescriptorPool();
     CreateDescriptorSets();
-    CreateCommandBuffers();
 
     CreateSyncObjects();
+
+    m_UploadManager->Flush();
+    m_PendingShaders.clear();
 }
 
 void VulkanRHI::Destory()
 {
-    Utils::VerifyResult(m_Device->waitIdle(), STEXT("Failed to Wait Idle!"));
+    m_Device.WaitIdle();
 
+    if (m_OffscreenTarget)
+    {
+        // The last frames in flight are still in the readback pool
+        m_OffscreenTarget->FlushReadbacks();
+        for (auto&& capture : m_PendingCaptures)
+        {
+            capture.Wait();
+        }
+        m_PendingCaptures.clear();
+        if (m_FrameNumber > 1)
+        {
+            float elapsed = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - m_HeadlessStartTime).count();
+            SA_LOG_INFO("Headless, {} frames in {:.2f} ms, {:.3f} ms per frame.", m_FrameNumber - 1, elapsed, elapsed / (m_FrameNumber - 1));
+        }
+    }
     CleanupSwapChain();
 
+    if (m_GpuCulling)
+    {
+        m_GpuCulling->Destroy();
+        m_Device->destroyShaderModule(m_CullShaderModule);
+    }
+    if (m_ClusterCulling)
+    {
+        m_ClusterCulling->Destroy();
+        m_Device->destroyShaderModule(m_ClusterCullShaderModule);
+    }
+    if (m_DepthPyramid)
+    {
+        m_DepthPyramid->Destroy();
+        m_Device->destroyShaderModule(m_DepthPyramidShaderModule);
+    }
+    m_PipelineCache->Destroy();
+    m_Device->destroyPipelineLayout(m_PipelineLayout);
+    m_Device->destroyShaderModule(m_VertShaderModule);
+    m_Device->destroyShaderModule(m_FragShaderModule);
     m_Device->destroyDescriptorSetLayout(m_DescriptorSetLayout);
     m_Device->destroyDescriptorPool(m_DescriptorPool);
+    if (m_TextureStreamer)
+    {
+        m_TextureStreamer->Destroy();
+    }
+    if (m_Texture)
+    {
+        m_Texture->Destroy();
+    }
+    m_BindlessHeap->Destroy();
 
     m_VertexBuffer->Destroy();
     m_IndexBuffer->Destroy();
-    for (size_t i = 0; i < m_Swapchain.Count(); i++)
-    {
-        m_UniformBuffers[i]->Destroy();
-    }
+    m_TransientBuffer->Destroy();
+    m_Mesh.reset();
 
     for (size_t i = 0; i < m_Instance.GetFrameCountInFlight(); i++)
     {
@@ -94,9 +178,16 @@ void VulkanRHI::Destory()
         m_Device->destroyFence(m_InFlightFences[i]);
     }
 
-    m_Texture->Destroy();
-
-    m_Device->destroyCommandPool(m_CommandPool);
+    m_RenderGraph->Destroy();
+    if (m_GpuProfiler)
+    {
+        m_GpuProfiler->Destroy();
+    }
+    m_UploadManager->Destroy();
+    for (auto&& framePool : m_FrameCommandPools)
+    {
+        framePool->Destroy();
+    }
 
     m_Device.Destroy();
     m_Instance.Destroy();
@@ -104,44 +195,6 @@ void VulkanRHI::Destory()
     SA_LOG_INFO("Vulkan Context Destoryed.");
 }
 
-vk::CommandBuffer VulkanRHI::BeginSingleTimeCommandBuffer()
-{
-    vk::CommandBufferAllocateInfo allocInfo = {
-        .commandPool = m_CommandPool,
-        .level = vk::CommandBufferLevel::ePrimary,
-        .commandBufferCount = 1,
-    };
-    vk::CommandBuffer cmd;
-    Utils::VerifyResult(m_Device->allocateCommandBuffers(allocInfo),
-                        [&](const auto& result) {
-                            if (result.result != vk::Result::eSuccess)
-                            {
-                                SA_LOG_ERROR("Failed to allocate single time command!");
-                            } else
-                            {
-                                cmd = result.value[0];
-                            }
-                        });
-    vk::CommandBufferBeginInfo beginInfo = {
-        .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
-    };
-    Utils::VerifyResult(cmd.begin(beginInfo), STEXT("Failed to begin recording single time command!"));
-    return cmd;
-}
-
-void VulkanRHI::EndSingleTimeCommandBuffer(vk::CommandBuffer cmd)
-{
-    cmd.end();
-    vk::SubmitInfo info = {
-        .commandBufferCount = 1,
-        .pCommandBuffers = &cmd,
-    };
-    auto& queue = m_Device.Queue(ERHIQueue::Graphics);
-    Utils::VerifyResult(queue.submit(info), STEXT("Failed to submit single time command!"));
-    queue.waitIdle();
-    m_Device->freeCommandBuffers(m_CommandPool, cmd);
-}
-
 void VulkanRHI::RecreateSwapchain()
 {
     SharedHandle windowSys = g_RuntimeContext.windowSys;
@@ -151,473 +204,569 @@ void VulkanRHI::RecreateSwapchain()
         std::tie(width, height) = windowSys->GetFramebufferSize();
         windowSys->WaitEvents();
     }
-    m_Device->waitIdle();
+    m_Device.WaitIdle();
+    // A pending compilation may still use the render pass about to be destroyed
+    m_PipelineCache->WaitIdle();
 
     CleanupSwapChain();
 
     m_Swapchain.Recreate();
 
-    CreateRenderPass();
+    BuildRenderGraph();
     CreateGraphicsPipeline();
-    CreateDepthAttachment();
-    CreateFramebuffers();
-    CreateCommandBuffers();
     SA_LOG_INFO("Recreate SwapChain, Complete.");
 }
 
 void VulkanRHI::CleanupSwapChain()
 {
-    m_DepthAttachment->Destroy();
-    for (auto&& framebuffer : m_SwapchainFramebuffers)
+    m_RenderGraph->Reset();
+    if (m_OffscreenTarget)
+    {
+        m_OffscreenTarget->Destroy();
+    } else
     {
-        m_Device->destroyFramebuffer(framebuffer);
+        m_Swapchain.Destory();
     }
-    m_Device->freeCommandBuffers(m_CommandPool, m_CommandBuffers);
-    m_Device->destroyPipeline(m_GraphicsPipeline);
-    m_Device->destroyPipelineLayout(m_PipelineLayout);
-    m_Device->destroyRenderPass(m_RenderPass);
-    m_Swapchain.Destory();
+}
+
+void VulkanRHI::CreateOffscreenTarget()
+{
+    auto [width, height] = g_RuntimeContext.windowSys->GetFramebufferSize();
+    VulkanOffscreenTarget::ReadbackFunc readback;
+    if (!m_HeadlessCaptureDir.empty())
+    {
+        readback = [this](uint64_t frameNumber, ArrayIn<uint8_t> texels) { CaptureFrame(frameNumber, texels); };
+    }
+    // RGBA so the readback is saved as it is, the swapchain would be BGRA
+    m_OffscreenTarget = MakeUnique<VulkanOffscreenTarget>();
+    m_OffscreenTarget->Init(&m_Device, vk::Extent2D{ width, height }, vk::Format::eR8G8B8A8Unorm, m_Instance.GetFrameCountInFlight(),
+                            std::move(readback));
+}
+
+void VulkanRHI::CaptureFrame(uint64_t frameNumber, ArrayIn<uint8_t> texels)
+{
+    std::erase_if(m_PendingCaptures, [](In<JobFuture<bool>> capture) { return capture.IsReady(); });
+
+    // The readback buffer is reused by the next frame of its slot, the encoding works on a copy
+    auto path = std::filesystem::path(SA_ENGINE_PATH(m_HeadlessCaptureDir)) / std::format("Frame_{:06}.png", frameNumber);
+    auto extent = m_OffscreenTarget->Extent();
+    m_PendingCaptures.emplace_back(g_RuntimeContext.jobSys->Async([path, extent, data = std::vector<uint8_t>(texels.begin(), texels.end())]() {
+        return g_RuntimeContext.assetMgr->SaveImage(path, data, extent.width, extent.height);
+    }));
+}
+
+void VulkanRHI::CreateBindlessHeap()
+{
+    m_BindlessHeap = MakeUnique<VulkanBindlessHeap>();
+    m_BindlessHeap->Init(&m_Device, m_BindlessSampledImageCount, m_BindlessSamplerCount, m_BindlessStorageBufferCount,
+                         m_Instance.GetFrameCountInFlight());
 }
 
 void VulkanRHI::CreateDescriptorSetLayout()
 {
     vk::DescriptorSetLayoutBinding uboLayoutBinding = {
         .binding = 0,
-        .descriptorType = vk::DescriptorType::eUniformBuffer,
+        .descriptorType = vk::DescriptorType::eUniformBufferDynamic,
         .descriptorCount = 1,
         .stageFlags = vk::ShaderStageFlagBits::eVertex,
         .pImmutableSamplers = SA_RHI_NULL,
     };
-    vk::DescriptorSetLayoutBinding samplerLayoutBinding = {
-        .binding = 1,
-        .descriptorType = vk::DescriptorType::eCombinedImageSampler,
-        .descriptorCount = 1,
-        .stageFlags = vk::ShaderStageFlagBits::eFragment,
-        .pImmutableSamplers = SA_RHI_NULL,
-    };
-    std::array bindings = { uboLayoutBinding, samplerLayoutBinding };
+    std::array bindings = { uboLayoutBinding };
     vk::DescriptorSetLayoutCreateInfo createInfo = {};
     createInfo.setBindings(bindings);
     Utils::VerifyResult(m_Device->createDescriptorSetLayout(createInfo), STEXT("Failed to create descriptor set layout!"), &m_DescriptorSetLayout);
 }
 
-void VulkanRHI::CreateGraphicsPipeline()
+void VulkanRHI::CreatePipelineCache()
 {
-    SharedHandle assetMgr = g_RuntimeContext.assetMgr;
-    auto vertShaderBinary = assetMgr->LoadSpirvShaderBinary(SA_ENGINE_PATH("Engine/Shaders/SPIR-V/vert.spv"));
-    auto vertShaderModule = m_Device.CreateShaderModule(vertShaderBinary);
-    vk::PipelineShaderStageCreateInfo vertShaderStageInfo = {
-        .stage = vk::ShaderStageFlagBits::eVertex,
-        .module = vertShaderModule,
-        .pName = "main",
-    };
-    auto fragShaderBinary = assetMgr->LoadSpirvShaderBinary(SA_ENGINE_PATH("Engine/Shaders/SPIR-V/frag.spv"));
-    auto fragShaderModule = m_Device.CreateShaderModule(fragShaderBinary);
-    vk::PipelineShaderStageCreateInfo fragShaderStageInfo = {
-        .stage = vk::ShaderStageFlagBits::eFragment,
-        .module = fragShaderModule,
-        .pName = "main",
-    };
-
-    std::array<vk::PipelineShaderStageCreateInfo, 2> shaderStages = { vertShaderStageInfo, fragShaderStageInfo };
-
-    auto bindingDescription = SimpleVertex::GetBindingDescription();
-    auto attributeDescriptions = SimpleVertex::GetAttributeDescriptions();
-    vk::PipelineVertexInputStateCreateInfo vertexInputInfo = {
-        .vertexBindingDescriptionCount = 1,
-        .pVertexBindingDescriptions = &bindingDescription,
-        .vertexAttributeDescriptionCount = SA_VK_NUM(attributeDescriptions.size()),
-        .pVertexAttributeDescriptions = attributeDescriptions.data(),
-    };
-
-    vk::PipelineInputAssemblyStateCreateInfo inputAssembly = {
-        .topology = vk::PrimitiveTopology::eTriangleList,
-        .primitiveRestartEnable = SA_RHI_FALSE,
-    };
-
-    vk::Viewport viewport = {
-        .x = 0.0f,
-        .y = 0.0f,
-        .width = static_cast<float>(m_Swapchain.Extent().width),
-        .height = static_cast<float>(m_Swapchain.Extent().height),
-        .minDepth = 0.0f,
-        .maxDepth = 1.0f,
-    };
+    std::filesystem::path cachePath;
+    if (!m_PipelineCacheFile.empty())
+    {
+        cachePath = SA_ENGINE_PATH(m_PipelineCacheFile);
+    }
+    m_PipelineCache = MakeUnique<VulkanPipelineCache>();
+    m_PipelineCache->Init(&m_Device, cachePath);
+}
 
-    vk::Rect2D scissor = {
-        .offset = {0, 0},
-        .extent = m_Swapchain.Extent(),
-    };
+void VulkanRHI::CreateGraphicsPipeline()
+{
+    // Shaders and layout don't depend on the swapchain, only created once
+    if (!m_PipelineLayout)
+    {
+        m_VertShaderModule = m_Device.CreateShaderModule(TakeShaderBinary("vert"));
+        m_FragShaderModule = m_Device.CreateShaderModule(TakeShaderBinary("frag"));
 
-    vk::PipelineViewportStateCreateInfo viewportState = {
-        .viewportCount = 1,
-        .pViewports = &viewport,
-        .scissorCount = 1,
-        .pScissors = &scissor,
-    };
+        std::array setLayouts = { m_BindlessHeap->SetLayout(), m_DescriptorSetLayout };
+        vk::PushConstantRange pushConstantRange = {
+            .stageFlags = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment,
+            .offset = 0,
+            .size = sizeof(SADrawConstants),
+        };
+        vk::PipelineLayoutCreateInfo pipelineLayoutInfo = {
+            .setLayoutCount = SA_VK_NUM(setLayouts.size()),
+            .pSetLayouts = setLayouts.data(),
+            .pushConstantRangeCount = 1,
+            .pPushConstantRanges = &pushConstantRange,
+        };
+        Utils::VerifyResult(m_Device->createPipelineLayout(pipelineLayoutInfo), STEXT("Failed to create pipeline layout!"), &m_PipelineLayout);
+    }
 
-    vk::PipelineRasterizationStateCreateInfo rasterizer = {
-        .depthClampEnable = SA_RHI_FALSE,
-        .rasterizerDiscardEnable = SA_RHI_FALSE,
-        .polygonMode = vk::PolygonMode::eFill,
-        .cullMode = vk::CullModeFlagBits::eBack,
-        .frontFace = vk::FrontFace::eCounterClockwise,
-        .depthBiasEnable = SA_RHI_FALSE,
-        .depthBiasConstantFactor = 0.0f,
-        .depthBiasClamp = 0.0f,
-        .depthBiasSlopeFactor = 0.0f,
-        .lineWidth = 1.0f,
+    m_GraphicsPipelineDesc = VulkanGraphicsPipelineDesc {
+        .vertexShader = m_VertShaderModule,
+        .fragmentShader = m_FragShaderModule,
+        .vertexBindings = m_VertexBindings,
+        .vertexAttributes = m_VertexAttributes,
+        .layout = m_PipelineLayout,
+        .renderPass = m_RenderGraph->RenderPass(m_ScenePass),
+        .subpass = m_RenderGraph->Subpass(m_ScenePass),
+        .colorFormats = { BackBufferFormat() },
+        .depthFormat = GetDepthFormat(),
     };
+    // A compatible render pass after a resize hits the cache, nothing is rebuilt
+    m_PipelineCache->RequestGraphicsPipeline(m_GraphicsPipelineDesc);
+}
 
-    vk::PipelineMultisampleStateCreateInfo multisampling = {
-        .rasterizationSamples = vk::SampleCountFlagBits::e1,
-        .sampleShadingEnable = SA_RHI_FALSE,
-        .minSampleShading = 1,
-        .pSampleMask = nullptr,
-        .alphaToCoverageEnable = SA_RHI_FALSE,
-        .alphaToOneEnable = SA_RHI_FALSE,
-    };
+void VulkanRHI::CreateRenderGraph()
+{
+    m_RenderGraph = MakeUnique<VulkanRenderGraph>();
+    m_RenderGraph->Init(&m_Device);
+    m_RenderGraph->SetGpuProfiler(m_GpuProfiler.get());
+    BuildRenderGraph();
+}
 
-    vk::PipelineDepthStencilStateCreateInfo depthStencil = {
-        .depthTestEnable = SA_RHI_TRUE,
-        .depthWriteEnable = SA_RHI_TRUE,
-        .depthCompareOp = vk::CompareOp::eLess,
-        .depthBoundsTestEnable = SA_RHI_FALSE,
-        .stencilTestEnable = SA_RHI_FALSE,
-        .front = {},
-        .back = {},
-        .minDepthBounds = 0.0f,
-        .maxDepthBounds = 1.0f,
-    };
+void VulkanRHI::BuildRenderGraph()
+{
+    m_RenderGraph->Reset();
 
-    vk::PipelineColorBlendAttachmentState colorBlendAttachment = {
-        .blendEnable = SA_RHI_FALSE,
-        .srcColorBlendFactor = vk::BlendFactor::eOne,
-        .dstColorBlendFactor = vk::BlendFactor::eZero,
-        .colorBlendOp = vk::BlendOp::eAdd,
-        .srcAlphaBlendFactor = vk::BlendFactor::eOne,
-        .dstAlphaBlendFactor = vk::BlendFactor::eZero,
-        .alphaBlendOp = vk::BlendOp::eAdd,
-        .colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA,
+    RenderGraphTextureDesc backBufferDesc = {
+        .format = BackBufferFormat(),
+        .extent = BackBufferExtent(),
     };
+    // Back buffer image changes every frame, bound right before execution
+    auto backBufferLayout = m_OffscreenTarget ? m_OffscreenTarget->FinalLayout() : vk::ImageLayout::ePresentSrcKHR;
+    m_BackBuffer = m_RenderGraph->ImportTexture(STEXT("BackBuffer"), backBufferDesc, vk::ImageAspectFlagBits::eColor,
+                                                vk::ImageLayout::eUndefined, backBufferLayout);
 
-    vk::PipelineColorBlendStateCreateInfo colorBlending = {
-        .logicOpEnable = SA_RHI_FALSE,
-        .logicOp = vk::LogicOp::eCopy,
-        .attachmentCount = 1,
-        .pAttachments = &colorBlendAttachment,
-        .blendConstants = std::array{0.0f, 0.0f, 0.0f, 0.0f},
+    RenderGraphTextureDesc sampledDesc = {
+        .format = vk::Format::eR8G8B8A8Unorm,
     };
+    // Left in shader read layout by the upload manager, the image changes whenever streamed mips land
+    m_SampledTexture = m_RenderGraph->ImportTexture(STEXT("SampledTexture"), sampledDesc, vk::ImageAspectFlagBits::eColor,
+                                                    vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eShaderReadOnlyOptimal);
 
-    std::array<vk::DynamicState, 2> dynamicStates = { vk::DynamicState::eViewport, vk::DynamicState::eLineWidth };
+    if (m_GpuDrivenRendering)
+    {
+        // Indirect buffers are synchronized by the culling itself, the graph only has to keep the pass
+        m_CullPass = m_RenderGraph->AddPass(STEXT("Cull"),
+            [](auto& builder) {
+                builder.SideEffect();
+            },
+            [this](vk::CommandBuffer cmd, In<RenderGraphPassContext> context) {
+                if (m_CommonMatricesValid)
+                {
+                    RecordCull(cmd, m_DepthPyramid ? ECullPhase::Early : ECullPhase::Single);
+                }
+            });
+    }
 
-    vk::PipelineDynamicStateCreateInfo dynamicStateCreateInfo = {
-        .dynamicStateCount = SA_VK_NUM(dynamicStates.size()),
-        .pDynamicStates = dynamicStates.data(),
-    };
+    RenderGraphTexture sceneDepth;
+    m_ScenePass = m_RenderGraph->AddPass(STEXT("Scene"),
+        [&, this](auto& builder) {
+            RenderGraphTextureDesc depthDesc = {
+                .format = GetDepthFormat(),
+                .extent = BackBufferExtent(),
+            };
+            sceneDepth = builder.CreateTexture(STEXT("SceneDepth"), depthDesc);
 
-    vk::PipelineLayoutCreateInfo pipelineLayoutInfo = {
-        .setLayoutCount = 1,
-        .pSetLayouts = &m_DescriptorSetLayout,
-        .pushConstantRangeCount = 0,
-        .pPushConstantRanges = nullptr,
-    };
+            builder.WriteColor(m_BackBuffer, vk::AttachmentLoadOp::eClear, vk::ClearValue{ .color = std::array{0.0f, 0.0f, 0.0f, 1.0f} });
+            builder.WriteDepthStencil(sceneDepth, vk::AttachmentLoadOp::eClear, vk::ClearValue{ .depthStencil = {1.0f, 0} });
+            builder.ReadTexture(m_SampledTexture);
+            if (!m_GpuDrivenRendering)
+            {
+                builder.UseSecondaryCommandBuffers();
+            }
+        },
+        [this](vk::CommandBuffer cmd, In<RenderGraphPassContext> context) {
+            m_ScenePassContext = context;
+            // Without the matrices the offset would point at someone else's data, only clear
+            if (!m_CommonMatricesValid)
+            {
+                return;
+            }
+            if (m_GpuDrivenRendering)
+            {
+                // A single indirect draw, nothing worth spreading over the job threads. The culling works on
+                // one placement of the mesh, only the first instance is drawn
+                RecordCulledDraw(cmd, context);
+                return;
+            }
+            uint32_t firstDraw = m_LodFirstDraws[m_CurrentLod];
+            auto drawCmds = RecordDrawCommandBuffers(context, std::span(m_Draws).subspan(firstDraw, m_LodFirstDraws[m_CurrentLod + 1] - firstDraw),
+                                                     m_InstanceCount);
+            if (!drawCmds.empty())
+            {
+                cmd.executeCommands(drawCmds);
+            }
+        });
 
-    Utils::VerifyResult(m_Device->createPipelineLayout(pipelineLayoutInfo), STEXT("Failed to create pipeline layout!"), &m_PipelineLayout);
-
-    vk::GraphicsPipelineCreateInfo graphicsPipelineInfo = {
-        .stageCount = SA_VK_NUM(shaderStages.size()),
-        .pStages = shaderStages.data(),
-        .pVertexInputState = &vertexInputInfo,
-        .pInputAssemblyState = &inputAssembly,
-        .pViewportState = &viewportState,
-        .pRasterizationState = &rasterizer,
-        .pMultisampleState = &multisampling,
-        .pDepthStencilState = &depthStencil,
-        .pColorBlendState = &colorBlending,
-        .pDynamicState = nullptr,
-        .layout = m_PipelineLayout,
-        .renderPass = m_RenderPass,
-        .subpass = 0,
-        .basePipelineHandle = SA_RHI_NULL,
-        .basePipelineIndex = -1,
-    };
+    if (m_DepthPyramid)
+    {
+        // The depth of what was visible last frame hides most of what wasn't, the late passes
+        // draw the rest on top of the early results
+        m_RenderGraph->AddPass(STEXT("DepthPyramid"),
+            [&](auto& builder) {
+                builder.ReadTexture(sceneDepth, vk::PipelineStageFlagBits::eComputeShader);
+                builder.SideEffect();
+            },
+            [this](vk::CommandBuffer cmd, In<RenderGraphPassContext> context) {
+                m_DepthPyramid->RecordBuild(cmd);
+            });
+        m_RenderGraph->AddPass(STEXT("LateCull"),
+            [](auto& builder) {
+                builder.SideEffect();
+            },
+            [this](vk::CommandBuffer cmd, In<RenderGraphPassContext> context) {
+                if (m_CommonMatricesValid)
+                {
+                    RecordCull(cmd, ECullPhase::Late);
+                }
+            });
+        m_RenderGraph->AddPass(STEXT("LateScene"),
+            [&](auto& builder) {
+                builder.WriteColor(m_BackBuffer, vk::AttachmentLoadOp::eLoad);
+                builder.WriteDepthStencil(sceneDepth, vk::AttachmentLoadOp::eLoad);
+                builder.ReadTexture(m_SampledTexture);
+            },
+            [this](vk::CommandBuffer cmd, In<RenderGraphPassContext> context) {
+                if (m_CommonMatricesValid)
+                {
+                    RecordCulledDraw(cmd, context);
+                }
+            });
+    }
 
-    Utils::VerifyResult(m_Device->createGraphicsPipeline(SA_RHI_NULL, graphicsPipelineInfo), STEXT("Failed to create graphics pipeline!"), &m_GraphicsPipeline);
+    if (m_OffscreenTarget && m_OffscreenTarget->HasReadback())
+    {
+        // Copied into the readback pool after the late passes, the frame as it would have been presented
+        m_RenderGraph->AddPass(STEXT("Readback"),
+            [this](auto& builder) {
+                builder.ReadTransfer(m_BackBuffer);
+                builder.SideEffect();
+            },
+            [this](vk::CommandBuffer cmd, In<RenderGraphPassContext> context) {
+                m_OffscreenTarget->RecordReadback(cmd, SA_VK_NUM(m_CurrFrameIndex), m_FrameNumber);
+            });
+    }
 
-    m_Device->destroyShaderModule(vertShaderModule);
-    m_Device->destroyShaderModule(fragShaderModule);
-    SA_LOG_INFO("Create Graphics Pipeline, Complete.");
+    m_RenderGraph->Compile();
+    if (m_DepthPyramid)
+    {
+        m_DepthPyramid->Resize(BackBufferExtent(), m_RenderGraph->SampledView(sceneDepth));
+    }
+    SA_LOG_INFO("Build Render Graph, Complete.");
 }
-void VulkanRHI::CreateRenderPass()
-{
-    vk::AttachmentDescription colorAttachmentDesc = {
-        .flags = vk::AttachmentDescriptionFlags{},
-        .format = m_Swapchain.Format(),
-        .samples = vk::SampleCountFlagBits::e1,
-        .loadOp = vk::AttachmentLoadOp::eClear,
-        .storeOp = vk::AttachmentStoreOp::eStore,
-        .stencilLoadOp = vk::AttachmentLoadOp::eDontCare,
-        .stencilStoreOp = vk::AttachmentStoreOp::eDontCare,
-        .initialLayout = vk::ImageLayout::eUndefined,
-        .finalLayout = vk::ImageLayout::ePresentSrcKHR,
-    };
-    vk::AttachmentReference colorAttachmentRef = {
-        .attachment = 0,
-        .layout = vk::ImageLayout::eColorAttachmentOptimal,
-    };
-
-    vk::AttachmentDescription depthAttachmentDesc = {
-        .flags = vk::AttachmentDescriptionFlags{},
-        .format = GetDepthFormat(),
-        .samples = vk::SampleCountFlagBits::e1,
-        .loadOp = vk::AttachmentLoadOp::eClear,
-        .storeOp = vk::AttachmentStoreOp::eDontCare,
-        .stencilLoadOp = vk::AttachmentLoadOp::eDontCare,
-        .stencilStoreOp = vk::AttachmentStoreOp::eDontCare,
-        .initialLayout = vk::ImageLayout::eUndefined,
-        .finalLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal,
-    };
-    vk::AttachmentReference depthAttachmentRef = {
-        .attachment = 1,
-        .layout = vk::ImageLayout::eDepthStencilAttachmentOptimal,
-    };
-
-    vk::SubpassDescription subpassDesc = {
-        .pipelineBindPoint = vk::PipelineBindPoint::eGraphics,
-        .colorAttachmentCount = 1,
-        .pColorAttachments = &colorAttachmentRef,
-        .pDepthStencilAttachment = &depthAttachmentRef,
-    };
 
-    vk::SubpassDependency subpassDependency = {
-        .srcSubpass = VK_SUBPASS_EXTERNAL,
-        .dstSubpass = 0,
-        .srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput,
-        .dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput,
-        .srcAccessMask = vk::AccessFlagBits::eNone,
-        .dstAccessMask = vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite,
-    };
-
-    std::array attachments = { colorAttachmentDesc, depthAttachmentDesc };
-
-    vk::RenderPassCreateInfo renderPassInfo = {
-        .attachmentCount = SA_VK_NUM(attachments.size()),
-        .pAttachments = attachments.data(),
-        .subpassCount = 1,
-        .pSubpasses = &subpassDesc,
-        .dependencyCount = 1,
-        .pDependencies = &subpassDependency,
-    };
+void VulkanRHI::CreateFrameCommandPools()
+{
+    auto& queueFamilyIndices = m_Device.Adapter().GetQueueFamilyIndices();
+    uint32_t threadCount = g_RuntimeContext.jobSys->ThreadCount();
 
-    Utils::VerifyResult(m_Device->createRenderPass(renderPassInfo, nullptr), STEXT("Failed to create render pass!"), &m_RenderPass);
-    SA_LOG_INFO("Create Render Pass, Complete.");
+    m_FrameCommandPools.resize(m_Instance.GetFrameCountInFlight());
+    for (auto&& framePool : m_FrameCommandPools)
+    {
+        framePool = MakeUnique<VulkanFrameCommandPool>();
+        framePool->Init(&m_Device, queueFamilyIndices.graphics.value(), threadCount);
+    }
+    SA_LOG_INFO("Create Command Pools, Complete.");
 }
 
-void VulkanRHI::CreateFramebuffers()
+void VulkanRHI::CreateGpuProfiler()
 {
-    m_SwapchainFramebuffers.resize(m_Swapchain.Count());
-    for (size_t i = 0; i < m_Swapchain.Count(); i++)
+    ProfileSystem* profileSys = g_RuntimeContext.profileSys.get();
+    if (!m_GpuProfiling || !profileSys->IsEnabled())
     {
-        std::array attachments = { m_Swapchain.View(i), m_DepthAttachment->View() };
-
-        vk::FramebufferCreateInfo framebufferInfo = {
-            .renderPass = m_RenderPass,
-            .attachmentCount = SA_VK_NUM(attachments.size()),
-            .pAttachments = attachments.data(),
-            .width = m_Swapchain.Extent().width,
-            .height = m_Swapchain.Extent().height,
-            .layers = 1,
-        };
+        return;
+    }
 
-        Utils::VerifyResult(m_Device->createFramebuffer(framebufferInfo, nullptr),
-                            std::format(STEXT("Failed to create framebuffer[{}]!"), i), &m_SwapchainFramebuffers[i]);
+    m_GpuProfiler = MakeUnique<VulkanGpuProfiler>();
+    m_GpuProfiler->Init(&m_Device, profileSys, m_Instance.GetFrameCountInFlight());
+    if (!m_GpuProfiler->IsEnabled())
+    {
+        m_GpuProfiler.reset();
     }
-    SA_LOG_INFO("Create Framebuffers, Complete.");
 }
 
-void VulkanRHI::CreateCommandPool()
+void VulkanRHI::CreateUploadManager()
 {
-    auto& queueFamilyIndices = m_Device.Adapter().GetQueueFamilyIndices();
+    m_UploadManager = MakeUnique<VulkanUploadManager>();
+    m_UploadManager->Init(&m_Device, m_UploadStagingBudget, m_Instance.GetFrameCountInFlight());
+}
 
-    vk::CommandPoolCreateInfo createInfo = {
-        .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
-        .queueFamilyIndex = queueFamilyIndices.graphics.value(),
+void VulkanRHI::LoadAssetsAsync()
+{
+    auto& assetMgr = *g_RuntimeContext.assetMgr;
+    auto loadShader = [&, this](In<AnsiString> name) {
+        m_PendingShaders.emplace(name, assetMgr.LoadShaderAsync(SA_ENGINE_PATH(std::format("Engine/Shaders/SPIR-V/{}.spv", name))));
     };
+    // Only the shaders the config uses, following the Create* functions
+    loadShader("vert");
+    loadShader("frag");
+    if (m_GpuDrivenRendering)
+    {
+        loadShader(m_MeshletCulling ? "cluster_cull" : "cull");
+        if (m_OcclusionCulling)
+        {
+            loadShader("depth_pyramid");
+        }
+    }
 
-    Utils::VerifyResult(m_Device->createCommandPool(createInfo, nullptr), STEXT("Failed to create command pool!"), &m_CommandPool);
-    SA_LOG_INFO("Create Command Pool, Complete.");
+    auto texturePath = SA_ENGINE_PATH("Engine/Assets/Texture/chalet.jpg");
+    if (m_TextureStreamer)
+    {
+        m_PendingTextureAsset = assetMgr.LoadTextureAssetAsync(texturePath, SelectTextureFormat());
+    } else
+    {
+        m_PendingTexture = assetMgr.LoadTextureAsync(texturePath);
+    }
+    m_PendingModel = assetMgr.LoadModelAsync(SA_ENGINE_PATH("Engine/Assets/Model/chalet.obj"));
 }
 
-void VulkanRHI::CreateCommandBuffers()
+std::vector<char> VulkanRHI::TakeShaderBinary(In<AnsiString> name)
 {
-    m_CommandBuffers.resize(m_SwapchainFramebuffers.size());
-
-    vk::CommandBufferAllocateInfo allocInfo = {
-        .commandPool = m_CommandPool,
-        .level = vk::CommandBufferLevel::ePrimary,
-        .commandBufferCount = static_cast<uint32_t>(m_CommandBuffers.size()),
-    };
-    Utils::VerifyResult(m_Device->allocateCommandBuffers(allocInfo), STEXT("Failed to allocate command buffers!"), &m_CommandBuffers);
-    SA_LOG_INFO("Create Command Buffers, Complete.");
+    return std::move(m_PendingShaders.at(name).Get());
 }
 
-void VulkanRHI::LoadModel(std::filesystem::path path)
+void VulkanRHI::LoadModel()
 {
-    tinyobj::attrib_t attrib;
-    std::vector<tinyobj::shape_t> shapes;
-    std::vector<tinyobj::material_t> materials;
-    AnsiString errorStr, warnStr;
+    // Mapped from the cooked file, the streams are uploaded without an intermediate copy
+    m_Mesh = std::move(m_PendingModel.Get());
+}
 
-    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &errorStr, &warnStr, path.string().c_str())) 
-    {
-        SA_LOG_ERROR("Load model error: {}", ANSI_TO_SSTR(errorStr));
-        return;
-    }
-    if (!warnStr.empty())
+void VulkanRHI::CreateVertexBuffer(In<MeshAsset> mesh)
+{
+    // Quantized by the cooker, positions are dequantized through ObjectToWorld
+    m_PositionDequantization = mesh.PositionDequantization();
+    auto& header = mesh.Header();
+    glm::vec3 center = header.positionMin + header.positionExtent * 0.5f;
+    m_MeshBoundingSphere = glm::vec4(center, glm::length(header.positionExtent * 0.5f));
+    Utils::GetVertexInputDescriptions(mesh.VertexBindings(), mesh.VertexAttributes(), &m_VertexBindings, &m_VertexAttributes);
+    m_VertexBufferOffsets.clear();
+    for (auto&& streamBinding : mesh.VertexBindings())
     {
-        SA_LOG_WARN("Load model warnning: {}", ANSI_TO_SSTR(warnStr));
+        m_VertexBufferOffsets.emplace_back(streamBinding.offset);
     }
 
-    std::unordered_map<SimpleVertex, uint32_t> uniqueVertices = {};
+    vk::DeviceSize bufferSize = mesh.VertexData().size();
+    m_VertexBuffer = m_Device.CreateBuffer(bufferSize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal);
+    m_UploadManager->UploadBuffer(*m_VertexBuffer, mesh.VertexData().data(), bufferSize, 0,
+                                  vk::PipelineStageFlagBits::eVertexInput, vk::AccessFlagBits::eVertexAttributeRead);
+    m_VertexBufferBindings.assign(m_VertexBufferOffsets.size(), *m_VertexBuffer);
+}
+
+void VulkanRHI::CreateIndexBuffer(ArrayIn<uint32_t> triangleIndices, ArrayIn<MeshLod> lods)
+{
+    vk::DeviceSize bufferSize = sizeof(decltype(triangleIndices)::value_type) * triangleIndices.size();
 
-    for (const auto& shape : shapes)
+    m_IndexBuffer = m_Device.CreateBuffer(bufferSize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal);
+    m_UploadManager->UploadBuffer(*m_IndexBuffer, triangleIndices.data(), bufferSize, 0,
+                                  vk::PipelineStageFlagBits::eVertexInput, vk::AccessFlagBits::eIndexRead);
+
+    // Split every LOD into fixed size draws so recording can be spread over the job threads
+    uint32_t chunkIndexCount = DrawChunkTriangleCount * 3;
+    m_Lods.assign(lods.begin(), lods.end());
+    m_LodFirstDraws.clear();
+    m_Draws.clear();
+    for (auto&& lod : m_Lods)
     {
-        for (const auto& index : shape.mesh.indices)
+        m_LodFirstDraws.emplace_back(SA_VK_NUM(m_Draws.size()));
+        for (uint32_t offset = 0; offset < lod.indexCount; offset += chunkIndexCount)
         {
-            SimpleVertex vertex;
-            vertex.position = {
-                attrib.vertices[3 * index.vertex_index + 0],
-                attrib.vertices[3 * index.vertex_index + 1],
-                attrib.vertices[3 * index.vertex_index + 2]
-            };
-            vertex.texcoord = {
-                attrib.texcoords[2 * index.texcoord_index + 0],
-                1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
-            };
-            vertex.color = {1.0f, 1.0f, 1.0f};
-            
-            if (!uniqueVertices.contains(vertex)) 
-            {
-                uniqueVertices[vertex] = static_cast<uint32_t>(g_TriangleVertices.size());
-                g_TriangleVertices.emplace_back(vertex);
-            }
-            g_TriangleIndices.emplace_back(uniqueVertices[vertex]);
+            m_Draws.emplace_back(vk::DrawIndexedIndirectCommand {
+                .indexCount = std::min(chunkIndexCount, lod.indexCount - offset),
+                .instanceCount = 1,
+                .firstIndex = lod.firstIndex + offset,
+                .vertexOffset = 0,
+                .firstInstance = 0,
+            });
         }
     }
+    m_LodFirstDraws.emplace_back(SA_VK_NUM(m_Draws.size()));
+    m_CurrentLod = 0;
 }
 
-void VulkanRHI::CreateVertexBuffer(ArrayIn<SimpleVertex> triangleVertices)
+void VulkanRHI::CreateTransientBuffer()
 {
-    vk::DeviceSize bufferSize = sizeof(decltype(triangleVertices)::value_type) * triangleVertices.size();
+    m_TransientBuffer = MakeUnique<VulkanTransientBuffer>();
+    m_TransientBuffer->Init(&m_Device, m_TransientBufferBudget, m_Instance.GetFrameCountInFlight());
+}
 
-    auto stagingBuffer = m_Device.CreateBuffer(bufferSize, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
-    void* data;
-    Utils::VerifyResult(m_Device->mapMemory(stagingBuffer->Memory(), 0, bufferSize, {}), STEXT("Failed to map vertex buffer memory!"), &data);
-    memcpy(data, triangleVertices.data(), (size_t)bufferSize);
-    m_Device->unmapMemory(stagingBuffer->Memory());
+void VulkanRHI::CreateGpuCulling()
+{
+    if (!m_GpuDrivenRendering || m_MeshletCulling)
+    {
+        return;
+    }
 
-    m_VertexBuffer = m_Device.CreateBuffer(bufferSize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal);
+    m_CullShaderModule = m_Device.CreateShaderModule(TakeShaderBinary("cull"));
 
-    CopyBuffer(*stagingBuffer, *m_VertexBuffer, bufferSize);
+    // Every draw chunk of every LOD is an instance, bounded by the sphere around its AABB
+    auto positions = m_Mesh->DecodePositions();
+    auto indices = m_Mesh->Indices();
+    std::vector<SAInstanceData> instances;
+    instances.reserve(m_Draws.size());
+    for (auto&& draw : m_Draws)
+    {
+        glm::vec3 minPos(std::numeric_limits<float>::max());
+        glm::vec3 maxPos(std::numeric_limits<float>::lowest());
+        for (uint32_t i = draw.firstIndex; i < draw.firstIndex + draw.indexCount; i++)
+        {
+            auto& position = positions[indices[i]];
+            minPos = glm::min(minPos, position);
+            maxPos = glm::max(maxPos, position);
+        }
+        glm::vec3 center = (minPos + maxPos) * 0.5f;
+        instances.emplace_back(SAInstanceData {
+            .SA_BoundingSphere = glm::vec4(center, glm::length(maxPos - center)),
+            .SA_FirstIndex = draw.firstIndex,
+            .SA_IndexCount = draw.indexCount,
+            .SA_VertexOffset = draw.vertexOffset,
+            .SA_Padding = 0,
+        });
+    }
 
-    stagingBuffer->Destroy();
+    m_GpuCulling = MakeUnique<VulkanGpuCulling>();
+    m_GpuCulling->Init(&m_Device, *m_BindlessHeap, *m_PipelineCache, *m_UploadManager, m_CullShaderModule, instances,
+                       m_Instance.GetFrameCountInFlight(), static_cast<bool>(m_DepthPyramid), m_GpuCullingValidation);
 }
 
-void VulkanRHI::CreateIndexBuffer(ArrayIn<uint32_t> triangleIndices)
+void VulkanRHI::CreateClusterCulling()
 {
-    vk::DeviceSize bufferSize = sizeof(decltype(triangleIndices)::value_type) * triangleIndices.size();
-
-    auto stagingBuffer = m_Device.CreateBuffer(bufferSize, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
-    void* data;
-    Utils::VerifyResult(m_Device->mapMemory(stagingBuffer->Memory(), 0, bufferSize, {}), STEXT("Failed to map index buffer memory!"), &data);
-    memcpy(data, triangleIndices.data(), (size_t)bufferSize);
-    m_Device->unmapMemory(stagingBuffer->Memory());
-
-    m_IndexBuffer = m_Device.CreateBuffer(bufferSize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal);
+    if (!m_GpuDrivenRendering || !m_MeshletCulling)
+    {
+        return;
+    }
 
-    CopyBuffer(*stagingBuffer, *m_IndexBuffer, bufferSize);
+    m_ClusterCullShaderModule = m_Device.CreateShaderModule(TakeShaderBinary("cluster_cull"));
+
+    // Meshlets are built in mesh space, the same space as the culling
+    Mesh mesh;
+    mesh.SetPositions(m_Mesh->DecodePositions());
+    mesh.SetIndices({ m_Mesh->Indices().begin(), m_Mesh->Indices().end() });
+    mesh.SetLods({ m_Lods.begin(), m_Lods.end() });
+    mesh.BuildMeshlets();
+
+    // Meshlet vertices first, the triangle offsets move past them
+    auto& meshletData = mesh.Meshlets();
+    std::vector<uint32_t> data = meshletData.vertices;
+    data.insert(data.end(), meshletData.triangles.begin(), meshletData.triangles.end());
+    std::vector<SAMeshletData> meshlets;
+    meshlets.reserve(meshletData.meshlets.size());
+    for (auto&& meshlet : meshletData.meshlets)
+    {
+        meshlets.emplace_back(SAMeshletData {
+            .SA_BoundingSphere = meshlet.boundingSphere,
+            .SA_Cone = meshlet.cone,
+            .SA_VertexOffset = meshlet.vertexOffset,
+            .SA_TriangleOffset = SA_VK_NUM(meshletData.vertices.size()) + meshlet.triangleOffset,
+            .SA_VertexCount = meshlet.vertexCount,
+            .SA_TriangleCount = meshlet.triangleCount,
+        });
+    }
+    m_MeshletLodFirsts.assign(mesh.MeshletLodFirsts().begin(), mesh.MeshletLodFirsts().end());
 
-    stagingBuffer->Destroy();
+    uint32_t maxIndexCount = 0;
+    for (auto&& lod : m_Lods)
+    {
+        maxIndexCount = std::max(maxIndexCount, lod.indexCount);
+    }
+    m_ClusterCulling = MakeUnique<VulkanClusterCulling>();
+    m_ClusterCulling->Init(&m_Device, *m_BindlessHeap, *m_PipelineCache, *m_UploadManager, m_ClusterCullShaderModule, meshlets, data,
+                           maxIndexCount, m_Instance.GetFrameCountInFlight(), static_cast<bool>(m_DepthPyramid), m_GpuCullingValidation);
 }
 
-void VulkanRHI::CreateUniformBuffer()
+void VulkanRHI::CreateDepthPyramid()
 {
-    vk::DeviceSize bufferSize = sizeof(SACommonMatrices);
-    size_t bufferCount = m_Swapchain.Count();
-    m_UniformBuffers.resize(bufferCount);
-
-    for (size_t i = 0; i < bufferCount; i++)
+    if (!m_GpuDrivenRendering || !m_OcclusionCulling)
     {
-        m_UniformBuffers[i] = m_Device.CreateBuffer(bufferSize, vk::BufferUsageFlagBits::eUniformBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+        return;
     }
+
+    m_DepthPyramidShaderModule = m_Device.CreateShaderModule(TakeShaderBinary("depth_pyramid"));
+
+    // Sized by the render graph, the pyramid follows the scene depth
+    m_DepthPyramid = MakeUnique<VulkanDepthPyramid>();
+    m_DepthPyramid->Init(&m_Device, *m_BindlessHeap, *m_PipelineCache, m_DepthPyramidShaderModule);
 }
 
-void VulkanRHI::CreateDepthAttachment()
+void VulkanRHI::CreateTextureStreamer()
 {
-    auto depthFormat = GetDepthFormat();
-    TextureData textureData = {
-        .pixels = SA_RHI_NULL,
-        .width = static_cast<int>(m_Swapchain.Extent().width),
-        .height = static_cast<int>(m_Swapchain.Extent().height),
-        .channel = 2,
-    };
-    VulkanTextureParams textureParams = {
-        .type = vk::ImageType::e2D,
-        .format = depthFormat,
-        .tiling = vk::ImageTiling::eOptimal,
-        .usage = vk::ImageUsageFlagBits::eDepthStencilAttachment,
-        .memoryProps = vk::MemoryPropertyFlagBits::eDeviceLocal,
+    if (!m_TextureStreaming)
+    {
+        return;
+    }
 
-        .viewType = vk::ImageViewType::e2D,
-        .aspectMask = vk::ImageAspectFlagBits::eDepth,
-    };
-    m_DepthAttachment = m_Device.CreateTexture(textureData, textureParams);
-    m_DepthAttachment->TransitionLayout(depthFormat, vk::ImageLayout::eUndefined, vk::ImageLayout::eDepthStencilAttachmentOptimal);
+    m_TextureStreamer = MakeUnique<VulkanTextureStreamer>();
+    m_TextureStreamer->Init(&m_Device, *m_BindlessHeap, *m_UploadManager, m_TextureStreamingBudget, m_TextureStreamingTailSize,
+                            m_Instance.GetFrameCountInFlight());
 }
 
-void VulkanRHI::CreateSampledTexture(std::filesystem::path path)
+void VulkanRHI::CreateSampledTexture()
 {
-    auto textureData = g_RuntimeContext.assetMgr->LoadTexture(path);
-    vk::DeviceSize texSize = textureData->width * textureData->height * 4;
+    if (m_TextureStreamer)
+    {
+        // Only the mip tail is uploaded here, the finer mips follow once the mesh is on screen
+        m_SceneTexture = m_TextureStreamer->AddTexture(std::move(m_PendingTextureAsset.Get()));
+        m_DrawConstants.SA_TextureIndex = m_TextureStreamer->TextureIndex(m_SceneTexture);
+        m_DrawConstants.SA_SamplerIndex = m_TextureStreamer->SamplerIndex();
+        return;
+    }
 
-    auto stagingBuffer = m_Device.CreateBuffer(texSize, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
-    void* data = m_Device->mapMemory(stagingBuffer->Memory(), 0, texSize, {}).value;
-    memcpy(data, textureData->pixels, static_cast<size_t>(texSize));
-    m_Device->unmapMemory(stagingBuffer->Memory());
+    auto textureData = std::move(m_PendingTexture.Get());
+    uint32_t width = SA_VK_NUM(textureData->width);
+    uint32_t height = SA_VK_NUM(textureData->height);
+    vk::DeviceSize texSize = vk::DeviceSize(width) * height * 4;
 
     VulkanTextureParams textureParams = {
         .type = vk::ImageType::e2D,
         .format = vk::Format::eR8G8B8A8Unorm,
         .tiling = vk::ImageTiling::eOptimal,
-        .usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+        .usage = vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
         .memoryProps = vk::MemoryPropertyFlagBits::eDeviceLocal,
 
         .viewType = vk::ImageViewType::e2D,
         .aspectMask = vk::ImageAspectFlagBits::eColor,
+        .mipLevels = TextureFilter::MipCount(width, height),
     };
     m_Texture = m_Device.CreateTexture(*textureData, textureParams);
-
-    m_Texture->TransitionLayout(vk::Format::eR8G8B8A8Unorm, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal);
-    CopyBufferToImage(*stagingBuffer, *m_Texture, SA_VK_NUM(textureData->width), SA_VK_NUM(textureData->height));
-    m_Texture->TransitionLayout(vk::Format::eR8G8B8A8Unorm, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal);
-
-    stagingBuffer->Destroy();
+    if (m_Texture->CanBlitMips())
+    {
+        m_UploadManager->UploadTextureWithMips(*m_Texture, textureData->pixels, texSize, width, height);
+    } else
+    {
+        // No linear blit for the format, the chain is filtered on the CPU and uploaded level by level
+        m_UploadManager->UploadTexture(*m_Texture, textureData->pixels, texSize, width, height);
+        auto mips = TextureFilter::BuildMipChain(ETextureMipFilter::Box, ArrayIn<uint8_t>(textureData->pixels, texSize), width, height);
+        for (uint32_t mip = 1; mip < m_Texture->MipLevels(); mip++)
+        {
+            width = TextureFilter::HalfSize(width);
+            height = TextureFilter::HalfSize(height);
+            auto& data = mips[mip - 1];
+            m_UploadManager->UploadTexture(*m_Texture, data.data(), data.size(), width, height, mip);
+        }
+    }
+    m_DrawConstants.SA_TextureIndex = m_BindlessHeap->RegisterSampledImage(m_Texture->View());
+    m_DrawConstants.SA_SamplerIndex = m_BindlessHeap->RegisterSampler(m_Texture->Sampler());
 }
 
 void VulkanRHI::CreateDescriptorPool()
 {
-    std::array<vk::DescriptorPoolSize, 2> poolSizes = {};
+    std::array<vk::DescriptorPoolSize, 1> poolSizes = {};
     poolSizes[0] = {
-        .type = vk::DescriptorType::eUniformBuffer,
-        .descriptorCount = m_Swapchain.Count(),
-    };
-    poolSizes[1] = {
-        .type = vk::DescriptorType::eCombinedImageSampler,
-        .descriptorCount = m_Swapchain.Count(),
+        .type = vk::DescriptorType::eUniformBufferDynamic,
+        .descriptorCount = 1,
     };
     vk::DescriptorPoolCreateInfo poolInfo = {
-        .maxSets = m_Swapchain.Count(),
+        .maxSets = 1,
         .poolSizeCount = SA_VK_NUM(poolSizes.size()),
         .pPoolSizes = poolSizes.data(),
     };
@@ -626,50 +775,35 @@ void VulkanRHI::CreateDescriptorPool()
 
 void VulkanRHI::CreateDescriptorSets()
 {
-    std::vector<vk::DescriptorSetLayout> layouts(m_Swapchain.Count(), m_DescriptorSetLayout);
+    // The uniform binding is dynamic, a single set serves every frame, the per-draw data
+    // lives in the transient buffer and is addressed through dynamic offsets.
     vk::DescriptorSetAllocateInfo allocInfo = {
         .descriptorPool = m_DescriptorPool,
-        .descriptorSetCount = m_Swapchain.Count(),
-        .pSetLayouts = layouts.data(),
+        .descriptorSetCount = 1,
+        .pSetLayouts = &m_DescriptorSetLayout,
+    };
+    std::vector<vk::DescriptorSet> descriptorSets;
+    Utils::VerifyResult(m_Device->allocateDescriptorSets(allocInfo), STEXT("Failed to alloc descriptor set!"), &descriptorSets);
+    m_DescriptorSet = descriptorSets.front();
+
+    vk::DescriptorBufferInfo bufferInfo = {
+        .buffer = *m_TransientBuffer,
+        .offset = 0,
+        .range = sizeof(SACommonMatrices),
     };
-    m_DescriptorSets.resize(m_Swapchain.Count());
-    Utils::VerifyResult(m_Device->allocateDescriptorSets(allocInfo), STEXT("Failed to alloc descriptor set!"), &m_DescriptorSets);
-    for (size_t i = 0; i < m_Swapchain.Count(); i++)
-    {
-        vk::DescriptorBufferInfo bufferInfo = {
-            .buffer = *m_UniformBuffers[i],
-            .offset = 0,
-            .range = sizeof(SACommonMatrices),
-        };
-        vk::DescriptorImageInfo imageInfo = {
-            .sampler = m_Texture->Sampler(),
-            .imageView = m_Texture->View(),
-            .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
-        };
 
-        std::array<vk::WriteDescriptorSet, 2> descriptorWrites = {};
-        descriptorWrites[0] = vk::WriteDescriptorSet{
-            .dstSet = m_DescriptorSets[i],
-            .dstBinding = 0,
-            .dstArrayElement = 0,
-            .descriptorCount = 1,
-            .descriptorType = vk::DescriptorType::eUniformBuffer,
-            .pImageInfo = SA_RHI_NULL,
-            .pBufferInfo = &bufferInfo,
-            .pTexelBufferView = SA_RHI_NULL,
-        };
-        descriptorWrites[1] = vk::WriteDescriptorSet{
-            .dstSet = m_DescriptorSets[i],
-            .dstBinding = 1,
-            .dstArrayElement = 0,
-            .descriptorCount = 1,
-            .descriptorType = vk::DescriptorType::eCombinedImageSampler,
-            .pImageInfo = &imageInfo,
-            .pBufferInfo = SA_RHI_NULL,
-            .pTexelBufferView = SA_RHI_NULL,
-        };
-        m_Device->updateDescriptorSets(descriptorWrites, nullptr);
-    }
+    std::array<vk::WriteDescriptorSet, 1> descriptorWrites = {};
+    descriptorWrites[0] = vk::WriteDescriptorSet{
+        .dstSet = m_DescriptorSet,
+        .dstBinding = 0,
+        .dstArrayElement = 0,
+        .descriptorCount = 1,
+        .descriptorType = vk::DescriptorType::eUniformBufferDynamic,
+        .pImageInfo = SA_RHI_NULL,
+        .pBufferInfo = &bufferInfo,
+        .pTexelBufferView = SA_RHI_NULL,
+    };
+    m_Device->updateDescriptorSets(descriptorWrites, nullptr);
     SA_LOG_INFO("Create Descriptor Sets, Complete.");
 }
 
@@ -699,110 +833,302 @@ void VulkanRHI::CreateSyncObjects()
     SA_LOG_INFO("Create Semaphores, Complete.");
 }
 
-void VulkanRHI::RecordCommandBuffer(ArrayIn<vk::CommandBuffer> cmds, uint32_t idx)
+void VulkanRHI::RecordCommandBuffer(vk::CommandBuffer cmd, uint32_t imageIdx)
 {
     vk::CommandBufferBeginInfo cmdBeginInfo = {
-        .flags = vk::CommandBufferUsageFlagBits::eSimultaneousUse,
+        .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
         .pInheritanceInfo = nullptr,
     };
 
-    Utils::VerifyResult(cmds[idx].begin(cmdBeginInfo),
+    Utils::VerifyResult(cmd.begin(cmdBeginInfo),
                         [&, this](auto result) {
                             if (result != vk::Result::eSuccess)
                             {
                                 SA_LOG_ERROR("Failed to begin recording command buffer!");
                             } else
                             {
-                                std::array clearValues = {
-                                    vk::ClearValue{.color = std::array{0.0f, 0.0f, 0.0f, 1.0f} },
-                                    vk::ClearValue{.depthStencil = {1.0f, 0} }
-                                };
-                                vk::RenderPassBeginInfo renderPassBeginInfo = {
-                                    .renderPass = m_RenderPass,
-                                    .framebuffer = m_SwapchainFramebuffers[idx],
-                                    .renderArea = vk::Rect2D {
-                                        .offset = {0, 0},
-                                        .extent = m_Swapchain.Extent(),
-                                    },
-                                    .clearValueCount = SA_VK_NUM(clearValues.size()),
-                                    .pClearValues = clearValues.data(),
-                                };
-
-                                cmds[idx].beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
-                                cmds[idx].bindPipeline(vk::PipelineBindPoint::eGraphics, m_GraphicsPipeline);
-
-                                std::array<vk::Buffer, 1> vertexBuffers = { *m_VertexBuffer };
-                                std::array<vk::DeviceSize, 1>   offsets = { 0 };
-                                cmds[idx].bindVertexBuffers(0, 1, vertexBuffers.data(), offsets.data());
-                                cmds[idx].bindIndexBuffer(*m_IndexBuffer, 0, vk::IndexType::eUint32);
-
-                                cmds[idx].bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_PipelineLayout, 0, m_DescriptorSets[idx], nullptr);
-
-                                cmds[idx].drawIndexed(SA_VK_NUM(g_TriangleIndices.size()), 1, 0, 0, 0);
-                                cmds[idx].endRenderPass();
-
-                                Utils::VerifyResult(cmds[idx].end(), STEXT("Failed to end recording command buffer!"));
+                                if (m_GpuProfiler)
+                                {
+                                    m_GpuProfiler->RecordReset(cmd, SA_VK_NUM(m_CurrFrameIndex));
+                                }
+                                m_UploadManager->RecordAcquireBarriers(cmd, SA_VK_NUM(m_CurrFrameIndex), m_FrameWaitSemaphores, m_FrameWaitStages);
+
+                                if (m_OffscreenTarget)
+                                {
+                                    m_RenderGraph->SetImportedTexture(m_BackBuffer, m_OffscreenTarget->Image(imageIdx), m_OffscreenTarget->View(imageIdx));
+                                } else
+                                {
+                                    m_RenderGraph->SetImportedTexture(m_BackBuffer, m_Swapchain.Image(imageIdx), m_Swapchain.View(imageIdx));
+                                }
+                                if (m_TextureStreamer)
+                                {
+                                    m_RenderGraph->SetImportedTexture(m_SampledTexture, m_TextureStreamer->Image(m_SceneTexture),
+                                                                      m_TextureStreamer->View(m_SceneTexture));
+                                } else
+                                {
+                                    m_RenderGraph->SetImportedTexture(m_SampledTexture, *m_Texture, m_Texture->View());
+                                }
+                                uint32_t frameZone = m_GpuProfiler ? m_GpuProfiler->BeginZone(cmd, "GPU Frame") : VulkanGpuProfiler::InvalidZone;
+                                m_RenderGraph->Execute(cmd);
+                                if (m_GpuProfiler)
+                                {
+                                    m_GpuProfiler->EndZone(cmd, frameZone);
+                                }
+
+                                Utils::VerifyResult(cmd.end(), STEXT("Failed to end recording command buffer!"));
                             }
                         });
 }
 
+std::vector<vk::CommandBuffer> VulkanRHI::RecordDrawCommandBuffers(In<RenderGraphPassContext> context, ArrayIn<vk::DrawIndexedIndirectCommand> draws,
+                                                               uint32_t instanceCount)
+{
+    auto& framePool = *m_FrameCommandPools[m_CurrFrameIndex];
+    vk::CommandBufferInheritanceInfo inheritanceInfo = {
+        .renderPass = context.renderPass,
+        .subpass = context.subpass,
+        .framebuffer = context.framebuffer,
+    };
+    vk::CommandBufferBeginInfo cmdBeginInfo = {
+        .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue,
+        .pInheritanceInfo = &inheritanceInfo,
+    };
+
+    uint32_t drawCount = SA_VK_NUM(draws.size());
+    std::vector<vk::CommandBuffer> drawCmds((drawCount + DrawsPerRecordJob - 1) / DrawsPerRecordJob);
+    g_RuntimeContext.jobSys->ParallelFor(drawCount, DrawsPerRecordJob, [&, this](uint32_t begin, uint32_t end) {
+        auto cmd = framePool.AllocateSecondary(JobSystem::ThreadIndex());
+        Utils::VerifyResult(cmd.begin(cmdBeginInfo), STEXT("Failed to begin recording secondary command buffer!"));
+
+        RecordSceneState(cmd, context);
+        for (uint32_t i = begin; i < end; i++)
+        {
+            auto& draw = draws[i];
+            cmd.drawIndexed(draw.indexCount, instanceCount, draw.firstIndex, draw.vertexOffset, draw.firstInstance);
+        }
+
+        Utils::VerifyResult(cmd.end(), STEXT("Failed to end recording secondary command buffer!"));
+        drawCmds[begin / DrawsPerRecordJob] = cmd;
+    });
+    return drawCmds;
+}
+
+void VulkanRHI::ResetBenchmarkDraws(uint32_t drawCount)
+{
+    SAssert(!m_GpuDrivenRendering && m_ScenePassContext.renderPass);
+
+    m_Device.WaitIdle();
+    m_FrameCommandPools[m_CurrFrameIndex]->Reset();
+    if (m_BenchmarkDraws.size() != drawCount)
+    {
+        uint32_t chunkCount = m_LodFirstDraws[1];
+        m_BenchmarkDraws.resize(drawCount);
+        for (uint32_t i = 0; i < drawCount; i++)
+        {
+            m_BenchmarkDraws[i] = m_Draws[i % chunkCount];
+        }
+    }
+}
+
+void VulkanRHI::RecordBenchmarkDraws()
+{
+    RecordDrawCommandBuffers(m_ScenePassContext, m_BenchmarkDraws, 1);
+}
+
+void VulkanRHI::RecordSceneState(vk::CommandBuffer cmd, In<RenderGraphPassContext> context)
+{
+    cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, m_GraphicsPipeline);
+
+    vk::Viewport viewport = {
+        .x = 0.0f,
+        .y = 0.0f,
+        .width = static_cast<float>(context.extent.width),
+        .height = static_cast<float>(context.extent.height),
+        .minDepth = 0.0f,
+        .maxDepth = 1.0f,
+    };
+    vk::Rect2D scissor = {
+        .offset = {0, 0},
+        .extent = context.extent,
+    };
+    cmd.setViewport(0, viewport);
+    cmd.setScissor(0, scissor);
+
+    cmd.bindVertexBuffers(0, m_VertexBufferBindings, m_VertexBufferOffsets);
+    cmd.bindIndexBuffer(*m_IndexBuffer, 0, vk::IndexType::eUint32);
+
+    // Textures are addressed through the bindless heap, a single bind whatever the material
+    std::array descriptorSets = { m_BindlessHeap->Native(), m_DescriptorSet };
+    cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_PipelineLayout, 0, descriptorSets, m_CommonMatricesOffset);
+    cmd.pushConstants<SADrawConstants>(m_PipelineLayout, vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0, m_DrawConstants);
+}
+
+void VulkanRHI::RecordCull(vk::CommandBuffer cmd, ECullPhase phase)
+{
+    auto objectToView = m_CommonMatrices.SA_MatrixV * m_CommonMatrices.SA_ObjectToWorld;
+    auto objectToClip = m_CommonMatrices.SA_MatrixP * objectToView;
+    auto view = VulkanGpuCulling::MakeCullView(objectToClip, glm::vec3(glm::inverse(objectToView)[3]));
+    if (m_DepthPyramid)
+    {
+        m_DepthPyramid->FillCullView(&view);
+    }
+
+    if (m_ClusterCulling)
+    {
+        uint32_t firstMeshlet = m_MeshletLodFirsts[m_CurrentLod];
+        m_ClusterCulling->RecordCull(cmd, SA_VK_NUM(m_CurrFrameIndex), view, phase, firstMeshlet, m_MeshletLodFirsts[m_CurrentLod + 1] - firstMeshlet);
+        return;
+    }
+    uint32_t firstDraw = m_LodFirstDraws[m_CurrentLod];
+    m_GpuCulling->RecordCull(cmd, SA_VK_NUM(m_CurrFrameIndex), view, phase, firstDraw, m_LodFirstDraws[m_CurrentLod + 1] - firstDraw);
+}
+
+void VulkanRHI::RecordCulledDraw(vk::CommandBuffer cmd, In<RenderGraphPassContext> context)
+{
+    RecordSceneState(cmd, context);
+    if (m_ClusterCulling)
+    {
+        m_ClusterCulling->RecordDraw(cmd);
+    } else
+    {
+        m_GpuCulling->RecordDraw(cmd);
+    }
+}
+
 void VulkanRHI::DrawFrame()
 {
-    auto waitForFencesResult = m_Device->waitForFences(m_InFlightFences[m_CurrFrameIndex], SA_RHI_TRUE, std::numeric_limits<uint64_t>::max());
+    SA_PROFILE_FUNCTION();
+    {
+        SA_PROFILE_SCOPE("WaitForFence");
+        auto waitForFencesResult = m_Device->waitForFences(m_InFlightFences[m_CurrFrameIndex], SA_RHI_TRUE, std::numeric_limits<uint64_t>::max());
+    }
 
-    uint32_t imageIdx;
-    Utils::VerifyResult(m_Device->acquireNextImageKHR(m_Swapchain, std::numeric_limits<uint64_t>::max(),
-                                                      m_ImageAvailableSemaphores[m_CurrFrameIndex], SA_RHI_NULL, &imageIdx),
-                        [this](auto result) {
-                            if (result == vk::Result::eErrorOutOfDateKHR)
-                            {
-                                RecreateSwapchain();
-                                return;
-                            } else if (result != vk::Result::eSuccess && result != vk::Result::eSuboptimalKHR)
-                            {
-                                SA_LOG_ERROR("Failed to acquire swap chain image!");
-                            }
-                        });
+    if (m_GpuProfiler)
+    {
+        m_GpuProfiler->BeginFrame(SA_VK_NUM(m_CurrFrameIndex));
+    }
+    m_TransientBuffer->BeginFrame(SA_VK_NUM(m_CurrFrameIndex));
+    m_UploadManager->BeginFrame(SA_VK_NUM(m_CurrFrameIndex));
+    m_BindlessHeap->BeginFrame(SA_VK_NUM(m_CurrFrameIndex));
+    if (m_TextureStreamer)
+    {
+        m_TextureStreamer->BeginFrame(SA_VK_NUM(m_CurrFrameIndex));
+        m_DrawConstants.SA_TextureIndex = m_TextureStreamer->TextureIndex(m_SceneTexture);
+    }
+    if (m_GpuCulling)
+    {
+        m_GpuCulling->BeginFrame(SA_VK_NUM(m_CurrFrameIndex));
+    }
+    if (m_ClusterCulling)
+    {
+        m_ClusterCulling->BeginFrame(SA_VK_NUM(m_CurrFrameIndex));
+    }
+    if (m_OffscreenTarget)
+    {
+        m_OffscreenTarget->BeginFrame(SA_VK_NUM(m_CurrFrameIndex));
+    }
+    m_FrameCommandPools[m_CurrFrameIndex]->Reset();
+
+    // Offscreen images are one per frame in flight, free since the fence wait
+    uint32_t imageIdx = SA_VK_NUM(m_CurrFrameIndex);
+    if (!m_Headless)
+    {
+        SA_PROFILE_SCOPE("Acquire");
+        Utils::VerifyResult(m_Device->acquireNextImageKHR(m_Swapchain, std::numeric_limits<uint64_t>::max(),
+                                                          m_ImageAvailableSemaphores[m_CurrFrameIndex], SA_RHI_NULL, &imageIdx),
+                            [this](auto result) {
+                                if (result == vk::Result::eErrorOutOfDateKHR)
+                                {
+                                    RecreateSwapchain();
+                                    return;
+                                } else if (result != vk::Result::eSuccess && result != vk::Result::eSuboptimalKHR)
+                                {
+                                    SA_LOG_ERROR("Failed to acquire swap chain image!");
+                                }
+                            });
+    }
 
     m_Device->resetFences(m_InFlightFences[m_CurrFrameIndex]);
 
-    UpdateUniformBuffer(imageIdx);
-    RecordCommandBuffer(m_CommandBuffers, imageIdx);
+    UpdateInstances();
+    UpdateUniformBuffer();
+    SelectMeshLod();
+    RequestTextureMips();
+
+    // Only blocks on the first frames, while the background compilation is still running
+    m_GraphicsPipeline = m_PipelineCache->GetGraphicsPipeline(m_GraphicsPipelineDesc);
 
-    std::array<vk::PipelineStageFlags, 1> waitDstStageMask = { vk::PipelineStageFlagBits::eColorAttachmentOutput };
+    m_UploadManager->Flush();
+    m_FrameWaitSemaphores.clear();
+    m_FrameWaitStages.clear();
+    if (!m_Headless)
+    {
+        m_FrameWaitSemaphores.emplace_back(m_ImageAvailableSemaphores[m_CurrFrameIndex]);
+        m_FrameWaitStages.emplace_back(vk::PipelineStageFlagBits::eColorAttachmentOutput);
+    }
+    auto cmd = m_FrameCommandPools[m_CurrFrameIndex]->AllocatePrimary(JobSystem::ThreadIndex());
+    {
+        SA_PROFILE_SCOPE("Record");
+        RecordCommandBuffer(cmd, imageIdx);
+    }
 
     vk::SubmitInfo submitInfo = {
-        .waitSemaphoreCount = 1,
-        .pWaitSemaphores = &m_ImageAvailableSemaphores[m_CurrFrameIndex],
-        .pWaitDstStageMask = waitDstStageMask.data(),
+        .waitSemaphoreCount = SA_VK_NUM(m_FrameWaitSemaphores.size()),
+        .pWaitSemaphores = m_FrameWaitSemaphores.data(),
+        .pWaitDstStageMask = m_FrameWaitStages.data(),
         .commandBufferCount = 1,
-        .pCommandBuffers = &m_CommandBuffers[imageIdx],
-        .signalSemaphoreCount = 1,
+        .pCommandBuffers = &cmd,
+        .signalSemaphoreCount = m_Headless ? 0u : 1u,
         .pSignalSemaphores = &m_RenderFinishedSemaphores[m_CurrFrameIndex],
     };
 
-    Utils::VerifyResult(m_Device.Queue(ERHIQueue::Graphics).submit(submitInfo, m_InFlightFences[m_CurrFrameIndex]), STEXT("Failed to submit draw command buffer!"));
+    {
+        SA_PROFILE_SCOPE("Submit");
+        std::scoped_lock queueLock(m_Device.QueueMutex(ERHIQueue::Graphics));
+        Utils::VerifyResult(m_Device.Queue(ERHIQueue::Graphics).submit(submitInfo, m_InFlightFences[m_CurrFrameIndex]), STEXT("Failed to submit draw command buffer!"));
+    }
+    m_FrameNumber++;
 
-    vk::PresentInfoKHR presentInfo = {
-        .waitSemaphoreCount = 1,
-        .pWaitSemaphores = &m_RenderFinishedSemaphores[m_CurrFrameIndex],
-        .swapchainCount = 1,
-        .pSwapchains = &m_Swapchain.Native(),
-        .pImageIndices = &imageIdx,
-    };
+    if (m_Headless)
+    {
+        if (m_FrameNumber == 1)
+        {
+            m_HeadlessStartTime = std::chrono::steady_clock::now();
+        }
+        if (m_HeadlessFrameCount > 0 && m_FrameNumber >= m_HeadlessFrameCount)
+        {
+            g_RuntimeContext.windowSys->SetShouldClose(true);
+        }
+    } else
+    {
+        SA_PROFILE_SCOPE("Present");
+        vk::PresentInfoKHR presentInfo = {
+            .waitSemaphoreCount = 1,
+            .pWaitSemaphores = &m_RenderFinishedSemaphores[m_CurrFrameIndex],
+            .swapchainCount = 1,
+            .pSwapchains = &m_Swapchain.Native(),
+            .pImageIndices = &imageIdx,
+        };
 
-    Utils::VerifyResult(m_Device.Queue(ERHIQueue::Present).presentKHR(presentInfo),
-                        [this](auto result) {
-                            SharedHandle windowSys = g_RuntimeContext.windowSys;
-                            if (result == vk::Result::eErrorOutOfDateKHR || result == vk::Result::eSuboptimalKHR || windowSys->IsFramebufferResized())
-                            {
-                                windowSys->SetFramebufferResizedToDefault();
-                                RecreateSwapchain();
-                            } else if (result != vk::Result::eSuccess)
-                            {
-                                SA_LOG_ERROR("Failed to present swap chain image!");
-                            }
-                        });
+        // Unlocked before the result is handled, recreating the swapchain waits on every queue
+        vk::Result presentResult;
+        {
+            std::scoped_lock queueLock(m_Device.QueueMutex(ERHIQueue::Present));
+            presentResult = m_Device.Queue(ERHIQueue::Present).presentKHR(presentInfo);
+        }
+        Utils::VerifyResult(presentResult,
+                            [this](auto result) {
+                                SharedHandle windowSys = g_RuntimeContext.windowSys;
+                                if (result == vk::Result::eErrorOutOfDateKHR || result == vk::Result::eSuboptimalKHR || windowSys->IsFramebufferResized())
+                                {
+                                    windowSys->SetFramebufferResizedToDefault();
+                                    RecreateSwapchain();
+                                } else if (result != vk::Result::eSuccess)
+                                {
+                                    SA_LOG_ERROR("Failed to present swap chain image!");
+                                }
+                            });
+    }
 
     m_CurrFrameIndex = (m_CurrFrameIndex + 1) % m_Instance.GetFrameCountInFlight();
 }
@@ -817,15 +1143,30 @@ void VulkanRHI::CreateInstance(Out<VulkanInstance> instance, In<RHIConfig> confi
     instance->EnableValidationLayers() = true & config.vkEnableValidationLayers;
 #endif
     instance->ValidationLayers().append_range(config.vkValidationLayers);
+    instance->Headless() = config.headless;
 
-    uint32_t glfwExtensionCount = 0;
-    const AnsiChar** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-    instance->RequiredExtensions().append_range(std::vector<const AnsiChar*>(glfwExtensions, glfwExtensions + glfwExtensionCount));
+    // Headless needs no WSI extension at all, software drivers built without a window system don't expose them
+    if (!config.headless)
+    {
+        uint32_t glfwExtensionCount = 0;
+        const AnsiChar** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+        instance->RequiredExtensions().append_range(std::vector<const AnsiChar*>(glfwExtensions, glfwExtensions + glfwExtensionCount));
+    }
     if (instance->EnableValidationLayers())
     {
         instance->RequiredExtensions().emplace_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
     }
-    instance->RequiredDeviceExtensions().append_range(config.vkDeviceExtensions);
+    for (auto&& extension : config.vkDeviceExtensions)
+    {
+        if (!config.headless || std::strcmp(extension, VK_KHR_SWAPCHAIN_EXTENSION_NAME) != 0)
+        {
+            instance->RequiredDeviceExtensions().emplace_back(extension);
+        }
+    }
+    if (config.gpuDrivenRendering && !config.meshletCulling)
+    {
+        instance->OptionalDeviceExtensions().emplace_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+    }
     instance->Init(this);
     SA_LOG_INFO("Vulkan Instance Initialized.");
 }
@@ -834,54 +1175,101 @@ void VulkanRHI::CreateInstance(Out<VulkanInstance> instance, In<RHIConfig> confi
 // Tool Functions
 // ==============================================
 
-void VulkanRHI::UpdateUniformBuffer(uint32_t idx)
+void VulkanRHI::UpdateInstances()
 {
-    static auto startTime = std::chrono::high_resolution_clock::now();
-    auto currentTime = std::chrono::high_resolution_clock::now();
-    float time = std::chrono::duration<float>(currentTime - startTime).count();
+    SA_PROFILE_FUNCTION();
+    // Registered for the previous frame, the heap only reuses the index once that frame is done
+    if (m_InstanceMatrixBufferIndex != UINT32_MAX)
+    {
+        m_BindlessHeap->Release(EVulkanBindlessType::StorageBuffer, m_InstanceMatrixBufferIndex);
+        m_InstanceMatrixBufferIndex = UINT32_MAX;
+    }
+    m_InstanceCount = 0;
 
+    bool fromScene = m_SceneState.writeInstances && m_SceneState.instanceCount > 0;
+    uint32_t instanceCount = fromScene ? m_SceneState.instanceCount : 1;
+    vk::DeviceSize size = sizeof(glm::mat4) * instanceCount;
+    auto allocation = m_TransientBuffer->Allocate(size, m_TransientBuffer->StorageAlignment());
+    if (!allocation.IsValid())
+    {
+        return;
+    }
+    // Written straight into the mapping, the scene's update pass is the upload
+    std::span instances(static_cast<glm::mat4*>(allocation.mappedData), instanceCount);
+    if (!fromScene)
+    {
+        instances[0] = glm::mat4(1.0f);
+    } else if (!m_SceneState.writeInstances(instances))
+    {
+        // Instances were added since the count was sampled, the next frame has room for them
+        return;
+    }
+    // Read back from the mapping, a single matrix
+    m_FirstInstanceToWorld = instances[0];
+    m_InstanceMatrixBufferIndex = m_BindlessHeap->RegisterStorageBuffer(allocation.buffer, allocation.offset, size);
+    m_DrawConstants.SA_InstanceMatrixBufferIndex = m_InstanceMatrixBufferIndex;
+    m_InstanceCount = instanceCount;
+}
+
+void VulkanRHI::UpdateUniformBuffer()
+{
     SACommonMatrices ubo = {};
-    ubo.SA_ObjectToWorld = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    ubo.SA_ObjectToWorld = m_SceneState.objectToWorld;
     ubo.SA_MatrixV = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-    ubo.SA_MatrixP = glm::perspective(glm::radians(45.0f), static_cast<float>(m_Swapchain.Extent().width) / m_Swapchain.Extent().height, 0.1f, 10.0f);
+    ubo.SA_MatrixP = glm::perspective(glm::radians(45.0f), static_cast<float>(BackBufferExtent().width) / BackBufferExtent().height, 0.1f, 10.0f);
     ubo.SA_MatrixP[1][1] *= -1;  // for vulkan
 
-    void* data;
-    Utils::VerifyResult(m_Device->mapMemory(m_UniformBuffers[idx]->Memory(), 0, sizeof(ubo), {}), STEXT("Failed to map index buffer memory!"), &data);
-    memcpy(data, &ubo, sizeof(ubo));
-    m_Device->unmapMemory(m_UniformBuffers[idx]->Memory());
+    // Culling works in mesh space of the first instance, the vertex shader reads quantized positions and
+    // puts the instance's world matrix on top
+    m_CommonMatrices = ubo;
+    m_CommonMatrices.SA_ObjectToWorld = m_FirstInstanceToWorld * ubo.SA_ObjectToWorld;
+    ubo.SA_ObjectToWorld = ubo.SA_ObjectToWorld * m_PositionDequantization;
+    auto allocation = m_TransientBuffer->PushUniform(ubo);
+    // Without instances nothing could be placed either
+    m_CommonMatricesValid = allocation.IsValid() && m_InstanceCount > 0;
+    m_CommonMatricesOffset = allocation.DynamicOffset();
 }
 
-void VulkanRHI::CopyBuffer(In<VulkanBuffer> srcBuffer, Ref<VulkanBuffer> dstBuffer, vk::DeviceSize size)
+void VulkanRHI::SelectMeshLod()
 {
-    auto cmd = BeginSingleTimeCommandBuffer();
-    vk::BufferCopy copyRegion = {
-        .srcOffset = 0,
-        .dstOffset = 0,
-        .size = size,
-    };
-    cmd.copyBuffer(srcBuffer, dstBuffer, copyRegion);
-    EndSingleTimeCommandBuffer(cmd);
-}
-
-void VulkanRHI::CopyBufferToImage(In<VulkanBuffer> srcBuffer, Ref<VulkanTexture> dstImage, uint32_t width, uint32_t height)
-{
-    auto cmd = BeginSingleTimeCommandBuffer();
-    vk::BufferImageCopy copyRegion = {
-        .bufferOffset = 0,
-        .bufferRowLength = 0,
-        .bufferImageHeight = 0,
-        .imageSubresource = vk::ImageSubresourceLayers {
-            .aspectMask = vk::ImageAspectFlagBits::eColor,
-            .mipLevel = 0,
-            .baseArrayLayer = 0,
-            .layerCount = 1,
-        },
-        .imageOffset = {0, 0, 0},
-        .imageExtent = {width, height, 1},
-    };
-    cmd.copyBufferToImage(srcBuffer, dstImage, vk::ImageLayout::eTransferDstOptimal, copyRegion);
-    EndSingleTimeCommandBuffer(cmd);
+    // The LOD error is in mesh space
+    m_CurrentLod = Mesh::SelectLod(m_Lods, MeshPixelsPerUnit(), m_LodPixelError);
+}
+
+void VulkanRHI::RequestTextureMips()
+{
+    if (!m_TextureStreamer)
+    {
+        return;
+    }
+
+    // The texture is unwrapped once over the mesh, its texels spread over the projected diameter
+    float screenSize = 2.0f * m_MeshBoundingSphere.w * MeshPixelsPerUnit();
+    auto extent = m_TextureStreamer->Extent(m_SceneTexture);
+    m_TextureStreamer->Request(m_SceneTexture, VulkanTextureStreamer::SelectMip(extent.width, extent.height, screenSize));
+}
+
+float VulkanRHI::MeshPixelsPerUnit() const noexcept
+{
+    // Projected from the nearest point of the bounding sphere
+    glm::mat4 objectToView = m_CommonMatrices.SA_MatrixV * m_CommonMatrices.SA_ObjectToWorld;
+    float scale = std::max({ glm::length(glm::vec3(objectToView[0])), glm::length(glm::vec3(objectToView[1])),
+                             glm::length(glm::vec3(objectToView[2])) });
+    glm::vec3 viewCenter = glm::vec3(objectToView * glm::vec4(glm::vec3(m_MeshBoundingSphere), 1.0f));
+    float distance = std::max(glm::length(viewCenter) - m_MeshBoundingSphere.w * scale, std::numeric_limits<float>::epsilon());
+
+    // SA_MatrixP[1][1] is cot(fovy / 2), flipped for vulkan
+    return 0.5f * BackBufferExtent().height * std::abs(m_CommonMatrices.SA_MatrixP[1][1]) * scale / distance;
+}
+
+vk::Format VulkanRHI::BackBufferFormat() const noexcept
+{
+    return m_OffscreenTarget ? m_OffscreenTarget->Format() : m_Swapchain.Format();
+}
+
+vk::Extent2D VulkanRHI::BackBufferExtent() const noexcept
+{
+    return m_OffscreenTarget ? m_OffscreenTarget->Extent() : m_Swapchain.Extent();
 }
 
 vk::Format VulkanRHI::FindSupportedFormat(ArrayIn<vk::Format> formats, vk::ImageTiling tiling, vk::FormatFeatureFlags features) const noexcept
@@ -901,6 +1289,18 @@ vk::Format VulkanRHI::FindSupportedFormat(ArrayIn<vk::Format> formats, vk::Image
     return vk::Format::eUndefined;
 }
 
+ETextureFormat VulkanRHI::SelectTextureFormat() const noexcept
+{
+    if (!m_TextureCompression)
+    {
+        return ETextureFormat::RGBA8;
+    }
+    // BC7 first, BC1 keeps the footprint down where BC7 isn't supported
+    std::array formats = { vk::Format::eBc7UnormBlock, vk::Format::eBc1RgbUnormBlock, vk::Format::eR8G8B8A8Unorm };
+    return Utils::ToTextureFormat(FindSupportedFormat(formats, vk::ImageTiling::eOptimal,
+                                                      vk::FormatFeatureFlagBits::eSampledImage | vk::FormatFeatureFlagBits::eSampledImageFilterLinear));
+}
+
 vk::Format VulkanRHI::GetDepthFormat() const noexcept
 {
     return FindSupportedFormat(Utils::CommonDepthFormats, vk::ImageTiling::eOptimal, vk::FormatFeatureFlagBits::eDepthStencilAttachment);
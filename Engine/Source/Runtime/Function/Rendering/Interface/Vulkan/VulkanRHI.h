@@ -1,12 +1,27 @@
 ﻿#pragma once
 #include "Engine/Source/Runtime/Core/Base/Common.h"
+#include "Engine/Source/Runtime/Core/Job/JobSystem.h"
 #include "Engine/Source/Runtime/Function/Rendering/Interface/RHI.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/RHITexture.h"
 #include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanUtils.h"
 
 #include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanAdapter.h"
 #include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanInstance.h"
 #include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanDevice.h"
 #include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanSwapchain.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanOffscreenTarget.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanTransientBuffer.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanUploadManager.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanFrameCommandPool.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanRenderGraph.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanPipelineCache.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanBindlessHeap.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanGpuCulling.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanClusterCulling.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanDepthPyramid.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanTextureStreamer.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanGpuProfiler.h"
+#include "Engine/Source/Runtime/Resource/MeshAsset.h"
 
 #include <vulkan/vulkan.hpp>
 
@@ -16,6 +31,7 @@ struct GLFWwindow;
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <chrono>
 #include <optional>
 
 namespace Snowy::Ark
@@ -27,71 +43,21 @@ struct SACommonMatrices
     glm::mat4 SA_MatrixP;
 };
 
-struct SimpleVertex
+// Bindless heap indices of a draw, pushed as push constants
+struct SADrawConstants
 {
-    glm::vec3 position;
-    glm::vec3 color;
-    glm::vec2 texcoord;
-
-    bool operator==(const SimpleVertex& other) const 
-    {
-        return position == other.position && color == other.color && texcoord == other.texcoord;
-    }
-
-    static vk::VertexInputBindingDescription GetBindingDescription()
-    {
-        vk::VertexInputBindingDescription bindingDescription = {
-            .binding = 0,
-            .stride = sizeof(SimpleVertex),
-            .inputRate = vk::VertexInputRate::eVertex,
-        };
-        return bindingDescription;
-    }
-    static std::array<vk::VertexInputAttributeDescription, 3> GetAttributeDescriptions()
-    {
-        std::array<vk::VertexInputAttributeDescription, 3> attributeDescriptions = {};
-        attributeDescriptions[0] = {
-            .location = 0,
-            .binding = 0,
-            .format = vk::Format::eR32G32B32Sfloat,
-            .offset = offsetof(SimpleVertex, position),
-        };
-        attributeDescriptions[1] = {
-            .location = 1,
-            .binding = 0,
-            .format = vk::Format::eR32G32B32Sfloat,
-            .offset = offsetof(SimpleVertex, color),
-        };
-        attributeDescriptions[2] = {
-            .location = 2,
-            .binding = 0,
-            .format = vk::Format::eR32G32Sfloat,
-            .offset = offsetof(SimpleVertex, texcoord),
-        };
-        return attributeDescriptions;
-    }
+    uint32_t SA_TextureIndex;
+    uint32_t SA_SamplerIndex;
+    uint32_t SA_InstanceMatrixBufferIndex;  // world matrices of the frame, indexed by gl_InstanceIndex
 };
 
 
-static std::vector<SimpleVertex> g_TriangleVertices = {}/* = {
-    {{-0.5f, -0.5f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
-    {{ 0.5f, -0.5f, 0.0f}, {0.0f, 1.0f, 0.0f}, {1.0f, 0.0f}},
-    {{ 0.5f,  0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}, {1.0f, 1.0f}},
-    {{-0.5f,  0.5f, 0.0f}, {1.0f, 1.0f, 1.0f}, {0.0f, 1.0f}},
-
-    {{-0.5f, -0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
-    {{ 0.5f, -0.5f, -0.5f}, {0.0f, 1.0f, 0.0f}, {1.0f, 0.0f}},
-    {{ 0.5f,  0.5f, -0.5f}, {0.0f, 0.0f, 1.0f}, {1.0f, 1.0f}},
-    {{-0.5f,  0.5f, -0.5f}, {1.0f, 1.0f, 1.0f}, {0.0f, 1.0f}}
-}*/;
-static std::vector<uint32_t> g_TriangleIndices = {}/* = {
-    0, 1, 2, 2, 3, 0,
-    4, 5, 6, 6, 7, 4,
-}*/;
-
-
 class VulkanRHI final : public RHI
 {
+public:
+    static constexpr uint32_t DrawChunkTriangleCount = 1024;
+    static constexpr uint32_t DrawsPerRecordJob = 64;
+
 public:
     VulkanRHI();
     ~VulkanRHI() override = default;
@@ -101,51 +67,150 @@ public:
     VulkanRHI& operator=(VulkanRHI&&) = default;
 
     void Init(In<RHIConfig> config) override;
-    void Run() override;
+    void Run(In<SceneRenderState> scene) override;
     void Destory() override;
 
+    // SnowyArkBenchmark: the scene pass recording of drawCount draws(the LOD 0 chunks repeated) over the job threads,
+    // against the scene pass of the last frame drawn without GPU culling. Nothing is submitted, ResetBenchmarkDraws
+    // waits for the GPU and recycles the command buffers of the current frame between recordings
+    void ResetBenchmarkDraws(uint32_t drawCount);
+    void RecordBenchmarkDraws();
+
 private:
     VulkanSwapchain m_Swapchain;
     ObserverHandle<GLFWwindow> m_WindowHandle;
     VulkanInstance m_Instance;
     VulkanDevice   m_Device;
 
-    std::vector<vk::Framebuffer> m_SwapchainFramebuffers;
-    vk::RenderPass m_RenderPass;
-
+    // Frames are drawn to offscreen images instead of the swapchain and nothing is presented
+    bool m_Headless = false;
+    uint32_t m_HeadlessFrameCount = 0;
+    AnsiString m_HeadlessCaptureDir;
+    UniqueHandle<VulkanOffscreenTarget> m_OffscreenTarget;
+    std::vector<JobFuture<bool>> m_PendingCaptures;
+    uint64_t m_FrameNumber = 0;
+    std::chrono::steady_clock::time_point m_HeadlessStartTime;     // end of the first frame, the pipeline compilation is left out
+
+    // Null unless the GPU profiling and the profiler are both on
+    bool m_GpuProfiling = false;
+    UniqueHandle<VulkanGpuProfiler> m_GpuProfiler;
+
+    UniqueHandle<VulkanRenderGraph> m_RenderGraph;
+    RenderGraphTexture m_BackBuffer;
+    RenderGraphTexture m_SampledTexture;
+    RenderGraphPass m_CullPass;
+    RenderGraphPass m_ScenePass;
+
+    // Set 0 is the bindless heap, set 1 the per-frame constants
+    uint32_t m_BindlessSampledImageCount = 0;
+    uint32_t m_BindlessSamplerCount = 0;
+    uint32_t m_BindlessStorageBufferCount = 0;
+    UniqueHandle<VulkanBindlessHeap> m_BindlessHeap;
     vk::DescriptorPool m_DescriptorPool;
     vk::DescriptorSetLayout m_DescriptorSetLayout;
-    std::vector<vk::DescriptorSet> m_DescriptorSets;
+    vk::DescriptorSet m_DescriptorSet;
 
+    AnsiString m_PipelineCacheFile;
+    UniqueHandle<VulkanPipelineCache> m_PipelineCache;
+    vk::ShaderModule m_VertShaderModule;
+    vk::ShaderModule m_FragShaderModule;
     vk::PipelineLayout m_PipelineLayout;
+    VulkanGraphicsPipelineDesc m_GraphicsPipelineDesc;
     vk::Pipeline m_GraphicsPipeline;
 
-    vk::CommandPool m_CommandPool;
-    std::vector<vk::CommandBuffer> m_CommandBuffers;
+    std::vector<UniqueHandle<VulkanFrameCommandPool>> m_FrameCommandPools;
+    std::vector<vk::DrawIndexedIndirectCommand> m_Draws;
+    // Draws of LOD i are [m_LodFirstDraws[i], m_LodFirstDraws[i + 1])
+    std::vector<MeshLod> m_Lods;
+    std::vector<uint32_t> m_LodFirstDraws;
+    float m_LodPixelError = 1.0f;
+    uint32_t m_CurrentLod = 0;
+    RenderGraphPassContext m_ScenePassContext;      // of the last frame, what the benchmark draws record against
+    std::vector<vk::DrawIndexedIndirectCommand> m_BenchmarkDraws;
+
+    // Draws are culled and emitted by a compute pass, the scene pass records one indirect draw
+    bool m_GpuDrivenRendering = false;
+    bool m_GpuCullingValidation = false;
+    vk::ShaderModule m_CullShaderModule;
+    UniqueHandle<VulkanGpuCulling> m_GpuCulling;
+    // Meshlets of LOD i are [m_MeshletLodFirsts[i], m_MeshletLodFirsts[i + 1])
+    bool m_MeshletCulling = false;
+    vk::ShaderModule m_ClusterCullShaderModule;
+    UniqueHandle<VulkanClusterCulling> m_ClusterCulling;
+    std::vector<uint32_t> m_MeshletLodFirsts;
+    // Early and late cull/scene passes around the depth pyramid, see ECullPhase
+    bool m_OcclusionCulling = false;
+    vk::ShaderModule m_DepthPyramidShaderModule;
+    UniqueHandle<VulkanDepthPyramid> m_DepthPyramid;
 
     std::vector<vk::Semaphore> m_ImageAvailableSemaphores;
     std::vector<vk::Semaphore> m_RenderFinishedSemaphores;
     std::vector<vk::Fence> m_InFlightFences;
     size_t m_CurrFrameIndex = 0;
-
-    std::vector<UniqueHandle<VulkanBuffer>> m_UniformBuffers;
-
+    std::vector<vk::Semaphore> m_FrameWaitSemaphores;
+    std::vector<vk::PipelineStageFlags> m_FrameWaitStages;
+
+    vk::DeviceSize m_TransientBufferBudget = 0;
+    UniqueHandle<VulkanTransientBuffer> m_TransientBuffer;
+    uint32_t m_CommonMatricesOffset = 0;
+    bool m_CommonMatricesValid = false;   // false when the transient budget ran out, the scene isn't drawn
+    SACommonMatrices m_CommonMatrices = {};
+    // The frame's instance world matrices live in the transient buffer, registered in the bindless heap
+    // for that frame only. Culling, LOD and texture streaming follow the first instance
+    uint32_t m_InstanceCount = 0;
+    uint32_t m_InstanceMatrixBufferIndex = UINT32_MAX;
+    glm::mat4 m_FirstInstanceToWorld = glm::mat4(1.0f);
+    SceneRenderState m_SceneState;     // interpolated by the engine loop for this frame
+
+    vk::DeviceSize m_UploadStagingBudget = 0;
+    UniqueHandle<VulkanUploadManager> m_UploadManager;
+
+    // Started before any resource is created, each asset is waited on where it is first needed
+    std::unordered_map<AnsiString, JobFuture<std::vector<char>>> m_PendingShaders;
+    JobFuture<UniqueHandle<MeshAsset>> m_PendingModel;
+    JobFuture<UniqueHandle<TextureAsset>> m_PendingTextureAsset;
+    JobFuture<UniqueHandle<TextureData>> m_PendingTexture;
+
+    UniqueHandle<MeshAsset> m_Mesh;
+    // Compressed vertex streams, all of them in the one vertex buffer
+    std::vector<vk::VertexInputBindingDescription> m_VertexBindings;
+    std::vector<vk::VertexInputAttributeDescription> m_VertexAttributes;
+    std::vector<vk::Buffer> m_VertexBufferBindings;    // m_VertexBuffer once per binding
+    std::vector<vk::DeviceSize> m_VertexBufferOffsets;
+    glm::mat4 m_PositionDequantization = glm::mat4(1.0f);
+    glm::vec4 m_MeshBoundingSphere = glm::vec4(0.0f);     // mesh space, radius in w
     UniqueHandle<VulkanBuffer> m_VertexBuffer;
     UniqueHandle<VulkanBuffer> m_IndexBuffer;
-    UniqueHandle<VulkanTexture> m_DepthAttachment;
+    SADrawConstants m_DrawConstants = {};
+
+    // Mips above the tail are streamed in by screen-space demand, the image changes when they land.
+    // Without streaming, m_Texture holds the whole chain generated at load
+    bool m_TextureStreaming = true;
+    bool m_TextureCompression = true;
+    vk::DeviceSize m_TextureStreamingBudget = 0;
+    uint32_t m_TextureStreamingTailSize = 0;
+    UniqueHandle<VulkanTextureStreamer> m_TextureStreamer;
+    uint32_t m_SceneTexture = 0;
     UniqueHandle<VulkanTexture> m_Texture;
 
 public:
     VulkanInstance& GetInstance() noexcept { m_Instance; }
     VulkanDevice& GetDevice() noexcept { m_Device; }
     VulkanSwapchain& GetSwapchain() noexcept { m_Swapchain; }
+    VulkanTransientBuffer& GetTransientBuffer() noexcept { return *m_TransientBuffer; }
+    VulkanUploadManager& GetUploadManager() noexcept { return *m_UploadManager; }
+    VulkanRenderGraph& GetRenderGraph() noexcept { return *m_RenderGraph; }
+    VulkanPipelineCache& GetPipelineCache() noexcept { return *m_PipelineCache; }
+    VulkanBindlessHeap& GetBindlessHeap() noexcept { return *m_BindlessHeap; }
+    VulkanGpuCulling& GetGpuCulling() noexcept { return *m_GpuCulling; }
+    VulkanClusterCulling& GetClusterCulling() noexcept { return *m_ClusterCulling; }
+    VulkanDepthPyramid& GetDepthPyramid() noexcept { return *m_DepthPyramid; }
+    VulkanTextureStreamer& GetTextureStreamer() noexcept { return *m_TextureStreamer; }
+    VulkanGpuProfiler& GetGpuProfiler() noexcept { return *m_GpuProfiler; }
 
     ObserverHandle<GLFWwindow> GetWindowHandle() const noexcept { return m_WindowHandle; }
     void SetWindowHandle(ObserverHandle<GLFWwindow> handle) noexcept { m_WindowHandle = handle; }
 
-    vk::CommandBuffer BeginSingleTimeCommandBuffer();
-    void EndSingleTimeCommandBuffer(vk::CommandBuffer cmd);
-
 private:
     void Init_Internal(In<RHIConfig> config);
     void PostInit_Internal();
@@ -154,26 +219,43 @@ private:
 
     void CleanupSwapChain();
     void RecreateSwapchain();
+    void CreateOffscreenTarget();
+    // Readback of a headless frame, saved on a job
+    void CaptureFrame(uint64_t frameNumber, ArrayIn<uint8_t> texels);
 
+    void CreateBindlessHeap();
     void CreateDescriptorSetLayout();
+    void CreatePipelineCache();
     void CreateGraphicsPipeline();  
-    void CreateRenderPass();
-    void CreateFramebuffers();
-    void CreateCommandPool();
-    void CreateCommandBuffers();
-
-    void LoadModel(std::filesystem::path path);
-    void CreateVertexBuffer(ArrayIn<SimpleVertex> triangleVertices);
-    void CreateIndexBuffer(ArrayIn<uint32_t> triangleIndices);
-    void CreateUniformBuffer();
-    void CreateDepthAttachment();
-    void CreateSampledTexture(std::filesystem::path path);
+    void CreateRenderGraph();
+    void BuildRenderGraph();
+    void CreateFrameCommandPools();
+    void CreateGpuProfiler();
+    void CreateUploadManager();
+
+    void LoadAssetsAsync();
+    // Waits for a binary of LoadAssetsAsync, name is the file name without extension
+    std::vector<char> TakeShaderBinary(In<AnsiString> name);
+    void LoadModel();
+    void CreateVertexBuffer(In<MeshAsset> mesh);
+    void CreateIndexBuffer(ArrayIn<uint32_t> triangleIndices, ArrayIn<MeshLod> lods);
+    void CreateTransientBuffer();
+    void CreateGpuCulling();
+    void CreateClusterCulling();
+    void CreateDepthPyramid();
+    void CreateTextureStreamer();
+    void CreateSampledTexture();
 
     void CreateDescriptorPool();
     void CreateDescriptorSets();
     void CreateSyncObjects();
 
-    void RecordCommandBuffer(ArrayIn<vk::CommandBuffer> cmds, uint32_t idx);
+    void RecordCommandBuffer(vk::CommandBuffer cmd, uint32_t imageIdx);
+    std::vector<vk::CommandBuffer> RecordDrawCommandBuffers(In<RenderGraphPassContext> context, ArrayIn<vk::DrawIndexedIndirectCommand> draws,
+                                                            uint32_t instanceCount);
+    void RecordSceneState(vk::CommandBuffer cmd, In<RenderGraphPassContext> context);
+    void RecordCull(vk::CommandBuffer cmd, ECullPhase phase);
+    void RecordCulledDraw(vk::CommandBuffer cmd, In<RenderGraphPassContext> context);
     
     void DrawFrame();
 
@@ -181,22 +263,21 @@ private:
 // Tool Functions
 // ==============================================
 public:
-    void UpdateUniformBuffer(uint32_t idx);
-    void CopyBuffer(In<VulkanBuffer> srcBuffer, Ref<VulkanBuffer> dstBuffer, vk::DeviceSize size);
-    void CopyBufferToImage(In<VulkanBuffer> srcBuffer, Ref<VulkanTexture> dstImage, uint32_t width, uint32_t height);
+    // Writes the scene instances into the frame's range of the transient buffer
+    void UpdateInstances();
+    void UpdateUniformBuffer();
+    void SelectMeshLod();
+    void RequestTextureMips();
+    // Screen pixels per mesh space unit at the nearest point of the mesh bounds
+    float MeshPixelsPerUnit() const noexcept;
+
+    // Of the swapchain, or of the offscreen target when headless
+    vk::Format BackBufferFormat() const noexcept;
+    vk::Extent2D BackBufferExtent() const noexcept;
 
     vk::Format FindSupportedFormat(ArrayIn<vk::Format> formats, vk::ImageTiling tiling, vk::FormatFeatureFlags features) const noexcept;
     vk::Format GetDepthFormat() const noexcept;
+    // Format streamed textures are cooked to
+    ETextureFormat SelectTextureFormat() const noexcept;
 };
 }
-
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
-
-namespace std {
-    template<> struct hash<Snowy::Ark::SimpleVertex> {
-        size_t operator()(Snowy::Ark::SimpleVertex const& vertex) const {
-            return ((hash<glm::vec3>()(vertex.position) ^ (hash<glm::vec3>()(vertex.color) << 1)) >> 1) ^ (hash<glm::vec2>()(vertex.texcoord) << 1);
-        }
-    };
-}
@@ -0,0 +1,858 @@
+﻿#include "VulkanRenderGraph.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanRHI.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanDevice.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanGpuProfiler.h"
+
+namespace Snowy::Ark
+{
+using Utils = VulkanUtils;
+
+static constexpr vk::AccessFlags WriteAccessMask = vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentWrite |
+                                                   vk::AccessFlagBits::eTransferWrite | vk::AccessFlagBits::eShaderWrite;
+
+/*----------------------------------------------------------*/
+// Pass Builder
+/*----------------------------------------------------------*/
+RenderGraphTexture RenderGraphPassBuilder::CreateTexture(SStringIn name, In<RenderGraphTextureDesc> desc)
+{
+    return m_Graph->CreateTexture(name, desc);
+}
+
+void RenderGraphPassBuilder::WriteColor(RenderGraphTexture texture, vk::AttachmentLoadOp loadOp, In<vk::ClearValue> clearValue)
+{
+    m_Graph->AddUse(m_Pass, TextureUse {
+        .texture = texture.index,
+        .access = ERenderGraphAccess::ColorAttachment,
+        .stages = vk::PipelineStageFlagBits::eColorAttachmentOutput,
+        .loadOp = loadOp,
+        .clearValue = clearValue,
+    });
+}
+
+void RenderGraphPassBuilder::WriteDepthStencil(RenderGraphTexture texture, vk::AttachmentLoadOp loadOp, In<vk::ClearValue> clearValue)
+{
+    m_Graph->AddUse(m_Pass, TextureUse {
+        .texture = texture.index,
+        .access = ERenderGraphAccess::DepthStencilAttachment,
+        .stages = vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests,
+        .loadOp = loadOp,
+        .clearValue = clearValue,
+    });
+}
+
+void RenderGraphPassBuilder::ReadTexture(RenderGraphTexture texture, vk::PipelineStageFlags stages)
+{
+    m_Graph->AddUse(m_Pass, TextureUse {
+        .texture = texture.index,
+        .access = ERenderGraphAccess::ShaderRead,
+        .stages = stages,
+    });
+}
+
+void RenderGraphPassBuilder::ReadTransfer(RenderGraphTexture texture)
+{
+    m_Graph->AddUse(m_Pass, TextureUse {
+        .texture = texture.index,
+        .access = ERenderGraphAccess::TransferRead,
+        .stages = vk::PipelineStageFlagBits::eTransfer,
+    });
+}
+
+void RenderGraphPassBuilder::WriteTransfer(RenderGraphTexture texture)
+{
+    m_Graph->AddUse(m_Pass, TextureUse {
+        .texture = texture.index,
+        .access = ERenderGraphAccess::TransferWrite,
+        .stages = vk::PipelineStageFlagBits::eTransfer,
+    });
+}
+
+void RenderGraphPassBuilder::SideEffect() noexcept
+{
+    m_Graph->m_Passes[m_Pass].sideEffect = true;
+}
+
+void RenderGraphPassBuilder::UseSecondaryCommandBuffers() noexcept
+{
+    m_Graph->m_Passes[m_Pass].secondaryCommandBuffers = true;
+}
+
+/*----------------------------------------------------------*/
+// Render Graph
+/*----------------------------------------------------------*/
+void VulkanRenderGraph::Init(ObserverHandle<OwnerType> owner)
+{
+    m_Owner = owner;
+    m_Ctx = owner->Context();
+}
+
+void VulkanRenderGraph::Destroy()
+{
+    Reset();
+}
+
+void VulkanRenderGraph::Reset()
+{
+    DestroyCompiled();
+    m_Textures.clear();
+    m_Passes.clear();
+}
+
+RenderGraphTexture VulkanRenderGraph::ImportTexture(SStringIn name, In<RenderGraphTextureDesc> desc, vk::ImageAspectFlags aspect,
+                                                    vk::ImageLayout initialLayout, vk::ImageLayout finalLayout,
+                                                    vk::Image image, vk::ImageView view)
+{
+    auto& node = m_Textures.emplace_back();
+    node.name = name;
+    node.desc = desc;
+    node.aspect = aspect;
+    node.imported = true;
+    node.initialLayout = initialLayout;
+    node.finalLayout = finalLayout;
+    node.image = image;
+    node.view = view;
+    return RenderGraphTexture{ SA_VK_NUM(m_Textures.size() - 1) };
+}
+
+void VulkanRenderGraph::SetImportedTexture(RenderGraphTexture texture, vk::Image image, vk::ImageView view) noexcept
+{
+    auto& node = m_Textures[texture.index];
+    node.image = image;
+    node.view = view;
+}
+
+RenderGraphTexture VulkanRenderGraph::CreateTexture(SStringIn name, In<RenderGraphTextureDesc> desc)
+{
+    auto& node = m_Textures.emplace_back();
+    node.name = name;
+    node.desc = desc;
+    node.usage = desc.usage;
+    if (std::ranges::find(Utils::CommonDepthFormats, desc.format) != Utils::CommonDepthFormats.end())
+    {
+        node.aspect = vk::ImageAspectFlagBits::eDepth;
+        if (Utils::HasStencilComponent(desc.format))
+        {
+            node.aspect |= vk::ImageAspectFlagBits::eStencil;
+        }
+    } else
+    {
+        node.aspect = vk::ImageAspectFlagBits::eColor;
+    }
+    return RenderGraphTexture{ SA_VK_NUM(m_Textures.size() - 1) };
+}
+
+RenderGraphPass VulkanRenderGraph::AddPass(SStringIn name, In<SetupFunc> setup, ExecuteFunc execute)
+{
+    uint32_t passIndex = SA_VK_NUM(m_Passes.size());
+    auto& pass = m_Passes.emplace_back();
+    pass.name = name;
+    pass.execute = std::move(execute);
+
+    RenderGraphPassBuilder builder(this, passIndex);
+    setup(builder);
+    return RenderGraphPass{ passIndex };
+}
+
+void VulkanRenderGraph::AddUse(uint32_t pass, In<TextureUse> use)
+{
+    static constexpr std::array<vk::ImageUsageFlags, static_cast<size_t>(ERenderGraphAccess::Count)> AccessUsages = {
+        vk::ImageUsageFlagBits::eColorAttachment,
+        vk::ImageUsageFlagBits::eDepthStencilAttachment,
+        vk::ImageUsageFlagBits::eSampled,
+        vk::ImageUsageFlagBits::eTransferSrc,
+        vk::ImageUsageFlagBits::eTransferDst,
+    };
+    m_Textures[use.texture].usage |= AccessUsages[static_cast<size_t>(use.access)];
+    m_Passes[pass].uses.emplace_back(use);
+}
+
+void VulkanRenderGraph::Compile()
+{
+    DestroyCompiled();
+
+    CullPasses();
+    BuildGroups();
+    CreateTransientTextures();
+    BuildBarriers();
+    CreateRenderPasses();
+    NameGpuZones();
+    m_Compiled = true;
+
+    auto alivePassCount = std::ranges::count_if(m_Passes, [](const auto& pass) { return pass.alive; });
+    auto culledPassCount = m_Passes.size() - alivePassCount;
+    auto renderPassCount = std::ranges::count_if(m_Groups, [](const auto& group) { return group.raster; });
+    vk::DeviceSize transientBytes = 0, aliasedBytes = 0;
+    for (auto&& slot : m_AliasSlots)
+    {
+        aliasedBytes += slot.requirements.size;
+        for (auto texture : slot.textures)
+        {
+            auto& node = m_Textures[texture];
+            transientBytes += m_Owner->Native().getImageMemoryRequirements(node.image).size;
+        }
+    }
+    SA_LOG_INFO("Render Graph Compiled, {} passes({} culled) in {} render passes, transient memory {} KB({} KB without aliasing).",
+                alivePassCount, culledPassCount, renderPassCount, aliasedBytes / 1024, transientBytes / 1024);
+}
+
+void VulkanRenderGraph::Execute(vk::CommandBuffer cmd)
+{
+    if (!m_Compiled)
+    {
+        SA_LOG_ERROR("Render graph must be compiled before execution!");
+        return;
+    }
+    for (auto&& group : m_Groups)
+    {
+        RecordBarriers(cmd, group.preBarriers);
+
+        if (!group.raster)
+        {
+            for (auto passIndex : group.passes)
+            {
+                auto& pass = m_Passes[passIndex];
+                uint32_t zone = pass.zoneName ? m_GpuProfiler->BeginZone(cmd, pass.zoneName) : VulkanGpuProfiler::InvalidZone;
+                pass.execute(cmd, RenderGraphPassContext{});
+                if (pass.zoneName)
+                {
+                    m_GpuProfiler->EndZone(cmd, zone);
+                }
+            }
+            continue;
+        }
+
+        RenderGraphPassContext context = {
+            .renderPass = group.renderPass,
+            .subpass = 0,
+            .framebuffer = AcquireFramebuffer(group),
+            .extent = group.extent,
+        };
+        vk::RenderPassBeginInfo renderPassBeginInfo = {
+            .renderPass = context.renderPass,
+            .framebuffer = context.framebuffer,
+            .renderArea = vk::Rect2D {
+                .offset = {0, 0},
+                .extent = context.extent,
+            },
+            .clearValueCount = SA_VK_NUM(group.clearValues.size()),
+            .pClearValues = group.clearValues.data(),
+        };
+        // Subpasses recorded into secondary command buffers can't hold timestamps, the zone covers the whole render pass
+        uint32_t zone = group.zoneName ? m_GpuProfiler->BeginZone(cmd, group.zoneName) : VulkanGpuProfiler::InvalidZone;
+        for (auto&& passIndex : group.passes)
+        {
+            auto& pass = m_Passes[passIndex];
+            auto contents = pass.secondaryCommandBuffers ? vk::SubpassContents::eSecondaryCommandBuffers : vk::SubpassContents::eInline;
+            if (pass.subpass == 0)
+            {
+                cmd.beginRenderPass(renderPassBeginInfo, contents);
+            } else
+            {
+                cmd.nextSubpass(contents);
+            }
+            context.subpass = pass.subpass;
+            pass.execute(cmd, context);
+        }
+        cmd.endRenderPass();
+        if (group.zoneName)
+        {
+            m_GpuProfiler->EndZone(cmd, zone);
+        }
+    }
+    RecordBarriers(cmd, m_FinalBarriers);
+}
+
+vk::RenderPass VulkanRenderGraph::RenderPass(RenderGraphPass pass) const noexcept
+{
+    auto& node = m_Passes[pass.index];
+    return node.alive ? m_Groups[node.group].renderPass : vk::RenderPass{};
+}
+
+vk::ImageView VulkanRenderGraph::SampledView(RenderGraphTexture texture) const noexcept
+{
+    auto& node = m_Textures[texture.index];
+    return node.sampledView ? node.sampledView : node.view;
+}
+
+vk::ImageLayout VulkanRenderGraph::AccessLayout(ERenderGraphAccess access) noexcept
+{
+    switch (access)
+    {
+    case ERenderGraphAccess::ColorAttachment:           return vk::ImageLayout::eColorAttachmentOptimal;
+    case ERenderGraphAccess::DepthStencilAttachment:    return vk::ImageLayout::eDepthStencilAttachmentOptimal;
+    case ERenderGraphAccess::ShaderRead:                return vk::ImageLayout::eShaderReadOnlyOptimal;
+    case ERenderGraphAccess::TransferRead:              return vk::ImageLayout::eTransferSrcOptimal;
+    case ERenderGraphAccess::TransferWrite:             return vk::ImageLayout::eTransferDstOptimal;
+    default:                                            return vk::ImageLayout::eGeneral;
+    }
+}
+
+vk::AccessFlags VulkanRenderGraph::AccessFlags(ERenderGraphAccess access) noexcept
+{
+    switch (access)
+    {
+    case ERenderGraphAccess::ColorAttachment:           return vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite;
+    case ERenderGraphAccess::DepthStencilAttachment:    return vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+    case ERenderGraphAccess::ShaderRead:                return vk::AccessFlagBits::eShaderRead;
+    case ERenderGraphAccess::TransferRead:              return vk::AccessFlagBits::eTransferRead;
+    case ERenderGraphAccess::TransferWrite:             return vk::AccessFlagBits::eTransferWrite;
+    default:                                            return {};
+    }
+}
+
+bool VulkanRenderGraph::IsWrite(ERenderGraphAccess access) noexcept
+{
+    return access == ERenderGraphAccess::ColorAttachment || access == ERenderGraphAccess::DepthStencilAttachment || access == ERenderGraphAccess::TransferWrite;
+}
+
+bool VulkanRenderGraph::IsAttachment(ERenderGraphAccess access) noexcept
+{
+    return access == ERenderGraphAccess::ColorAttachment || access == ERenderGraphAccess::DepthStencilAttachment;
+}
+
+void VulkanRenderGraph::CullPasses()
+{
+    // Walk backwards, a pass survives if it writes something a surviving later pass (or the outside) reads
+    std::vector<bool> needed(m_Textures.size());
+    for (size_t i = 0; i < m_Textures.size(); i++)
+    {
+        needed[i] = m_Textures[i].imported;
+    }
+    for (auto pass = m_Passes.rbegin(); pass != m_Passes.rend(); ++pass)
+    {
+        pass->alive = pass->sideEffect || std::ranges::any_of(pass->uses, [&](const auto& use) {
+            return IsWrite(use.access) && needed[use.texture];
+        });
+        if (!pass->alive)
+        {
+            continue;
+        }
+        for (auto&& use : pass->uses)
+        {
+            if (IsWrite(use.access) && use.loadOp != vk::AttachmentLoadOp::eLoad && !m_Textures[use.texture].imported)
+            {
+                needed[use.texture] = false;
+            }
+        }
+        for (auto&& use : pass->uses)
+        {
+            if (!IsWrite(use.access) || use.loadOp == vk::AttachmentLoadOp::eLoad)
+            {
+                needed[use.texture] = true;
+            }
+        }
+    }
+}
+
+void VulkanRenderGraph::BuildGroups()
+{
+    std::vector<bool> writtenInGroup(m_Textures.size());
+    std::vector<bool> attachedInGroup(m_Textures.size());
+    for (uint32_t passIndex = 0; passIndex < m_Passes.size(); passIndex++)
+    {
+        auto& pass = m_Passes[passIndex];
+        if (!pass.alive)
+        {
+            continue;
+        }
+
+        auto firstAttachment = std::ranges::find_if(pass.uses, [](const auto& use) { return IsAttachment(use.access); });
+        bool raster = firstAttachment != pass.uses.end();
+        vk::Extent2D extent = raster ? m_Textures[firstAttachment->texture].desc.extent : vk::Extent2D{};
+
+        // Merge into the previous render pass as a new subpass when nothing forces a round trip through memory
+        bool merge = !m_Groups.empty() && raster && m_Groups.back().raster && m_Groups.back().extent == extent;
+        if (merge)
+        {
+            for (auto&& use : pass.uses)
+            {
+                bool isAttachment = IsAttachment(use.access);
+                if ((!isAttachment && (writtenInGroup[use.texture] || attachedInGroup[use.texture])) ||
+                    (isAttachment && attachedInGroup[use.texture] && use.loadOp != vk::AttachmentLoadOp::eLoad) ||
+                    (isAttachment && !attachedInGroup[use.texture] && writtenInGroup[use.texture]))
+                {
+                    merge = false;
+                    break;
+                }
+            }
+        }
+
+        if (!merge)
+        {
+            auto& group = m_Groups.emplace_back();
+            group.raster = raster;
+            group.extent = extent;
+            std::ranges::fill(writtenInGroup, false);
+            std::ranges::fill(attachedInGroup, false);
+        }
+        auto& group = m_Groups.back();
+        pass.group = SA_VK_NUM(m_Groups.size() - 1);
+        pass.subpass = SA_VK_NUM(group.passes.size());
+        group.passes.emplace_back(passIndex);
+
+        for (auto&& use : pass.uses)
+        {
+            writtenInGroup[use.texture] = writtenInGroup[use.texture] || IsWrite(use.access);
+            attachedInGroup[use.texture] = attachedInGroup[use.texture] || IsAttachment(use.access);
+
+            auto& node = m_Textures[use.texture];
+            node.firstGroup = std::min(node.firstGroup, pass.group);
+            node.lastGroup = std::max(node.lastGroup, pass.group);
+        }
+    }
+}
+
+void VulkanRenderGraph::CreateTransientTextures()
+{
+    auto& device = m_Owner->Native();
+
+    std::vector<uint32_t> transients;
+    std::vector<vk::MemoryRequirements> requirements(m_Textures.size());
+    for (uint32_t i = 0; i < m_Textures.size(); i++)
+    {
+        auto& node = m_Textures[i];
+        if (node.imported || node.firstGroup == UINT32_MAX)
+        {
+            continue;
+        }
+
+        vk::ImageCreateInfo info = {
+            .flags = {},
+            .imageType = vk::ImageType::e2D,
+            .format = node.desc.format,
+            .extent = vk::Extent3D {
+                .width = node.desc.extent.width,
+                .height = node.desc.extent.height,
+                .depth = 1
+            },
+            .mipLevels = 1,
+            .arrayLayers = 1,
+            .samples = vk::SampleCountFlagBits::e1,
+            .tiling = vk::ImageTiling::eOptimal,
+            .usage = node.usage,
+            .sharingMode = vk::SharingMode::eExclusive,
+            .initialLayout = vk::ImageLayout::eUndefined,
+        };
+        Utils::VerifyResult(device.createImage(info), STEXT("Failed to create render graph texture!"), &node.image);
+        requirements[i] = device.getImageMemoryRequirements(node.image);
+        transients.emplace_back(i);
+    }
+
+    // Greedy interval packing, biggest textures first
+    std::ranges::sort(transients, [&](uint32_t a, uint32_t b) { return requirements[a].size > requirements[b].size; });
+    for (auto texture : transients)
+    {
+        auto& node = m_Textures[texture];
+        auto& req = requirements[texture];
+        auto overlaps = [&](In<AliasSlot> slot) {
+            return std::ranges::any_of(slot.textures, [&](uint32_t other) {
+                auto& otherNode = m_Textures[other];
+                return node.firstGroup <= otherNode.lastGroup && otherNode.firstGroup <= node.lastGroup;
+            });
+        };
+
+        uint32_t slotIndex = 0;
+        for (; slotIndex < m_AliasSlots.size(); slotIndex++)
+        {
+            auto& slot = m_AliasSlots[slotIndex];
+            if ((slot.requirements.memoryTypeBits & req.memoryTypeBits) != 0 && !overlaps(slot))
+            {
+                break;
+            }
+        }
+        if (slotIndex == m_AliasSlots.size())
+        {
+            m_AliasSlots.emplace_back().requirements = req;
+        }
+
+        auto& slot = m_AliasSlots[slotIndex];
+        slot.requirements.size = std::max(slot.requirements.size, req.size);
+        slot.requirements.alignment = std::max(slot.requirements.alignment, req.alignment);
+        slot.requirements.memoryTypeBits &= req.memoryTypeBits;
+        slot.textures.emplace_back(texture);
+        node.aliasSlot = slotIndex;
+    }
+
+    for (auto&& slot : m_AliasSlots)
+    {
+        slot.allocation = m_Owner->Allocator().Allocate(slot.requirements, vk::MemoryPropertyFlagBits::eDeviceLocal, EVulkanResourceKind::Optimal);
+        for (auto texture : slot.textures)
+        {
+            auto& node = m_Textures[texture];
+            Utils::VerifyResult(device.bindImageMemory(node.image, slot.allocation.memory, slot.allocation.offset), STEXT("Failed to bind render graph texture memory!"));
+
+            vk::ImageViewCreateInfo viewInfo = {
+                .image = node.image,
+                .viewType = vk::ImageViewType::e2D,
+                .format = node.desc.format,
+                .subresourceRange = {
+                    .aspectMask = node.aspect,
+                    .baseMipLevel = 0,
+                    .levelCount = 1,
+                    .baseArrayLayer = 0,
+                    .layerCount = 1,
+                },
+            };
+            Utils::VerifyResult(device.createImageView(viewInfo), STEXT("Failed to create render graph texture view!"), &node.view);
+
+            if ((node.usage & vk::ImageUsageFlagBits::eSampled) && (node.aspect & vk::ImageAspectFlagBits::eStencil))
+            {
+                viewInfo.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eDepth;
+                Utils::VerifyResult(device.createImageView(viewInfo), STEXT("Failed to create render graph texture view!"), &node.sampledView);
+            }
+        }
+    }
+}
+
+void VulkanRenderGraph::BuildBarriers()
+{
+    std::vector<TextureState> states(m_Textures.size());
+    std::vector<TextureState> slotStates(m_AliasSlots.size());
+
+    // Simulated twice, the second run starts from the state the first run ended with
+    // so the barriers of a frame also cover the accesses of the previous frame
+    for (uint32_t round = 0; round < 2; round++)
+    {
+        for (size_t i = 0; i < m_Textures.size(); i++)
+        {
+            states[i] = TextureState{ .layout = m_Textures[i].initialLayout };
+        }
+
+        for (uint32_t groupIndex = 0; groupIndex < m_Groups.size(); groupIndex++)
+        {
+            auto& group = m_Groups[groupIndex];
+            BarrierBatch batch;
+
+            // Merge the uses of each texture over the whole group
+            std::vector<TextureUse> groupUses;
+            for (auto passIndex : group.passes)
+            {
+                for (auto&& use : m_Passes[passIndex].uses)
+                {
+                    auto merged = std::ranges::find_if(groupUses, [&](const auto& other) { return other.texture == use.texture; });
+                    if (merged == groupUses.end())
+                    {
+                        groupUses.emplace_back(use);
+                    } else
+                    {
+                        merged->stages |= use.stages;
+                        if (IsWrite(use.access))
+                        {
+                            merged->access = use.access;
+                        }
+                    }
+                }
+            }
+
+            for (auto&& use : groupUses)
+            {
+                auto& node = m_Textures[use.texture];
+                auto& state = states[use.texture];
+                if (!node.imported && node.firstGroup == groupIndex)
+                {
+                    // Aliased memory, wait for the previous owner of the slot
+                    state = slotStates[node.aliasSlot];
+                    state.layout = vk::ImageLayout::eUndefined;
+                }
+
+                auto newLayout = AccessLayout(use.access);
+                auto accessFlags = AccessFlags(use.access);
+                bool isWrite = IsWrite(use.access);
+                if (state.layout != newLayout || isWrite || state.writeAccess)
+                {
+                    batch.srcStages |= state.stages ? state.stages : use.stages;
+                    batch.dstStages |= use.stages;
+                    batch.barriers.emplace_back(TextureBarrier {
+                        .texture = use.texture,
+                        .oldLayout = state.layout,
+                        .newLayout = newLayout,
+                        .srcAccess = state.writeAccess,
+                        .dstAccess = accessFlags,
+                    });
+                    state = TextureState {
+                        .layout = newLayout,
+                        .stages = use.stages,
+                        .writeAccess = isWrite ? accessFlags & WriteAccessMask : vk::AccessFlags{},
+                        .readAccess = accessFlags & ~WriteAccessMask,
+                    };
+                } else
+                {
+                    // Read after read, later writers must wait for every reader
+                    state.stages |= use.stages;
+                    state.readAccess |= accessFlags;
+                }
+
+                if (!node.imported && node.lastGroup == groupIndex)
+                {
+                    slotStates[node.aliasSlot] = state;
+                }
+            }
+
+            if (round == 1)
+            {
+                group.preBarriers = std::move(batch);
+            }
+        }
+    }
+
+    m_FinalBarriers = {};
+    for (uint32_t i = 0; i < m_Textures.size(); i++)
+    {
+        auto& node = m_Textures[i];
+        auto& state = states[i];
+        if (!node.imported || node.finalLayout == vk::ImageLayout::eUndefined || node.finalLayout == state.layout)
+        {
+            continue;
+        }
+        m_FinalBarriers.srcStages |= state.stages ? state.stages : vk::PipelineStageFlagBits::eTopOfPipe;
+        m_FinalBarriers.dstStages |= vk::PipelineStageFlagBits::eBottomOfPipe;
+        m_FinalBarriers.barriers.emplace_back(TextureBarrier {
+            .texture = i,
+            .oldLayout = state.layout,
+            .newLayout = node.finalLayout,
+            .srcAccess = state.writeAccess,
+            .dstAccess = {},
+        });
+    }
+}
+
+void VulkanRenderGraph::CreateRenderPasses()
+{
+    for (uint32_t groupIndex = 0; groupIndex < m_Groups.size(); groupIndex++)
+    {
+        auto& group = m_Groups[groupIndex];
+        if (!group.raster)
+        {
+            continue;
+        }
+
+        std::vector<vk::AttachmentDescription> attachmentDescs;
+        std::vector<std::vector<vk::AttachmentReference>> colorRefs(group.passes.size());
+        std::vector<vk::AttachmentReference> depthRefs(group.passes.size(), vk::AttachmentReference{ .attachment = VK_ATTACHMENT_UNUSED });
+        std::vector<std::vector<uint32_t>> passAttachments(group.passes.size());
+
+        for (uint32_t subpass = 0; subpass < group.passes.size(); subpass++)
+        {
+            for (auto&& use : m_Passes[group.passes[subpass]].uses)
+            {
+                if (!IsAttachment(use.access))
+                {
+                    continue;
+                }
+
+                auto found = std::ranges::find(group.attachments, use.texture);
+                uint32_t attachment = SA_VK_NUM(std::distance(group.attachments.begin(), found));
+                if (found == group.attachments.end())
+                {
+                    auto& node = m_Textures[use.texture];
+                    auto layout = AccessLayout(use.access);
+                    bool keep = node.imported || node.lastGroup > groupIndex;
+                    bool hasStencil = static_cast<bool>(node.aspect & vk::ImageAspectFlagBits::eStencil);
+                    attachmentDescs.emplace_back(vk::AttachmentDescription {
+                        .flags = vk::AttachmentDescriptionFlags{},
+                        .format = node.desc.format,
+                        .samples = vk::SampleCountFlagBits::e1,
+                        .loadOp = use.loadOp,
+                        .storeOp = keep ? vk::AttachmentStoreOp::eStore : vk::AttachmentStoreOp::eDontCare,
+                        .stencilLoadOp = hasStencil ? use.loadOp : vk::AttachmentLoadOp::eDontCare,
+                        .stencilStoreOp = hasStencil && keep ? vk::AttachmentStoreOp::eStore : vk::AttachmentStoreOp::eDontCare,
+                        .initialLayout = layout,    // transitioned by the barriers recorded before the render pass
+                        .finalLayout = layout,
+                    });
+                    group.attachments.emplace_back(use.texture);
+                    group.clearValues.emplace_back(use.clearValue);
+                }
+
+                vk::AttachmentReference ref = {
+                    .attachment = attachment,
+                    .layout = AccessLayout(use.access),
+                };
+                if (use.access == ERenderGraphAccess::ColorAttachment)
+                {
+                    colorRefs[subpass].emplace_back(ref);
+                } else
+                {
+                    depthRefs[subpass] = ref;
+                }
+                passAttachments[subpass].emplace_back(attachment);
+            }
+        }
+
+        std::vector<vk::SubpassDescription> subpassDescs;
+        std::vector<vk::SubpassDependency> dependencies;
+        for (uint32_t subpass = 0; subpass < group.passes.size(); subpass++)
+        {
+            subpassDescs.emplace_back(vk::SubpassDescription {
+                .pipelineBindPoint = vk::PipelineBindPoint::eGraphics,
+                .colorAttachmentCount = SA_VK_NUM(colorRefs[subpass].size()),
+                .pColorAttachments = colorRefs[subpass].data(),
+                .pDepthStencilAttachment = depthRefs[subpass].attachment != VK_ATTACHMENT_UNUSED ? &depthRefs[subpass] : nullptr,
+            });
+
+            // Later subpasses touching the same attachment wait for the earlier ones
+            for (uint32_t earlier = 0; earlier < subpass; earlier++)
+            {
+                bool shared = std::ranges::any_of(passAttachments[subpass], [&](uint32_t attachment) {
+                    return std::ranges::find(passAttachments[earlier], attachment) != passAttachments[earlier].end();
+                });
+                if (shared)
+                {
+                    dependencies.emplace_back(vk::SubpassDependency {
+                        .srcSubpass = earlier,
+                        .dstSubpass = subpass,
+                        .srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eLateFragmentTests,
+                        .dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests,
+                        .srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+                        .dstAccessMask = vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite |
+                                         vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+                        .dependencyFlags = vk::DependencyFlagBits::eByRegion,
+                    });
+                }
+            }
+        }
+
+        vk::RenderPassCreateInfo renderPassInfo = {
+            .attachmentCount = SA_VK_NUM(attachmentDescs.size()),
+            .pAttachments = attachmentDescs.data(),
+            .subpassCount = SA_VK_NUM(subpassDescs.size()),
+            .pSubpasses = subpassDescs.data(),
+            .dependencyCount = SA_VK_NUM(dependencies.size()),
+            .pDependencies = dependencies.data(),
+        };
+        Utils::VerifyResult(m_Owner->Native().createRenderPass(renderPassInfo, nullptr), STEXT("Failed to create render pass!"), &group.renderPass);
+    }
+}
+
+void VulkanRenderGraph::NameGpuZones()
+{
+    if (!m_GpuProfiler || !m_GpuProfiler->IsEnabled())
+    {
+        return;
+    }
+
+    for (auto&& group : m_Groups)
+    {
+        if (!group.raster)
+        {
+            for (auto passIndex : group.passes)
+            {
+                auto& pass = m_Passes[passIndex];
+                pass.zoneName = m_GpuProfiler->InternName(SSTR_TO_UTF8(pass.name));
+            }
+            continue;
+        }
+
+        std::string groupName;
+        for (auto passIndex : group.passes)
+        {
+            groupName += groupName.empty() ? "" : "+";
+            groupName += SSTR_TO_UTF8(m_Passes[passIndex].name);
+        }
+        group.zoneName = m_GpuProfiler->InternName(groupName);
+    }
+}
+
+void VulkanRenderGraph::DestroyCompiled()
+{
+    auto& device = m_Owner->Native();
+    for (auto&& group : m_Groups)
+    {
+        for (auto&& [views, framebuffer] : group.framebuffers)
+        {
+            device.destroyFramebuffer(framebuffer);
+        }
+        device.destroyRenderPass(group.renderPass);
+    }
+    m_Groups.clear();
+
+    for (auto&& slot : m_AliasSlots)
+    {
+        for (auto texture : slot.textures)
+        {
+            auto& node = m_Textures[texture];
+            device.destroyImageView(node.view);
+            device.destroyImageView(node.sampledView);
+            device.destroyImage(node.image);
+            node.view = SA_RHI_NULL;
+            node.sampledView = SA_RHI_NULL;
+            node.image = SA_RHI_NULL;
+        }
+        m_Owner->Allocator().Free(slot.allocation);
+    }
+    m_AliasSlots.clear();
+
+    for (auto&& node : m_Textures)
+    {
+        node.firstGroup = UINT32_MAX;
+        node.lastGroup = 0;
+        node.aliasSlot = UINT32_MAX;
+    }
+    for (auto&& pass : m_Passes)
+    {
+        pass.alive = false;
+        pass.group = UINT32_MAX;
+        pass.subpass = 0;
+    }
+    m_FinalBarriers = {};
+    m_Compiled = false;
+}
+
+vk::Framebuffer VulkanRenderGraph::AcquireFramebuffer(Ref<PassGroup> group)
+{
+    std::vector<VkImageView> views;
+    for (auto texture : group.attachments)
+    {
+        views.emplace_back(m_Textures[texture].view);
+    }
+    if (auto found = group.framebuffers.find(views); found != group.framebuffers.end())
+    {
+        return found->second;
+    }
+
+    std::vector<vk::ImageView> attachments(views.begin(), views.end());
+    vk::FramebufferCreateInfo framebufferInfo = {
+        .renderPass = group.renderPass,
+        .attachmentCount = SA_VK_NUM(attachments.size()),
+        .pAttachments = attachments.data(),
+        .width = group.extent.width,
+        .height = group.extent.height,
+        .layers = 1,
+    };
+    vk::Framebuffer framebuffer;
+    Utils::VerifyResult(m_Owner->Native().createFramebuffer(framebufferInfo, nullptr), STEXT("Failed to create framebuffer!"), &framebuffer);
+    group.framebuffers.emplace(std::move(views), framebuffer);
+    return framebuffer;
+}
+
+void VulkanRenderGraph::RecordBarriers(vk::CommandBuffer cmd, In<BarrierBatch> batch) const
+{
+    if (batch.barriers.empty())
+    {
+        return;
+    }
+
+    std::vector<vk::ImageMemoryBarrier> imageBarriers;
+    imageBarriers.reserve(batch.barriers.size());
+    for (auto&& barrier : batch.barriers)
+    {
+        auto& node = m_Textures[barrier.texture];
+        imageBarriers.emplace_back(vk::ImageMemoryBarrier {
+            .srcAccessMask = barrier.srcAccess,
+            .dstAccessMask = barrier.dstAccess,
+            .oldLayout = barrier.oldLayout,
+            .newLayout = barrier.newLayout,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = node.image,
+            .subresourceRange = vk::ImageSubresourceRange {
+                .aspectMask = node.aspect,
+                .baseMipLevel = 0,
+                .levelCount = VK_REMAINING_MIP_LEVELS,
+                .baseArrayLayer = 0,
+                .layerCount = VK_REMAINING_ARRAY_LAYERS,
+            },
+        });
+    }
+    cmd.pipelineBarrier(batch.srcStages, batch.dstStages, {}, nullptr, nullptr, imageBarriers);
+}
+}
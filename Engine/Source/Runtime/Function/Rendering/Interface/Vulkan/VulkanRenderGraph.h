@@ -0,0 +1,239 @@
+﻿#pragma once
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanUtils.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanMemoryAllocator.h"
+
+#include <functional>
+#include <map>
+
+namespace Snowy::Ark
+{
+/// <summary>
+/// How a render graph pass accesses a texture
+/// </summary>
+enum class ERenderGraphAccess : uint8_t
+{
+    ColorAttachment = 0,
+    DepthStencilAttachment,
+    ShaderRead,
+    TransferRead,
+    TransferWrite,
+    // ========
+    Count,
+};
+
+struct RenderGraphTexture
+{
+    uint32_t index = UINT32_MAX;
+    bool IsValid() const noexcept { return index != UINT32_MAX; }
+};
+
+struct RenderGraphPass
+{
+    uint32_t index = UINT32_MAX;
+    bool IsValid() const noexcept { return index != UINT32_MAX; }
+};
+
+struct RenderGraphTextureDesc
+{
+    vk::Format format = vk::Format::eUndefined;
+    vk::Extent2D extent = {};
+    vk::ImageUsageFlags usage = {};     // extra usage beside the ones implied by the passes
+};
+
+struct RenderGraphPassContext
+{
+    vk::RenderPass renderPass;          // null for passes outside of a render pass
+    uint32_t subpass = 0;
+    vk::Framebuffer framebuffer;
+    vk::Extent2D extent = {};
+};
+
+class VulkanRenderGraph;
+class RenderGraphPassBuilder
+{
+    friend class VulkanRenderGraph;
+public:
+    RenderGraphTexture CreateTexture(SStringIn name, In<RenderGraphTextureDesc> desc);
+
+    void WriteColor(RenderGraphTexture texture, vk::AttachmentLoadOp loadOp, In<vk::ClearValue> clearValue = {});
+    void WriteDepthStencil(RenderGraphTexture texture, vk::AttachmentLoadOp loadOp, In<vk::ClearValue> clearValue = {});
+    void ReadTexture(RenderGraphTexture texture, vk::PipelineStageFlags stages = vk::PipelineStageFlagBits::eFragmentShader);
+    void ReadTransfer(RenderGraphTexture texture);
+    void WriteTransfer(RenderGraphTexture texture);
+
+    // Pass is never culled, e.g. it writes buffers the graph doesn't track
+    void SideEffect() noexcept;
+    // Subpass content is recorded into secondary command buffers
+    void UseSecondaryCommandBuffers() noexcept;
+
+private:
+    RenderGraphPassBuilder(ObserverHandle<VulkanRenderGraph> graph, uint32_t pass) : m_Graph(graph), m_Pass(pass) {}
+
+    ObserverHandle<VulkanRenderGraph> m_Graph;
+    uint32_t m_Pass;
+};
+
+class VulkanDevice;
+class VulkanGpuProfiler;
+
+/// <summary>
+/// Declarative frame graph, passes declare the textures they read and write and the graph
+/// culls unused passes, merges consecutive raster passes into subpasses, aliases the memory of
+/// transient textures whose lifetimes don't overlap, and records every barrier and layout transition.
+/// The graph is compiled once and executed every frame, imported textures can be rebound per frame.
+/// </summary>
+class VulkanRenderGraph
+{
+    friend class RenderGraphPassBuilder;
+public:
+    using OwnerType = VulkanDevice;
+    using SetupFunc = std::function<void(Ref<RenderGraphPassBuilder>)>;
+    using ExecuteFunc = std::function<void(vk::CommandBuffer, In<RenderGraphPassContext>)>;
+
+public:
+    VulkanRenderGraph() = default;
+    ~VulkanRenderGraph() = default;
+    VulkanRenderGraph(const VulkanRenderGraph&) = delete;
+    VulkanRenderGraph(VulkanRenderGraph&&) = delete;
+    VulkanRenderGraph& operator=(const VulkanRenderGraph&) = delete;
+    VulkanRenderGraph& operator=(VulkanRenderGraph&&) = delete;
+
+    void Init(ObserverHandle<OwnerType> owner);
+    void Destroy();
+
+    ObserverHandle<OwnerType> Owner() const noexcept { return m_Owner; }
+    ObserverHandle<VulkanRHI> Context() const noexcept { return m_Ctx; }
+
+    // Drops every pass, texture and compiled object
+    void Reset();
+    // Set before Compile, every pass outside of a render pass and every render pass is then a GPU zone
+    void SetGpuProfiler(ObserverHandle<VulkanGpuProfiler> gpuProfiler) noexcept { m_GpuProfiler = gpuProfiler; }
+
+    RenderGraphTexture ImportTexture(SStringIn name, In<RenderGraphTextureDesc> desc, vk::ImageAspectFlags aspect,
+                                     vk::ImageLayout initialLayout, vk::ImageLayout finalLayout,
+                                     vk::Image image = SA_RHI_NULL, vk::ImageView view = SA_RHI_NULL);
+    void SetImportedTexture(RenderGraphTexture texture, vk::Image image, vk::ImageView view) noexcept;
+    RenderGraphTexture CreateTexture(SStringIn name, In<RenderGraphTextureDesc> desc);
+    RenderGraphPass AddPass(SStringIn name, In<SetupFunc> setup, ExecuteFunc execute);
+
+    void Compile();
+    void Execute(vk::CommandBuffer cmd);
+
+    bool IsCulled(RenderGraphPass pass) const noexcept { return !m_Passes[pass.index].alive; }
+    vk::RenderPass RenderPass(RenderGraphPass pass) const noexcept;
+    uint32_t Subpass(RenderGraphPass pass) const noexcept { return m_Passes[pass.index].subpass; }
+    vk::ImageView View(RenderGraphTexture texture) const noexcept { return m_Textures[texture.index].view; }
+    // Depth only view of a depth/stencil texture, the one shaders can sample
+    vk::ImageView SampledView(RenderGraphTexture texture) const noexcept;
+
+private:
+    struct TextureUse
+    {
+        uint32_t texture = UINT32_MAX;
+        ERenderGraphAccess access = ERenderGraphAccess::ShaderRead;
+        vk::PipelineStageFlags stages;
+        vk::AttachmentLoadOp loadOp = vk::AttachmentLoadOp::eDontCare;
+        vk::ClearValue clearValue;
+    };
+    struct TextureNode
+    {
+        SString name;
+        RenderGraphTextureDesc desc;
+        vk::ImageAspectFlags aspect;
+        vk::ImageUsageFlags usage;
+
+        bool imported = false;
+        vk::ImageLayout initialLayout = vk::ImageLayout::eUndefined;
+        vk::ImageLayout finalLayout = vk::ImageLayout::eUndefined;
+
+        vk::Image image;
+        vk::ImageView view;
+        vk::ImageView sampledView;      // only when the view has a stencil aspect
+
+        uint32_t firstGroup = UINT32_MAX;
+        uint32_t lastGroup = 0;
+        uint32_t aliasSlot = UINT32_MAX;
+    };
+    struct PassNode
+    {
+        SString name;
+        std::vector<TextureUse> uses;
+        ExecuteFunc execute;
+        bool sideEffect = false;
+        bool secondaryCommandBuffers = false;
+
+        bool alive = false;
+        uint32_t group = UINT32_MAX;
+        uint32_t subpass = 0;
+        const char* zoneName = nullptr;
+    };
+    struct TextureBarrier
+    {
+        uint32_t texture;
+        vk::ImageLayout oldLayout;
+        vk::ImageLayout newLayout;
+        vk::AccessFlags srcAccess;
+        vk::AccessFlags dstAccess;
+    };
+    struct BarrierBatch
+    {
+        vk::PipelineStageFlags srcStages;
+        vk::PipelineStageFlags dstStages;
+        std::vector<TextureBarrier> barriers;
+    };
+    struct PassGroup
+    {
+        std::vector<uint32_t> passes;
+        bool raster = false;
+        vk::Extent2D extent = {};
+        vk::RenderPass renderPass;
+        std::vector<uint32_t> attachments;
+        std::vector<vk::ClearValue> clearValues;
+        std::map<std::vector<VkImageView>, vk::Framebuffer> framebuffers;
+        BarrierBatch preBarriers;
+        const char* zoneName = nullptr;     // subpass names joined by '+', raster groups only
+    };
+    struct AliasSlot
+    {
+        vk::MemoryRequirements requirements;
+        std::vector<uint32_t> textures;
+        VulkanAllocation allocation;
+    };
+    struct TextureState
+    {
+        vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+        vk::PipelineStageFlags stages;
+        vk::AccessFlags writeAccess;
+        vk::AccessFlags readAccess;
+    };
+
+    static vk::ImageLayout AccessLayout(ERenderGraphAccess access) noexcept;
+    static vk::AccessFlags AccessFlags(ERenderGraphAccess access) noexcept;
+    static bool IsWrite(ERenderGraphAccess access) noexcept;
+    static bool IsAttachment(ERenderGraphAccess access) noexcept;
+
+    void AddUse(uint32_t pass, In<TextureUse> use);
+    void CullPasses();
+    void BuildGroups();
+    void CreateTransientTextures();
+    void BuildBarriers();
+    void CreateRenderPasses();
+    void NameGpuZones();
+    void DestroyCompiled();
+
+    vk::Framebuffer AcquireFramebuffer(Ref<PassGroup> group);
+    void RecordBarriers(vk::CommandBuffer cmd, In<BarrierBatch> batch) const;
+
+private:
+    ObserverHandle<OwnerType> m_Owner;
+    ObserverHandle<VulkanRHI> m_Ctx;
+    ObserverHandle<VulkanGpuProfiler> m_GpuProfiler = nullptr;
+
+    std::vector<TextureNode> m_Textures;
+    std::vector<PassNode> m_Passes;
+    std::vector<PassGroup> m_Groups;
+    std::vector<AliasSlot> m_AliasSlots;
+    BarrierBatch m_FinalBarriers;
+    bool m_Compiled = false;
+};
+}
@@ -9,6 +9,10 @@ void VulkanTexture::Init(ObserverHandle<OwnerType> owner, In<TextureData> data,
 {
     m_Owner = owner;
     m_Ctx = owner->Context();
+    m_MipLevels = params.mipLevels;
+    m_Extent = vk::Extent2D{ .width = SA_VK_NUM(data.width), .height = SA_VK_NUM(data.height) };
+    m_Format = params.format;
+    m_Usage = params.usage;
 
     vk::ImageCreateInfo info = {
         .flags = {},
@@ -19,7 +23,7 @@ void VulkanTexture::Init(ObserverHandle<OwnerType> owner, In<TextureData> data,
             .height = SA_VK_NUM(data.height),
             .depth = 1
         },
-        .mipLevels = 1,
+        .mipLevels = m_MipLevels,
         .arrayLayers = 1,
         .samples = vk::SampleCountFlagBits::e1,
         .tiling = params.tiling,
@@ -31,13 +35,9 @@ void VulkanTexture::Init(ObserverHandle<OwnerType> owner, In<TextureData> data,
     Utils::VerifyResult(m_Owner->Native().createImage(info), STEXT("Failed to create image!"), &m_Native);
 
     vk::MemoryRequirements memRequirements = m_Owner->Native().getImageMemoryRequirements(m_Native);
-    vk::MemoryAllocateInfo allocInfo = {
-        .allocationSize = memRequirements.size,
-        .memoryTypeIndex = m_Owner->FindMemoryType(memRequirements.memoryTypeBits, params.memoryProps),
-    };
-
-    Utils::VerifyResult(m_Owner->Native().allocateMemory(allocInfo), STEXT("Failed to allocate memory!"), &m_Memory);
-    Utils::VerifyResult(m_Owner->Native().bindImageMemory(m_Native, m_Memory, 0), STEXT("Failed to bind texture memory!"));
+    auto kind = params.tiling == vk::ImageTiling::eOptimal ? EVulkanResourceKind::Optimal : EVulkanResourceKind::Linear;
+    m_Allocation = m_Owner->Allocator().Allocate(memRequirements, params.memoryProps, kind);
+    Utils::VerifyResult(m_Owner->Native().bindImageMemory(m_Native, m_Allocation.memory, m_Allocation.offset), STEXT("Failed to bind texture memory!"));
 
     // View
     vk::ImageViewCreateInfo viewInfo = {
@@ -47,7 +47,7 @@ void VulkanTexture::Init(ObserverHandle<OwnerType> owner, In<TextureData> data,
         .subresourceRange = {
             .aspectMask = params.aspectMask,
             .baseMipLevel = 0,
-            .levelCount = 1,
+            .levelCount = m_MipLevels,
             .baseArrayLayer = 0,
             .layerCount = 1,
         },
@@ -68,81 +68,98 @@ void VulkanTexture::Init(ObserverHandle<OwnerType> owner, In<TextureData> data,
         .compareEnable = SA_RHI_FALSE,
         .compareOp = vk::CompareOp::eAlways,
         .minLod = 0.0f,
-        .maxLod = 0.0f,
+        .maxLod = static_cast<float>(m_MipLevels),
         .borderColor = vk::BorderColor::eIntOpaqueBlack,
         .unnormalizedCoordinates = SA_RHI_FALSE,
     };
     Utils::VerifyResult(m_Owner->Native().createSampler(sampleInfo), STEXT("Failed to create texture sampler!"), &m_Sampler);
 }
 
-void VulkanTexture::Destroy()
+bool VulkanTexture::CanBlitMips() const noexcept
 {
-    m_Owner->Native().destroySampler(m_Sampler);
-    m_Owner->Native().destroyImageView(m_View);
-    m_Owner->Native().destroyImage(m_Native);
-    m_Owner->Native().freeMemory(m_Memory);
+    constexpr auto features = vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst |
+                              vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+    vk::FormatProperties props = m_Owner->Adapter()->getFormatProperties(m_Format);
+    return (props.optimalTilingFeatures & features) == features && (m_Usage & vk::ImageUsageFlagBits::eTransferSrc);
 }
 
-void VulkanTexture::TransitionLayout(vk::Format format, vk::ImageLayout oldLayout, vk::ImageLayout newLayout)
+void VulkanTexture::RecordGenerateMips(vk::CommandBuffer cmd, vk::PipelineStageFlags dstStages, vk::AccessFlags dstAccess) const
 {
-    auto cmd = m_Ctx->BeginSingleTimeCommandBuffer();
-
     vk::ImageMemoryBarrier barrier = {
-        .srcAccessMask = {},
-        .dstAccessMask = {},
-        .oldLayout = oldLayout,
-        .newLayout = newLayout,
+        .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+        .dstAccessMask = vk::AccessFlagBits::eTransferRead,
+        .oldLayout = vk::ImageLayout::eTransferDstOptimal,
+        .newLayout = vk::ImageLayout::eTransferSrcOptimal,
         .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
         .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
         .image = m_Native,
         .subresourceRange = vk::ImageSubresourceRange {
+            .aspectMask = vk::ImageAspectFlagBits::eColor,
             .baseMipLevel = 0,
             .levelCount = 1,
             .baseArrayLayer = 0,
             .layerCount = 1,
         },
     };
-    if (newLayout == vk::ImageLayout::eDepthStencilAttachmentOptimal)
-    {
-        barrier.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eDepth;
-        if (Utils::HasStencilComponent(format))
-        {
-            barrier.subresourceRange.aspectMask |= vk::ImageAspectFlagBits::eStencil;
-        }
-    } else
+
+    int32_t width = static_cast<int32_t>(m_Extent.width);
+    int32_t height = static_cast<int32_t>(m_Extent.height);
+    for (uint32_t mip = 1; mip < m_MipLevels; mip++)
     {
-        barrier.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
-    }
+        // The previous mip was just written, by the upload copy or the previous blit
+        barrier.subresourceRange.baseMipLevel = mip - 1;
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, {}, nullptr, nullptr, barrier);
 
+        int32_t mipWidth = std::max(width / 2, 1);
+        int32_t mipHeight = std::max(height / 2, 1);
+        vk::ImageBlit blit = {
+            .srcSubresource = vk::ImageSubresourceLayers {
+                .aspectMask = vk::ImageAspectFlagBits::eColor,
+                .mipLevel = mip - 1,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+            .srcOffsets = std::array{ vk::Offset3D{0, 0, 0}, vk::Offset3D{width, height, 1} },
+            .dstSubresource = vk::ImageSubresourceLayers {
+                .aspectMask = vk::ImageAspectFlagBits::eColor,
+                .mipLevel = mip,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+            .dstOffsets = std::array{ vk::Offset3D{0, 0, 0}, vk::Offset3D{mipWidth, mipHeight, 1} },
+        };
+        cmd.blitImage(m_Native, vk::ImageLayout::eTransferSrcOptimal, m_Native, vk::ImageLayout::eTransferDstOptimal, blit, vk::Filter::eLinear);
+        width = mipWidth;
+        height = mipHeight;
+    }
 
-    vk::PipelineStageFlags srcStages, dstStages;
-    if (oldLayout == vk::ImageLayout::eUndefined && newLayout == vk::ImageLayout::eTransferDstOptimal)
-    {
-        barrier.srcAccessMask = {};
-        barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
-        srcStages = vk::PipelineStageFlagBits::eTopOfPipe;
-        dstStages = vk::PipelineStageFlagBits::eTransfer;
-    } else if (oldLayout == vk::ImageLayout::eTransferDstOptimal && newLayout == vk::ImageLayout::eShaderReadOnlyOptimal)
-    {
-        barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
-        barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
-        srcStages = vk::PipelineStageFlagBits::eTransfer;
-        dstStages = vk::PipelineStageFlagBits::eFragmentShader;
-    } else if (oldLayout == vk::ImageLayout::eUndefined && newLayout == vk::ImageLayout::eDepthStencilAttachmentOptimal)
+    // Every mip but the last one was a blit source, one transition for the whole chain
+    std::array<vk::ImageMemoryBarrier, 2> finalBarriers = { barrier, barrier };
+    finalBarriers[0].srcAccessMask = vk::AccessFlagBits::eTransferRead;
+    finalBarriers[0].dstAccessMask = dstAccess;
+    finalBarriers[0].oldLayout = vk::ImageLayout::eTransferSrcOptimal;
+    finalBarriers[0].newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+    finalBarriers[0].subresourceRange.baseMipLevel = 0;
+    finalBarriers[0].subresourceRange.levelCount = m_MipLevels - 1;
+    finalBarriers[1].srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    finalBarriers[1].dstAccessMask = dstAccess;
+    finalBarriers[1].oldLayout = vk::ImageLayout::eTransferDstOptimal;
+    finalBarriers[1].newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+    finalBarriers[1].subresourceRange.baseMipLevel = m_MipLevels - 1;
+    if (m_MipLevels > 1)
     {
-        barrier.srcAccessMask = {};
-        barrier.dstAccessMask = vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
-        srcStages = vk::PipelineStageFlagBits::eTopOfPipe;
-        dstStages = vk::PipelineStageFlagBits::eEarlyFragmentTests;
-    }
-    else
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, dstStages, {}, nullptr, nullptr, finalBarriers);
+    } else
     {
-        SA_LOG_ERROR("Unsupported layout transition!");
-        return;
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, dstStages, {}, nullptr, nullptr, finalBarriers[1]);
     }
+}
 
-    cmd.pipelineBarrier(srcStages, dstStages, {}, nullptr, nullptr, barrier);
-
-    m_Ctx->EndSingleTimeCommandBuffer(cmd);
+void VulkanTexture::Destroy()
+{
+    m_Owner->Native().destroySampler(m_Sampler);
+    m_Owner->Native().destroyImageView(m_View);
+    m_Owner->Native().destroyImage(m_Native);
+    m_Owner->Allocator().Free(m_Allocation);
 }
 }
@@ -1,6 +1,7 @@
 ﻿#pragma once
 #include "Engine/Source/Runtime/Function/Rendering/Interface/RHITexture.h"
 #include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanUtils.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanMemoryAllocator.h"
 
 namespace Snowy::Ark
 {
@@ -14,6 +15,7 @@ struct VulkanTextureParams
 
     vk::ImageViewType viewType;
     vk::ImageAspectFlagBits aspectMask;
+    uint32_t mipLevels = 1;     // data gives the size of mip 0
 };
 
 class VulkanDevice;
@@ -45,19 +47,30 @@ public:
     ObserverHandle<OwnerType> Owner() const noexcept { return m_Owner; }
     ObserverHandle<VulkanRHI> Context() const noexcept { return m_Ctx; }
 
-    const vk::DeviceMemory& Memory() const noexcept { return m_Memory; }
+    const vk::DeviceMemory& Memory() const noexcept { return m_Allocation.memory; }
+    vk::DeviceSize MemoryOffset() const noexcept { return m_Allocation.offset; }
     const vk::ImageView& View() const noexcept { return m_View; }
     const vk::Sampler& Sampler() const noexcept { return m_Sampler; }
+    uint32_t MipLevels() const noexcept { return m_MipLevels; }
+    vk::Extent2D Extent() const noexcept { return m_Extent; }
 
-    void TransitionLayout(vk::Format format, vk::ImageLayout oldLayout, vk::ImageLayout newLayout);
+    // Linear blits need a blittable format with linear filtering in optimal tiling, and transfer src usage
+    bool CanBlitMips() const noexcept;
+    // Blits each mip from the previous one. Expects every mip in transfer dst layout with mip 0 written by a transfer,
+    // leaves them all in shader read layout
+    void RecordGenerateMips(vk::CommandBuffer cmd, vk::PipelineStageFlags dstStages, vk::AccessFlags dstAccess) const;
 
 private:
     NativeType m_Native;
     ObserverHandle<OwnerType> m_Owner;
     ObserverHandle<VulkanRHI> m_Ctx;
 
-    vk::DeviceMemory m_Memory;
+    VulkanAllocation m_Allocation;
     vk::ImageView m_View;
     vk::Sampler m_Sampler;
+    uint32_t m_MipLevels = 1;
+    vk::Extent2D m_Extent = {};
+    vk::Format m_Format = vk::Format::eUndefined;
+    vk::ImageUsageFlags m_Usage;
 };
 }
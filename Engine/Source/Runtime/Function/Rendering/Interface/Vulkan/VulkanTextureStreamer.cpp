@@ -0,0 +1,286 @@
+﻿#include "VulkanTextureStreamer.h"
+#include "Engine/Source/Runtime/Core/Job/JobSystem.h"
+#include "Engine/Source/Runtime/Function/Global/GlobalContext.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanRHI.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanDevice.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanBindlessHeap.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanUploadManager.h"
+
+#include <cmath>
+
+namespace Snowy::Ark
+{
+using Utils = VulkanUtils;
+
+void VulkanTextureStreamer::Init(ObserverHandle<OwnerType> owner, Ref<VulkanBindlessHeap> bindlessHeap, Ref<VulkanUploadManager> uploadManager,
+                                 vk::DeviceSize budget, uint32_t tailSize, uint32_t frameCount)
+{
+    m_Owner = owner;
+    m_Ctx = owner->Context();
+    m_BindlessHeap = &bindlessHeap;
+    m_UploadManager = &uploadManager;
+    m_Budget = budget;
+    m_TailSize = std::max(tailSize, 1u);
+    m_RetiredImages.resize(frameCount);
+
+    vk::SamplerCreateInfo samplerInfo = {
+        .magFilter = vk::Filter::eLinear,
+        .minFilter = vk::Filter::eLinear,
+        .mipmapMode = vk::SamplerMipmapMode::eLinear,
+        .addressModeU = vk::SamplerAddressMode::eRepeat,
+        .addressModeV = vk::SamplerAddressMode::eRepeat,
+        .addressModeW = vk::SamplerAddressMode::eRepeat,
+        .mipLodBias = 0.0f,
+        .anisotropyEnable = SA_RHI_TRUE,
+        .maxAnisotropy = 16,
+        .compareEnable = SA_RHI_FALSE,
+        .compareOp = vk::CompareOp::eAlways,
+        .minLod = 0.0f,
+        .maxLod = VK_LOD_CLAMP_NONE,
+        .borderColor = vk::BorderColor::eIntOpaqueBlack,
+        .unnormalizedCoordinates = SA_RHI_FALSE,
+    };
+    Utils::VerifyResult(m_Owner->Native().createSampler(samplerInfo), STEXT("Failed to create streaming sampler!"), &m_Sampler);
+    m_SamplerIndex = m_BindlessHeap->RegisterSampler(m_Sampler);
+
+    SA_LOG_INFO("Texture Streamer, budget {} MB, mip tail up to {}x{}.", m_Budget / (1024 * 1024), m_TailSize, m_TailSize);
+}
+
+void VulkanTextureStreamer::Destroy()
+{
+    {
+        std::unique_lock lock(m_Mutex);
+        m_JobCondition.wait(lock, [this] { return m_RunningJobs == 0; });
+    }
+
+    for (auto&& images : m_RetiredImages)
+    {
+        for (auto&& image : images)
+        {
+            image->Destroy();
+        }
+        images.clear();
+    }
+    for (auto&& texture : m_Textures)
+    {
+        m_BindlessHeap->Release(EVulkanBindlessType::SampledImage, texture->textureIndex);
+        texture->texture->Destroy();
+        if (texture->pending)
+        {
+            texture->pending->Destroy();
+        }
+    }
+    m_Textures.clear();
+    m_BindlessHeap->Release(EVulkanBindlessType::Sampler, m_SamplerIndex);
+    m_Owner->Native().destroySampler(m_Sampler);
+
+    auto stats = Stats();
+    SA_LOG_INFO("Texture Streamer, {} hits, {} misses, {} evictions, {:.2f} MB streamed.", stats.hits, stats.misses, stats.evictions,
+                stats.bytesStreamed / (1024.0 * 1024.0));
+}
+
+uint32_t VulkanTextureStreamer::AddTexture(UniqueHandle<TextureAsset> asset)
+{
+    auto& texture = *m_Textures.emplace_back(MakeUnique<StreamedTexture>());
+    texture.asset = std::move(asset);
+
+    auto& textureAsset = *texture.asset;
+    uint32_t tailMip = 0;
+    while (tailMip + 1 < textureAsset.MipCount() && std::max(textureAsset.Mip(tailMip).width, textureAsset.Mip(tailMip).height) > m_TailSize)
+    {
+        tailMip++;
+    }
+    texture.tailMip = tailMip;
+    texture.residentMip = tailMip;
+    texture.texture = CreateImage(textureAsset, tailMip);
+
+    // A few KB, recorded right away so the first frame already samples the tail
+    uint64_t ticket;
+    UploadMips(*texture.texture, textureAsset, tailMip, &ticket);
+    texture.textureIndex = m_BindlessHeap->RegisterSampledImage(texture.texture->View());
+    m_CommittedBytes += textureAsset.MipChainSize(tailMip);
+    return SA_VK_NUM(m_Textures.size() - 1);
+}
+
+void VulkanTextureStreamer::Request(uint32_t texture, uint32_t mip) noexcept
+{
+    auto& streamed = *m_Textures[texture];
+    streamed.requestedMip = std::min(streamed.requestedMip, mip);
+    streamed.lastRequestFrame = m_FrameNumber;
+}
+
+uint32_t VulkanTextureStreamer::SelectMip(uint32_t width, uint32_t height, float screenSize) noexcept
+{
+    // Mip m is max(width, height) / 2^m texels across, the coarsest one still covering a texel per pixel
+    if (screenSize < 1.0f)
+    {
+        return UINT32_MAX;
+    }
+    float texelsPerPixel = static_cast<float>(std::max(width, height)) / screenSize;
+    return texelsPerPixel <= 1.0f ? 0 : static_cast<uint32_t>(std::floor(std::log2(texelsPerPixel)));
+}
+
+void VulkanTextureStreamer::BeginFrame(uint32_t frameIndex)
+{
+    for (auto&& image : m_RetiredImages[frameIndex])
+    {
+        image->Destroy();
+    }
+    m_RetiredImages[frameIndex].clear();
+    CompleteStreams(frameIndex);
+
+    uint32_t startedCount = 0;
+    for (auto&& texture : m_Textures)
+    {
+        if (texture->requestedMip == UINT32_MAX)
+        {
+            continue;
+        }
+        uint32_t mip = std::min(texture->requestedMip, texture->tailMip);
+        texture->requestedMip = UINT32_MAX;
+        if (mip >= texture->residentMip)
+        {
+            m_Hits++;
+            continue;
+        }
+        m_Misses++;
+        if (texture->pending || startedCount == MaxStreamsPerFrame)
+        {
+            continue;
+        }
+
+        // Settles for a coarser mip when even evicting everything else doesn't make room
+        auto& asset = *texture->asset;
+        while (mip < texture->residentMip && !MakeRoom(asset.MipChainSize(mip) - asset.MipChainSize(texture->residentMip), *texture))
+        {
+            mip++;
+        }
+        if (mip < texture->residentMip)
+        {
+            StartStream(*texture, mip);
+            startedCount++;
+        }
+    }
+    m_FrameNumber++;
+}
+
+VulkanTextureStreamingStats VulkanTextureStreamer::Stats() const noexcept
+{
+    return VulkanTextureStreamingStats{
+        .hits = m_Hits,
+        .misses = m_Misses,
+        .evictions = m_Evictions,
+        .bytesStreamed = m_BytesStreamed.load(std::memory_order_relaxed),
+        .residentBytes = m_CommittedBytes,
+    };
+}
+
+UniqueHandle<VulkanTexture> VulkanTextureStreamer::CreateImage(In<TextureAsset> asset, uint32_t firstMip)
+{
+    auto& mip = asset.Mip(firstMip);
+    TextureData data = {
+        .pixels = nullptr,
+        .width = static_cast<int>(mip.width),
+        .height = static_cast<int>(mip.height),
+        .channel = TextureEncoder::BytesPerTexel,
+    };
+    VulkanTextureParams params = {
+        .type = vk::ImageType::e2D,
+        .format = Utils::ToVkFormat(asset.Format()),
+        .tiling = vk::ImageTiling::eOptimal,
+        .usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+        .memoryProps = vk::MemoryPropertyFlagBits::eDeviceLocal,
+
+        .viewType = vk::ImageViewType::e2D,
+        .aspectMask = vk::ImageAspectFlagBits::eColor,
+        .mipLevels = asset.MipCount() - firstMip,
+    };
+    return m_Owner->CreateTexture(data, params);
+}
+
+void VulkanTextureStreamer::UploadMips(Ref<VulkanTexture> image, In<TextureAsset> asset, uint32_t firstMip, Out<uint64_t> ticket)
+{
+    // Reading the mapping faults the pages in, on whichever thread records the upload
+    for (uint32_t mip = firstMip; mip < asset.MipCount(); mip++)
+    {
+        auto& info = asset.Mip(mip);
+        auto data = asset.MipData(mip);
+        *ticket = m_UploadManager->UploadTexture(image, data.data(), data.size(), info.width, info.height, mip - firstMip);
+    }
+}
+
+void VulkanTextureStreamer::StartStream(Ref<StreamedTexture> texture, uint32_t mip)
+{
+    auto& asset = *texture.asset;
+    m_CommittedBytes += asset.MipChainSize(mip);
+    m_CommittedBytes -= asset.MipChainSize(texture.residentMip);
+
+    texture.pending = CreateImage(asset, mip);
+    texture.pendingMip = mip;
+    texture.pendingTicket.store(0, std::memory_order_relaxed);
+    {
+        std::scoped_lock lock(m_Mutex);
+        m_RunningJobs++;
+    }
+    g_RuntimeContext.jobSys->Submit([this, &texture] {
+        uint64_t ticket;
+        UploadMips(*texture.pending, *texture.asset, texture.pendingMip, &ticket);
+        m_BytesStreamed.fetch_add(texture.asset->MipChainSize(texture.pendingMip), std::memory_order_relaxed);
+        texture.pendingTicket.store(ticket, std::memory_order_release);
+        {
+            std::scoped_lock lock(m_Mutex);
+            m_RunningJobs--;
+        }
+        m_JobCondition.notify_all();
+    });
+}
+
+void VulkanTextureStreamer::CompleteStreams(uint32_t frameIndex)
+{
+    for (auto&& texture : m_Textures)
+    {
+        if (!texture->pending)
+        {
+            continue;
+        }
+        uint64_t ticket = texture->pendingTicket.load(std::memory_order_acquire);
+        if (ticket == 0 || !m_UploadManager->IsComplete(ticket))
+        {
+            continue;
+        }
+
+        // Frames still in flight sample the previous image through its old index, both retire with this frame
+        m_BindlessHeap->Release(EVulkanBindlessType::SampledImage, texture->textureIndex);
+        m_RetiredImages[frameIndex].emplace_back(std::move(texture->texture));
+        texture->texture = std::move(texture->pending);
+        texture->residentMip = texture->pendingMip;
+        texture->textureIndex = m_BindlessHeap->RegisterSampledImage(texture->texture->View());
+        SA_LOG_DEBUG("Stream Texture, mip {} resident, {}x{}.", texture->residentMip, texture->asset->Mip(texture->residentMip).width,
+                     texture->asset->Mip(texture->residentMip).height);
+    }
+}
+
+bool VulkanTextureStreamer::MakeRoom(vk::DeviceSize bytes, Ref<StreamedTexture> requester)
+{
+    while (m_CommittedBytes + bytes > m_Budget)
+    {
+        // Textures requested last frame are on screen, the others are cached
+        StreamedTexture* victim = nullptr;
+        for (auto&& texture : m_Textures)
+        {
+            if (texture.get() != &requester && !texture->pending && texture->residentMip < texture->tailMip &&
+                texture->lastRequestFrame < m_FrameNumber && (!victim || texture->lastRequestFrame < victim->lastRequestFrame))
+            {
+                victim = texture.get();
+            }
+        }
+        if (!victim)
+        {
+            return false;
+        }
+        StartStream(*victim, victim->tailMip);
+        m_Evictions++;
+    }
+    return true;
+}
+}
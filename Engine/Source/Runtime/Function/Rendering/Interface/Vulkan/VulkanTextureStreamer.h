@@ -0,0 +1,129 @@
+﻿#pragma once
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanUtils.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanTexture.h"
+#include "Engine/Source/Runtime/Resource/TextureAsset.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+namespace Snowy::Ark
+{
+struct VulkanTextureStreamingStats
+{
+    uint64_t hits = 0;              // requests already covered by the resident mips
+    uint64_t misses = 0;            // requests that needed a stream in
+    uint64_t evictions = 0;
+    uint64_t bytesStreamed = 0;
+    uint64_t residentBytes = 0;     // mips resident or being streamed in
+};
+
+class VulkanDevice;
+class VulkanBindlessHeap;
+class VulkanUploadManager;
+
+/// <summary>
+/// Streams the mips of cooked textures by screen-space demand. The mip tail(every mip up to TailSize)
+/// is uploaded when a texture is added and stays resident, so anything can be drawn on the first frame.
+/// Finer mips are requested every frame, a worker stages them from the file mapping into a new image
+/// holding [mip, tail], and the image is swapped in once its upload completed, the previous one retires
+/// with the frames in flight. Past the budget, the least recently requested textures fall back to their tail.
+/// </summary>
+class VulkanTextureStreamer
+{
+public:
+    using OwnerType = VulkanDevice;
+
+    static constexpr uint32_t MaxStreamsPerFrame = 4;
+
+public:
+    VulkanTextureStreamer() = default;
+    ~VulkanTextureStreamer() = default;
+    VulkanTextureStreamer(const VulkanTextureStreamer&) = delete;
+    VulkanTextureStreamer(VulkanTextureStreamer&&) = delete;
+    VulkanTextureStreamer& operator=(const VulkanTextureStreamer&) = delete;
+    VulkanTextureStreamer& operator=(VulkanTextureStreamer&&) = delete;
+
+    void Init(ObserverHandle<OwnerType> owner, Ref<VulkanBindlessHeap> bindlessHeap, Ref<VulkanUploadManager> uploadManager,
+              vk::DeviceSize budget, uint32_t tailSize, uint32_t frameCount);
+    void Destroy();
+
+    ObserverHandle<OwnerType> Owner() const noexcept { return m_Owner; }
+    ObserverHandle<VulkanRHI> Context() const noexcept { return m_Ctx; }
+
+    // Uploads the mip tail, returns the id of the texture
+    uint32_t AddTexture(UniqueHandle<TextureAsset> asset);
+    // Finest mip wanted this frame, the finest of all the requests of a frame wins
+    void Request(uint32_t texture, uint32_t mip) noexcept;
+    // Finest mip worth having for a texture of width x height spanning screenSize pixels
+    static uint32_t SelectMip(uint32_t width, uint32_t height, float screenSize) noexcept;
+
+    // Called once the fence of frameIndex has been waited on, swaps in the completed streams
+    // and starts new ones from the requests of the previous frame
+    void BeginFrame(uint32_t frameIndex);
+
+    // Valid until the next BeginFrame
+    vk::Image Image(uint32_t texture) const noexcept { return *m_Textures[texture]->texture; }
+    vk::ImageView View(uint32_t texture) const noexcept { return m_Textures[texture]->texture->View(); }
+    uint32_t TextureIndex(uint32_t texture) const noexcept { return m_Textures[texture]->textureIndex; }
+    uint32_t ResidentMip(uint32_t texture) const noexcept { return m_Textures[texture]->residentMip; }
+    // Size of mip 0
+    vk::Extent2D Extent(uint32_t texture) const noexcept
+    {
+        auto& header = m_Textures[texture]->asset->Header();
+        return vk::Extent2D{ .width = header.width, .height = header.height };
+    }
+    uint32_t SamplerIndex() const noexcept { return m_SamplerIndex; }
+    VulkanTextureStreamingStats Stats() const noexcept;
+
+private:
+    struct StreamedTexture
+    {
+        UniqueHandle<TextureAsset> asset;
+        uint32_t tailMip = 0;
+
+        UniqueHandle<VulkanTexture> texture;    // holds [residentMip, mip count)
+        uint32_t residentMip = 0;
+        uint32_t textureIndex = UINT32_MAX;
+
+        uint32_t requestedMip = UINT32_MAX;     // finest request since the last BeginFrame
+        uint64_t lastRequestFrame = 0;
+
+        UniqueHandle<VulkanTexture> pending;    // being filled by a worker
+        uint32_t pendingMip = 0;
+        std::atomic<uint64_t> pendingTicket = 0;    // upload ticket, 0 until every mip is recorded
+    };
+
+    UniqueHandle<VulkanTexture> CreateImage(In<TextureAsset> asset, uint32_t firstMip);
+    void UploadMips(Ref<VulkanTexture> image, In<TextureAsset> asset, uint32_t firstMip, Out<uint64_t> ticket);
+    void StartStream(Ref<StreamedTexture> texture, uint32_t mip);
+    void CompleteStreams(uint32_t frameIndex);
+    // Drops textures to their tail, least recently requested first, until bytes more fit in the budget
+    bool MakeRoom(vk::DeviceSize bytes, Ref<StreamedTexture> requester);
+
+private:
+    ObserverHandle<OwnerType> m_Owner;
+    ObserverHandle<VulkanRHI> m_Ctx;
+    ObserverHandle<VulkanBindlessHeap> m_BindlessHeap;
+    ObserverHandle<VulkanUploadManager> m_UploadManager;
+
+    vk::DeviceSize m_Budget = 0;
+    uint32_t m_TailSize = 0;
+    vk::Sampler m_Sampler;      // shared by every streamed texture, the LOD range comes from the views
+    uint32_t m_SamplerIndex = UINT32_MAX;
+
+    std::vector<UniqueHandle<StreamedTexture>> m_Textures;
+    std::vector<std::vector<UniqueHandle<VulkanTexture>>> m_RetiredImages;    // per frame in flight
+    uint64_t m_FrameNumber = 1;
+    vk::DeviceSize m_CommittedBytes = 0;    // at the target mip of every texture
+
+    uint64_t m_Hits = 0;
+    uint64_t m_Misses = 0;
+    uint64_t m_Evictions = 0;
+    std::atomic<uint64_t> m_BytesStreamed = 0;
+
+    uint32_t m_RunningJobs = 0;
+    std::mutex m_Mutex;
+    std::condition_variable m_JobCondition;
+};
+}
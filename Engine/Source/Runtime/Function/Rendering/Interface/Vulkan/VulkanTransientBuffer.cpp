@@ -0,0 +1,68 @@
+﻿#include "VulkanTransientBuffer.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanRHI.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanDevice.h"
+
+namespace Snowy::Ark
+{
+using Utils = VulkanUtils;
+
+void VulkanTransientBuffer::Init(ObserverHandle<OwnerType> owner, vk::DeviceSize budgetPerFrame, uint32_t frameCount)
+{
+    m_Owner = owner;
+    m_Ctx = owner->Context();
+
+    auto& limits = m_Owner->Adapter().Properties().limits;
+    m_UniformAlignment = std::max<vk::DeviceSize>(limits.minUniformBufferOffsetAlignment, 16);
+    m_StorageAlignment = std::max<vk::DeviceSize>(limits.minStorageBufferOffsetAlignment, 16);
+
+    // Every frame region starts on a base both uniform and storage allocations can be aligned from
+    vk::DeviceSize regionAlignment = std::max(m_UniformAlignment, m_StorageAlignment);
+    m_BudgetPerFrame = (budgetPerFrame + regionAlignment - 1) & ~(regionAlignment - 1);
+    m_Buffer = m_Owner->CreateBuffer(m_BudgetPerFrame * frameCount,
+                                     vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eStorageBuffer |
+                                     vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eIndexBuffer,
+                                     vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+    if (!m_Buffer->MappedData())
+    {
+        SA_LOG_ERROR("Transient buffer is not host visible!");
+    }
+    BeginFrame(0);
+}
+
+void VulkanTransientBuffer::Destroy()
+{
+    m_Buffer->Destroy();
+}
+
+void VulkanTransientBuffer::BeginFrame(uint32_t frameIndex) noexcept
+{
+    m_FrameBase = m_BudgetPerFrame * frameIndex;
+    m_Cursor.store(0, std::memory_order_relaxed);
+}
+
+VulkanTransientAllocation VulkanTransientBuffer::Allocate(vk::DeviceSize size, vk::DeviceSize alignment) noexcept
+{
+    vk::DeviceSize cursor = m_Cursor.load(std::memory_order_relaxed);
+    vk::DeviceSize alignedCursor;
+    do
+    {
+        alignedCursor = (cursor + alignment - 1) & ~(alignment - 1);
+        if (alignedCursor + size > m_BudgetPerFrame)
+        {
+            // Null buffer and mapping, never mistaken for the allocation at offset 0
+            SA_LOG_ERROR("Transient buffer budget({} bytes) exceeded, {} bytes requested!", m_BudgetPerFrame, size);
+            return VulkanTransientAllocation {
+                .buffer = {},
+                .mappedData = nullptr,
+            };
+        }
+    } while (!m_Cursor.compare_exchange_weak(cursor, alignedCursor + size, std::memory_order_relaxed));
+
+    vk::DeviceSize offset = m_FrameBase + alignedCursor;
+    return VulkanTransientAllocation {
+        .buffer = m_Buffer->Native(),
+        .offset = offset,
+        .mappedData = static_cast<std::byte*>(m_Buffer->MappedData()) + offset,
+    };
+}
+}
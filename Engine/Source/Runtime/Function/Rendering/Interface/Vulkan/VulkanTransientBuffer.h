@@ -0,0 +1,83 @@
+﻿#pragma once
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanUtils.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanBuffer.h"
+
+#include <atomic>
+
+namespace Snowy::Ark
+{
+struct VulkanTransientAllocation
+{
+    vk::Buffer buffer;
+    vk::DeviceSize offset = 0;
+    void* mappedData = nullptr;
+
+    bool IsValid() const noexcept { return buffer && mappedData != nullptr; }
+    uint32_t DynamicOffset() const noexcept { return static_cast<uint32_t>(offset); }
+};
+
+class VulkanDevice;
+
+/// <summary>
+/// Persistently mapped per-frame linear ring for transient GPU data (constants, dynamic vertices...).
+/// The buffer is split into one region per frame in flight, allocations bump a cursor inside the
+/// region of the current frame and are recycled once that frame's fence has been waited on.
+/// </summary>
+class VulkanTransientBuffer
+{
+public:
+    using NativeType = vk::Buffer;
+    using OwnerType  = VulkanDevice;
+
+public:
+    VulkanTransientBuffer() = default;
+    ~VulkanTransientBuffer() = default;
+    VulkanTransientBuffer(const VulkanTransientBuffer&) = delete;
+    VulkanTransientBuffer(VulkanTransientBuffer&&) = delete;
+    VulkanTransientBuffer& operator=(const VulkanTransientBuffer&) = delete;
+    VulkanTransientBuffer& operator=(VulkanTransientBuffer&&) = delete;
+
+    void Init(ObserverHandle<OwnerType> owner, vk::DeviceSize budgetPerFrame, uint32_t frameCount);
+    void Destroy();
+
+    auto& Native    () noexcept { return m_Buffer->Native(); }
+    auto& Native    () const noexcept { return m_Buffer->Native(); }
+    operator NativeType() const noexcept { return m_Buffer->Native(); }
+    ObserverHandle<OwnerType> Owner() const noexcept { return m_Owner; }
+    ObserverHandle<VulkanRHI> Context() const noexcept { return m_Ctx; }
+
+    vk::DeviceSize BudgetPerFrame() const noexcept { return m_BudgetPerFrame; }
+    vk::DeviceSize UniformAlignment() const noexcept { return m_UniformAlignment; }
+    vk::DeviceSize StorageAlignment() const noexcept { return m_StorageAlignment; }
+    vk::DeviceSize UsedBytes() const noexcept { return m_Cursor.load(std::memory_order_relaxed); }
+
+    // Must only be called once the GPU is done with the frame that used this region
+    void BeginFrame(uint32_t frameIndex) noexcept;
+
+    // Thread safe, lock free. Invalid once the frame budget is exceeded, callers must check IsValid
+    VulkanTransientAllocation Allocate(vk::DeviceSize size, vk::DeviceSize alignment) noexcept;
+
+    template<typename T>
+    VulkanTransientAllocation PushUniform(In<T> data) noexcept
+    {
+        auto allocation = Allocate(sizeof(T), m_UniformAlignment);
+        if (allocation.IsValid())
+        {
+            memcpy(allocation.mappedData, &data, sizeof(T));
+        }
+        return allocation;
+    }
+
+private:
+    ObserverHandle<OwnerType> m_Owner;
+    ObserverHandle<VulkanRHI> m_Ctx;
+
+    UniqueHandle<VulkanBuffer> m_Buffer;
+    vk::DeviceSize m_BudgetPerFrame = 0;
+    vk::DeviceSize m_FrameBase = 0;
+    std::atomic<vk::DeviceSize> m_Cursor = 0;
+
+    vk::DeviceSize m_UniformAlignment = 256;
+    vk::DeviceSize m_StorageAlignment = 256;
+};
+}
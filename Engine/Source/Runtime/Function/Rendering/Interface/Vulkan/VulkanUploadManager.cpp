@@ -0,0 +1,468 @@
+﻿#include "VulkanUploadManager.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanRHI.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanDevice.h"
+
+namespace Snowy::Ark
+{
+using Utils = VulkanUtils;
+
+void VulkanUploadManager::Init(ObserverHandle<OwnerType> owner, vk::DeviceSize stagingSize, uint32_t frameCount)
+{
+    m_Owner = owner;
+    m_Ctx = owner->Context();
+
+    auto& indices = m_Owner->Adapter().GetQueueFamilyIndices();
+    m_GraphicsFamily = indices.graphics.value();
+    m_TransferFamily = indices.transfer.value_or(m_GraphicsFamily);
+    m_Queue = m_Owner->Queue(ERHIQueue::Transfer);
+
+    vk::CommandPoolCreateInfo poolInfo = {
+        .flags = vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+        .queueFamilyIndex = m_TransferFamily,
+    };
+    Utils::VerifyResult(m_Owner->Native().createCommandPool(poolInfo), STEXT("Failed to create upload command pool!"), &m_CommandPool);
+
+    auto& limits = m_Owner->Adapter().Properties().limits;
+    m_StagingAlignment = std::max<vk::DeviceSize>(limits.optimalBufferCopyOffsetAlignment, 16);
+    m_StagingSize = stagingSize;
+    m_StagingBuffer = m_Owner->CreateBuffer(m_StagingSize, vk::BufferUsageFlagBits::eTransferSrc,
+                                            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+                                            EVulkanAllocationStrategy::Linear);
+
+    m_FrameSemaphores.resize(frameCount);
+    SA_LOG_INFO("Upload Manager uses queue family {}, graphics queue family {}.", m_TransferFamily, m_GraphicsFamily);
+}
+
+void VulkanUploadManager::Destroy()
+{
+    {
+        std::scoped_lock queueLock(m_Owner->QueueMutex(ERHIQueue::Transfer));
+        Utils::VerifyResult(m_Queue.waitIdle(), STEXT("Failed to Wait Idle!"));
+    }
+    Retire(false);
+
+    auto& device = m_Owner->Native();
+    auto destroyBatch = [&](Ref<UniqueHandle<Batch>> batch) {
+        device.destroyFence(batch->fence);
+        for (auto&& buffer : batch->overflowBuffers)
+        {
+            buffer->Destroy();
+        }
+    };
+    if (m_Recording)
+    {
+        destroyBatch(m_Recording);
+    }
+    for (auto&& batch : m_FreeBatches)
+    {
+        destroyBatch(batch);
+    }
+    for (auto&& acquire : m_PendingAcquires)
+    {
+        device.destroySemaphore(acquire.semaphore);
+    }
+    for (auto&& semaphores : m_FrameSemaphores)
+    {
+        for (auto&& semaphore : semaphores)
+        {
+            device.destroySemaphore(semaphore);
+        }
+    }
+    for (auto&& semaphore : m_FreeSemaphores)
+    {
+        device.destroySemaphore(semaphore);
+    }
+
+    m_StagingBuffer->Destroy();
+    device.destroyCommandPool(m_CommandPool);
+}
+
+uint64_t VulkanUploadManager::UploadBuffer(Ref<VulkanBuffer> dst, const void* data, vk::DeviceSize size, vk::DeviceSize dstOffset,
+                                           vk::PipelineStageFlags dstStages, vk::AccessFlags dstAccess)
+{
+    std::scoped_lock lock(m_Mutex);
+
+    vk::Buffer srcBuffer;
+    vk::DeviceSize srcOffset;
+    StageData(data, size, &srcBuffer, &srcOffset);
+
+    auto& batch = RecordingBatch();
+    vk::BufferCopy copyRegion = {
+        .srcOffset = srcOffset,
+        .dstOffset = dstOffset,
+        .size = size,
+    };
+    batch.cmd.copyBuffer(srcBuffer, dst, copyRegion);
+
+    vk::BufferMemoryBarrier barrier = {
+        .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+        .dstAccessMask = {},
+        .srcQueueFamilyIndex = m_TransferFamily,
+        .dstQueueFamilyIndex = m_GraphicsFamily,
+        .buffer = dst,
+        .offset = dstOffset,
+        .size = size,
+    };
+    if (NeedOwnershipTransfer())
+    {
+        // Release
+        batch.cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, {}, nullptr, barrier, nullptr);
+
+        barrier.srcAccessMask = {};
+        barrier.dstAccessMask = dstAccess;
+        m_RecordingAcquire.bufferBarriers.emplace_back(barrier);
+    }
+    m_RecordingAcquire.stages |= dstStages;
+    return batch.ticket;
+}
+
+uint64_t VulkanUploadManager::UploadTexture(Ref<VulkanTexture> dst, const void* data, vk::DeviceSize size, uint32_t width, uint32_t height,
+                                            uint32_t mipLevel, vk::PipelineStageFlags dstStages)
+{
+    std::scoped_lock lock(m_Mutex);
+
+    vk::Buffer srcBuffer;
+    vk::DeviceSize srcOffset;
+    StageData(data, size, &srcBuffer, &srcOffset);
+
+    auto& batch = RecordingBatch();
+    vk::ImageMemoryBarrier barrier = {
+        .srcAccessMask = {},
+        .dstAccessMask = vk::AccessFlagBits::eTransferWrite,
+        .oldLayout = vk::ImageLayout::eUndefined,
+        .newLayout = vk::ImageLayout::eTransferDstOptimal,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = dst,
+        .subresourceRange = vk::ImageSubresourceRange {
+            .aspectMask = vk::ImageAspectFlagBits::eColor,
+            .baseMipLevel = mipLevel,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        },
+    };
+    batch.cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {}, nullptr, nullptr, barrier);
+
+    vk::BufferImageCopy copyRegion = {
+        .bufferOffset = srcOffset,
+        .bufferRowLength = 0,
+        .bufferImageHeight = 0,
+        .imageSubresource = vk::ImageSubresourceLayers {
+            .aspectMask = vk::ImageAspectFlagBits::eColor,
+            .mipLevel = mipLevel,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        },
+        .imageOffset = {0, 0, 0},
+        .imageExtent = {width, height, 1},
+    };
+    batch.cmd.copyBufferToImage(srcBuffer, dst, vk::ImageLayout::eTransferDstOptimal, copyRegion);
+
+    // Release, the layout transition happens once on the queue family that owns the image
+    barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    barrier.dstAccessMask = {};
+    barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+    barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+    if (NeedOwnershipTransfer())
+    {
+        barrier.srcQueueFamilyIndex = m_TransferFamily;
+        barrier.dstQueueFamilyIndex = m_GraphicsFamily;
+    }
+    batch.cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, {}, nullptr, nullptr, barrier);
+
+    if (NeedOwnershipTransfer())
+    {
+        barrier.srcAccessMask = {};
+        barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+        m_RecordingAcquire.imageBarriers.emplace_back(barrier);
+    }
+    m_RecordingAcquire.stages |= dstStages;
+    return batch.ticket;
+}
+
+uint64_t VulkanUploadManager::UploadTextureWithMips(Ref<VulkanTexture> dst, const void* data, vk::DeviceSize size, uint32_t width, uint32_t height,
+                                                    vk::PipelineStageFlags dstStages)
+{
+    std::scoped_lock lock(m_Mutex);
+
+    vk::Buffer srcBuffer;
+    vk::DeviceSize srcOffset;
+    StageData(data, size, &srcBuffer, &srcOffset);
+
+    auto& batch = RecordingBatch();
+    vk::ImageMemoryBarrier barrier = {
+        .srcAccessMask = {},
+        .dstAccessMask = vk::AccessFlagBits::eTransferWrite,
+        .oldLayout = vk::ImageLayout::eUndefined,
+        .newLayout = vk::ImageLayout::eTransferDstOptimal,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = dst,
+        .subresourceRange = vk::ImageSubresourceRange {
+            .aspectMask = vk::ImageAspectFlagBits::eColor,
+            .baseMipLevel = 0,
+            .levelCount = dst.MipLevels(),
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        },
+    };
+    batch.cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {}, nullptr, nullptr, barrier);
+
+    vk::BufferImageCopy copyRegion = {
+        .bufferOffset = srcOffset,
+        .bufferRowLength = 0,
+        .bufferImageHeight = 0,
+        .imageSubresource = vk::ImageSubresourceLayers {
+            .aspectMask = vk::ImageAspectFlagBits::eColor,
+            .mipLevel = 0,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        },
+        .imageOffset = {0, 0, 0},
+        .imageExtent = {width, height, 1},
+    };
+    batch.cmd.copyBufferToImage(srcBuffer, dst, vk::ImageLayout::eTransferDstOptimal, copyRegion);
+
+    if (!NeedOwnershipTransfer())
+    {
+        // Same family as the graphics queue, blits are supported, the semaphore wait makes the chain visible
+        dst.RecordGenerateMips(batch.cmd, vk::PipelineStageFlagBits::eBottomOfPipe, {});
+        m_RecordingAcquire.stages |= dstStages;
+        return batch.ticket;
+    }
+
+    // Release every mip as it is, the graphics queue acquires them for the blits
+    barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    barrier.dstAccessMask = {};
+    barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+    barrier.srcQueueFamilyIndex = m_TransferFamily;
+    barrier.dstQueueFamilyIndex = m_GraphicsFamily;
+    batch.cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, {}, nullptr, nullptr, barrier);
+
+    barrier.srcAccessMask = {};
+    barrier.dstAccessMask = vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite;
+    m_RecordingAcquire.imageBarriers.emplace_back(barrier);
+    m_RecordingAcquire.mipGenerations.emplace_back(&dst);
+    m_RecordingAcquire.stages |= dstStages | vk::PipelineStageFlagBits::eTransfer;
+    return batch.ticket;
+}
+
+uint64_t VulkanUploadManager::Flush()
+{
+    std::scoped_lock lock(m_Mutex);
+    return Flush_Internal();
+}
+
+bool VulkanUploadManager::IsComplete(uint64_t ticket)
+{
+    std::scoped_lock lock(m_Mutex);
+    Retire(false);
+    return ticket <= m_CompletedTicket;
+}
+
+void VulkanUploadManager::Wait(uint64_t ticket)
+{
+    std::scoped_lock lock(m_Mutex);
+    if (ticket > m_SubmittedTicket)
+    {
+        Flush_Internal();
+    }
+    while (ticket > m_CompletedTicket && !m_InFlight.empty())
+    {
+        Retire(true);
+    }
+}
+
+void VulkanUploadManager::BeginFrame(uint32_t frameIndex)
+{
+    std::scoped_lock lock(m_Mutex);
+    auto& semaphores = m_FrameSemaphores[frameIndex];
+    m_FreeSemaphores.append_range(semaphores);
+    semaphores.clear();
+    Retire(false);
+}
+
+void VulkanUploadManager::RecordAcquireBarriers(vk::CommandBuffer cmd, uint32_t frameIndex,
+                                                Ref<std::vector<vk::Semaphore>> waitSemaphores, Ref<std::vector<vk::PipelineStageFlags>> waitStages)
+{
+    std::scoped_lock lock(m_Mutex);
+    for (auto&& acquire : m_PendingAcquires)
+    {
+        // The acquire barrier's first scope chains with the semaphore wait on the same stages
+        if (!acquire.bufferBarriers.empty() || !acquire.imageBarriers.empty())
+        {
+            cmd.pipelineBarrier(acquire.stages, acquire.stages, {}, nullptr, acquire.bufferBarriers, acquire.imageBarriers);
+        }
+        for (auto&& texture : acquire.mipGenerations)
+        {
+            texture->RecordGenerateMips(cmd, acquire.stages, vk::AccessFlagBits::eShaderRead);
+        }
+        waitSemaphores.emplace_back(acquire.semaphore);
+        waitStages.emplace_back(acquire.stages);
+        m_FrameSemaphores[frameIndex].emplace_back(acquire.semaphore);
+    }
+    m_PendingAcquires.clear();
+}
+
+VulkanUploadManager::Batch& VulkanUploadManager::RecordingBatch()
+{
+    if (m_Recording)
+    {
+        return *m_Recording;
+    }
+
+    if (!m_FreeBatches.empty())
+    {
+        m_Recording = std::move(m_FreeBatches.back());
+        m_FreeBatches.pop_back();
+    } else
+    {
+        m_Recording = MakeUnique<Batch>();
+        vk::CommandBufferAllocateInfo allocInfo = {
+            .commandPool = m_CommandPool,
+            .level = vk::CommandBufferLevel::ePrimary,
+            .commandBufferCount = 1,
+        };
+        std::vector<vk::CommandBuffer> cmds;
+        Utils::VerifyResult(m_Owner->Native().allocateCommandBuffers(allocInfo), STEXT("Failed to allocate upload command buffer!"), &cmds);
+        m_Recording->cmd = cmds.front();
+        Utils::VerifyResult(m_Owner->Native().createFence(vk::FenceCreateInfo{}), STEXT("Failed to create upload fence!"), &m_Recording->fence);
+    }
+    m_Recording->ticket = m_NextTicket++;
+
+    vk::CommandBufferBeginInfo beginInfo = {
+        .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
+    };
+    Utils::VerifyResult(m_Recording->cmd.begin(beginInfo), STEXT("Failed to begin recording upload command buffer!"));
+    return *m_Recording;
+}
+
+uint64_t VulkanUploadManager::Flush_Internal()
+{
+    if (!m_Recording)
+    {
+        return m_SubmittedTicket;
+    }
+
+    auto& batch = *m_Recording;
+    Utils::VerifyResult(batch.cmd.end(), STEXT("Failed to end recording upload command buffer!"));
+
+    m_RecordingAcquire.semaphore = AcquireSemaphore();
+    vk::SubmitInfo submitInfo = {
+        .commandBufferCount = 1,
+        .pCommandBuffers = &batch.cmd,
+        .signalSemaphoreCount = 1,
+        .pSignalSemaphores = &m_RecordingAcquire.semaphore,
+    };
+    {
+        // Streaming jobs flush from workers, the queue may be the graphics queue the frame is submitted to
+        std::scoped_lock queueLock(m_Owner->QueueMutex(ERHIQueue::Transfer));
+        Utils::VerifyResult(m_Queue.submit(submitInfo, batch.fence), STEXT("Failed to submit upload command buffer!"));
+    }
+
+    batch.stagingEnd = m_StagingHead;
+    m_SubmittedTicket = batch.ticket;
+    m_PendingAcquires.emplace_back(std::move(m_RecordingAcquire));
+    m_RecordingAcquire = {};
+    m_InFlight.emplace_back(std::move(m_Recording));
+    return m_SubmittedTicket;
+}
+
+void VulkanUploadManager::Retire(bool waitOldest)
+{
+    auto& device = m_Owner->Native();
+    if (waitOldest && !m_InFlight.empty())
+    {
+        Utils::VerifyResult(device.waitForFences(m_InFlight.front()->fence, SA_RHI_TRUE, std::numeric_limits<uint64_t>::max()),
+                            STEXT("Failed to wait for upload fence!"));
+    }
+
+    while (!m_InFlight.empty() && device.getFenceStatus(m_InFlight.front()->fence) == vk::Result::eSuccess)
+    {
+        auto batch = std::move(m_InFlight.front());
+        m_InFlight.pop_front();
+
+        m_StagingTail = batch->stagingEnd;
+        m_CompletedTicket = batch->ticket;
+        for (auto&& buffer : batch->overflowBuffers)
+        {
+            buffer->Destroy();
+        }
+        batch->overflowBuffers.clear();
+        device.resetFences(batch->fence);
+        Utils::VerifyResult(batch->cmd.reset(), STEXT("Failed to reset upload command buffer!"));
+        m_FreeBatches.emplace_back(std::move(batch));
+    }
+
+    if (m_InFlight.empty() && m_StagingTail == m_StagingHead)
+    {
+        m_StagingHead = m_StagingTail = 0;
+    }
+}
+
+void VulkanUploadManager::StageData(const void* data, vk::DeviceSize size, Out<vk::Buffer> srcBuffer, Out<vk::DeviceSize> srcOffset)
+{
+    if (size > m_StagingSize)
+    {
+        auto overflowBuffer = m_Owner->CreateBuffer(size, vk::BufferUsageFlagBits::eTransferSrc,
+                                                    vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+                                                    EVulkanAllocationStrategy::Linear);
+        memcpy(overflowBuffer->MappedData(), data, static_cast<size_t>(size));
+        *srcBuffer = *overflowBuffer;
+        *srcOffset = 0;
+        RecordingBatch().overflowBuffers.emplace_back(std::move(overflowBuffer));
+        return;
+    }
+
+    // Ring is full, submit what has been recorded and recycle the oldest batch
+    while (!AllocateStaging(size, srcOffset))
+    {
+        Flush_Internal();
+        Retire(true);
+    }
+    memcpy(static_cast<std::byte*>(m_StagingBuffer->MappedData()) + *srcOffset, data, static_cast<size_t>(size));
+    *srcBuffer = *m_StagingBuffer;
+}
+
+bool VulkanUploadManager::AllocateStaging(vk::DeviceSize size, Out<vk::DeviceSize> offset) noexcept
+{
+    // [tail, head) is in use, head never catches up with tail after wrapping around
+    vk::DeviceSize alignedHead = (m_StagingHead + m_StagingAlignment - 1) & ~(m_StagingAlignment - 1);
+    if (m_StagingHead >= m_StagingTail)
+    {
+        if (alignedHead + size <= m_StagingSize)
+        {
+            *offset = alignedHead;
+            m_StagingHead = alignedHead + size;
+            return true;
+        }
+        if (size < m_StagingTail)
+        {
+            *offset = 0;
+            m_StagingHead = size;
+            return true;
+        }
+    } else if (alignedHead + size < m_StagingTail)
+    {
+        *offset = alignedHead;
+        m_StagingHead = alignedHead + size;
+        return true;
+    }
+    return false;
+}
+
+vk::Semaphore VulkanUploadManager::AcquireSemaphore()
+{
+    vk::Semaphore semaphore;
+    if (!m_FreeSemaphores.empty())
+    {
+        semaphore = m_FreeSemaphores.back();
+        m_FreeSemaphores.pop_back();
+    } else
+    {
+        Utils::VerifyResult(m_Owner->Native().createSemaphore(vk::SemaphoreCreateInfo{}), STEXT("Failed to create upload semaphore!"), &semaphore);
+    }
+    return semaphore;
+}
+}
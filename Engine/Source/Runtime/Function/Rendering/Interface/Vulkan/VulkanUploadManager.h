@@ -0,0 +1,123 @@
+﻿#pragma once
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanUtils.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanBuffer.h"
+#include "Engine/Source/Runtime/Function/Rendering/Interface/Vulkan/VulkanTexture.h"
+
+#include <deque>
+#include <mutex>
+
+namespace Snowy::Ark
+{
+class VulkanDevice;
+
+/// <summary>
+/// Streams buffer/texture data to device local memory through the transfer queue.
+/// Copies are batched into one submission per Flush, staged in a persistently mapped ring,
+/// and handed over to the graphics queue with a release/acquire ownership transfer.
+/// The graphics side never blocks: the frame waits on the batch semaphore on the GPU only.
+/// </summary>
+class VulkanUploadManager
+{
+public:
+    using NativeType = vk::Queue;
+    using OwnerType  = VulkanDevice;
+
+public:
+    VulkanUploadManager() = default;
+    ~VulkanUploadManager() = default;
+    VulkanUploadManager(const VulkanUploadManager&) = delete;
+    VulkanUploadManager(VulkanUploadManager&&) = delete;
+    VulkanUploadManager& operator=(const VulkanUploadManager&) = delete;
+    VulkanUploadManager& operator=(VulkanUploadManager&&) = delete;
+
+    void Init(ObserverHandle<OwnerType> owner, vk::DeviceSize stagingSize, uint32_t frameCount);
+    void Destroy();
+
+    auto& Native    () noexcept { return m_Queue; }
+    auto& Native    () const noexcept { return m_Queue; }
+    operator NativeType() const noexcept { return m_Queue; }
+    ObserverHandle<OwnerType> Owner() const noexcept { return m_Owner; }
+    ObserverHandle<VulkanRHI> Context() const noexcept { return m_Ctx; }
+
+    // Returns the ticket of the batch the copy was recorded into
+    uint64_t UploadBuffer(Ref<VulkanBuffer> dst, const void* data, vk::DeviceSize size, vk::DeviceSize dstOffset = 0,
+                          vk::PipelineStageFlags dstStages = vk::PipelineStageFlagBits::eVertexInput,
+                          vk::AccessFlags dstAccess = vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eIndexRead);
+    // Fills one mip, width and height are the size of that mip
+    uint64_t UploadTexture(Ref<VulkanTexture> dst, const void* data, vk::DeviceSize size, uint32_t width, uint32_t height, uint32_t mipLevel = 0,
+                           vk::PipelineStageFlags dstStages = vk::PipelineStageFlagBits::eFragmentShader);
+    // Fills mip 0 and blits the rest of the chain from it, dst must be able to blit its mips(see VulkanTexture::CanBlitMips).
+    // A dedicated transfer queue can't blit, the chain is then recorded on the graphics queue right after the acquire
+    uint64_t UploadTextureWithMips(Ref<VulkanTexture> dst, const void* data, vk::DeviceSize size, uint32_t width, uint32_t height,
+                                   vk::PipelineStageFlags dstStages = vk::PipelineStageFlagBits::eFragmentShader);
+
+    // Submits the recording batch, returns the last submitted ticket
+    uint64_t Flush();
+    bool IsComplete(uint64_t ticket);
+    void Wait(uint64_t ticket);
+
+    // Called once the fence of frameIndex has been waited on
+    void BeginFrame(uint32_t frameIndex);
+    // Records the acquire half of the ownership transfers into the graphics command buffer,
+    // and outputs the semaphores the graphics submission has to wait on
+    void RecordAcquireBarriers(vk::CommandBuffer cmd, uint32_t frameIndex,
+                               Ref<std::vector<vk::Semaphore>> waitSemaphores, Ref<std::vector<vk::PipelineStageFlags>> waitStages);
+
+private:
+    struct Batch
+    {
+        vk::CommandBuffer cmd;
+        vk::Fence fence;
+        uint64_t ticket = 0;
+        vk::DeviceSize stagingEnd = 0;
+        std::vector<UniqueHandle<VulkanBuffer>> overflowBuffers;
+    };
+    struct PendingAcquire
+    {
+        vk::Semaphore semaphore;
+        vk::PipelineStageFlags stages;
+        std::vector<vk::BufferMemoryBarrier> bufferBarriers;
+        std::vector<vk::ImageMemoryBarrier> imageBarriers;
+        std::vector<ObserverHandle<VulkanTexture>> mipGenerations;    // blitted after the acquire
+    };
+
+    bool NeedOwnershipTransfer() const noexcept { return m_TransferFamily != m_GraphicsFamily; }
+
+    Batch& RecordingBatch();
+    uint64_t Flush_Internal();
+    void Retire(bool waitOldest);
+    void StageData(const void* data, vk::DeviceSize size, Out<vk::Buffer> srcBuffer, Out<vk::DeviceSize> srcOffset);
+    bool AllocateStaging(vk::DeviceSize size, Out<vk::DeviceSize> offset) noexcept;
+    vk::Semaphore AcquireSemaphore();
+
+private:
+    ObserverHandle<OwnerType> m_Owner;
+    ObserverHandle<VulkanRHI> m_Ctx;
+
+    vk::Queue m_Queue;
+    uint32_t m_TransferFamily = 0;
+    uint32_t m_GraphicsFamily = 0;
+    vk::CommandPool m_CommandPool;
+
+    UniqueHandle<VulkanBuffer> m_StagingBuffer;
+    vk::DeviceSize m_StagingSize = 0;
+    vk::DeviceSize m_StagingAlignment = 16;
+    vk::DeviceSize m_StagingHead = 0;
+    vk::DeviceSize m_StagingTail = 0;
+
+    UniqueHandle<Batch> m_Recording;
+    PendingAcquire m_RecordingAcquire;
+    std::deque<UniqueHandle<Batch>> m_InFlight;
+    std::vector<UniqueHandle<Batch>> m_FreeBatches;
+    std::vector<PendingAcquire> m_PendingAcquires;
+
+    std::vector<vk::Semaphore> m_FreeSemaphores;
+    std::vector<std::vector<vk::Semaphore>> m_FrameSemaphores;  // waited by the frame, recycled with it
+
+    uint64_t m_NextTicket = 1;
+    uint64_t m_SubmittedTicket = 0;
+    uint64_t m_CompletedTicket = 0;
+
+    std::mutex m_Mutex;
+};
+}
@@ -12,4 +12,73 @@ bool VulkanUtils::HasStencilComponent(vk::Format format)
     using enum vk::Format;
     return format == eD32SfloatS8Uint || format == eD24UnormS8Uint;
 }
+
+vk::Format VulkanUtils::ToVkFormat(EVertexAttributeFormat format) noexcept
+{
+    switch (format)
+    {
+        case EVertexAttributeFormat::Float32x2: return vk::Format::eR32G32Sfloat;
+        case EVertexAttributeFormat::Float32x3: return vk::Format::eR32G32B32Sfloat;
+        case EVertexAttributeFormat::Float32x4: return vk::Format::eR32G32B32A32Sfloat;
+        case EVertexAttributeFormat::Float16x2: return vk::Format::eR16G16Sfloat;
+        case EVertexAttributeFormat::Float16x4: return vk::Format::eR16G16B16A16Sfloat;
+        case EVertexAttributeFormat::Snorm16x2: return vk::Format::eR16G16Snorm;
+        case EVertexAttributeFormat::Unorm16x4: return vk::Format::eR16G16B16A16Unorm;
+        case EVertexAttributeFormat::Unorm8x4:  return vk::Format::eR8G8B8A8Unorm;
+        default: return vk::Format::eUndefined;
+    }
+}
+
+vk::Format VulkanUtils::ToVkFormat(ETextureFormat format) noexcept
+{
+    switch (format)
+    {
+        case ETextureFormat::RGBA8: return vk::Format::eR8G8B8A8Unorm;
+        case ETextureFormat::BC1:   return vk::Format::eBc1RgbUnormBlock;
+        case ETextureFormat::BC3:   return vk::Format::eBc3UnormBlock;
+        case ETextureFormat::BC4:   return vk::Format::eBc4UnormBlock;
+        case ETextureFormat::BC5:   return vk::Format::eBc5UnormBlock;
+        case ETextureFormat::BC7:   return vk::Format::eBc7UnormBlock;
+        default: return vk::Format::eUndefined;
+    }
+}
+
+ETextureFormat VulkanUtils::ToTextureFormat(vk::Format format) noexcept
+{
+    switch (format)
+    {
+        case vk::Format::eR8G8B8A8Unorm:     return ETextureFormat::RGBA8;
+        case vk::Format::eBc1RgbUnormBlock:  return ETextureFormat::BC1;
+        case vk::Format::eBc3UnormBlock:     return ETextureFormat::BC3;
+        case vk::Format::eBc4UnormBlock:     return ETextureFormat::BC4;
+        case vk::Format::eBc5UnormBlock:     return ETextureFormat::BC5;
+        case vk::Format::eBc7UnormBlock:     return ETextureFormat::BC7;
+        default: return ETextureFormat::Count;
+    }
+}
+
+void VulkanUtils::GetVertexInputDescriptions(ArrayIn<VertexStreamBinding> streamBindings, ArrayIn<VertexStreamAttribute> streamAttributes,
+                                             Out<std::vector<vk::VertexInputBindingDescription>> bindings,
+                                             Out<std::vector<vk::VertexInputAttributeDescription>> attributes)
+{
+    bindings->clear();
+    for (auto&& streamBinding : streamBindings)
+    {
+        bindings->emplace_back(vk::VertexInputBindingDescription {
+            .binding = streamBinding.binding,
+            .stride = streamBinding.stride,
+            .inputRate = vk::VertexInputRate::eVertex,
+        });
+    }
+    attributes->clear();
+    for (auto&& attribute : streamAttributes)
+    {
+        attributes->emplace_back(vk::VertexInputAttributeDescription {
+            .location = attribute.location,
+            .binding = attribute.binding,
+            .format = ToVkFormat(attribute.format),
+            .offset = attribute.offset,
+        });
+    }
+}
 }
@@ -2,6 +2,7 @@
 #include "Engine/Source/Runtime/Core/Base/Common.h"
 #include "Engine/Source/Runtime/Core/Log/Logger.h"
 #include "Engine/Source/Runtime/Function/Rendering/Interface/RHI.h"
+#include "Engine/Source/Runtime/Function/Rendering/Mesh.h"
 
 #include <vulkan/vulkan.hpp>
 
@@ -38,6 +39,15 @@ public:
 
     static bool HasStencilComponent(vk::Format format);
 
+    static vk::Format ToVkFormat(EVertexAttributeFormat format) noexcept;
+    static vk::Format ToVkFormat(ETextureFormat format) noexcept;
+    // ETextureFormat::Count for formats textures aren't cooked to
+    static ETextureFormat ToTextureFormat(vk::Format format) noexcept;
+    // Vertex input state matching the streams, binding offsets are applied at bind time
+    static void GetVertexInputDescriptions(ArrayIn<VertexStreamBinding> streamBindings, ArrayIn<VertexStreamAttribute> streamAttributes,
+                                           Out<std::vector<vk::VertexInputBindingDescription>> bindings,
+                                           Out<std::vector<vk::VertexInputAttributeDescription>> attributes);
+
     /*----------------------------------------------------------*/
     // Vulkan Result Process Function
     /*----------------------------------------------------------*/
@@ -1,8 +1,347 @@
 ﻿#include "Mesh.h"
+#include "Engine/Source/Runtime/Core/Log/Logger.h"
+#include "Engine/Source/Runtime/Core/Job/JobSystem.h"
+#include "Engine/Source/Runtime/Function/Global/GlobalContext.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+
 namespace Snowy::Ark
 {
+namespace
+{
+constexpr std::array<EVertexAttribute, 5> StreamAttributeOrder = {
+    EVertexAttribute::Position, EVertexAttribute::Color, EVertexAttribute::Texcoord, EVertexAttribute::Normal, EVertexAttribute::Tangent,
+};
+
+glm::vec2 SignNotZero(glm::vec2 value) noexcept
+{
+    return glm::vec2(value.x >= 0.0f ? 1.0f : -1.0f, value.y >= 0.0f ? 1.0f : -1.0f);
+}
+
+// Unit vector to the [-1, 1] square, the lower hemisphere is folded over the diagonals
+glm::vec2 OctahedralEncode(glm::vec3 direction) noexcept
+{
+    direction /= std::max(std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z), 1e-20f);
+    glm::vec2 oct = glm::vec2(direction);
+    if (direction.z < 0.0f)
+    {
+        oct = (1.0f - glm::abs(glm::vec2(oct.y, oct.x))) * SignNotZero(oct);
+    }
+    return oct;
+}
+
+int16_t QuantizeSnorm16(float value) noexcept
+{
+    return static_cast<int16_t>(std::round(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+}
+
 bool Mesh::HasAttribute(EVertexAttribute attr) const noexcept
 {
-    return false;
+    switch (attr)
+    {
+        case EVertexAttribute::Position: return !position.data.empty();
+        case EVertexAttribute::Normal:   return !normal.data.empty();
+        case EVertexAttribute::Tangent:  return !tangent.data.empty();
+        case EVertexAttribute::Color:    return !color.data.empty();
+        case EVertexAttribute::Texcoord: return !texcoords.empty() && !texcoords.front().data.empty();
+        default: return false;
+    }
+}
+
+void Mesh::SetIndices(std::vector<uint32_t> indices)
+{
+    m_Indices = std::move(indices);
+    m_Lods = { MeshLod{ .firstIndex = 0, .indexCount = static_cast<uint32_t>(m_Indices.size()), .error = 0.0f } };
+}
+
+void Mesh::GenerateLods(ArrayIn<float> ratios, float targetError)
+{
+    if (!HasAttribute(EVertexAttribute::Position) || m_Indices.empty())
+    {
+        SA_LOG_WARN("Mesh LODs need positions and indices!");
+        return;
+    }
+    // Regenerated from LOD 0
+    m_Indices.resize(m_Lods.empty() ? m_Indices.size() : m_Lods.front().indexCount);
+    m_Lods = MeshOptimizer::BuildLods(m_Indices, position.data, ratios, targetError);
+}
+
+void Mesh::BuildMeshlets(uint32_t maxVertices, uint32_t maxTriangles)
+{
+    if (!HasAttribute(EVertexAttribute::Position) || m_Lods.empty())
+    {
+        SA_LOG_WARN("Mesh meshlets need positions and indices!");
+        return;
+    }
+    std::vector<MeshletData> lodMeshlets(m_Lods.size());
+    g_RuntimeContext.jobSys->ParallelFor(static_cast<uint32_t>(m_Lods.size()), 1, [&, this](uint32_t begin, uint32_t end) {
+        for (uint32_t lod = begin; lod < end; lod++)
+        {
+            auto lodIndices = ArrayIn<uint32_t>(m_Indices).subspan(m_Lods[lod].firstIndex, m_Lods[lod].indexCount);
+            MeshOptimizer::BuildMeshlets(lodIndices, position.data, maxVertices, maxTriangles, &lodMeshlets[lod]);
+        }
+    });
+
+    m_Meshlets = {};
+    m_MeshletLodFirsts.clear();
+    for (auto&& meshlets : lodMeshlets)
+    {
+        m_MeshletLodFirsts.emplace_back(static_cast<uint32_t>(m_Meshlets.meshlets.size()));
+        for (auto meshlet : meshlets.meshlets)
+        {
+            meshlet.vertexOffset += static_cast<uint32_t>(m_Meshlets.vertices.size());
+            meshlet.triangleOffset += static_cast<uint32_t>(m_Meshlets.triangles.size());
+            m_Meshlets.meshlets.emplace_back(meshlet);
+        }
+        m_Meshlets.vertices.insert(m_Meshlets.vertices.end(), meshlets.vertices.begin(), meshlets.vertices.end());
+        m_Meshlets.triangles.insert(m_Meshlets.triangles.end(), meshlets.triangles.begin(), meshlets.triangles.end());
+    }
+    m_MeshletLodFirsts.emplace_back(static_cast<uint32_t>(m_Meshlets.meshlets.size()));
+}
+
+void Mesh::SetTexcoords(uint32_t set, std::vector<glm::vec2> data)
+{
+    if (set >= MaxTexcoordCount)
+    {
+        SA_LOG_ERROR("Texcoord set {} exceeds the {} supported sets!", set, MaxTexcoordCount);
+        return;
+    }
+    if (set >= texcoords.size())
+    {
+        texcoords.resize(set + 1);
+    }
+    texcoords[set].data = std::move(data);
+}
+
+void Mesh::SetAttributeFormat(EVertexAttribute attr, EVertexAttributeFormat format) noexcept
+{
+    switch (attr)
+    {
+        case EVertexAttribute::Position: position.format = format; break;
+        case EVertexAttribute::Normal:   normal.format = format; break;
+        case EVertexAttribute::Tangent:  tangent.format = format; break;
+        case EVertexAttribute::Color:    color.format = format; break;
+        case EVertexAttribute::Texcoord:
+            for (auto&& texcoord : texcoords)
+            {
+                texcoord.format = format;
+            }
+            break;
+        default: break;
+    }
+}
+
+VertexStreams Mesh::BuildVertexStreams(EVertexStreamLayout layout)
+{
+    VertexStreams streams;
+    uint32_t vertexCount = VertexCount();
+
+    if (position.format == EVertexAttributeFormat::Unorm16x4)
+    {
+        glm::vec3 minPos(std::numeric_limits<float>::max());
+        glm::vec3 maxPos(std::numeric_limits<float>::lowest());
+        for (auto&& pos : position.data)
+        {
+            minPos = glm::min(minPos, pos);
+            maxPos = glm::max(maxPos, pos);
+        }
+        m_PositionMin = vertexCount > 0 ? minPos : glm::vec3(0.0f);
+        m_PositionExtent = vertexCount > 0 ? maxPos - minPos : glm::vec3(0.0f);
+    }
+
+    // Attributes in stream order, bindings assigned by the layout
+    auto addAttribute = [&](EVertexAttribute attr, uint32_t set, Ref<EVertexAttributeFormat> format, Ref<uint32_t> binding) {
+        if (layout == EVertexStreamLayout::Separate || streams.bindings.empty() ||
+            (layout == EVertexStreamLayout::PositionInterleaved && streams.bindings.size() == 1 && streams.attributes.back().attribute == EVertexAttribute::Position))
+        {
+            streams.bindings.emplace_back(VertexStreamBinding{ .binding = static_cast<uint32_t>(streams.bindings.size()), .stride = 0, .offset = 0 });
+        }
+        auto& streamBinding = streams.bindings.back();
+        binding = streamBinding.binding;
+        streams.attributes.emplace_back(VertexStreamAttribute {
+            .attribute = attr,
+            .set = set,
+            .location = AttributeLocation(attr, set),
+            .binding = binding,
+            .format = format,
+            .offset = streamBinding.stride,
+        });
+        streamBinding.stride += AttributeFormatSize(format);
+    };
+    for (auto attr : StreamAttributeOrder)
+    {
+        switch (attr)
+        {
+            case EVertexAttribute::Position:
+                if (HasAttribute(attr)) addAttribute(attr, 0, position.format, position.binding);
+                break;
+            case EVertexAttribute::Normal:
+                if (HasAttribute(attr)) addAttribute(attr, 0, normal.format, normal.binding);
+                break;
+            case EVertexAttribute::Tangent:
+                if (HasAttribute(attr)) addAttribute(attr, 0, tangent.format, tangent.binding);
+                break;
+            case EVertexAttribute::Color:
+                if (HasAttribute(attr)) addAttribute(attr, 0, color.format, color.binding);
+                break;
+            case EVertexAttribute::Texcoord:
+                for (uint32_t set = 0; set < texcoords.size(); set++)
+                {
+                    if (!texcoords[set].data.empty())
+                    {
+                        addAttribute(attr, set, texcoords[set].format, texcoords[set].binding);
+                    }
+                }
+                break;
+            default: break;
+        }
+    }
+
+    uint64_t dataSize = 0;
+    for (auto&& streamBinding : streams.bindings)
+    {
+        streamBinding.offset = (dataSize + VertexStreams::StreamAlignment - 1) & ~(VertexStreams::StreamAlignment - 1);
+        dataSize = streamBinding.offset + static_cast<uint64_t>(streamBinding.stride) * vertexCount;
+    }
+    streams.data.resize(dataSize);
+
+    for (auto&& attribute : streams.attributes)
+    {
+        auto& streamBinding = streams.bindings[attribute.binding];
+        auto dst = streams.data.data() + streamBinding.offset + attribute.offset;
+        for (uint32_t vertex = 0; vertex < vertexCount; vertex++, dst += streamBinding.stride)
+        {
+            EncodeAttribute(attribute.attribute, attribute.set, attribute.format, vertex, dst);
+        }
+    }
+    return streams;
+}
+
+glm::mat4 Mesh::PositionDequantization() const noexcept
+{
+    if (position.format != EVertexAttributeFormat::Unorm16x4)
+    {
+        return glm::mat4(1.0f);
+    }
+    return PositionDequantization(m_PositionMin, m_PositionExtent);
+}
+
+glm::mat4 Mesh::PositionDequantization(glm::vec3 positionMin, glm::vec3 positionExtent) noexcept
+{
+    return glm::scale(glm::translate(glm::mat4(1.0f), positionMin), positionExtent);
+}
+
+uint32_t Mesh::AttributeLocation(EVertexAttribute attr, uint32_t set) noexcept
+{
+    switch (attr)
+    {
+        case EVertexAttribute::Position: return 0;
+        case EVertexAttribute::Color:    return 1;
+        case EVertexAttribute::Texcoord: return 2 + set;
+        case EVertexAttribute::Normal:   return 2 + MaxTexcoordCount;
+        case EVertexAttribute::Tangent:  return 3 + MaxTexcoordCount;
+        default: return 0;
+    }
+}
+
+uint32_t Mesh::AttributeFormatSize(EVertexAttributeFormat format) noexcept
+{
+    switch (format)
+    {
+        case EVertexAttributeFormat::Float32x2: return 8;
+        case EVertexAttributeFormat::Float32x3: return 12;
+        case EVertexAttributeFormat::Float32x4: return 16;
+        case EVertexAttributeFormat::Float16x2: return 4;
+        case EVertexAttributeFormat::Float16x4: return 8;
+        case EVertexAttributeFormat::Snorm16x2: return 4;
+        case EVertexAttributeFormat::Unorm16x4: return 8;
+        case EVertexAttributeFormat::Unorm8x4:  return 4;
+        default: return 0;
+    }
+}
+
+uint32_t Mesh::SelectLod(ArrayIn<MeshLod> lods, float pixelsPerUnit, float maxPixelError) noexcept
+{
+    // Errors grow along the chain, the first fit from the coarse end is the coarsest
+    for (uint32_t lod = static_cast<uint32_t>(lods.size()); lod > 1; lod--)
+    {
+        if (lods[lod - 1].error * pixelsPerUnit <= maxPixelError)
+        {
+            return lod - 1;
+        }
+    }
+    return 0;
+}
+
+void Mesh::EncodeAttribute(EVertexAttribute attr, uint32_t set, EVertexAttributeFormat format, uint32_t vertex, Out<uint8_t> dst) const noexcept
+{
+    glm::vec4 value(0.0f, 0.0f, 0.0f, 1.0f);
+    switch (attr)
+    {
+        case EVertexAttribute::Position: value = glm::vec4(position.data[vertex], 1.0f); break;
+        case EVertexAttribute::Normal:   value = glm::vec4(normal.data[vertex], 0.0f); break;
+        case EVertexAttribute::Tangent:  value = tangent.data[vertex]; break;
+        case EVertexAttribute::Color:    value = color.data[vertex]; break;
+        case EVertexAttribute::Texcoord: value = glm::vec4(texcoords[set].data[vertex], 0.0f, 0.0f); break;
+        default: break;
+    }
+
+    switch (format)
+    {
+        case EVertexAttributeFormat::Float32x2:
+        case EVertexAttributeFormat::Float32x3:
+        case EVertexAttributeFormat::Float32x4:
+            std::memcpy(dst, &value, AttributeFormatSize(format));
+            break;
+        case EVertexAttributeFormat::Float16x2:
+        {
+            uint32_t packed = glm::packHalf2x16(glm::vec2(value));
+            std::memcpy(dst, &packed, sizeof(packed));
+            break;
+        }
+        case EVertexAttributeFormat::Float16x4:
+        {
+            uint64_t packed = glm::packHalf4x16(value);
+            std::memcpy(dst, &packed, sizeof(packed));
+            break;
+        }
+        case EVertexAttributeFormat::Snorm16x2:
+        {
+            auto oct = OctahedralEncode(glm::vec3(value));
+            std::array<int16_t, 2> packed = { QuantizeSnorm16(oct.x), QuantizeSnorm16(oct.y) };
+            if (attr == EVertexAttribute::Tangent)
+            {
+                // Odd x is a negative bitangent sign, kept inside [-32767, 32767] so decoding stays exact
+                int32_t x = (packed[0] & ~1) | (value.w < 0.0f ? 1 : 0);
+                packed[0] = static_cast<int16_t>(x < -32767 ? x + 2 : x);
+            }
+            std::memcpy(dst, packed.data(), sizeof(packed));
+            break;
+        }
+        case EVertexAttributeFormat::Unorm16x4:
+        {
+            glm::vec3 normalized = glm::vec3(value);
+            if (attr == EVertexAttribute::Position)
+            {
+                normalized = glm::vec3(
+                    m_PositionExtent.x > 0.0f ? (value.x - m_PositionMin.x) / m_PositionExtent.x : 0.0f,
+                    m_PositionExtent.y > 0.0f ? (value.y - m_PositionMin.y) / m_PositionExtent.y : 0.0f,
+                    m_PositionExtent.z > 0.0f ? (value.z - m_PositionMin.z) / m_PositionExtent.z : 0.0f);
+            }
+            uint64_t packed = glm::packUnorm4x16(glm::vec4(normalized, 1.0f));
+            std::memcpy(dst, &packed, sizeof(packed));
+            break;
+        }
+        case EVertexAttributeFormat::Unorm8x4:
+        {
+            uint32_t packed = glm::packUnorm4x8(value);
+            std::memcpy(dst, &packed, sizeof(packed));
+            break;
+        }
+        default: break;
+    }
 }
 }
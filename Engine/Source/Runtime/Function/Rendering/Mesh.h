@@ -1,6 +1,7 @@
 ﻿#pragma once
 #include "Engine/Source/Runtime/Core/Base/Common.h"
 #include "Engine/Source/Runtime/Function/Global/GlobalTypedef.h"
+#include "Engine/Source/Runtime/Resource/MeshOptimizer.h"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -14,7 +15,7 @@ struct VertexPosition
     static inline constexpr EVertexAttribute type = EVertexAttribute::Position;
 
     std::vector<glm::vec3> data;
-    EVertexAttributeFormat format;
+    EVertexAttributeFormat format = EVertexAttributeFormat::Float32x3;
     uint32_t binding = 0;
 };
 struct VertexNormal
@@ -22,15 +23,15 @@ struct VertexNormal
     static inline constexpr EVertexAttribute type = EVertexAttribute::Normal;
 
     std::vector<glm::vec3> data;
-    EVertexAttributeFormat format;
+    EVertexAttributeFormat format = EVertexAttributeFormat::Float32x3;
     uint32_t binding = 0;
 };
 struct VertexTangent
 {
     static inline constexpr EVertexAttribute type = EVertexAttribute::Tangent;
 
-    std::vector<glm::vec4> data;
-    EVertexAttributeFormat format;
+    std::vector<glm::vec4> data;   // w is the bitangent sign
+    EVertexAttributeFormat format = EVertexAttributeFormat::Float32x4;
     uint32_t binding = 0;
 };
 struct VertexColor
@@ -38,7 +39,7 @@ struct VertexColor
     static inline constexpr EVertexAttribute type = EVertexAttribute::Color;
 
     std::vector<glm::vec4> data;
-    EVertexAttributeFormat format;
+    EVertexAttributeFormat format = EVertexAttributeFormat::Float32x4;
     uint32_t binding = 0;
 };
 struct VertexTexcoord
@@ -46,12 +47,43 @@ struct VertexTexcoord
     static inline constexpr EVertexAttribute type = EVertexAttribute::Texcoord;
 
     std::vector<glm::vec2> data;
-    EVertexAttributeFormat format;
+    EVertexAttributeFormat format = EVertexAttributeFormat::Float32x2;
     uint32_t binding = 0;
 };
 
+struct VertexStreamBinding
+{
+    uint32_t binding;
+    uint32_t stride;
+    uint64_t offset;    // of the stream in VertexStreams::data
+};
+struct VertexStreamAttribute
+{
+    EVertexAttribute attribute;
+    uint32_t set;       // texcoord set, 0 otherwise
+    uint32_t location;
+    uint32_t binding;
+    EVertexAttributeFormat format;
+    uint32_t offset;    // in the vertex of its binding
+};
+/// <summary>
+/// Packed GPU vertex streams of a mesh, every stream starts on StreamAlignment in a single blob
+/// so the whole mesh fits in one vertex buffer bound at the binding offsets.
+/// </summary>
+struct VertexStreams
+{
+    static constexpr uint64_t StreamAlignment = 16;
+
+    std::vector<uint8_t> data;
+    std::vector<VertexStreamBinding> bindings;
+    std::vector<VertexStreamAttribute> attributes;
+};
+
 class Mesh
 {
+public:
+    static constexpr uint32_t MaxTexcoordCount = 8;
+
 public:
     Mesh() = default;
     ~Mesh() = default;
@@ -61,9 +93,55 @@ public:
     Mesh& operator=(Mesh&&) = default;
 
     bool HasAttribute(EVertexAttribute attr) const noexcept;
+    uint32_t VertexCount() const noexcept { return static_cast<uint32_t>(position.data.size()); }
+    ArrayIn<uint32_t> Indices() const noexcept { return m_Indices; }
+    // Ranges of Indices, a single LOD until GenerateLods
+    ArrayIn<MeshLod> Lods() const noexcept { return m_Lods; }
+    // Meshlets of LOD i are [MeshletLodFirsts()[i], MeshletLodFirsts()[i + 1]), empty until BuildMeshlets
+    In<MeshletData> Meshlets() const noexcept { return m_Meshlets; }
+    ArrayIn<uint32_t> MeshletLodFirsts() const noexcept { return m_MeshletLodFirsts; }
+
+    void SetIndices(std::vector<uint32_t> indices);
+    // LODs made offline, ranges of the indices already set
+    void SetLods(std::vector<MeshLod> lods) { m_Lods = std::move(lods); }
+    void SetPositions(std::vector<glm::vec3> data) { position.data = std::move(data); }
+    void SetNormals(std::vector<glm::vec3> data) { normal.data = std::move(data); }
+    void SetTangents(std::vector<glm::vec4> data) { tangent.data = std::move(data); }
+    void SetColors(std::vector<glm::vec4> data) { color.data = std::move(data); }
+    void SetTexcoords(uint32_t set, std::vector<glm::vec2> data);
+    // Texcoord applies to every set
+    void SetAttributeFormat(EVertexAttribute attr, EVertexAttributeFormat format) noexcept;
+
+    // Quadric simplification of LOD 0 per ratio, appended to the index buffer, seams are preserved.
+    // targetError is an object space distance, the chain ends early rather than exceed it
+    void GenerateLods(ArrayIn<float> ratios, float targetError);
+    // Splits every LOD into meshlets with bounding spheres and normal cones, the LODs are built in parallel
+    void BuildMeshlets(uint32_t maxVertices = MeshOptimizer::MeshletMaxVertices, uint32_t maxTriangles = MeshOptimizer::MeshletMaxTriangles);
+
+    // Every attribute present is packed in its format, bindings are assigned by the layout
+    VertexStreams BuildVertexStreams(EVertexStreamLayout layout);
+    // Maps the decoded position attribute back to mesh space, identity unless positions are quantized
+    glm::mat4 PositionDequantization() const noexcept;
+    // Range the positions were quantized to by BuildVertexStreams, meaningless unless quantized
+    glm::vec3 PositionMin() const noexcept { return m_PositionMin; }
+    glm::vec3 PositionExtent() const noexcept { return m_PositionExtent; }
+
+    // Shader input locations are fixed per attribute
+    static uint32_t AttributeLocation(EVertexAttribute attr, uint32_t set = 0) noexcept;
+    static uint32_t AttributeFormatSize(EVertexAttributeFormat format) noexcept;
+    static glm::mat4 PositionDequantization(glm::vec3 positionMin, glm::vec3 positionExtent) noexcept;
+    // Coarsest LOD whose error stays under maxPixelError once projected, pixelsPerUnit is the
+    // screen size of one object space unit at the distance of the mesh
+    static uint32_t SelectLod(ArrayIn<MeshLod> lods, float pixelsPerUnit, float maxPixelError) noexcept;
+
+private:
+    void EncodeAttribute(EVertexAttribute attr, uint32_t set, EVertexAttributeFormat format, uint32_t vertex, Out<uint8_t> dst) const noexcept;
 
 private:
     std::vector<uint32_t> m_Indices;
+    std::vector<MeshLod> m_Lods;
+    MeshletData m_Meshlets;
+    std::vector<uint32_t> m_MeshletLodFirsts;
 
     VertexPosition position;
     VertexNormal normal;
@@ -71,22 +149,8 @@ private:
     VertexColor color;
     std::vector<VertexTexcoord> texcoords;
 
-private:
-    struct VertexAttributeFlags
-    {
-        unsigned int position  : 1;
-        unsigned int normal    : 1;
-        unsigned int tangent   : 1;
-        unsigned int color     : 1;
-        unsigned int texcoord0 : 1;
-        unsigned int texcoord1 : 1;
-        unsigned int texcoord2 : 1;
-        unsigned int texcoord3 : 1;
-        unsigned int texcoord4 : 1;
-        unsigned int texcoord5 : 1;
-        unsigned int texcoord6 : 1;
-        unsigned int texcoord7 : 1;
-    };
-    VertexAttributeFlags m_Flags;
+    // Bounds of the quantized positions
+    glm::vec3 m_PositionMin = glm::vec3(0.0f);
+    glm::vec3 m_PositionExtent = glm::vec3(1.0f);
 };
 }
@@ -7,9 +7,9 @@ void RenderSystem::Init(Ref<RenderSystemConfig> config)
     m_RHIContext = RHI::CreateRHI(config.rhi.backend);
     m_RHIContext->Init(config.rhi);
 }
-void RenderSystem::Tick()
+void RenderSystem::Tick(In<SceneRenderState> scene)
 {
-    m_RHIContext->Run();
+    m_RHIContext->Run(scene);
 }
 void RenderSystem::Destory()
 {
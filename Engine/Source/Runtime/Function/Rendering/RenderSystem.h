@@ -12,9 +12,11 @@ public:
     RenderSystem() = default;
 
     void Init(Ref<RenderSystemConfig> config);
-    void Tick();
+    void Tick(In<SceneRenderState> scene);
     void Destory();
 
+    SharedHandle<RHI> GetRHIContext() const noexcept { return m_RHIContext; }
+
 private:
     SharedHandle<RHI> m_RHIContext;
 };
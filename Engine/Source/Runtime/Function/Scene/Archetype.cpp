@@ -0,0 +1,94 @@
+﻿#include "Engine/Source/Runtime/Function/Scene/Archetype.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace Snowy::Ark
+{
+// Columns start on cache lines, a chunk of one column never shares a line with the next one
+static constexpr uint32_t ColumnAlignment = 64;
+
+static uint32_t AlignUp(uint32_t value, uint32_t alignment) noexcept
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+Archetype::Archetype(ComponentMask mask)
+    : m_Mask(mask)
+{
+    m_ColumnOf.fill(NoColumn);
+    for (ComponentMask bits = mask; bits != 0; bits &= bits - 1)
+    {
+        ComponentTypeId id = static_cast<ComponentTypeId>(std::countr_zero(bits));
+        m_ColumnOf[id] = static_cast<uint8_t>(m_Components.size());
+        m_Components.emplace_back(id);
+        m_Sizes.emplace_back(ComponentRegistry::Info(id).size);
+    }
+
+    // Start from the capacity ignoring the padding and back off until the padded columns fit
+    uint32_t entityBytes = sizeof(Entity);
+    for (auto&& size : m_Sizes)
+    {
+        entityBytes += size;
+    }
+    m_Offsets.resize(m_Components.size());
+    for (m_Capacity = ArchetypeChunk::Size / entityBytes; m_Capacity > 0; m_Capacity--)
+    {
+        uint32_t offset = m_Capacity * sizeof(Entity);
+        for (size_t i = 0; i < m_Components.size(); i++)
+        {
+            m_Offsets[i] = AlignUp(offset, ColumnAlignment);
+            offset = m_Offsets[i] + m_Capacity * m_Sizes[i];
+        }
+        if (offset <= ArchetypeChunk::Size)
+        {
+            break;
+        }
+    }
+    if (m_Capacity == 0)
+    {
+        throw std::runtime_error("Components of an archetype don't fit in a chunk!");
+    }
+}
+
+void Archetype::Add(Entity entity, uint32_t version, Out<uint32_t> chunk, Out<uint32_t> row)
+{
+    if (m_Chunks.empty() || m_Chunks.back()->count == m_Capacity)
+    {
+        auto& newChunk = m_Chunks.emplace_back(MakeUnique<ArchetypeChunk>());
+        newChunk->versions.resize(m_Components.size());
+    }
+    auto& lastChunk = *m_Chunks.back();
+    *chunk = ChunkCount() - 1;
+    *row = lastChunk.count++;
+    Entities(*chunk)[*row] = entity;
+    std::ranges::fill(lastChunk.versions, version);
+    m_EntityCount++;
+}
+
+Entity Archetype::Remove(uint32_t chunk, uint32_t row, uint32_t version)
+{
+    uint32_t lastChunk = ChunkCount() - 1;
+    uint32_t lastRow = m_Chunks[lastChunk]->count - 1;
+    Entity moved;
+    if (chunk != lastChunk || row != lastRow)
+    {
+        moved = Entities(lastChunk)[lastRow];
+        Entities(chunk)[row] = moved;
+        for (size_t i = 0; i < m_Components.size(); i++)
+        {
+            uint8_t column = static_cast<uint8_t>(i);
+            std::memcpy(Component(chunk, row, column), Component(lastChunk, lastRow, column), m_Sizes[i]);
+        }
+        std::ranges::fill(m_Chunks[chunk]->versions, version);
+    }
+
+    if (--m_Chunks[lastChunk]->count == 0)
+    {
+        m_Chunks.pop_back();
+    }
+    m_EntityCount--;
+    return moved;
+}
+}
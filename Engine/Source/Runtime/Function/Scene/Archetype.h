@@ -0,0 +1,73 @@
+﻿#pragma once
+#include "Engine/Source/Runtime/Core/Base/Common.h"
+#include "Engine/Source/Runtime/Function/Scene/Entity.h"
+
+#include <array>
+#include <vector>
+
+namespace Snowy::Ark
+{
+/// <summary>
+/// Fixed size block holding up to the archetype capacity of entities, one array per component type(SoA), so a
+/// query streams through exactly the columns it reads. Every column remembers the world version it was last
+/// written at, systems skip chunks whose columns haven't changed since their last run.
+/// </summary>
+struct ArchetypeChunk
+{
+    static constexpr uint32_t Size = 16 * 1024;
+
+    uint32_t count = 0;
+    std::vector<uint32_t> versions;     // per column
+    alignas(64) std::array<std::byte, Size> data;
+};
+
+/// <summary>
+/// All entities with exactly the same set of components. Chunks are kept full except for the last one,
+/// a removed entity is replaced by the last entity of the archetype.
+/// </summary>
+class Archetype
+{
+public:
+    static constexpr uint8_t NoColumn = 0xFF;
+
+public:
+    explicit Archetype(ComponentMask mask);
+    ~Archetype() = default;
+    Archetype(const Archetype&) = delete;
+    Archetype(Archetype&&) = delete;
+    Archetype& operator=(const Archetype&) = delete;
+    Archetype& operator=(Archetype&&) = delete;
+
+    ComponentMask Mask() const noexcept { return m_Mask; }
+    uint32_t Capacity() const noexcept { return m_Capacity; }
+    uint32_t ChunkCount() const noexcept { return static_cast<uint32_t>(m_Chunks.size()); }
+    uint32_t EntityCount() const noexcept { return m_EntityCount; }
+    ArrayIn<ComponentTypeId> Components() const noexcept { return m_Components; }
+    // Column of component type id, NoColumn when the archetype doesn't have it
+    uint8_t ColumnOf(ComponentTypeId id) const noexcept { return m_ColumnOf[id]; }
+
+    Ref<ArchetypeChunk> Chunk(uint32_t chunk) noexcept { return *m_Chunks[chunk]; }
+    Entity* Entities(uint32_t chunk) noexcept { return reinterpret_cast<Entity*>(m_Chunks[chunk]->data.data()); }
+    void* Column(uint32_t chunk, uint8_t column) noexcept { return m_Chunks[chunk]->data.data() + m_Offsets[column]; }
+    void* Component(uint32_t chunk, uint32_t row, uint8_t column) noexcept
+    {
+        return static_cast<std::byte*>(Column(chunk, column)) + size_t(row) * m_Sizes[column];
+    }
+
+    // Appends entity with its components uninitialized, every column of the chunk is stamped with version
+    void Add(Entity entity, uint32_t version, Out<uint32_t> chunk, Out<uint32_t> row);
+    // Fills the hole with the last entity of the archetype and returns it, invalid when the hole was the last one
+    Entity Remove(uint32_t chunk, uint32_t row, uint32_t version);
+
+private:
+    ComponentMask m_Mask;
+    std::vector<ComponentTypeId> m_Components;      // ascending, the order of the columns
+    std::vector<uint32_t> m_Offsets;                // of the columns in the chunk data
+    std::vector<uint32_t> m_Sizes;
+    std::array<uint8_t, MaxComponentTypes> m_ColumnOf;
+    uint32_t m_Capacity = 0;                        // entities per chunk
+
+    std::vector<UniqueHandle<ArchetypeChunk>> m_Chunks;
+    uint32_t m_EntityCount = 0;
+};
+}
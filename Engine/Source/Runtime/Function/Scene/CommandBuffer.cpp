@@ -0,0 +1,57 @@
+﻿#include "Engine/Source/Runtime/Function/Scene/CommandBuffer.h"
+
+namespace Snowy::Ark
+{
+void CommandBuffer::Record(ECommandType type, Entity entity, ArrayIn<ComponentTypeId> ids, ArrayIn<const void*> components)
+{
+    std::scoped_lock lock(m_Mutex);
+    m_Commands.emplace_back(Command{ type, entity, static_cast<uint32_t>(ids.size()), m_ComponentTypes.size() });
+    for (size_t i = 0; i < ids.size(); i++)
+    {
+        m_ComponentTypes.emplace_back(ids[i]);
+        m_ComponentOffsets.emplace_back(m_Data.size());
+        if (i < components.size())
+        {
+            auto bytes = static_cast<const std::byte*>(components[i]);
+            m_Data.insert(m_Data.end(), bytes, bytes + ComponentRegistry::Info(ids[i]).size);
+        }
+    }
+}
+
+void CommandBuffer::Playback(Ref<World> world)
+{
+    std::scoped_lock lock(m_Mutex);
+    std::vector<const void*> components;
+    for (auto&& command : m_Commands)
+    {
+        ArrayIn<ComponentTypeId> ids(m_ComponentTypes.data() + command.firstComponent, command.componentCount);
+        components.clear();
+        for (uint32_t i = 0; i < command.componentCount; i++)
+        {
+            components.emplace_back(m_Data.data() + m_ComponentOffsets[command.firstComponent + i]);
+        }
+
+        switch (command.type)
+        {
+            case ECommandType::CreateEntity:
+                world.CreateEntityFrom(ids, components);
+                break;
+            case ECommandType::DestroyEntity:
+                world.DestroyEntity(command.entity);
+                break;
+            case ECommandType::AddComponent:
+                world.AddComponentData(command.entity, ids[0], components[0]);
+                break;
+            case ECommandType::RemoveComponent:
+                world.RemoveComponentType(command.entity, ids[0]);
+                break;
+            default:
+                break;
+        }
+    }
+    m_Commands.clear();
+    m_ComponentTypes.clear();
+    m_ComponentOffsets.clear();
+    m_Data.clear();
+}
+}
@@ -0,0 +1,76 @@
+﻿#pragma once
+#include "Engine/Source/Runtime/Core/Base/Common.h"
+#include "Engine/Source/Runtime/Function/Scene/World.h"
+
+#include <mutex>
+
+namespace Snowy::Ark
+{
+/// <summary>
+/// Structural changes recorded while queries run and applied to the world afterwards. Jobs may record into
+/// the same buffer at once, the commands of one job play back in the order it recorded them.
+/// Commands on entities that are dead by the time they play back are dropped.
+/// </summary>
+class CommandBuffer
+{
+public:
+    CommandBuffer() = default;
+    ~CommandBuffer() = default;
+    CommandBuffer(const CommandBuffer&) = delete;
+    CommandBuffer(CommandBuffer&&) = delete;
+    CommandBuffer& operator=(const CommandBuffer&) = delete;
+    CommandBuffer& operator=(CommandBuffer&&) = delete;
+
+    template<typename... Ts>
+    void CreateEntity(In<Ts>... components)
+    {
+        std::array<ComponentTypeId, sizeof...(Ts)> ids = { ComponentRegistry::TypeId<Ts>()... };
+        std::array<const void*, sizeof...(Ts)> data = { &components... };
+        Record(ECommandType::CreateEntity, Entity(), ids, data);
+    }
+    void DestroyEntity(Entity entity) { Record(ECommandType::DestroyEntity, entity, {}, {}); }
+    template<typename T>
+    void AddComponent(Entity entity, In<T> component)
+    {
+        ComponentTypeId id = ComponentRegistry::TypeId<T>();
+        const void* data = &component;
+        Record(ECommandType::AddComponent, entity, { &id, 1 }, { &data, 1 });
+    }
+    template<typename T>
+    void RemoveComponent(Entity entity)
+    {
+        ComponentTypeId id = ComponentRegistry::TypeId<T>();
+        Record(ECommandType::RemoveComponent, entity, { &id, 1 }, {});
+    }
+
+    bool Empty() const noexcept { return m_Commands.empty(); }
+    // Applies the commands in recording order and clears the buffer
+    void Playback(Ref<World> world);
+
+private:
+    enum class ECommandType : uint8_t
+    {
+        CreateEntity,
+        DestroyEntity,
+        AddComponent,
+        RemoveComponent,
+    };
+
+    struct Command
+    {
+        ECommandType type;
+        Entity entity;
+        uint32_t componentCount;
+        size_t firstComponent;      // into m_ComponentTypes and m_ComponentData
+    };
+
+    void Record(ECommandType type, Entity entity, ArrayIn<ComponentTypeId> ids, ArrayIn<const void*> components);
+
+private:
+    std::mutex m_Mutex;
+    std::vector<Command> m_Commands;
+    std::vector<ComponentTypeId> m_ComponentTypes;
+    std::vector<size_t> m_ComponentOffsets;     // into m_Data, per component type
+    std::vector<std::byte> m_Data;
+};
+}
@@ -0,0 +1,28 @@
+﻿#include "Engine/Source/Runtime/Function/Scene/Entity.h"
+
+#include <array>
+#include <mutex>
+
+namespace Snowy::Ark
+{
+static std::mutex s_ComponentTypeMutex;
+static std::array<ComponentTypeInfo, MaxComponentTypes> s_ComponentTypes;
+static uint32_t s_ComponentTypeCount = 0;
+
+In<ComponentTypeInfo> ComponentRegistry::Info(ComponentTypeId id) noexcept
+{
+    // Entries are written once before their id is handed out, the reader got the id after that
+    return s_ComponentTypes[id];
+}
+
+ComponentTypeId ComponentRegistry::Register(In<ComponentTypeInfo> info)
+{
+    std::scoped_lock lock(s_ComponentTypeMutex);
+    if (s_ComponentTypeCount == MaxComponentTypes)
+    {
+        throw std::runtime_error("Too many component types!");
+    }
+    s_ComponentTypes[s_ComponentTypeCount] = info;
+    return s_ComponentTypeCount++;
+}
+}
@@ -0,0 +1,59 @@
+﻿#pragma once
+#include "Engine/Source/Runtime/Core/Base/Common.h"
+
+#include <type_traits>
+#include <typeinfo>
+
+namespace Snowy::Ark
+{
+// Index into the entity slots of a World, the generation tells a reused slot from the entity that held it before
+struct Entity
+{
+    static constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+    uint32_t index = InvalidIndex;
+    uint32_t generation = 0;
+
+    bool IsValid() const noexcept { return index != InvalidIndex; }
+    bool operator==(const Entity&) const = default;
+};
+
+using ComponentTypeId = uint32_t;
+using ComponentMask = uint64_t;     // bit i set when the archetype has component type i
+
+inline constexpr uint32_t MaxComponentTypes = 64;
+
+struct ComponentTypeInfo
+{
+    uint32_t size = 0;
+    uint32_t alignment = 0;
+    const char* name = nullptr;
+};
+
+/// <summary>
+/// Process wide ids of the component types, handed out the first time a type is used. Components live in raw
+/// chunk memory and are moved around with memcpy, so they must be trivially copyable.
+/// </summary>
+class ComponentRegistry
+{
+public:
+    template<typename T>
+    static ComponentTypeId TypeId()
+    {
+        static_assert(std::is_trivially_copyable_v<T> && std::is_same_v<T, std::remove_cv_t<T>>);
+        static const ComponentTypeId id = Register(ComponentTypeInfo{ sizeof(T), alignof(T), typeid(T).name() });
+        return id;
+    }
+
+    template<typename T>
+    static ComponentMask Mask()
+    {
+        return ComponentMask(1) << TypeId<T>();
+    }
+
+    static In<ComponentTypeInfo> Info(ComponentTypeId id) noexcept;
+
+private:
+    static ComponentTypeId Register(In<ComponentTypeInfo> info);
+};
+}
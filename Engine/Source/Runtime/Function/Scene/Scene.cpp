@@ -0,0 +1,106 @@
+﻿#include "Engine/Source/Runtime/Function/Scene/Scene.h"
+#include "Engine/Source/Runtime/Core/Log/Logger.h"
+#include "Engine/Source/Runtime/Core/Profile/Profiler.h"
+#include "Engine/Source/Runtime/Function/Global/GlobalContext.h"
+
+#include <cmath>
+
+namespace Snowy::Ark
+{
+static constexpr float EntitySpacing = 2.0f;
+static constexpr uint32_t EntityGroupSize = 4;      // a static root with a chain of spinning children
+static constexpr float ChildOffset = 0.6f;
+static constexpr float ChildScale = 0.8f;
+
+void Scene::Init(In<SceneConfig> config)
+{
+    SpawnEntities(config.entityCount);
+    constexpr const char* TransformKernelNames[] = { "Scalar", "SSE2", "AVX" };
+    SA_LOG_INFO("Scene Initialized, {} entities in {} archetypes, transform kernel {}.", m_World.EntityCount(), m_World.ArchetypeCount(),
+                TransformKernelNames[static_cast<size_t>(m_Hierarchy.Kernel())]);
+}
+
+void Scene::Tick(float deltaTime)
+{
+    SA_PROFILE_FUNCTION();
+    UpdateSpin(deltaTime);
+    UpdateHierarchy();
+    m_Commands.Playback(m_World);
+}
+
+void Scene::SpawnEntities(uint32_t count)
+{
+    // The group roots on a cube grid around the origin, the spin axes come from a hash of the index so every run
+    // spawns the same scene
+    uint32_t groupCount = (count + EntityGroupSize - 1) / EntityGroupSize;
+    uint32_t side = std::max(static_cast<uint32_t>(std::ceil(std::cbrt(static_cast<double>(groupCount)))), 1u);
+    glm::vec3 origin = glm::vec3(static_cast<float>(side - 1) * EntitySpacing * -0.5f);
+    TransformHierarchy::NodeId parent = TransformHierarchy::NoNode;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        Transform transform;
+        MeshRenderer meshRenderer;
+        if (i % EntityGroupSize == 0)
+        {
+            uint32_t group = i / EntityGroupSize;
+            transform.position = origin + glm::vec3(group % side, group / side % side, group / (side * side)) * EntitySpacing;
+            parent = m_Hierarchy.CreateNode();
+            m_Hierarchy.SetInstance(parent, m_InstanceCount++);
+            m_World.CreateEntity(transform, TransformNode{ parent }, meshRenderer);
+            continue;
+        }
+        transform.position = glm::vec3(ChildOffset, 0.0f, 0.0f);
+        transform.scale = ChildScale;
+
+        uint32_t hash = i * 2654435761u;
+        glm::vec3 axis = glm::vec3(hash & 0xFF, (hash >> 8) & 0xFF, (hash >> 16) & 0xFF) / 255.0f - 0.5f;
+        Spin spin;
+        spin.axis = glm::length(axis) > 0.01f ? glm::normalize(axis) : glm::vec3(0.0f, 0.0f, 1.0f);
+        spin.speed = 0.5f + static_cast<float>(hash >> 24) / 255.0f * 2.0f;
+        // The first UpdateHierarchy hands the transforms over
+        parent = m_Hierarchy.CreateNode(parent);
+        m_Hierarchy.SetInstance(parent, m_InstanceCount++);
+        m_World.CreateEntity(transform, TransformNode{ parent }, meshRenderer, spin);
+    }
+}
+
+void Scene::UpdateSpin(float deltaTime)
+{
+    SA_PROFILE_FUNCTION();
+    m_World.AdvanceVersion();
+    auto query = m_World.Query<Transform, const Spin>();
+    query.ParallelForEachChunk(*g_RuntimeContext.jobSys, [deltaTime](ArrayIn<Entity> entities, std::span<Transform> transforms, std::span<const Spin> spins) {
+        for (size_t i = 0; i < entities.size(); i++)
+        {
+            transforms[i].rotation = glm::normalize(glm::angleAxis(spins[i].speed * deltaTime, spins[i].axis) * transforms[i].rotation);
+        }
+    });
+}
+
+void Scene::UpdateHierarchy()
+{
+    SA_PROFILE_FUNCTION();
+    uint32_t version = m_World.AdvanceVersion();
+    auto query = m_World.Query<const Transform, const TransformNode>().ChangedSince<Transform>(m_HierarchyVersion);
+    query.ParallelForEachChunk(*g_RuntimeContext.jobSys, [this](ArrayIn<Entity> entities, std::span<const Transform> transforms, std::span<const TransformNode> nodes) {
+        for (size_t i = 0; i < entities.size(); i++)
+        {
+            m_Hierarchy.SetLocalTransform(nodes[i].node, transforms[i].position, transforms[i].rotation, transforms[i].scale);
+        }
+    });
+    m_Hierarchy.Update(*g_RuntimeContext.jobSys);
+    m_HierarchyVersion = version;
+}
+
+bool Scene::WriteInstances(std::span<glm::mat4> instances)
+{
+    SA_PROFILE_FUNCTION();
+    if (instances.size() < m_InstanceCount)
+    {
+        return false;
+    }
+    // Usually nothing changed since the Tick updated the hierarchy, the pass then only copies the world matrices out
+    m_Hierarchy.Update(*g_RuntimeContext.jobSys, instances);
+    return true;
+}
+}
@@ -0,0 +1,44 @@
+﻿#pragma once
+#include "Engine/Source/Runtime/Core/Base/Common.h"
+#include "Engine/Source/Runtime/Function/Global/GlobalContextConfig.h"
+#include "Engine/Source/Runtime/Function/Scene/World.h"
+#include "Engine/Source/Runtime/Function/Scene/CommandBuffer.h"
+#include "Engine/Source/Runtime/Function/Scene/SceneComponents.h"
+#include "Engine/Source/Runtime/Function/Scene/TransformHierarchy.h"
+
+namespace Snowy::Ark
+{
+/// <summary>
+/// The simulated world and the systems stepping it. Owned by whichever thread runs the logic.
+/// </summary>
+class Scene
+{
+public:
+    void Init(In<SceneConfig> config);
+    void Tick(float deltaTime);
+
+    Ref<World> GetWorld() noexcept { return m_World; }
+    In<TransformHierarchy> Hierarchy() const noexcept { return m_Hierarchy; }
+    // Structural changes recorded during Tick, applied at its end
+    Ref<CommandBuffer> Commands() noexcept { return m_Commands; }
+
+    // Every entity with a mesh renderer is an instance, its index is the one its node was given
+    uint32_t InstanceCount() const noexcept { return m_InstanceCount; }
+    // Writes the world matrix of every instance to instances[index], as of the last Tick. False and nothing
+    // written when they don't fit
+    bool WriteInstances(std::span<glm::mat4> instances);
+
+private:
+    void SpawnEntities(uint32_t count);
+    void UpdateSpin(float deltaTime);
+    // Hands the transforms changed since the last update to the hierarchy and recomputes the world matrices
+    void UpdateHierarchy();
+
+private:
+    World m_World;
+    CommandBuffer m_Commands;
+    TransformHierarchy m_Hierarchy;
+    uint32_t m_HierarchyVersion = 0;    // world version of the last UpdateHierarchy
+    uint32_t m_InstanceCount = 0;
+};
+}
@@ -0,0 +1,35 @@
+﻿#pragma once
+#include "Engine/Source/Runtime/Core/Base/Common.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+namespace Snowy::Ark
+{
+// Relative to the parent node
+struct Transform
+{
+    glm::vec3 position = glm::vec3(0.0f);
+    float scale = 1.0f;     // uniform
+    glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+};
+
+// Node of the entity in the transform hierarchy of the scene, where its world matrix is
+struct TransformNode
+{
+    uint32_t node = UINT32_MAX;
+};
+
+// Rotates the transform around axis, entities without it never move
+struct Spin
+{
+    glm::vec3 axis = glm::vec3(0.0f, 0.0f, 1.0f);   // normalized
+    float speed = 0.0f;                             // radians per second
+};
+
+struct MeshRenderer
+{
+    uint32_t mesh = 0;
+    uint32_t material = 0;
+};
+}
@@ -0,0 +1,555 @@
+﻿#include "Engine/Source/Runtime/Function/Scene/TransformHierarchy.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define SA_TRANSFORM_SSE2 1
+    #include <immintrin.h>
+#else
+    #define SA_TRANSFORM_SSE2 0
+#endif
+
+// The AVX kernel is built into every x86 target and only picked when the CPU runs it
+#if SA_TRANSFORM_SSE2 && (defined(_MSC_VER) || defined(__GNUC__) || defined(__clang__))
+    #define SA_TRANSFORM_AVX 1
+#else
+    #define SA_TRANSFORM_AVX 0
+#endif
+
+#if SA_TRANSFORM_AVX && (defined(__GNUC__) || defined(__clang__))
+    #define SA_TRANSFORM_TARGET_AVX __attribute__((target("avx")))
+#else
+    #define SA_TRANSFORM_TARGET_AVX
+    #if SA_TRANSFORM_AVX
+        #include <intrin.h>
+    #endif
+#endif
+
+namespace Snowy::Ark
+{
+struct TransformSlotArrays
+{
+    const float* position[3];
+    const float* rotation[4];       // x, y, z, w
+    const float* scale;
+    const uint32_t* parent;         // slot of the parent, NoSlot for roots and padding
+    const uint8_t* dirty;
+    glm::mat4* world;
+};
+
+namespace
+{
+constexpr uint32_t NoParentSlot = UINT32_MAX;
+
+// Every kernel builds the rotation from the same doubled products, their results only differ in the last bits
+glm::mat4 ComposeLocal(In<TransformSlotArrays> slots, uint32_t slot) noexcept
+{
+    float x = slots.rotation[0][slot];
+    float y = slots.rotation[1][slot];
+    float z = slots.rotation[2][slot];
+    float w = slots.rotation[3][slot];
+    float scale = slots.scale[slot];
+    float xx = x * (x + x), yy = y * (y + y), zz = z * (z + z);
+    float xy = x * (y + y), xz = x * (z + z), yz = y * (z + z);
+    float wx = w * (x + x), wy = w * (y + y), wz = w * (z + z);
+
+    glm::mat4 local;
+    local[0] = glm::vec4((1.0f - (yy + zz)) * scale, (xy + wz) * scale, (xz - wy) * scale, 0.0f);
+    local[1] = glm::vec4((xy - wz) * scale, (1.0f - (xx + zz)) * scale, (yz + wx) * scale, 0.0f);
+    local[2] = glm::vec4((xz + wy) * scale, (yz - wx) * scale, (1.0f - (xx + yy)) * scale, 0.0f);
+    local[3] = glm::vec4(slots.position[0][slot], slots.position[1][slot], slots.position[2][slot], 1.0f);
+    return local;
+}
+
+void UpdateScalar(In<TransformSlotArrays> slots, uint32_t first)
+{
+    for (uint32_t slot = first; slot < first + TransformHierarchy::BatchSize; slot++)
+    {
+        if (!slots.dirty[slot])
+        {
+            continue;
+        }
+        glm::mat4 local = ComposeLocal(slots, slot);
+        uint32_t parent = slots.parent[slot];
+        slots.world[slot] = parent == NoParentSlot ? local : slots.world[parent] * local;
+    }
+}
+
+#if SA_TRANSFORM_SSE2
+// One column of parent * local, the parent is a column major matrix
+__m128 TransformColumn(const float* parent, __m128 column) noexcept
+{
+    __m128 result = _mm_mul_ps(_mm_loadu_ps(parent), _mm_shuffle_ps(column, column, _MM_SHUFFLE(0, 0, 0, 0)));
+    result = _mm_add_ps(result, _mm_mul_ps(_mm_loadu_ps(parent + 4), _mm_shuffle_ps(column, column, _MM_SHUFFLE(1, 1, 1, 1))));
+    result = _mm_add_ps(result, _mm_mul_ps(_mm_loadu_ps(parent + 8), _mm_shuffle_ps(column, column, _MM_SHUFFLE(2, 2, 2, 2))));
+    return _mm_add_ps(result, _mm_mul_ps(_mm_loadu_ps(parent + 12), _mm_shuffle_ps(column, column, _MM_SHUFFLE(3, 3, 3, 3))));
+}
+
+void UpdateSSE2(In<TransformSlotArrays> slots, uint32_t first)
+{
+    for (uint32_t quad = first; quad < first + TransformHierarchy::BatchSize; quad += 4)
+    {
+        uint32_t dirtyMask;
+        std::memcpy(&dirtyMask, slots.dirty + quad, sizeof(dirtyMask));
+        if (dirtyMask == 0)
+        {
+            continue;
+        }
+
+        // 4 nodes a register, the lanes are the nodes
+        __m128 x = _mm_loadu_ps(slots.rotation[0] + quad);
+        __m128 y = _mm_loadu_ps(slots.rotation[1] + quad);
+        __m128 z = _mm_loadu_ps(slots.rotation[2] + quad);
+        __m128 w = _mm_loadu_ps(slots.rotation[3] + quad);
+        __m128 scale = _mm_loadu_ps(slots.scale + quad);
+        __m128 x2 = _mm_add_ps(x, x), y2 = _mm_add_ps(y, y), z2 = _mm_add_ps(z, z);
+        __m128 xx = _mm_mul_ps(x, x2), yy = _mm_mul_ps(y, y2), zz = _mm_mul_ps(z, z2);
+        __m128 xy = _mm_mul_ps(x, y2), xz = _mm_mul_ps(x, z2), yz = _mm_mul_ps(y, z2);
+        __m128 wx = _mm_mul_ps(w, x2), wy = _mm_mul_ps(w, y2), wz = _mm_mul_ps(w, z2);
+        __m128 one = _mm_set1_ps(1.0f);
+        __m128 zero = _mm_setzero_ps();
+
+        // columns[c] holds column c of the 4 local matrices, transposed to one node a register
+        __m128 columns[4][4] = {
+            { _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), scale), _mm_mul_ps(_mm_add_ps(xy, wz), scale), _mm_mul_ps(_mm_sub_ps(xz, wy), scale), zero },
+            { _mm_mul_ps(_mm_sub_ps(xy, wz), scale), _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), scale), _mm_mul_ps(_mm_add_ps(yz, wx), scale), zero },
+            { _mm_mul_ps(_mm_add_ps(xz, wy), scale), _mm_mul_ps(_mm_sub_ps(yz, wx), scale), _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), scale), zero },
+            { _mm_loadu_ps(slots.position[0] + quad), _mm_loadu_ps(slots.position[1] + quad), _mm_loadu_ps(slots.position[2] + quad), one },
+        };
+        for (auto&& column : columns)
+        {
+            _MM_TRANSPOSE4_PS(column[0], column[1], column[2], column[3]);
+        }
+
+        for (uint32_t lane = 0; lane < 4; lane++)
+        {
+            uint32_t slot = quad + lane;
+            if (!slots.dirty[slot])
+            {
+                continue;
+            }
+            float* world = &slots.world[slot][0][0];
+            uint32_t parent = slots.parent[slot];
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                __m128 column = parent == NoParentSlot ? columns[c][lane] : TransformColumn(&slots.world[parent][0][0], columns[c][lane]);
+                _mm_storeu_ps(world + c * 4, column);
+            }
+        }
+    }
+}
+#endif
+
+#if SA_TRANSFORM_AVX
+// Two columns of parent * local at once, the low half is the first column
+SA_TRANSFORM_TARGET_AVX __m256 TransformColumnPair(const float* parent, __m256 columns) noexcept
+{
+    __m256 result = _mm256_mul_ps(_mm256_broadcast_ps(reinterpret_cast<const __m128*>(parent)), _mm256_permute_ps(columns, 0x00));
+    result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_broadcast_ps(reinterpret_cast<const __m128*>(parent + 4)), _mm256_permute_ps(columns, 0x55)));
+    result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_broadcast_ps(reinterpret_cast<const __m128*>(parent + 8)), _mm256_permute_ps(columns, 0xAA)));
+    return _mm256_add_ps(result, _mm256_mul_ps(_mm256_broadcast_ps(reinterpret_cast<const __m128*>(parent + 12)), _mm256_permute_ps(columns, 0xFF)));
+}
+
+// Transposes within each 128 bit half, row r then holds node r in the low half and node r + 4 in the high one
+SA_TRANSFORM_TARGET_AVX void Transpose4x4x2(__m256 (&rows)[4]) noexcept
+{
+    __m256 t0 = _mm256_unpacklo_ps(rows[0], rows[1]);
+    __m256 t1 = _mm256_unpackhi_ps(rows[0], rows[1]);
+    __m256 t2 = _mm256_unpacklo_ps(rows[2], rows[3]);
+    __m256 t3 = _mm256_unpackhi_ps(rows[2], rows[3]);
+    rows[0] = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+    rows[1] = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    rows[2] = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    rows[3] = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+}
+
+SA_TRANSFORM_TARGET_AVX void UpdateAVX(In<TransformSlotArrays> slots, uint32_t first)
+{
+    static_assert(TransformHierarchy::BatchSize == 8);
+
+    // 8 nodes a register, the lanes are the nodes
+    __m256 x = _mm256_loadu_ps(slots.rotation[0] + first);
+    __m256 y = _mm256_loadu_ps(slots.rotation[1] + first);
+    __m256 z = _mm256_loadu_ps(slots.rotation[2] + first);
+    __m256 w = _mm256_loadu_ps(slots.rotation[3] + first);
+    __m256 scale = _mm256_loadu_ps(slots.scale + first);
+    __m256 x2 = _mm256_add_ps(x, x), y2 = _mm256_add_ps(y, y), z2 = _mm256_add_ps(z, z);
+    __m256 xx = _mm256_mul_ps(x, x2), yy = _mm256_mul_ps(y, y2), zz = _mm256_mul_ps(z, z2);
+    __m256 xy = _mm256_mul_ps(x, y2), xz = _mm256_mul_ps(x, z2), yz = _mm256_mul_ps(y, z2);
+    __m256 wx = _mm256_mul_ps(w, x2), wy = _mm256_mul_ps(w, y2), wz = _mm256_mul_ps(w, z2);
+    __m256 one = _mm256_set1_ps(1.0f);
+    __m256 zero = _mm256_setzero_ps();
+
+    __m256 columns[4][4] = {
+        { _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(yy, zz)), scale), _mm256_mul_ps(_mm256_add_ps(xy, wz), scale), _mm256_mul_ps(_mm256_sub_ps(xz, wy), scale), zero },
+        { _mm256_mul_ps(_mm256_sub_ps(xy, wz), scale), _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, zz)), scale), _mm256_mul_ps(_mm256_add_ps(yz, wx), scale), zero },
+        { _mm256_mul_ps(_mm256_add_ps(xz, wy), scale), _mm256_mul_ps(_mm256_sub_ps(yz, wx), scale), _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, yy)), scale), zero },
+        { _mm256_loadu_ps(slots.position[0] + first), _mm256_loadu_ps(slots.position[1] + first), _mm256_loadu_ps(slots.position[2] + first), one },
+    };
+    for (auto&& column : columns)
+    {
+        Transpose4x4x2(column);
+    }
+
+    for (uint32_t lane = 0; lane < TransformHierarchy::BatchSize; lane++)
+    {
+        uint32_t slot = first + lane;
+        if (!slots.dirty[slot])
+        {
+            continue;
+        }
+        // Columns 0 and 1 of the node in one register, 2 and 3 in the other
+        uint32_t row = lane & 3;
+        __m256 columns01 = lane < 4 ? _mm256_permute2f128_ps(columns[0][row], columns[1][row], 0x20) : _mm256_permute2f128_ps(columns[0][row], columns[1][row], 0x31);
+        __m256 columns23 = lane < 4 ? _mm256_permute2f128_ps(columns[2][row], columns[3][row], 0x20) : _mm256_permute2f128_ps(columns[2][row], columns[3][row], 0x31);
+        uint32_t parent = slots.parent[slot];
+        if (parent != NoParentSlot)
+        {
+            const float* parentWorld = &slots.world[parent][0][0];
+            columns01 = TransformColumnPair(parentWorld, columns01);
+            columns23 = TransformColumnPair(parentWorld, columns23);
+        }
+        float* world = &slots.world[slot][0][0];
+        _mm256_storeu_ps(world, columns01);
+        _mm256_storeu_ps(world + 8, columns23);
+    }
+}
+
+bool CpuHasAvx() noexcept
+{
+    #if defined(__GNUC__) || defined(__clang__)
+    return __builtin_cpu_supports("avx");
+    #else
+    // The CPU must have it and the OS must save the YMM registers
+    int info[4];
+    __cpuid(info, 1);
+    bool osSavesYmm = (info[2] & (1 << 27)) && (_xgetbv(0) & 0x6) == 0x6;
+    return (info[2] & (1 << 28)) && osSavesYmm;
+    #endif
+}
+#endif
+}
+
+TransformHierarchy::TransformHierarchy()
+{
+    SetKernel(BestKernel());
+}
+
+ETransformKernel TransformHierarchy::BestKernel() noexcept
+{
+    for (auto kernel : { ETransformKernel::AVX, ETransformKernel::SSE2 })
+    {
+        if (IsKernelSupported(kernel))
+        {
+            return kernel;
+        }
+    }
+    return ETransformKernel::Scalar;
+}
+
+bool TransformHierarchy::IsKernelSupported(ETransformKernel kernel) noexcept
+{
+    switch (kernel)
+    {
+        case ETransformKernel::Scalar: return true;
+        case ETransformKernel::SSE2:   return SA_TRANSFORM_SSE2;
+#if SA_TRANSFORM_AVX
+        case ETransformKernel::AVX:    return CpuHasAvx();
+#endif
+        default: return false;
+    }
+}
+
+bool TransformHierarchy::SetKernel(ETransformKernel kernel) noexcept
+{
+    if (!IsKernelSupported(kernel))
+    {
+        return false;
+    }
+    m_Kernel = kernel;
+    m_KernelFunc = KernelOf(kernel);
+    return true;
+}
+
+TransformHierarchy::KernelFunc TransformHierarchy::KernelOf(ETransformKernel kernel) noexcept
+{
+    switch (kernel)
+    {
+#if SA_TRANSFORM_SSE2
+        case ETransformKernel::SSE2: return &UpdateSSE2;
+#endif
+#if SA_TRANSFORM_AVX
+        case ETransformKernel::AVX:  return &UpdateAVX;
+#endif
+        default: return &UpdateScalar;
+    }
+}
+
+TransformHierarchy::NodeId TransformHierarchy::CreateNode(NodeId parent)
+{
+    NodeId node;
+    if (!m_FreeNodes.empty())
+    {
+        node = m_FreeNodes.back();
+        m_FreeNodes.pop_back();
+    } else
+    {
+        node = static_cast<NodeId>(m_Nodes.size());
+        m_Nodes.emplace_back();
+    }
+
+    // Appended unsorted, the next Update sorts it in
+    m_Nodes[node] = Node();
+    m_Nodes[node].slot = static_cast<uint32_t>(m_Scale.size());
+    ResizeSlots(m_Nodes[node].slot + 1);
+    m_Dirty[m_Nodes[node].slot] = 1;
+    if (parent != NoNode)
+    {
+        AddChild(parent, node);
+    }
+    m_NodeCount++;
+    m_SlotsDirty = true;
+    return node;
+}
+
+void TransformHierarchy::DestroyNode(NodeId node)
+{
+    if (m_Nodes[node].parent != NoNode)
+    {
+        RemoveChild(m_Nodes[node].parent, node);
+    }
+
+    std::vector<NodeId> subtree = { node };
+    while (!subtree.empty())
+    {
+        NodeId current = subtree.back();
+        subtree.pop_back();
+        for (NodeId child = m_Nodes[current].firstChild; child != NoNode; child = m_Nodes[child].nextSibling)
+        {
+            subtree.emplace_back(child);
+        }
+
+        // The slot stays until the next Update drops it, nothing may write through it meanwhile
+        m_SlotInstance[m_Nodes[current].slot] = NoInstance;
+        m_Nodes[current] = Node();
+        m_FreeNodes.emplace_back(current);
+        m_NodeCount--;
+    }
+    m_SlotsDirty = true;
+}
+
+void TransformHierarchy::SetParent(NodeId node, NodeId parent)
+{
+    for (NodeId ancestor = parent; ancestor != NoNode; ancestor = m_Nodes[ancestor].parent)
+    {
+        SAssert(ancestor != node && "A node can't be parented to its own subtree");
+    }
+
+    if (m_Nodes[node].parent != NoNode)
+    {
+        RemoveChild(m_Nodes[node].parent, node);
+    }
+    if (parent != NoNode)
+    {
+        AddChild(parent, node);
+    }
+    m_Dirty[m_Nodes[node].slot] = 1;
+    m_SlotsDirty = true;
+}
+
+void TransformHierarchy::SetLocalTransform(NodeId node, In<glm::vec3> position, In<glm::quat> rotation, float scale)
+{
+    uint32_t slot = m_Nodes[node].slot;
+    m_Position[0][slot] = position.x;
+    m_Position[1][slot] = position.y;
+    m_Position[2][slot] = position.z;
+    m_Rotation[0][slot] = rotation.x;
+    m_Rotation[1][slot] = rotation.y;
+    m_Rotation[2][slot] = rotation.z;
+    m_Rotation[3][slot] = rotation.w;
+    m_Scale[slot] = scale;
+    m_Dirty[slot] = 1;
+}
+
+void TransformHierarchy::SetInstance(NodeId node, uint32_t instance)
+{
+    m_Nodes[node].instance = instance;
+    m_SlotInstance[m_Nodes[node].slot] = instance;
+}
+
+void TransformHierarchy::Update(Ref<JobSystem> jobSys, std::span<glm::mat4> instances)
+{
+    if (m_SlotsDirty)
+    {
+        RebuildSlots();
+    }
+
+    TransformSlotArrays slots = {
+        .position = { m_Position[0].data(), m_Position[1].data(), m_Position[2].data() },
+        .rotation = { m_Rotation[0].data(), m_Rotation[1].data(), m_Rotation[2].data(), m_Rotation[3].data() },
+        .scale = m_Scale.data(),
+        .parent = m_ParentSlot.data(),
+        .dirty = m_Dirty.data(),
+        .world = m_World.data(),
+    };
+    for (size_t level = 0; level + 1 < m_LevelBegins.size(); level++)
+    {
+        uint32_t levelBegin = m_LevelBegins[level];
+        uint32_t batchCount = (m_LevelBegins[level + 1] - levelBegin) / BatchSize;
+        if (batchCount < ParallelBatchThreshold)
+        {
+            for (uint32_t batch = 0; batch < batchCount; batch++)
+            {
+                UpdateBatch(slots, levelBegin + batch * BatchSize, instances);
+            }
+            continue;
+        }
+        // The parents are all in finished levels, the batches of one level don't depend on each other
+        jobSys.ParallelFor(batchCount, JobSystem::AutoGrainSize, [&, this](uint32_t begin, uint32_t end) {
+            for (uint32_t batch = begin; batch < end; batch++)
+            {
+                UpdateBatch(slots, levelBegin + batch * BatchSize, instances);
+            }
+        });
+    }
+    std::ranges::fill(m_Dirty, uint8_t(0));
+}
+
+void TransformHierarchy::AddChild(NodeId parent, NodeId child)
+{
+    m_Nodes[child].parent = parent;
+    m_Nodes[child].nextSibling = m_Nodes[parent].firstChild;
+    m_Nodes[parent].firstChild = child;
+}
+
+void TransformHierarchy::RemoveChild(NodeId parent, NodeId child)
+{
+    NodeId* link = &m_Nodes[parent].firstChild;
+    while (*link != child)
+    {
+        link = &m_Nodes[*link].nextSibling;
+    }
+    *link = m_Nodes[child].nextSibling;
+    m_Nodes[child].parent = NoNode;
+    m_Nodes[child].nextSibling = NoNode;
+}
+
+void TransformHierarchy::RebuildSlots()
+{
+    // Breadth first from the roots, every level padded to whole batches
+    std::vector<NodeId> order;
+    std::vector<NodeId> level;
+    std::vector<NodeId> nextLevel;
+    for (NodeId node = 0; node < m_Nodes.size(); node++)
+    {
+        if (m_Nodes[node].slot != NoSlot && m_Nodes[node].parent == NoNode)
+        {
+            level.emplace_back(node);
+        }
+    }
+    m_LevelBegins.clear();
+    while (!level.empty())
+    {
+        m_LevelBegins.emplace_back(static_cast<uint32_t>(order.size()));
+        nextLevel.clear();
+        for (auto&& node : level)
+        {
+            order.emplace_back(node);
+            for (NodeId child = m_Nodes[node].firstChild; child != NoNode; child = m_Nodes[child].nextSibling)
+            {
+                nextLevel.emplace_back(child);
+            }
+        }
+        order.resize((order.size() + BatchSize - 1) / BatchSize * BatchSize, NoNode);
+        level.swap(nextLevel);
+    }
+    m_LevelBegins.emplace_back(static_cast<uint32_t>(order.size()));
+
+    // Gathered into the new order, the padding keeps the identity
+    auto gather = [&order, this](auto& values, auto padding) {
+        std::remove_reference_t<decltype(values)> sorted(order.size(), padding);
+        for (size_t i = 0; i < order.size(); i++)
+        {
+            if (order[i] != NoNode)
+            {
+                sorted[i] = values[m_Nodes[order[i]].slot];
+            }
+        }
+        values.swap(sorted);
+    };
+    for (auto&& values : m_Position)
+    {
+        gather(values, 0.0f);
+    }
+    for (size_t i = 0; i < 4; i++)
+    {
+        gather(m_Rotation[i], i == 3 ? 1.0f : 0.0f);
+    }
+    gather(m_Scale, 1.0f);
+    gather(m_SlotInstance, NoInstance);
+    gather(m_World, glm::mat4(1.0f));
+
+    m_ParentSlot.assign(order.size(), NoSlot);
+    for (uint32_t slot = 0; slot < order.size(); slot++)
+    {
+        if (order[slot] != NoNode)
+        {
+            // Parents come first, their slots are already the new ones
+            m_Nodes[order[slot]].slot = slot;
+            NodeId parent = m_Nodes[order[slot]].parent;
+            m_ParentSlot[slot] = parent == NoNode ? NoSlot : m_Nodes[parent].slot;
+        }
+    }
+    // Nodes that moved under another parent need new world matrices, so do their subtrees
+    m_Dirty.assign(order.size(), 1);
+    m_SlotsDirty = false;
+}
+
+void TransformHierarchy::ResizeSlots(uint32_t slotCount)
+{
+    for (auto&& values : m_Position)
+    {
+        values.resize(slotCount, 0.0f);
+    }
+    for (size_t i = 0; i < 4; i++)
+    {
+        m_Rotation[i].resize(slotCount, i == 3 ? 1.0f : 0.0f);
+    }
+    m_Scale.resize(slotCount, 1.0f);
+    m_ParentSlot.resize(slotCount, NoSlot);
+    m_SlotInstance.resize(slotCount, NoInstance);
+    m_Dirty.resize(slotCount, 0);
+    m_World.resize(slotCount, glm::mat4(1.0f));
+}
+
+void TransformHierarchy::UpdateBatch(In<TransformSlotArrays> slots, uint32_t first, std::span<glm::mat4> instances)
+{
+    // A parent is dirty when anything above it is, its level already got the flag
+    bool anyDirty = false;
+    for (uint32_t slot = first; slot < first + BatchSize; slot++)
+    {
+        uint32_t parent = m_ParentSlot[slot];
+        if (parent != NoSlot && m_Dirty[parent])
+        {
+            m_Dirty[slot] = 1;
+        }
+        anyDirty |= m_Dirty[slot] != 0;
+    }
+    if (anyDirty)
+    {
+        m_KernelFunc(slots, first);
+    }
+
+    if (!instances.empty())
+    {
+        for (uint32_t slot = first; slot < first + BatchSize; slot++)
+        {
+            if (m_SlotInstance[slot] != NoInstance)
+            {
+                instances[m_SlotInstance[slot]] = m_World[slot];
+            }
+        }
+    }
+}
+}
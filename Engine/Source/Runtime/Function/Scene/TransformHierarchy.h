@@ -0,0 +1,113 @@
+﻿#pragma once
+#include "Engine/Source/Runtime/Core/Base/Common.h"
+#include "Engine/Source/Runtime/Core/Job/JobSystem.h"
+#include "Engine/Source/Runtime/Function/Global/GlobalTypedef.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <span>
+#include <vector>
+
+namespace Snowy::Ark
+{
+struct TransformSlotArrays;
+
+/// <summary>
+/// Parent relative transforms of a node tree and the world matrices computed from them. The local
+/// transforms are stored SoA and sorted by depth, every depth level starting on a batch, so a single
+/// pass over the levels sees every parent before its children and a batch never holds both.
+/// Changing a local transform marks its node dirty, Update recomputes the dirty nodes and their subtrees
+/// and leaves the rest alone. The kernel is picked at runtime from what the CPU supports.
+/// Structural changes(creating, destroying, reparenting) re-sort the nodes on the next Update, local
+/// transforms of different nodes may be set from several threads at once in between.
+/// </summary>
+class TransformHierarchy
+{
+public:
+    using NodeId = uint32_t;
+
+    static constexpr NodeId NoNode = UINT32_MAX;
+    static constexpr uint32_t NoInstance = UINT32_MAX;
+    static constexpr uint32_t BatchSize = 8;                // nodes per kernel call
+    static constexpr uint32_t ParallelBatchThreshold = 64;  // levels with fewer batches are run on the calling thread
+
+public:
+    TransformHierarchy();
+    ~TransformHierarchy() = default;
+    TransformHierarchy(const TransformHierarchy&) = delete;
+    TransformHierarchy(TransformHierarchy&&) = delete;
+    TransformHierarchy& operator=(const TransformHierarchy&) = delete;
+    TransformHierarchy& operator=(TransformHierarchy&&) = delete;
+
+    // The best kernel the CPU runs
+    static ETransformKernel BestKernel() noexcept;
+    static bool IsKernelSupported(ETransformKernel kernel) noexcept;
+    ETransformKernel Kernel() const noexcept { return m_Kernel; }
+    // False when the CPU can't run it, the current kernel stays
+    bool SetKernel(ETransformKernel kernel) noexcept;
+
+    // Starts with the identity transform
+    NodeId CreateNode(NodeId parent = NoNode);
+    // Destroys the whole subtree
+    void DestroyNode(NodeId node);
+    // Keeps the local transform, the node moves with its new parent from now on
+    void SetParent(NodeId node, NodeId parent);
+    NodeId Parent(NodeId node) const noexcept { return m_Nodes[node].parent; }
+    uint32_t NodeCount() const noexcept { return m_NodeCount; }
+
+    void SetLocalTransform(NodeId node, In<glm::vec3> position, In<glm::quat> rotation, float scale);
+    // Update writes the world matrix of the node to instances[instance]
+    void SetInstance(NodeId node, uint32_t instance);
+    // As of the last Update
+    In<glm::mat4> WorldMatrix(NodeId node) const noexcept { return m_World[m_Nodes[node].slot]; }
+
+    // Recomputes the dirty subtrees level by level, the batches of a large level are spread over the job system.
+    // When instances is given every node with an instance gets its world matrix written there in the same
+    // pass, dirty or not, so the span can be a buffer that is rewritten every frame
+    void Update(Ref<JobSystem> jobSys, std::span<glm::mat4> instances = {});
+
+private:
+    static constexpr uint32_t NoSlot = UINT32_MAX;
+
+    struct Node
+    {
+        NodeId parent = NoNode;
+        NodeId firstChild = NoNode;
+        NodeId nextSibling = NoNode;
+        uint32_t slot = NoSlot;         // NoSlot while free
+        uint32_t instance = NoInstance;
+    };
+
+    // Computes the world matrices of the dirty nodes in the BatchSize slots from first
+    using KernelFunc = void (*)(In<TransformSlotArrays> slots, uint32_t first);
+
+    static KernelFunc KernelOf(ETransformKernel kernel) noexcept;
+
+    void AddChild(NodeId parent, NodeId child);
+    void RemoveChild(NodeId parent, NodeId child);
+    // Sorts the slots by depth, done before an Update after structural changes
+    void RebuildSlots();
+    void ResizeSlots(uint32_t slotCount);
+    void UpdateBatch(In<TransformSlotArrays> slots, uint32_t first, std::span<glm::mat4> instances);
+
+private:
+    ETransformKernel m_Kernel = ETransformKernel::Scalar;
+    KernelFunc m_KernelFunc = nullptr;
+
+    std::vector<Node> m_Nodes;
+    std::vector<NodeId> m_FreeNodes;
+    uint32_t m_NodeCount = 0;
+    bool m_SlotsDirty = false;
+
+    // Per slot, slots of a level are contiguous and padded to BatchSize
+    std::vector<float> m_Position[3];
+    std::vector<float> m_Rotation[4];
+    std::vector<float> m_Scale;
+    std::vector<uint32_t> m_ParentSlot;
+    std::vector<uint32_t> m_SlotInstance;
+    std::vector<uint8_t> m_Dirty;
+    std::vector<glm::mat4> m_World;
+    std::vector<uint32_t> m_LevelBegins;    // first slot of every level, then the slot count
+};
+}
@@ -0,0 +1,167 @@
+﻿#include "Engine/Source/Runtime/Function/Scene/World.h"
+
+#include <cstring>
+
+namespace Snowy::Ark
+{
+void World::DestroyEntity(Entity entity)
+{
+    if (!IsAlive(entity))
+    {
+        return;
+    }
+
+    auto& record = m_Records[entity.index];
+    Entity moved = record.archetype->Remove(record.chunk, record.row, m_Version);
+    if (moved.IsValid())
+    {
+        m_Records[moved.index].chunk = record.chunk;
+        m_Records[moved.index].row = record.row;
+    }
+    record.archetype = nullptr;
+    record.generation++;
+    m_FreeRecords.emplace_back(entity.index);
+    m_EntityCount--;
+}
+
+bool World::IsAlive(Entity entity) const noexcept
+{
+    return entity.index < m_Records.size() && m_Records[entity.index].archetype && m_Records[entity.index].generation == entity.generation;
+}
+
+Entity World::CreateEntityFrom(ArrayIn<ComponentTypeId> ids, ArrayIn<const void*> components)
+{
+    ComponentMask mask = 0;
+    for (auto&& id : ids)
+    {
+        SAssert((mask & (ComponentMask(1) << id)) == 0 && "An entity can't have a component type twice");
+        mask |= ComponentMask(1) << id;
+    }
+
+    Entity entity;
+    if (!m_FreeRecords.empty())
+    {
+        entity.index = m_FreeRecords.back();
+        m_FreeRecords.pop_back();
+    } else
+    {
+        entity.index = static_cast<uint32_t>(m_Records.size());
+        m_Records.emplace_back();
+    }
+    auto& record = m_Records[entity.index];
+    entity.generation = record.generation;
+
+    record.archetype = &FindArchetype(mask);
+    record.archetype->Add(entity, m_Version, &record.chunk, &record.row);
+    for (size_t i = 0; i < ids.size(); i++)
+    {
+        uint8_t column = record.archetype->ColumnOf(ids[i]);
+        std::memcpy(record.archetype->Component(record.chunk, record.row, column), components[i], ComponentRegistry::Info(ids[i]).size);
+    }
+    m_EntityCount++;
+    return entity;
+}
+
+void World::AddComponentData(Entity entity, ComponentTypeId id, const void* component)
+{
+    if (!IsAlive(entity))
+    {
+        return;
+    }
+
+    auto& record = m_Records[entity.index];
+    ComponentMask mask = record.archetype->Mask() | (ComponentMask(1) << id);
+    if (mask != record.archetype->Mask())
+    {
+        MoveEntity(entity, FindArchetype(mask));
+    }
+    std::memcpy(FindComponent(entity, id), component, ComponentRegistry::Info(id).size);
+}
+
+void World::RemoveComponentType(Entity entity, ComponentTypeId id)
+{
+    if (!IsAlive(entity))
+    {
+        return;
+    }
+
+    auto& record = m_Records[entity.index];
+    ComponentMask mask = record.archetype->Mask() & ~(ComponentMask(1) << id);
+    if (mask != record.archetype->Mask())
+    {
+        MoveEntity(entity, FindArchetype(mask));
+    }
+}
+
+const void* World::FindComponent(Entity entity, ComponentTypeId id) const
+{
+    if (!IsAlive(entity))
+    {
+        return nullptr;
+    }
+
+    auto& record = m_Records[entity.index];
+    uint8_t column = record.archetype->ColumnOf(id);
+    if (column == Archetype::NoColumn)
+    {
+        return nullptr;
+    }
+    return record.archetype->Component(record.chunk, record.row, column);
+}
+
+void* World::FindComponent(Entity entity, ComponentTypeId id)
+{
+    if (!IsAlive(entity))
+    {
+        return nullptr;
+    }
+
+    auto& record = m_Records[entity.index];
+    uint8_t column = record.archetype->ColumnOf(id);
+    if (column == Archetype::NoColumn)
+    {
+        return nullptr;
+    }
+    record.archetype->Chunk(record.chunk).versions[column] = m_Version;
+    return record.archetype->Component(record.chunk, record.row, column);
+}
+
+Ref<Archetype> World::FindArchetype(ComponentMask mask)
+{
+    auto it = m_ArchetypeByMask.find(mask);
+    if (it != m_ArchetypeByMask.end())
+    {
+        return *it->second;
+    }
+    auto& archetype = m_Archetypes.emplace_back(MakeUnique<Archetype>(mask));
+    m_ArchetypeByMask.emplace(mask, archetype.get());
+    return *archetype;
+}
+
+void World::MoveEntity(Entity entity, Ref<Archetype> target)
+{
+    auto& record = m_Records[entity.index];
+    Archetype& source = *record.archetype;
+    uint32_t chunk;
+    uint32_t row;
+    target.Add(entity, m_Version, &chunk, &row);
+    for (auto&& id : source.Components())
+    {
+        uint8_t column = target.ColumnOf(id);
+        if (column != Archetype::NoColumn)
+        {
+            std::memcpy(target.Component(chunk, row, column), source.Component(record.chunk, record.row, source.ColumnOf(id)), ComponentRegistry::Info(id).size);
+        }
+    }
+
+    Entity moved = source.Remove(record.chunk, record.row, m_Version);
+    if (moved.IsValid())
+    {
+        m_Records[moved.index].chunk = record.chunk;
+        m_Records[moved.index].row = record.row;
+    }
+    record.archetype = &target;
+    record.chunk = chunk;
+    record.row = row;
+}
+}
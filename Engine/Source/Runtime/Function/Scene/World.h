@@ -0,0 +1,232 @@
+﻿#pragma once
+#include "Engine/Source/Runtime/Core/Base/Common.h"
+#include "Engine/Source/Runtime/Core/Job/JobSystem.h"
+#include "Engine/Source/Runtime/Function/Scene/Archetype.h"
+
+#include <bit>
+#include <span>
+#include <unordered_map>
+#include <utility>
+
+namespace Snowy::Ark
+{
+class World;
+
+/// <summary>
+/// Visits the chunks of every archetype with all of Ts, a const T is only read. Writable columns are stamped
+/// with the world version before the chunk is handed out. Structural changes must wait for the end of the
+/// query, record them into a CommandBuffer meanwhile.
+/// </summary>
+template<typename... Ts>
+class EntityQuery
+{
+public:
+    explicit EntityQuery(Ref<World> world) noexcept : m_World(world) {}
+
+    template<typename T>
+    EntityQuery& With() { m_Include |= ComponentRegistry::Mask<T>(); return *this; }
+    template<typename T>
+    EntityQuery& Without() { m_Exclude |= ComponentRegistry::Mask<T>(); return *this; }
+    // Skips chunks none of whose filtered columns were written after version
+    template<typename T>
+    EntityQuery& ChangedSince(uint32_t version)
+    {
+        m_ChangedFilter |= ComponentRegistry::Mask<T>();
+        m_ChangedSince = version;
+        return *this;
+    }
+
+    // func(ArrayIn<Entity> entities, std::span<Ts>... columns)
+    template<typename F>
+    void ForEachChunk(F&& func)
+    {
+        for (auto&& chunk : CollectChunks())
+        {
+            RunChunk(chunk, func, std::index_sequence_for<Ts...>());
+        }
+    }
+
+    // Chunks are spread over the job system, func must be safe to run on several chunks at once
+    template<typename F>
+    void ParallelForEachChunk(Ref<JobSystem> jobSys, F&& func)
+    {
+        auto chunks = CollectChunks();
+        jobSys.ParallelFor(static_cast<uint32_t>(chunks.size()), 1, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; i++)
+            {
+                RunChunk(chunks[i], func, std::index_sequence_for<Ts...>());
+            }
+        });
+    }
+
+    // func(Ts&... components), one entity at a time
+    template<typename F>
+    void ForEach(F&& func)
+    {
+        ForEachChunk([&func](ArrayIn<Entity> entities, std::span<Ts>... columns) {
+            for (size_t i = 0; i < entities.size(); i++)
+            {
+                func(columns[i]...);
+            }
+        });
+    }
+
+    uint32_t Count() const
+    {
+        uint32_t count = 0;
+        for (auto&& chunk : CollectChunks())
+        {
+            count += chunk.archetype->Chunk(chunk.chunk).count;
+        }
+        return count;
+    }
+
+private:
+    struct ChunkRef
+    {
+        ObserverHandle<Archetype> archetype;
+        uint32_t chunk;
+        std::array<uint8_t, sizeof...(Ts)> columns;
+    };
+
+    std::vector<ChunkRef> CollectChunks() const;
+
+    template<typename F, size_t... Is>
+    void RunChunk(In<ChunkRef> ref, Ref<F> func, std::index_sequence<Is...>);
+
+private:
+    Ref<World> m_World;
+    ComponentMask m_Include = 0;
+    ComponentMask m_Exclude = 0;
+    ComponentMask m_ChangedFilter = 0;
+    uint32_t m_ChangedSince = 0;
+};
+
+/// <summary>
+/// Entities and their components, grouped by archetype into chunks. Not thread safe for structural changes
+/// (creating and destroying entities, adding and removing components), queries may run chunks in parallel.
+/// </summary>
+class World
+{
+    template<typename... Ts>
+    friend class EntityQuery;
+    friend class CommandBuffer;
+
+public:
+    World() = default;
+    ~World() = default;
+    World(const World&) = delete;
+    World(World&&) = delete;
+    World& operator=(const World&) = delete;
+    World& operator=(World&&) = delete;
+
+    template<typename... Ts>
+    Entity CreateEntity(In<Ts>... components)
+    {
+        std::array<ComponentTypeId, sizeof...(Ts)> ids = { ComponentRegistry::TypeId<Ts>()... };
+        std::array<const void*, sizeof...(Ts)> data = { &components... };
+        return CreateEntityFrom(ids, data);
+    }
+    void DestroyEntity(Entity entity);
+    bool IsAlive(Entity entity) const noexcept;
+    uint32_t EntityCount() const noexcept { return m_EntityCount; }
+    uint32_t ArchetypeCount() const noexcept { return static_cast<uint32_t>(m_Archetypes.size()); }
+
+    // Overwrites the component when the entity already has one
+    template<typename T>
+    void AddComponent(Entity entity, In<T> component) { AddComponentData(entity, ComponentRegistry::TypeId<T>(), &component); }
+    template<typename T>
+    void RemoveComponent(Entity entity) { RemoveComponentType(entity, ComponentRegistry::TypeId<T>()); }
+    template<typename T>
+    bool HasComponent(Entity entity) const { return FindComponent(entity, ComponentRegistry::TypeId<T>()) != nullptr; }
+    // Null when the entity doesn't have it
+    template<typename T>
+    const T* GetComponent(Entity entity) const { return static_cast<const T*>(FindComponent(entity, ComponentRegistry::TypeId<T>())); }
+    // Counts as a write, the chunk column is stamped with the world version
+    template<typename T>
+    T* GetMutableComponent(Entity entity) { return static_cast<T*>(FindComponent(entity, ComponentRegistry::TypeId<T>())); }
+
+    template<typename... Ts>
+    EntityQuery<Ts...> Query() { return EntityQuery<Ts...>(*this); }
+
+    // A system advances the version before it runs and keeps it, next run it only needs the chunks
+    // written after that. Writes of the system itself carry its own version and don't count
+    uint32_t Version() const noexcept { return m_Version; }
+    uint32_t AdvanceVersion() noexcept { return ++m_Version; }
+    // Wrap safe
+    static bool IsNewer(uint32_t version, uint32_t since) noexcept { return static_cast<int32_t>(version - since) > 0; }
+
+private:
+    struct EntityRecord
+    {
+        ObserverHandle<Archetype> archetype = nullptr;   // null while the slot is free
+        uint32_t chunk = 0;
+        uint32_t row = 0;
+        uint32_t generation = 0;
+    };
+
+    Entity CreateEntityFrom(ArrayIn<ComponentTypeId> ids, ArrayIn<const void*> components);
+    void AddComponentData(Entity entity, ComponentTypeId id, const void* component);
+    void RemoveComponentType(Entity entity, ComponentTypeId id);
+    const void* FindComponent(Entity entity, ComponentTypeId id) const;
+    // Stamps the chunk column with the world version
+    void* FindComponent(Entity entity, ComponentTypeId id);
+    Ref<Archetype> FindArchetype(ComponentMask mask);
+    // Components target lacks are dropped, the ones only target has are left uninitialized
+    void MoveEntity(Entity entity, Ref<Archetype> target);
+
+private:
+    std::vector<UniqueHandle<Archetype>> m_Archetypes;
+    std::unordered_map<ComponentMask, ObserverHandle<Archetype>> m_ArchetypeByMask;
+    std::vector<EntityRecord> m_Records;
+    std::vector<uint32_t> m_FreeRecords;
+    uint32_t m_EntityCount = 0;
+    uint32_t m_Version = 1;
+};
+
+template<typename... Ts>
+auto EntityQuery<Ts...>::CollectChunks() const -> std::vector<ChunkRef>
+{
+    ComponentMask required = m_Include | (ComponentRegistry::Mask<std::remove_const_t<Ts>>() | ... | 0);
+    std::vector<ChunkRef> chunks;
+    for (auto&& archetype : m_World.m_Archetypes)
+    {
+        if ((archetype->Mask() & required) != required || (archetype->Mask() & m_Exclude) != 0)
+        {
+            continue;
+        }
+
+        ChunkRef ref = { archetype.get(), 0, { archetype->ColumnOf(ComponentRegistry::TypeId<std::remove_const_t<Ts>>())... } };
+        for (ref.chunk = 0; ref.chunk < archetype->ChunkCount(); ref.chunk++)
+        {
+            if (m_ChangedFilter != 0)
+            {
+                bool changed = false;
+                auto& versions = archetype->Chunk(ref.chunk).versions;
+                for (ComponentMask bits = m_ChangedFilter; bits != 0 && !changed; bits &= bits - 1)
+                {
+                    uint8_t column = archetype->ColumnOf(static_cast<ComponentTypeId>(std::countr_zero(bits)));
+                    changed = column != Archetype::NoColumn && World::IsNewer(versions[column], m_ChangedSince);
+                }
+                if (!changed)
+                {
+                    continue;
+                }
+            }
+            chunks.emplace_back(ref);
+        }
+    }
+    return chunks;
+}
+
+template<typename... Ts>
+template<typename F, size_t... Is>
+void EntityQuery<Ts...>::RunChunk(In<ChunkRef> ref, Ref<F> func, std::index_sequence<Is...>)
+{
+    auto& chunk = ref.archetype->Chunk(ref.chunk);
+    uint32_t version = m_World.Version();
+    ((std::is_const_v<Ts> ? void() : void(chunk.versions[ref.columns[Is]] = version)), ...);
+    func(ArrayIn<Entity>(ref.archetype->Entities(ref.chunk), chunk.count),
+         std::span<Ts>(static_cast<Ts*>(ref.archetype->Column(ref.chunk, ref.columns[Is])), chunk.count)...);
+}
+}
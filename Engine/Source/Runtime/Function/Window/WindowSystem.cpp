@@ -4,12 +4,20 @@ namespace Snowy::Ark
 {
 void WindowSystem::Init(Ref<WindowSystemConfig> config) 
 {
+    m_Width  = config.width;
+    m_Height = config.height;
+    m_Headless = config.headless;
+    // Build machines may have no display server at all
+    if (m_Headless)
+    {
+        SA_LOG_INFO("Headless, {}x{} framebuffer without a window.", m_Width, m_Height);
+        return;
+    }
+
     if (!glfwInit())
     {
         return;
     }
-    m_Width  = config.width;
-    m_Height = config.height;
 
     auto backend = config.rhiBackend;
     if (backend == ERHIBackend::Vulkan)
@@ -47,6 +55,10 @@ void WindowSystem::Init(Ref<WindowSystemConfig> config)
 
 void WindowSystem::Destory()
 {
+    if (m_Headless)
+    {
+        return;
+    }
     glfwDestroyWindow(m_Handle);
     glfwTerminate();
 }
@@ -56,19 +68,41 @@ GLFWwindow* WindowSystem::GetHandle() const
     return m_Handle;
 }
 
+bool WindowSystem::IsHeadless() const
+{
+    return m_Headless;
+}
+
 void WindowSystem::PollEvents() const
 {
-    glfwPollEvents();
+    if (!m_Headless)
+    {
+        glfwPollEvents();
+    }
 }
 
 void WindowSystem::WaitEvents() const
 {
-    glfwWaitEvents();
+    if (!m_Headless)
+    {
+        glfwWaitEvents();
+    }
 }
 
 bool WindowSystem::ShouldClose() const
 {
-    return glfwWindowShouldClose(m_Handle);
+    return m_Headless ? m_ShouldClose : glfwWindowShouldClose(m_Handle);
+}
+
+void WindowSystem::SetShouldClose(bool value)
+{
+    if (m_Headless)
+    {
+        m_ShouldClose = value;
+    } else
+    {
+        glfwSetWindowShouldClose(m_Handle, value);
+    }
 }
 
 std::tuple<uint32_t, uint32_t> WindowSystem::GetWindowSize() const
@@ -78,6 +112,10 @@ std::tuple<uint32_t, uint32_t> WindowSystem::GetWindowSize() const
 
 std::tuple<uint32_t, uint32_t> WindowSystem::GetFramebufferSize() const
 {
+    if (m_Headless)
+    {
+        return std::make_tuple(m_Width, m_Height);
+    }
     int width = 0, height = 0;
     glfwGetFramebufferSize(m_Handle, &width, &height);
     return std::make_tuple(width, height);
@@ -95,7 +133,7 @@ void WindowSystem::SetFramebufferResizedToDefault()
 
 bool WindowSystem::IsMouseButtonDown(int button) const
 {
-    if (button < GLFW_MOUSE_BUTTON_1 || button > GLFW_MOUSE_BUTTON_LAST)
+    if (m_Headless || button < GLFW_MOUSE_BUTTON_1 || button > GLFW_MOUSE_BUTTON_LAST)
     {
         return false;
     }
@@ -110,11 +148,19 @@ bool WindowSystem::GetFocusMode() const
 void WindowSystem::SetFocusMode(bool mode)
 {
     m_IsFocusMode = mode;
+    if (m_Headless)
+    {
+        return;
+    }
     glfwSetInputMode(m_Handle, GLFW_CURSOR, m_IsFocusMode ? GLFW_CURSOR_DISABLED : GLFW_CURSOR_NORMAL);
 }
 
 void WindowSystem::SetTitle(const char* title)
 {
+    if (m_Headless)
+    {
+        return;
+    }
     glfwSetWindowTitle(m_Handle, title);
 }
 }
@@ -16,10 +16,13 @@ public:
     void Destory();
 
     GLFWwindow* GetHandle() const;
+    // No window is created, GLFW isn't even initialized
+    bool IsHeadless() const;
 
     void PollEvents() const;
     void WaitEvents() const;
     bool ShouldClose() const;
+    void SetShouldClose(bool value);
 
     std::tuple<uint32_t, uint32_t> GetWindowSize() const;
     std::tuple<uint32_t, uint32_t> GetFramebufferSize() const;
@@ -196,11 +199,13 @@ protected:
     }
 
 private:
-    GLFWwindow* m_Handle;
+    GLFWwindow* m_Handle = nullptr;
     uint32_t m_Width;
     uint32_t m_Height;
     bool m_IsFocusMode = false;
     bool m_FramebufferResized = false;
+    bool m_Headless = false;
+    bool m_ShouldClose = false;     // only for headless, a window keeps it in GLFW
 
     // Window Events
     /*------------------------------------------------------------------------------*/
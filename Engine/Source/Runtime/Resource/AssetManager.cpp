@@ -1,12 +1,14 @@
 ﻿#include "AssetManager.h"
 #include "Engine/Source/Runtime/Core/Log/Logger.h"
+#include "Engine/Source/Runtime/Function/Global/GlobalContext.h"
 
+#include <chrono>
 #include <fstream>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include<stb/stb_image.h>
-//#define TINYOBJLOADER_IMPLEMENTATION
-//#include<tinyobjloader/tiny_obj_loader.h>
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb/stb_image_write.h>
 
 namespace Snowy::Ark
 {
@@ -44,4 +46,95 @@ UniqueHandle<TextureData> AssetManager::LoadTexture(std::filesystem::path path)
     }
     return data;
 }
+
+UniqueHandle<TextureAsset> AssetManager::LoadTextureAsset(std::filesystem::path path, ETextureFormat format)
+{
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    auto cookedPath = CookedTexturePath(path, format);
+    if (!TextureCooker::IsUpToDate(path, cookedPath, format) && !TextureCooker::Cook(path, cookedPath, format))
+    {
+        SA_LOG_ERROR("Failed to cook texture: {}", PATH_TO_SSTR(path));
+        return nullptr;
+    }
+    auto texture = MakeUnique<TextureAsset>();
+    if (!texture->Open(cookedPath))
+    {
+        SA_LOG_ERROR("Failed to load texture: {}", PATH_TO_SSTR(cookedPath));
+        return nullptr;
+    }
+
+    auto loadTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+    SA_LOG_INFO("Load Texture {}, {}x{}, {} mips, {} in {:.2f} ms.", PATH_TO_SSTR(path.filename()), texture->Header().width,
+                texture->Header().height, texture->MipCount(), TextureEncoder::Name(texture->Format()), loadTime);
+    return texture;
+}
+
+UniqueHandle<MeshAsset> AssetManager::LoadModel(std::filesystem::path path)
+{
+    auto cookedPath = CookedMeshPath(path);
+    if (!MeshCooker::IsUpToDate(path, cookedPath) && !MeshCooker::CookObj(path, cookedPath))
+    {
+        SA_LOG_ERROR("Failed to cook model: {}", PATH_TO_SSTR(path));
+        return nullptr;
+    }
+    auto mesh = MakeUnique<MeshAsset>();
+    if (!mesh->Open(cookedPath))
+    {
+        SA_LOG_ERROR("Failed to load model: {}", PATH_TO_SSTR(cookedPath));
+        return nullptr;
+    }
+
+    SA_LOG_INFO("Load Model {}, {} vertices, {} indices.", PATH_TO_SSTR(path.filename()), mesh->VertexCount(), mesh->Indices().size());
+    return mesh;
+}
+
+JobFuture<std::vector<char>> AssetManager::LoadShaderAsync(std::filesystem::path path)
+{
+    return g_RuntimeContext.jobSys->Async([this, path]() { return LoadSpirvShaderBinary(path); });
+}
+
+JobFuture<UniqueHandle<TextureData>> AssetManager::LoadTextureAsync(std::filesystem::path path)
+{
+    return g_RuntimeContext.jobSys->Async([this, path]() { return LoadTexture(path); });
+}
+
+JobFuture<UniqueHandle<TextureAsset>> AssetManager::LoadTextureAssetAsync(std::filesystem::path path, ETextureFormat format)
+{
+    return g_RuntimeContext.jobSys->Async([this, path, format]() { return LoadTextureAsset(path, format); });
+}
+
+JobFuture<UniqueHandle<MeshAsset>> AssetManager::LoadModelAsync(std::filesystem::path path)
+{
+    return g_RuntimeContext.jobSys->Async([this, path]() { return LoadModel(path); });
+}
+
+bool AssetManager::SaveImage(In<std::filesystem::path> path, ArrayIn<uint8_t> texels, uint32_t width, uint32_t height)
+{
+    std::error_code error;
+    std::filesystem::create_directories(path.parent_path(), error);
+    int stride = static_cast<int>(width * 4);
+    if (!stbi_write_png(path.string().c_str(), static_cast<int>(width), static_cast<int>(height), STBI_rgb_alpha, texels.data(), stride))
+    {
+        SA_LOG_ERROR("Failed to save image: {}", PATH_TO_SSTR(path));
+        return false;
+    }
+    return true;
+}
+
+std::filesystem::path AssetManager::CookedMeshPath(In<std::filesystem::path> path) const
+{
+    auto fileName = path.stem();
+    fileName += ".samesh";
+    return std::filesystem::path(SA_ENGINE_PATH("Engine/Intermediate/Mesh/")) / fileName;
+}
+
+std::filesystem::path AssetManager::CookedTexturePath(In<std::filesystem::path> path, ETextureFormat format) const
+{
+    auto fileName = path.stem();
+    fileName += ".";
+    fileName += TextureEncoder::Name(format);
+    fileName += ".satex";
+    return std::filesystem::path(SA_ENGINE_PATH("Engine/Intermediate/Texture/")) / fileName;
+}
 }
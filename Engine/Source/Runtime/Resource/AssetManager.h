@@ -1,6 +1,9 @@
 ﻿#pragma once
 #include "Engine/Source/Runtime/Core/Base/Common.h"
+#include "Engine/Source/Runtime/Core/Job/JobSystem.h"
 #include "Engine/Source/Runtime/Function/Rendering/Interface/RHITexture.h"
+#include "Engine/Source/Runtime/Resource/MeshAsset.h"
+#include "Engine/Source/Runtime/Resource/TextureAsset.h"
 #include <filesystem>
 
 namespace Snowy::Ark
@@ -21,7 +24,24 @@ public:
 public:
     std::vector<char> LoadSpirvShaderBinary(std::filesystem::path path);
     UniqueHandle<TextureData> LoadTexture(std::filesystem::path path);
-    void LoadModel(std::filesystem::path path);
+    // Maps the cooked mip chain, the source is cooked to format first when the cooked file is missing or stale
+    UniqueHandle<TextureAsset> LoadTextureAsset(std::filesystem::path path, ETextureFormat format = ETextureFormat::RGBA8);
+    // Maps the cooked mesh, the source is cooked first when the cooked file is missing or stale
+    UniqueHandle<MeshAsset> LoadModel(std::filesystem::path path);
+    // Same loads run as jobs, so every asset of a scene decodes at once. Cooking still spreads over the
+    // job system from inside the job, the futures can be waited on from any thread
+    JobFuture<std::vector<char>> LoadShaderAsync(std::filesystem::path path);
+    JobFuture<UniqueHandle<TextureData>> LoadTextureAsync(std::filesystem::path path);
+    JobFuture<UniqueHandle<TextureAsset>> LoadTextureAssetAsync(std::filesystem::path path, ETextureFormat format = ETextureFormat::RGBA8);
+    JobFuture<UniqueHandle<MeshAsset>> LoadModelAsync(std::filesystem::path path);
+
+    // Writes RGBA8 texels as a PNG, the directories are created when missing
+    bool SaveImage(In<std::filesystem::path> path, ArrayIn<uint8_t> texels, uint32_t width, uint32_t height);
+
+    std::filesystem::path CookedMeshPath(In<std::filesystem::path> path) const;
+
+    // One cooked file per format, <stem>.<format>.satex
+    std::filesystem::path CookedTexturePath(In<std::filesystem::path> path, ETextureFormat format) const;
 
 
 public:
@@ -0,0 +1,269 @@
+﻿#include "MeshAsset.h"
+#include "Engine/Source/Runtime/Core/Log/Logger.h"
+#include "Engine/Source/Runtime/Resource/ObjImporter.h"
+#include "Engine/Source/Runtime/Resource/MeshOptimizer.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+
+namespace Snowy::Ark
+{
+namespace
+{
+uint64_t AlignUp(uint64_t value, uint64_t alignment) noexcept
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+int64_t SourceWriteTime(In<std::filesystem::path> path, Ref<std::error_code> error)
+{
+    return static_cast<int64_t>(std::filesystem::last_write_time(path, error).time_since_epoch().count());
+}
+}
+
+bool MeshAsset::Open(In<std::filesystem::path> path)
+{
+    if (!m_File.Open(path))
+    {
+        return false;
+    }
+    if (m_File.Size() < sizeof(MeshFileHeader))
+    {
+        SA_LOG_WARN("Cooked mesh is truncated: {}", PATH_TO_SSTR(path));
+        m_File.Close();
+        return false;
+    }
+    std::memcpy(&m_Header, m_File.Data(), sizeof(MeshFileHeader));
+
+    if (m_Header.magic != MeshFileHeader::Magic || m_Header.version != MeshFileHeader::Version ||
+        m_Header.indexStride != sizeof(uint32_t) || m_Header.vertexStreamLayout != static_cast<uint32_t>(MeshCooker::StreamLayout))
+    {
+        SA_LOG_INFO("Cooked mesh has an outdated format: {}", PATH_TO_SSTR(path));
+        m_File.Close();
+        return false;
+    }
+    auto layoutBytes = m_Header.vertexBindingCount * sizeof(VertexStreamBinding) + m_Header.vertexAttributeCount * sizeof(VertexStreamAttribute);
+    auto indexBytes = m_Header.indexCount * m_Header.indexStride;
+    auto lodBytes = m_Header.lodCount * sizeof(MeshLod);
+    if (m_Header.vertexLayoutOffset % MeshFileHeader::StreamAlignment != 0 || m_Header.vertexDataOffset % MeshFileHeader::StreamAlignment != 0 ||
+        m_Header.indexDataOffset % MeshFileHeader::StreamAlignment != 0 || m_Header.lodDataOffset % MeshFileHeader::StreamAlignment != 0 ||
+        m_Header.lodCount == 0 || m_Header.vertexBindingCount == 0 ||
+        m_Header.vertexLayoutOffset + layoutBytes > m_File.Size() || m_Header.vertexDataOffset + m_Header.vertexDataSize > m_File.Size() ||
+        m_Header.indexDataOffset + indexBytes > m_File.Size() || m_Header.lodDataOffset + lodBytes > m_File.Size())
+    {
+        SA_LOG_WARN("Cooked mesh is corrupted: {}", PATH_TO_SSTR(path));
+        m_File.Close();
+        return false;
+    }
+
+    auto layoutData = m_File.Data() + m_Header.vertexLayoutOffset;
+    m_VertexBindings = ArrayIn<VertexStreamBinding>(reinterpret_cast<const VertexStreamBinding*>(layoutData), m_Header.vertexBindingCount);
+    m_VertexAttributes = ArrayIn<VertexStreamAttribute>(reinterpret_cast<const VertexStreamAttribute*>(layoutData + m_Header.vertexBindingCount * sizeof(VertexStreamBinding)),
+                                                        m_Header.vertexAttributeCount);
+    for (auto&& binding : m_VertexBindings)
+    {
+        if (binding.offset + static_cast<uint64_t>(binding.stride) * m_Header.vertexCount > m_Header.vertexDataSize)
+        {
+            SA_LOG_WARN("Cooked mesh is corrupted: {}", PATH_TO_SSTR(path));
+            m_File.Close();
+            return false;
+        }
+    }
+    m_VertexData = ArrayIn<uint8_t>(reinterpret_cast<const uint8_t*>(m_File.Data() + m_Header.vertexDataOffset), m_Header.vertexDataSize);
+    m_Indices = ArrayIn<uint32_t>(reinterpret_cast<const uint32_t*>(m_File.Data() + m_Header.indexDataOffset), m_Header.indexCount);
+    m_Lods = ArrayIn<MeshLod>(reinterpret_cast<const MeshLod*>(m_File.Data() + m_Header.lodDataOffset), m_Header.lodCount);
+    return true;
+}
+
+glm::mat4 MeshAsset::PositionDequantization() const noexcept
+{
+    auto position = std::ranges::find(m_VertexAttributes, EVertexAttribute::Position, &VertexStreamAttribute::attribute);
+    if (position == m_VertexAttributes.end() || position->format != EVertexAttributeFormat::Unorm16x4)
+    {
+        return glm::mat4(1.0f);
+    }
+    return Mesh::PositionDequantization(m_Header.positionMin, m_Header.positionExtent);
+}
+
+std::vector<glm::vec3> MeshAsset::DecodePositions() const
+{
+    std::vector<glm::vec3> positions;
+    auto position = std::ranges::find(m_VertexAttributes, EVertexAttribute::Position, &VertexStreamAttribute::attribute);
+    if (position == m_VertexAttributes.end())
+    {
+        return positions;
+    }
+
+    positions.resize(VertexCount());
+    auto& binding = m_VertexBindings[position->binding];
+    auto src = m_VertexData.data() + binding.offset + position->offset;
+    for (auto&& pos : positions)
+    {
+        if (position->format == EVertexAttributeFormat::Unorm16x4)
+        {
+            uint64_t packed;
+            std::memcpy(&packed, src, sizeof(packed));
+            pos = m_Header.positionMin + glm::vec3(glm::unpackUnorm4x16(packed)) * m_Header.positionExtent;
+        } else
+        {
+            std::memcpy(&pos, src, sizeof(pos));
+        }
+        src += binding.stride;
+    }
+    return positions;
+}
+
+bool MeshCooker::IsUpToDate(In<std::filesystem::path> sourcePath, In<std::filesystem::path> cookedPath)
+{
+    std::ifstream file(cookedPath, std::ios::binary);
+    MeshFileHeader header;
+    if (!file.is_open() || !file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+    {
+        return false;
+    }
+    std::error_code error;
+    auto sourceSize = std::filesystem::file_size(sourcePath, error);
+    auto sourceWriteTime = SourceWriteTime(sourcePath, error);
+    if (error)
+    {
+        // Shipped without sources, the cooked file is all there is
+        return true;
+    }
+    return header.magic == MeshFileHeader::Magic && header.version == MeshFileHeader::Version &&
+           header.sourceSize == sourceSize && header.sourceWriteTime == sourceWriteTime;
+}
+
+bool MeshCooker::CookObj(In<std::filesystem::path> sourcePath, In<std::filesystem::path> cookedPath)
+{
+    std::vector<MeshVertex> vertices;
+    std::vector<uint32_t> indices;
+    if (!ObjImporter::Import(sourcePath, &vertices, &indices))
+    {
+        return false;
+    }
+    Optimize(&vertices, &indices);
+    auto lods = GenerateLods(vertices, &indices);
+    Mesh mesh;
+    auto streams = BuildVertexStreams(vertices, &mesh);
+
+    std::error_code error;
+    MeshFileHeader header = {
+        .magic = MeshFileHeader::Magic,
+        .version = MeshFileHeader::Version,
+        .indexStride = sizeof(uint32_t),
+        .vertexBindingCount = static_cast<uint32_t>(streams.bindings.size()),
+        .vertexAttributeCount = static_cast<uint32_t>(streams.attributes.size()),
+        .vertexStreamLayout = static_cast<uint32_t>(StreamLayout),
+        .vertexCount = vertices.size(),
+        .indexCount = indices.size(),
+        .vertexDataSize = streams.data.size(),
+        .lodCount = lods.size(),
+        .sourceSize = std::filesystem::file_size(sourcePath, error),
+        .sourceWriteTime = SourceWriteTime(sourcePath, error),
+        .positionMin = mesh.PositionMin(),
+        .positionExtent = mesh.PositionExtent(),
+    };
+    auto bindingBytes = streams.bindings.size() * sizeof(VertexStreamBinding);
+    auto attributeBytes = streams.attributes.size() * sizeof(VertexStreamAttribute);
+    header.vertexLayoutOffset = AlignUp(sizeof(MeshFileHeader), MeshFileHeader::StreamAlignment);
+    header.vertexDataOffset = AlignUp(header.vertexLayoutOffset + bindingBytes + attributeBytes, MeshFileHeader::StreamAlignment);
+    header.indexDataOffset = AlignUp(header.vertexDataOffset + streams.data.size(), MeshFileHeader::StreamAlignment);
+    header.lodDataOffset = AlignUp(header.indexDataOffset + indices.size() * sizeof(uint32_t), MeshFileHeader::StreamAlignment);
+
+    // Written aside and renamed so a crash never leaves a truncated mesh behind
+    std::filesystem::create_directories(cookedPath.parent_path(), error);
+    auto tempPath = cookedPath;
+    tempPath += ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            SA_LOG_WARN("Failed to write cooked mesh: {}", PATH_TO_SSTR(tempPath));
+            return false;
+        }
+        std::array<char, MeshFileHeader::StreamAlignment> padding = {};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(padding.data(), static_cast<std::streamsize>(header.vertexLayoutOffset - sizeof(header)));
+        file.write(reinterpret_cast<const char*>(streams.bindings.data()), static_cast<std::streamsize>(bindingBytes));
+        file.write(reinterpret_cast<const char*>(streams.attributes.data()), static_cast<std::streamsize>(attributeBytes));
+        file.write(padding.data(), static_cast<std::streamsize>(header.vertexDataOffset - header.vertexLayoutOffset - bindingBytes - attributeBytes));
+        file.write(reinterpret_cast<const char*>(streams.data.data()), static_cast<std::streamsize>(streams.data.size()));
+        file.write(padding.data(), static_cast<std::streamsize>(header.indexDataOffset - header.vertexDataOffset - streams.data.size()));
+        file.write(reinterpret_cast<const char*>(indices.data()), static_cast<std::streamsize>(indices.size() * sizeof(uint32_t)));
+        file.write(padding.data(), static_cast<std::streamsize>(header.lodDataOffset - header.indexDataOffset - indices.size() * sizeof(uint32_t)));
+        file.write(reinterpret_cast<const char*>(lods.data()), static_cast<std::streamsize>(lods.size() * sizeof(MeshLod)));
+    }
+    std::filesystem::rename(tempPath, cookedPath, error);
+    if (error)
+    {
+        SA_LOG_WARN("Failed to write cooked mesh: {}", PATH_TO_SSTR(cookedPath));
+        return false;
+    }
+    SA_LOG_INFO("Cook Mesh, {} vertices({} bytes of vertex streams), {} indices, {} LODs.", vertices.size(), streams.data.size(), indices.size(), lods.size());
+    return true;
+}
+
+void MeshCooker::Optimize(Out<std::vector<MeshVertex>> vertices, Out<std::vector<uint32_t>> indices)
+{
+    uint32_t vertexCount = static_cast<uint32_t>(vertices->size());
+    auto before = MeshOptimizer::AnalyzeVertexCache(*indices, vertexCount);
+
+    *indices = MeshOptimizer::OptimizeVertexCache(*indices, vertexCount);
+    std::vector<glm::vec3> positions(vertexCount);
+    std::ranges::transform(*vertices, positions.begin(), [](const MeshVertex& vertex) { return vertex.position; });
+    *indices = MeshOptimizer::OptimizeOverdraw(*indices, positions);
+
+    auto remap = MeshOptimizer::BuildVertexFetchRemap(*indices, vertexCount);
+    MeshOptimizer::RemapIndices(*indices, remap);
+    MeshOptimizer::RemapVertices(*vertices, remap);
+
+    auto after = MeshOptimizer::AnalyzeVertexCache(*indices, vertexCount);
+    SA_LOG_INFO("Optimize Mesh, ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}.", before.acmr, after.acmr, before.atvr, after.atvr);
+}
+
+std::vector<MeshLod> MeshCooker::GenerateLods(ArrayIn<MeshVertex> vertices, Out<std::vector<uint32_t>> indices)
+{
+    std::vector<glm::vec3> positions(vertices.size());
+    std::ranges::transform(vertices, positions.begin(), [](const MeshVertex& vertex) { return vertex.position; });
+    glm::vec3 minPos(std::numeric_limits<float>::max());
+    glm::vec3 maxPos(std::numeric_limits<float>::lowest());
+    for (auto&& position : positions)
+    {
+        minPos = glm::min(minPos, position);
+        maxPos = glm::max(maxPos, position);
+    }
+    float targetError = positions.empty() ? 0.0f : LodTargetError * glm::length(maxPos - minPos);
+
+    auto lods = MeshOptimizer::BuildLods(*indices, positions, LodRatios, targetError);
+    for (size_t i = 1; i < lods.size(); i++)
+    {
+        SA_LOG_INFO("Mesh LOD {}, {} triangles, error {:.5f}.", i, lods[i].indexCount / 3, lods[i].error);
+    }
+    return lods;
+}
+
+VertexStreams MeshCooker::BuildVertexStreams(ArrayIn<MeshVertex> vertices, Out<Mesh> mesh)
+{
+    std::vector<glm::vec3> positions(vertices.size());
+    std::vector<glm::vec4> colors(vertices.size());
+    std::vector<glm::vec2> texcoords(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        positions[i] = vertices[i].position;
+        colors[i] = glm::vec4(vertices[i].color, 1.0f);
+        texcoords[i] = vertices[i].texcoord;
+    }
+
+    // Positions are dequantized through ObjectToWorld at runtime
+    mesh->SetPositions(std::move(positions));
+    mesh->SetColors(std::move(colors));
+    mesh->SetTexcoords(0, std::move(texcoords));
+    mesh->SetAttributeFormat(EVertexAttribute::Position, PositionFormat);
+    mesh->SetAttributeFormat(EVertexAttribute::Color, ColorFormat);
+    mesh->SetAttributeFormat(EVertexAttribute::Texcoord, TexcoordFormat);
+    return mesh->BuildVertexStreams(StreamLayout);
+}
+}
@@ -0,0 +1,122 @@
+﻿#pragma once
+#include "Engine/Source/Runtime/Core/Base/Common.h"
+#include "Engine/Source/Runtime/Core/File/MappedFile.h"
+#include "Engine/Source/Runtime/Function/Rendering/Mesh.h"
+#include "Engine/Source/Runtime/Resource/MeshOptimizer.h"
+
+#include <glm/glm.hpp>
+
+namespace Snowy::Ark
+{
+// Vertex of the import, quantized into the GPU vertex streams by the cooker
+struct MeshVertex
+{
+    glm::vec3 position;
+    glm::vec3 color;
+    glm::vec2 texcoord;
+};
+
+/// <summary>
+/// Cooked mesh file: header followed by the finished GPU vertex streams(VertexStreams::data) and the
+/// index stream, both aligned to StreamAlignment so they can be uploaded straight from a mapping of
+/// the file. The vertex layout(bindings then attributes) describes the streams, positions are
+/// dequantized with positionMin/positionExtent. The index stream holds every LOD back to back,
+/// the LOD table comes last. The source size and write time are kept to detect a stale cook.
+/// </summary>
+struct MeshFileHeader
+{
+    static constexpr uint32_t Magic = 0x484D4153;   // "SAMH"
+    // 2: index/vertex order optimized by MeshOptimizer, 3: LOD table, 4: quantized vertex streams and their layout
+    static constexpr uint32_t Version = 4;
+    static constexpr uint64_t StreamAlignment = 16;
+
+    uint32_t magic;
+    uint32_t version;
+    uint32_t indexStride;
+    uint32_t vertexBindingCount;
+    uint32_t vertexAttributeCount;
+    uint32_t vertexStreamLayout;     // EVertexStreamLayout
+    uint64_t vertexCount;
+    uint64_t indexCount;
+    uint64_t vertexLayoutOffset;
+    uint64_t vertexDataOffset;
+    uint64_t vertexDataSize;
+    uint64_t indexDataOffset;
+    uint64_t lodCount;
+    uint64_t lodDataOffset;
+    uint64_t sourceSize;
+    int64_t sourceWriteTime;
+    glm::vec3 positionMin;
+    glm::vec3 positionExtent;
+};
+
+/// <summary>
+/// Read-only view of a cooked mesh, the streams point into the file mapping
+/// and stay valid for the lifetime of the asset.
+/// </summary>
+class MeshAsset
+{
+public:
+    MeshAsset() = default;
+    ~MeshAsset() = default;
+    MeshAsset(const MeshAsset&) = delete;
+    MeshAsset(MeshAsset&&) = delete;
+    MeshAsset& operator=(const MeshAsset&) = delete;
+    MeshAsset& operator=(MeshAsset&&) = delete;
+
+    // Fails on a missing, truncated or outdated file
+    bool Open(In<std::filesystem::path> path);
+
+    In<MeshFileHeader> Header() const noexcept { return m_Header; }
+    uint32_t VertexCount() const noexcept { return static_cast<uint32_t>(m_Header.vertexCount); }
+    // Every stream of VertexBindings at its binding offset, ready for a single vertex buffer
+    ArrayIn<uint8_t> VertexData() const noexcept { return m_VertexData; }
+    ArrayIn<VertexStreamBinding> VertexBindings() const noexcept { return m_VertexBindings; }
+    ArrayIn<VertexStreamAttribute> VertexAttributes() const noexcept { return m_VertexAttributes; }
+    glm::mat4 PositionDequantization() const noexcept;
+    // Mesh space positions as the GPU decodes them, for CPU side bounds(culling, meshlets)
+    std::vector<glm::vec3> DecodePositions() const;
+    // Every LOD, ranges are given by Lods
+    ArrayIn<uint32_t> Indices() const noexcept { return m_Indices; }
+    ArrayIn<MeshLod> Lods() const noexcept { return m_Lods; }
+
+private:
+    MappedFile m_File;
+    MeshFileHeader m_Header = {};
+    ArrayIn<uint8_t> m_VertexData;
+    ArrayIn<VertexStreamBinding> m_VertexBindings;
+    ArrayIn<VertexStreamAttribute> m_VertexAttributes;
+    ArrayIn<uint32_t> m_Indices;
+    ArrayIn<MeshLod> m_Lods;
+};
+
+/// <summary>
+/// Converts source meshes(OBJ) into the cooked format, run at first load or when the source changed.
+/// Vertices are deduplicated, triangles reordered for the post-transform cache and overdraw,
+/// then vertices ordered by first use in the index stream. LODs are simplified from LOD 0.
+/// The vertices are finally quantized into the GPU vertex streams, 16 bytes per vertex instead of 32.
+/// </summary>
+class MeshCooker
+{
+public:
+    static constexpr std::array LodRatios = { 0.5f, 0.25f, 0.125f, 0.0625f };
+    static constexpr float LodTargetError = 0.02f;     // relative to the bounds diagonal
+
+    static constexpr EVertexStreamLayout StreamLayout = EVertexStreamLayout::PositionInterleaved;
+    static constexpr EVertexAttributeFormat PositionFormat = EVertexAttributeFormat::Unorm16x4;
+    static constexpr EVertexAttributeFormat ColorFormat = EVertexAttributeFormat::Unorm8x4;
+    static constexpr EVertexAttributeFormat TexcoordFormat = EVertexAttributeFormat::Float16x2;
+
+public:
+    static bool IsUpToDate(In<std::filesystem::path> sourcePath, In<std::filesystem::path> cookedPath);
+    static bool CookObj(In<std::filesystem::path> sourcePath, In<std::filesystem::path> cookedPath);
+
+private:
+    // Vertex cache, overdraw and vertex fetch order, logs the simulated ACMR/ATVR before and after
+    static void Optimize(Out<std::vector<MeshVertex>> vertices, Out<std::vector<uint32_t>> indices);
+    // Appends the LODs to indices, returns the LOD table
+    static std::vector<MeshLod> GenerateLods(ArrayIn<MeshVertex> vertices, Out<std::vector<uint32_t>> indices);
+    // Quantized streams in the cooked formats, the dequantization range is kept by the mesh
+    static VertexStreams BuildVertexStreams(ArrayIn<MeshVertex> vertices, Out<Mesh> mesh);
+};
+}
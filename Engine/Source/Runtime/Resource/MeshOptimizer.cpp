@@ -0,0 +1,959 @@
+﻿#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace Snowy::Ark
+{
+namespace
+{
+constexpr float ForsythCacheDecayPower = 1.5f;
+constexpr float ForsythLastTriangleScore = 0.75f;
+constexpr float ForsythValenceBoostScale = 2.0f;
+constexpr float ForsythValenceBoostPower = 0.5f;
+
+float ForsythVertexScore(int32_t cachePosition, uint32_t liveTriangleCount) noexcept
+{
+    if (liveTriangleCount == 0)
+    {
+        return -1.0f;
+    }
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+        // The last triangle's vertices get a fixed score so the next triangle doesn't just reuse them
+        if (cachePosition < 3)
+        {
+            score = ForsythLastTriangleScore;
+        } else
+        {
+            float scale = 1.0f / (MeshOptimizer::ForsythCacheSize - 3);
+            score = std::pow(1.0f - (cachePosition - 3) * scale, ForsythCacheDecayPower);
+        }
+    }
+    // Vertices with few triangles left are finished first so they leave the cache for good
+    score += ForsythValenceBoostScale * std::pow(static_cast<float>(liveTriangleCount), -ForsythValenceBoostPower);
+    return score;
+}
+
+/// <summary>
+/// FIFO cache simulation, a vertex is cached while fewer than cacheSize misses happened since its own
+/// </summary>
+class FifoCache
+{
+public:
+    FifoCache(uint32_t vertexCount, uint32_t cacheSize) : m_Timestamps(vertexCount, 0), m_CacheSize(cacheSize), m_Time(cacheSize + 1) {}
+
+    // Returns the misses of the triangle
+    uint32_t Access(const uint32_t* triangle) noexcept
+    {
+        uint32_t misses = 0;
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            auto& timestamp = m_Timestamps[triangle[i]];
+            if (m_Time - timestamp > m_CacheSize)
+            {
+                timestamp = m_Time++;
+                misses++;
+            }
+        }
+        return misses;
+    }
+    // Forgets everything, as if other geometry was drawn in between
+    void Reset() noexcept { m_Time += m_CacheSize + 1; }
+
+private:
+    std::vector<uint32_t> m_Timestamps;
+    uint32_t m_CacheSize;
+    uint32_t m_Time;
+};
+
+/// <summary>
+/// Sum of squared distances to area weighted planes, the distance of a point is sqrt(Evaluate / weight)
+/// </summary>
+struct Quadric
+{
+    double a00 = 0.0, a11 = 0.0, a22 = 0.0, a10 = 0.0, a20 = 0.0, a21 = 0.0;
+    double b0 = 0.0, b1 = 0.0, b2 = 0.0, c = 0.0;
+    double weight = 0.0;
+
+    static Quadric FromPlane(glm::dvec3 normal, double distance, double weight) noexcept
+    {
+        Quadric quadric;
+        quadric.a00 = normal.x * normal.x * weight;
+        quadric.a11 = normal.y * normal.y * weight;
+        quadric.a22 = normal.z * normal.z * weight;
+        quadric.a10 = normal.y * normal.x * weight;
+        quadric.a20 = normal.z * normal.x * weight;
+        quadric.a21 = normal.z * normal.y * weight;
+        quadric.b0 = normal.x * distance * weight;
+        quadric.b1 = normal.y * distance * weight;
+        quadric.b2 = normal.z * distance * weight;
+        quadric.c = distance * distance * weight;
+        quadric.weight = weight;
+        return quadric;
+    }
+
+    Quadric& operator+=(const Quadric& other) noexcept
+    {
+        a00 += other.a00; a11 += other.a11; a22 += other.a22;
+        a10 += other.a10; a20 += other.a20; a21 += other.a21;
+        b0 += other.b0; b1 += other.b1; b2 += other.b2;
+        c += other.c;
+        weight += other.weight;
+        return *this;
+    }
+
+    // Mean squared distance of the point to the planes
+    float Error(glm::vec3 point) const noexcept
+    {
+        double x = point.x, y = point.y, z = point.z;
+        double result = a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a10 * x * y + a20 * x * z + a21 * y * z) +
+                        2.0 * (b0 * x + b1 * y + b2 * z) + c;
+        return weight > 0.0 ? static_cast<float>(std::max(result, 0.0) / weight) : 0.0f;
+    }
+};
+
+enum class ESimplifyVertexKind : uint8_t
+{
+    Manifold,   // single wedge, every edge shared
+    Seam,       // two wedges with a seam edge in and out, collapses along the seam only
+    Locked,     // border, seam corner or anything else that would tear the mesh
+};
+
+// Triangle corner of a vertex, the other two vertices in winding order
+struct SimplifyCorner
+{
+    uint32_t next;
+    uint32_t prev;
+};
+}
+
+std::vector<uint32_t> MeshOptimizer::OptimizeVertexCache(ArrayIn<uint32_t> indices, uint32_t vertexCount)
+{
+    uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+
+    // Triangles of each vertex, the live ones are kept at the front of the vertex's range
+    std::vector<uint32_t> liveTriangleCounts(vertexCount, 0);
+    for (auto index : indices)
+    {
+        liveTriangleCounts[index]++;
+    }
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (uint32_t vertex = 0; vertex < vertexCount; vertex++)
+    {
+        adjacencyOffsets[vertex + 1] = adjacencyOffsets[vertex] + liveTriangleCounts[vertex];
+    }
+    std::vector<uint32_t> adjacency(indices.size());
+    {
+        std::vector<uint32_t> cursors(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (uint32_t i = 0; i < indices.size(); i++)
+        {
+            adjacency[cursors[indices[i]]++] = i / 3;
+        }
+    }
+
+    std::vector<int32_t> cachePositions(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (uint32_t vertex = 0; vertex < vertexCount; vertex++)
+    {
+        vertexScores[vertex] = ForsythVertexScore(-1, liveTriangleCounts[vertex]);
+    }
+    std::vector<float> triangleScores(triangleCount);
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    uint32_t bestTriangle = triangleCount > 0 ? 0 : UINT32_MAX;
+    for (uint32_t triangle = 0; triangle < triangleCount; triangle++)
+    {
+        triangleScores[triangle] = vertexScores[indices[triangle * 3]] + vertexScores[indices[triangle * 3 + 1]] + vertexScores[indices[triangle * 3 + 2]];
+        if (triangleScores[triangle] > triangleScores[bestTriangle])
+        {
+            bestTriangle = triangle;
+        }
+    }
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    std::array<uint32_t, ForsythCacheSize + 3> cache;
+    std::array<uint32_t, ForsythCacheSize + 3> newCache;
+    uint32_t cacheCount = 0;
+    uint32_t scanCursor = 0;
+
+    while (bestTriangle != UINT32_MAX)
+    {
+        const uint32_t* triangle = &indices[bestTriangle * 3];
+        emitted[bestTriangle] = 1;
+        result.insert(result.end(), triangle, triangle + 3);
+
+        // Emitted triangle goes past the live range of its vertices
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            auto vertex = triangle[i];
+            auto live = adjacency.begin() + adjacencyOffsets[vertex];
+            auto it = std::find(live, live + liveTriangleCounts[vertex], bestTriangle);
+            std::iter_swap(it, live + liveTriangleCounts[vertex] - 1);
+            liveTriangleCounts[vertex]--;
+        }
+
+        // LRU: the triangle's vertices move to the front, the overflow is evicted
+        uint32_t newCacheCount = 0;
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            newCache[newCacheCount++] = triangle[i];
+        }
+        for (uint32_t i = 0; i < cacheCount; i++)
+        {
+            auto vertex = cache[i];
+            if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+            {
+                newCache[newCacheCount++] = vertex;
+            }
+        }
+
+        for (uint32_t i = 0; i < newCacheCount; i++)
+        {
+            auto vertex = newCache[i];
+            int32_t cachePosition = i < ForsythCacheSize ? static_cast<int32_t>(i) : -1;
+            cachePositions[vertex] = cachePosition;
+            float score = ForsythVertexScore(cachePosition, liveTriangleCounts[vertex]);
+            float delta = score - vertexScores[vertex];
+            vertexScores[vertex] = score;
+            for (uint32_t j = 0; j < liveTriangleCounts[vertex]; j++)
+            {
+                triangleScores[adjacency[adjacencyOffsets[vertex] + j]] += delta;
+            }
+        }
+        cacheCount = std::min(newCacheCount, ForsythCacheSize);
+        std::swap(cache, newCache);
+
+        // Next triangle among the ones touching the cache, a linear scan only when the cache is exhausted
+        bestTriangle = UINT32_MAX;
+        float bestScore = -1.0f;
+        for (uint32_t i = 0; i < cacheCount; i++)
+        {
+            auto vertex = cache[i];
+            for (uint32_t j = 0; j < liveTriangleCounts[vertex]; j++)
+            {
+                auto candidate = adjacency[adjacencyOffsets[vertex] + j];
+                if (triangleScores[candidate] > bestScore)
+                {
+                    bestScore = triangleScores[candidate];
+                    bestTriangle = candidate;
+                }
+            }
+        }
+        if (bestTriangle == UINT32_MAX)
+        {
+            while (scanCursor < triangleCount && emitted[scanCursor])
+            {
+                scanCursor++;
+            }
+            bestTriangle = scanCursor < triangleCount ? scanCursor : UINT32_MAX;
+        }
+    }
+    return result;
+}
+
+std::vector<uint32_t> MeshOptimizer::OptimizeOverdraw(ArrayIn<uint32_t> indices, ArrayIn<glm::vec3> positions, float threshold)
+{
+    uint32_t vertexCount = static_cast<uint32_t>(positions.size());
+    uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+    if (triangleCount == 0)
+    {
+        return { indices.begin(), indices.end() };
+    }
+
+    // Hard boundaries where the cache restarts(a triangle missing all its vertices)
+    std::vector<uint32_t> hardBoundaries;
+    {
+        FifoCache cache(vertexCount, AnalyzeCacheSize);
+        for (uint32_t triangle = 0; triangle < triangleCount; triangle++)
+        {
+            if (cache.Access(&indices[triangle * 3]) == 3)
+            {
+                hardBoundaries.emplace_back(triangle);
+            }
+        }
+        hardBoundaries.emplace_back(triangleCount);
+    }
+
+    // Soft boundaries split a cluster as soon as the part so far stays within threshold of the cluster's
+    // own ACMR, the cache is reset at every boundary since clusters may end up anywhere after sorting
+    std::vector<uint32_t> clusterStarts;
+    {
+        FifoCache cache(vertexCount, AnalyzeCacheSize);
+        for (size_t i = 0; i + 1 < hardBoundaries.size(); i++)
+        {
+            uint32_t begin = hardBoundaries[i], end = hardBoundaries[i + 1];
+            cache.Reset();
+            uint32_t clusterMisses = 0;
+            for (uint32_t triangle = begin; triangle < end; triangle++)
+            {
+                clusterMisses += cache.Access(&indices[triangle * 3]);
+            }
+            float limit = threshold * clusterMisses / (end - begin);
+
+            cache.Reset();
+            clusterStarts.emplace_back(begin);
+            uint32_t misses = 0, count = 0;
+            for (uint32_t triangle = begin; triangle < end; triangle++)
+            {
+                misses += cache.Access(&indices[triangle * 3]);
+                count++;
+                if (triangle + 1 < end && misses <= limit * count)
+                {
+                    cache.Reset();
+                    clusterStarts.emplace_back(triangle + 1);
+                    misses = count = 0;
+                }
+            }
+        }
+        clusterStarts.emplace_back(triangleCount);
+    }
+
+    // Area weighted centroid and normal of every cluster
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    uint32_t clusterCount = static_cast<uint32_t>(clusterStarts.size() - 1);
+    std::vector<glm::vec3> clusterCentroids(clusterCount, glm::vec3(0.0f));
+    std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3(0.0f));
+    for (uint32_t cluster = 0; cluster < clusterCount; cluster++)
+    {
+        float clusterArea = 0.0f;
+        for (uint32_t triangle = clusterStarts[cluster]; triangle < clusterStarts[cluster + 1]; triangle++)
+        {
+            auto& p0 = positions[indices[triangle * 3]];
+            auto& p1 = positions[indices[triangle * 3 + 1]];
+            auto& p2 = positions[indices[triangle * 3 + 2]];
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float area = glm::length(normal);
+            clusterCentroids[cluster] += (p0 + p1 + p2) * (area / 3.0f);
+            clusterNormals[cluster] += normal;
+            clusterArea += area;
+        }
+        meshCentroid += clusterCentroids[cluster];
+        meshArea += clusterArea;
+        clusterCentroids[cluster] = clusterArea > 0.0f ? clusterCentroids[cluster] / clusterArea : positions[indices[clusterStarts[cluster] * 3]];
+        float normalLength = glm::length(clusterNormals[cluster]);
+        clusterNormals[cluster] = normalLength > 0.0f ? clusterNormals[cluster] / normalLength : glm::vec3(0.0f);
+    }
+    meshCentroid = meshArea > 0.0f ? meshCentroid / meshArea : glm::vec3(0.0f);
+
+    // Outward facing clusters far from the centre occlude the rest from most directions, drawn first
+    std::vector<float> sortKeys(clusterCount);
+    std::vector<uint32_t> clusterOrder(clusterCount);
+    for (uint32_t cluster = 0; cluster < clusterCount; cluster++)
+    {
+        sortKeys[cluster] = glm::dot(clusterCentroids[cluster] - meshCentroid, clusterNormals[cluster]);
+        clusterOrder[cluster] = cluster;
+    }
+    std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&](uint32_t lhs, uint32_t rhs) { return sortKeys[lhs] > sortKeys[rhs]; });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (auto cluster : clusterOrder)
+    {
+        result.insert(result.end(), indices.begin() + clusterStarts[cluster] * 3, indices.begin() + clusterStarts[cluster + 1] * 3);
+    }
+    return result;
+}
+
+std::vector<uint32_t> MeshOptimizer::BuildVertexFetchRemap(ArrayIn<uint32_t> indices, uint32_t vertexCount)
+{
+    std::vector<uint32_t> remap(vertexCount, UINT32_MAX);
+    uint32_t nextVertex = 0;
+    for (auto index : indices)
+    {
+        if (remap[index] == UINT32_MAX)
+        {
+            remap[index] = nextVertex++;
+        }
+    }
+    for (auto&& target : remap)
+    {
+        if (target == UINT32_MAX)
+        {
+            target = nextVertex++;
+        }
+    }
+    return remap;
+}
+
+void MeshOptimizer::RemapIndices(Ref<std::vector<uint32_t>> indices, ArrayIn<uint32_t> remap)
+{
+    for (auto&& index : indices)
+    {
+        index = remap[index];
+    }
+}
+
+std::vector<uint32_t> MeshOptimizer::Simplify(ArrayIn<uint32_t> indices, ArrayIn<glm::vec3> positions, uint32_t targetIndexCount,
+                                              float targetError, Out<float> error)
+{
+    float errorLimit = targetError * targetError;
+    uint32_t vertexCount = static_cast<uint32_t>(positions.size());
+    std::vector<uint32_t> result(indices.begin(), indices.end());
+    float maxError = 0.0f;
+
+    // Wedges: vertices sharing a position but not the other attributes, linked in a ring
+    std::vector<uint32_t> positionIds(vertexCount);
+    std::vector<uint32_t> wedgeNext(vertexCount);
+    {
+        uint32_t capacity = std::bit_ceil(std::max(vertexCount * 2, 16u));
+        std::vector<uint32_t> table(capacity, UINT32_MAX);
+        for (uint32_t vertex = 0; vertex < vertexCount; vertex++)
+        {
+            auto& position = positions[vertex];
+            auto bits = std::bit_cast<std::array<uint32_t, 3>>(position);
+            uint32_t slot = (bits[0] * 73856093u ^ bits[1] * 19349663u ^ bits[2] * 83492791u) & (capacity - 1);
+            while (table[slot] != UINT32_MAX && positions[table[slot]] != position)
+            {
+                slot = (slot + 1) & (capacity - 1);
+            }
+            if (table[slot] == UINT32_MAX)
+            {
+                table[slot] = vertex;
+                positionIds[vertex] = vertex;
+                wedgeNext[vertex] = vertex;
+            } else
+            {
+                auto first = table[slot];
+                positionIds[vertex] = first;
+                wedgeNext[vertex] = wedgeNext[first];
+                wedgeNext[first] = vertex;
+            }
+        }
+    }
+
+    // Quadrics live on positions, wedges of a seam share the surface
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i + 2 < result.size(); i += 3)
+    {
+        glm::dvec3 p0 = positions[result[i]], p1 = positions[result[i + 1]], p2 = positions[result[i + 2]];
+        glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+        double area = glm::length(normal);
+        if (area == 0.0)
+        {
+            continue;
+        }
+        normal /= area;
+        auto quadric = Quadric::FromPlane(normal, -glm::dot(normal, p0), area);
+        quadrics[positionIds[result[i]]] += quadric;
+        quadrics[positionIds[result[i + 1]]] += quadric;
+        quadrics[positionIds[result[i + 2]]] += quadric;
+    }
+
+    std::vector<uint32_t> cornerOffsets(vertexCount + 1);
+    std::vector<SimplifyCorner> corners;
+    std::vector<uint32_t> openIn(vertexCount), openOut(vertexCount);
+    std::vector<ESimplifyVertexKind> kinds(vertexCount);
+    std::vector<uint8_t> touched(vertexCount);
+    std::vector<uint32_t> remap(vertexCount);
+
+    auto hasEdge = [&](uint32_t from, uint32_t to) {
+        for (uint32_t i = cornerOffsets[from]; i < cornerOffsets[from + 1]; i++)
+        {
+            if (corners[i].next == to)
+            {
+                return true;
+            }
+        }
+        return false;
+    };
+    auto hasPositionEdge = [&](uint32_t from, uint32_t to) {
+        uint32_t wedge = from;
+        do
+        {
+            for (uint32_t i = cornerOffsets[wedge]; i < cornerOffsets[wedge + 1]; i++)
+            {
+                if (positionIds[corners[i].next] == positionIds[to])
+                {
+                    return true;
+                }
+            }
+            wedge = wedgeNext[wedge];
+        } while (wedge != from);
+        return false;
+    };
+    // Moving from onto to must not turn any remaining triangle of from over
+    auto hasFlips = [&](uint32_t from, uint32_t to) {
+        for (uint32_t i = cornerOffsets[from]; i < cornerOffsets[from + 1]; i++)
+        {
+            auto& corner = corners[i];
+            if (corner.next == to || corner.prev == to)
+            {
+                continue;
+            }
+            auto& next = positions[corner.next];
+            auto& prev = positions[corner.prev];
+            glm::vec3 before = glm::cross(next - positions[from], prev - positions[from]);
+            glm::vec3 after = glm::cross(next - positions[to], prev - positions[to]);
+            // Beyond ~75 degrees, also keeps collapses from leaving slivers of random orientation
+            if (glm::dot(before, after) <= 0.25f * glm::length(before) * glm::length(after))
+            {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // Flip checks assume the fan of a collapsed vertex stays put for the rest of the pass
+    auto lockRing = [&](uint32_t vertex) {
+        for (uint32_t i = cornerOffsets[vertex]; i < cornerOffsets[vertex + 1]; i++)
+        {
+            touched[corners[i].next] = touched[corners[i].prev] = 1;
+        }
+    };
+
+    struct Collapse
+    {
+        uint32_t from;
+        uint32_t to;
+        float error;
+    };
+    std::vector<Collapse> collapses;
+
+    while (result.size() > targetIndexCount)
+    {
+        // Corners of every vertex, gives both the directed edges and the triangle fans
+        std::fill(cornerOffsets.begin(), cornerOffsets.end(), 0);
+        for (auto index : result)
+        {
+            cornerOffsets[index + 1]++;
+        }
+        for (uint32_t vertex = 0; vertex < vertexCount; vertex++)
+        {
+            cornerOffsets[vertex + 1] += cornerOffsets[vertex];
+        }
+        corners.resize(result.size());
+        {
+            std::vector<uint32_t> cursors(cornerOffsets.begin(), cornerOffsets.end() - 1);
+            for (size_t i = 0; i < result.size(); i += 3)
+            {
+                for (uint32_t k = 0; k < 3; k++)
+                {
+                    corners[cursors[result[i + k]]++] = SimplifyCorner{ .next = result[i + (k + 1) % 3], .prev = result[i + (k + 2) % 3] };
+                }
+            }
+        }
+
+        // Open edges have no twin between the same wedges, a seam if the positions still have one
+        std::fill(openIn.begin(), openIn.end(), UINT32_MAX);
+        std::fill(openOut.begin(), openOut.end(), UINT32_MAX);
+        std::fill(kinds.begin(), kinds.end(), ESimplifyVertexKind::Manifold);
+        auto markOpen = [&](uint32_t& slot, uint32_t vertex) { slot = slot == UINT32_MAX ? vertex : UINT32_MAX - 1; };
+        for (uint32_t vertex = 0; vertex < vertexCount; vertex++)
+        {
+            for (uint32_t i = cornerOffsets[vertex]; i < cornerOffsets[vertex + 1]; i++)
+            {
+                auto next = corners[i].next;
+                if (hasEdge(next, vertex))
+                {
+                    continue;
+                }
+                if (!hasPositionEdge(next, vertex))
+                {
+                    kinds[vertex] = kinds[next] = ESimplifyVertexKind::Locked;
+                }
+                markOpen(openOut[vertex], next);
+                markOpen(openIn[next], vertex);
+            }
+        }
+        for (uint32_t vertex = 0; vertex < vertexCount; vertex++)
+        {
+            if (kinds[vertex] == ESimplifyVertexKind::Locked)
+            {
+                continue;
+            }
+            uint32_t wedgeCount = 0;
+            bool seam = true;
+            uint32_t wedge = vertex;
+            do
+            {
+                wedgeCount++;
+                seam = seam && kinds[wedge] != ESimplifyVertexKind::Locked && openIn[wedge] < UINT32_MAX - 1 && openOut[wedge] < UINT32_MAX - 1;
+                wedge = wedgeNext[wedge];
+            } while (wedge != vertex);
+
+            if (wedgeCount == 1)
+            {
+                kinds[vertex] = openIn[vertex] == UINT32_MAX && openOut[vertex] == UINT32_MAX ? ESimplifyVertexKind::Manifold : ESimplifyVertexKind::Locked;
+            } else
+            {
+                kinds[vertex] = wedgeCount == 2 && seam ? ESimplifyVertexKind::Seam : ESimplifyVertexKind::Locked;
+            }
+        }
+
+        // Cheapest collapse of every movable vertex, a seam only moves along itself
+        collapses.clear();
+        for (uint32_t vertex = 0; vertex < vertexCount; vertex++)
+        {
+            if (kinds[vertex] == ESimplifyVertexKind::Locked || cornerOffsets[vertex] == cornerOffsets[vertex + 1])
+            {
+                continue;
+            }
+            auto& quadric = quadrics[positionIds[vertex]];
+            Collapse best = { .from = vertex, .to = UINT32_MAX, .error = std::numeric_limits<float>::max() };
+            auto consider = [&](uint32_t target) {
+                float collapseError = quadric.Error(positions[target]);
+                if (collapseError < best.error)
+                {
+                    best = Collapse{ .from = vertex, .to = target, .error = collapseError };
+                }
+            };
+            if (kinds[vertex] == ESimplifyVertexKind::Seam)
+            {
+                if (vertex > wedgeNext[vertex])
+                {
+                    continue;
+                }
+                consider(openOut[vertex]);
+                consider(openIn[vertex]);
+            } else
+            {
+                for (uint32_t i = cornerOffsets[vertex]; i < cornerOffsets[vertex + 1]; i++)
+                {
+                    consider(corners[i].next);
+                    consider(corners[i].prev);
+                }
+            }
+            if (best.to != UINT32_MAX)
+            {
+                collapses.emplace_back(best);
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& lhs, const Collapse& rhs) { return lhs.error < rhs.error; });
+
+        // Every collapse removes about two triangles, a pass only takes the cheapest quarter so later
+        // passes see the updated quadrics
+        size_t triangleGoal = (result.size() - targetIndexCount + 2) / 3;
+        size_t collapseGoal = std::min((triangleGoal + 1) / 2, collapses.size() / 4 + 1);
+        std::fill(touched.begin(), touched.end(), 0);
+        std::iota(remap.begin(), remap.end(), 0);
+        size_t collapseCount = 0;
+        for (auto&& collapse : collapses)
+        {
+            if (collapseCount >= collapseGoal || collapse.error > errorLimit)
+            {
+                break;
+            }
+            uint32_t from = collapse.from, to = collapse.to;
+            if (touched[from] || touched[to])
+            {
+                continue;
+            }
+            if (kinds[from] == ESimplifyVertexKind::Seam)
+            {
+                // The other side goes onto the wedge of the target position it shares the seam with
+                uint32_t twin = wedgeNext[from];
+                uint32_t twinTo = to == openOut[from] ? openIn[twin] : openOut[twin];
+                if (twinTo >= UINT32_MAX - 1 || positionIds[twinTo] != positionIds[to] || touched[twin] || touched[twinTo] ||
+                    hasFlips(from, to) || hasFlips(twin, twinTo))
+                {
+                    continue;
+                }
+                remap[twin] = twinTo;
+                touched[twin] = touched[twinTo] = 1;
+                lockRing(twin);
+            } else if (hasFlips(from, to))
+            {
+                continue;
+            }
+            remap[from] = to;
+            touched[from] = touched[to] = 1;
+            lockRing(from);
+            quadrics[positionIds[to]] += quadrics[positionIds[from]];
+            maxError = std::max(maxError, collapse.error);
+            collapseCount++;
+        }
+        if (collapseCount == 0)
+        {
+            break;
+        }
+
+        // Triangles around the collapsed edges degenerate
+        size_t writeIndex = 0;
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            uint32_t v0 = remap[result[i]], v1 = remap[result[i + 1]], v2 = remap[result[i + 2]];
+            if (v0 != v1 && v1 != v2 && v2 != v0)
+            {
+                result[writeIndex++] = v0;
+                result[writeIndex++] = v1;
+                result[writeIndex++] = v2;
+            }
+        }
+        result.resize(writeIndex);
+    }
+
+    *error = std::sqrt(maxError);
+    return result;
+}
+
+std::vector<MeshLod> MeshOptimizer::BuildLods(Ref<std::vector<uint32_t>> indices, ArrayIn<glm::vec3> positions, ArrayIn<float> ratios, float targetError)
+{
+    uint32_t baseIndexCount = static_cast<uint32_t>(indices.size());
+    std::vector<MeshLod> lods = { MeshLod{ .firstIndex = 0, .indexCount = baseIndexCount, .error = 0.0f } };
+    std::vector<uint32_t> previous = indices;
+    for (auto ratio : ratios)
+    {
+        // Every level starts from the previous one, faster and the errors add up to a bound to LOD 0
+        uint32_t targetIndexCount = static_cast<uint32_t>(baseIndexCount * ratio) / 3 * 3;
+        float previousError = lods.back().error;
+        float error = 0.0f;
+        auto simplified = Simplify(previous, positions, targetIndexCount, targetError - previousError, &error);
+        if (simplified.empty() || simplified.size() * 10 > previous.size() * 9)
+        {
+            break;
+        }
+        simplified = OptimizeVertexCache(simplified, static_cast<uint32_t>(positions.size()));
+
+        lods.emplace_back(MeshLod{ .firstIndex = static_cast<uint32_t>(indices.size()), .indexCount = static_cast<uint32_t>(simplified.size()),
+                                   .error = previousError + error });
+        indices.insert(indices.end(), simplified.begin(), simplified.end());
+        previous = std::move(simplified);
+    }
+    return lods;
+}
+
+void MeshOptimizer::BuildMeshlets(ArrayIn<uint32_t> indices, ArrayIn<glm::vec3> positions, uint32_t maxVertices, uint32_t maxTriangles,
+                                  Out<MeshletData> meshletData)
+{
+    maxVertices = std::clamp(maxVertices, 3u, 256u);
+    maxTriangles = std::max(maxTriangles, 1u);
+    uint32_t vertexCount = static_cast<uint32_t>(positions.size());
+    uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+
+    // Live triangles of every vertex at the front of its range, as in OptimizeVertexCache
+    std::vector<uint32_t> liveTriangleCounts(vertexCount, 0);
+    for (auto index : indices)
+    {
+        liveTriangleCounts[index]++;
+    }
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (uint32_t vertex = 0; vertex < vertexCount; vertex++)
+    {
+        adjacencyOffsets[vertex + 1] = adjacencyOffsets[vertex] + liveTriangleCounts[vertex];
+    }
+    std::vector<uint32_t> adjacency(indices.size());
+    {
+        std::vector<uint32_t> cursors(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (uint32_t i = 0; i < indices.size(); i++)
+        {
+            adjacency[cursors[indices[i]]++] = i / 3;
+        }
+    }
+
+    std::vector<glm::vec3> triangleNormals(triangleCount);
+    std::vector<glm::vec3> triangleCentroids(triangleCount);
+    for (uint32_t triangle = 0; triangle < triangleCount; triangle++)
+    {
+        auto& p0 = positions[indices[triangle * 3]];
+        auto& p1 = positions[indices[triangle * 3 + 1]];
+        auto& p2 = positions[indices[triangle * 3 + 2]];
+        glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        float length = glm::length(normal);
+        triangleNormals[triangle] = length > 0.0f ? normal / length : glm::vec3(0.0f);
+        triangleCentroids[triangle] = (p0 + p1 + p2) / 3.0f;
+    }
+
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    std::vector<uint8_t> localIndices(vertexCount, 0xff);
+    std::vector<uint32_t> meshletVertices;
+    std::vector<uint32_t> meshletTriangles;
+    glm::vec3 centroidSum(0.0f), normalSum(0.0f);
+    uint32_t scanCursor = 0;
+
+    auto emit = [&](uint32_t triangle) {
+        uint32_t packed = 0;
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            auto vertex = indices[triangle * 3 + k];
+            if (localIndices[vertex] == 0xff)
+            {
+                localIndices[vertex] = static_cast<uint8_t>(meshletVertices.size());
+                meshletVertices.emplace_back(vertex);
+            }
+            packed |= static_cast<uint32_t>(localIndices[vertex]) << (k * 8);
+
+            auto live = adjacency.begin() + adjacencyOffsets[vertex];
+            auto it = std::find(live, live + liveTriangleCounts[vertex], triangle);
+            std::iter_swap(it, live + liveTriangleCounts[vertex] - 1);
+            liveTriangleCounts[vertex]--;
+        }
+        meshletTriangles.emplace_back(packed);
+        centroidSum += triangleCentroids[triangle];
+        normalSum += triangleNormals[triangle];
+        emitted[triangle] = 1;
+    };
+    auto newVertexCount = [&](uint32_t triangle) {
+        return (localIndices[indices[triangle * 3]] == 0xff ? 1u : 0u) + (localIndices[indices[triangle * 3 + 1]] == 0xff ? 1u : 0u) +
+               (localIndices[indices[triangle * 3 + 2]] == 0xff ? 1u : 0u);
+    };
+    auto flush = [&]() {
+        if (meshletTriangles.empty())
+        {
+            return;
+        }
+        Meshlet meshlet = {
+            .vertexOffset = static_cast<uint32_t>(meshletData->vertices.size()),
+            .triangleOffset = static_cast<uint32_t>(meshletData->triangles.size()),
+            .vertexCount = static_cast<uint32_t>(meshletVertices.size()),
+            .triangleCount = static_cast<uint32_t>(meshletTriangles.size()),
+        };
+
+        // Sphere around the AABB, cone around the average normal
+        glm::vec3 minPos(std::numeric_limits<float>::max());
+        glm::vec3 maxPos(std::numeric_limits<float>::lowest());
+        for (auto vertex : meshletVertices)
+        {
+            minPos = glm::min(minPos, positions[vertex]);
+            maxPos = glm::max(maxPos, positions[vertex]);
+        }
+        glm::vec3 center = (minPos + maxPos) * 0.5f;
+        float radius = 0.0f;
+        for (auto vertex : meshletVertices)
+        {
+            radius = std::max(radius, glm::length(positions[vertex] - center));
+        }
+        meshlet.boundingSphere = glm::vec4(center, radius);
+
+        float normalLength = glm::length(normalSum);
+        glm::vec3 axis = normalLength > 0.0f ? normalSum / normalLength : glm::vec3(0.0f, 0.0f, 1.0f);
+        float minDot = normalLength > 0.0f ? 1.0f : -1.0f;
+        for (auto packed : meshletTriangles)
+        {
+            auto& p0 = positions[meshletVertices[packed & 0xff]];
+            auto& p1 = positions[meshletVertices[(packed >> 8) & 0xff]];
+            auto& p2 = positions[meshletVertices[(packed >> 16) & 0xff]];
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float length = glm::length(normal);
+            if (length > 0.0f)
+            {
+                minDot = std::min(minDot, glm::dot(normal / length, axis));
+            }
+        }
+        // Normals spread over more than ~84 degrees leave nothing worth testing
+        float cutoff = minDot <= 0.1f ? 1.0f : std::sqrt(1.0f - minDot * minDot);
+        meshlet.cone = glm::vec4(axis, cutoff);
+
+        meshletData->meshlets.emplace_back(meshlet);
+        meshletData->vertices.insert(meshletData->vertices.end(), meshletVertices.begin(), meshletVertices.end());
+        meshletData->triangles.insert(meshletData->triangles.end(), meshletTriangles.begin(), meshletTriangles.end());
+        for (auto vertex : meshletVertices)
+        {
+            localIndices[vertex] = 0xff;
+        }
+        meshletVertices.clear();
+        meshletTriangles.clear();
+        centroidSum = normalSum = glm::vec3(0.0f);
+    };
+
+    uint32_t remaining = triangleCount;
+    uint32_t seed = UINT32_MAX;
+    while (remaining > 0)
+    {
+        if (seed == UINT32_MAX)
+        {
+            while (emitted[scanCursor])
+            {
+                scanCursor++;
+            }
+            seed = scanCursor;
+        }
+        emit(seed);
+        remaining--;
+
+        while (meshletTriangles.size() < maxTriangles)
+        {
+            glm::vec3 center = centroidSum / static_cast<float>(meshletTriangles.size());
+            glm::vec3 axis = glm::length(normalSum) > 0.0f ? glm::normalize(normalSum) : glm::vec3(0.0f);
+            uint32_t best = UINT32_MAX;
+            uint32_t bestExtra = 3;
+            float bestScore = std::numeric_limits<float>::max();
+            for (auto vertex : meshletVertices)
+            {
+                for (uint32_t i = 0; i < liveTriangleCounts[vertex]; i++)
+                {
+                    auto candidate = adjacency[adjacencyOffsets[vertex] + i];
+                    uint32_t extra = newVertexCount(candidate);
+                    if (meshletVertices.size() + extra > maxVertices || extra > bestExtra)
+                    {
+                        continue;
+                    }
+                    float distance = glm::length(triangleCentroids[candidate] - center);
+                    float score = distance * (2.0f - glm::dot(triangleNormals[candidate], axis));
+                    if (extra > 0)
+                    {
+                        // New vertices with few triangles left get finished here instead of stranded
+                        score *= static_cast<float>(liveTriangleCounts[indices[candidate * 3]] + liveTriangleCounts[indices[candidate * 3 + 1]] +
+                                                    liveTriangleCounts[indices[candidate * 3 + 2]]);
+                    }
+                    if (extra < bestExtra || score < bestScore)
+                    {
+                        best = candidate;
+                        bestExtra = extra;
+                        bestScore = score;
+                    }
+                }
+            }
+            if (best == UINT32_MAX)
+            {
+                break;
+            }
+            emit(best);
+            remaining--;
+        }
+
+        // The next meshlet starts on the border of this one, from the triangle with the fewest
+        // live neighbours so no small islands are left behind
+        seed = UINT32_MAX;
+        uint32_t seedValence = UINT32_MAX;
+        for (auto vertex : meshletVertices)
+        {
+            for (uint32_t i = 0; i < liveTriangleCounts[vertex]; i++)
+            {
+                auto candidate = adjacency[adjacencyOffsets[vertex] + i];
+                uint32_t valence = liveTriangleCounts[indices[candidate * 3]] + liveTriangleCounts[indices[candidate * 3 + 1]] +
+                                   liveTriangleCounts[indices[candidate * 3 + 2]];
+                if (valence < seedValence)
+                {
+                    seed = candidate;
+                    seedValence = valence;
+                }
+            }
+        }
+        flush();
+    }
+}
+
+bool MeshOptimizer::IsMeshletBackFacing(In<Meshlet> meshlet, glm::vec3 cameraPosition) noexcept
+{
+    glm::vec3 center = glm::vec3(meshlet.boundingSphere);
+    glm::vec3 view = center - cameraPosition;
+    return glm::dot(view, glm::vec3(meshlet.cone)) >= meshlet.cone.w * glm::length(view) + meshlet.boundingSphere.w;
+}
+
+VertexCacheStatistics MeshOptimizer::AnalyzeVertexCache(ArrayIn<uint32_t> indices, uint32_t vertexCount, uint32_t cacheSize)
+{
+    VertexCacheStatistics statistics;
+    std::vector<uint8_t> referenced(vertexCount, 0);
+    FifoCache cache(vertexCount, cacheSize);
+    uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+    for (uint32_t triangle = 0; triangle < triangleCount; triangle++)
+    {
+        statistics.transformedCount += cache.Access(&indices[triangle * 3]);
+    }
+    for (auto index : indices)
+    {
+        statistics.vertexCount += referenced[index] ? 0 : 1;
+        referenced[index] = 1;
+    }
+    statistics.acmr = triangleCount > 0 ? static_cast<float>(statistics.transformedCount) / triangleCount : 0.0f;
+    statistics.atvr = statistics.vertexCount > 0 ? static_cast<float>(statistics.transformedCount) / statistics.vertexCount : 0.0f;
+    return statistics;
+}
+}
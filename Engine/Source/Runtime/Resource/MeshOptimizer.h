@@ -0,0 +1,95 @@
+﻿#pragma once
+#include "Engine/Source/Runtime/Core/Base/Common.h"
+
+#include <glm/glm.hpp>
+
+namespace Snowy::Ark
+{
+// Post-transform cache behaviour of an index buffer, simulated as a FIFO cache
+struct VertexCacheStatistics
+{
+    uint32_t vertexCount = 0;       // referenced vertices
+    uint32_t transformedCount = 0;  // cache misses
+    float acmr = 0.0f;              // misses per triangle, 0.5 is the limit for a regular grid
+    float atvr = 0.0f;              // misses per referenced vertex, 1.0 is optimal
+};
+
+// Range of one level of detail in a shared index buffer
+struct MeshLod
+{
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    float error;        // object space distance to LOD 0, grows with the level
+};
+
+// Cluster of triangles with its own small vertex list, the unit of cluster culling
+struct Meshlet
+{
+    uint32_t vertexOffset;      // in MeshletData::vertices
+    uint32_t triangleOffset;    // in MeshletData::triangles
+    uint32_t vertexCount;
+    uint32_t triangleCount;
+    glm::vec4 boundingSphere;   // center, radius in w
+    glm::vec4 cone;             // axis of the front face normals, cos of the cutoff in w(1 never culls)
+};
+struct MeshletData
+{
+    std::vector<Meshlet> meshlets;
+    std::vector<uint32_t> vertices;     // mesh vertex indices
+    std::vector<uint32_t> triangles;    // three 8 bit meshlet vertex indices, packed from the low byte
+};
+
+/// <summary>
+/// Offline index/vertex reordering run by the mesh cooker, in this order:
+/// vertex cache(Forsyth), overdraw(cluster sort, bounded by an ACMR threshold), vertex fetch.
+/// Every reordering pass is a pure permutation, the rendered triangles never change, Simplify builds LODs.
+/// </summary>
+class MeshOptimizer
+{
+public:
+    static constexpr uint32_t ForsythCacheSize = 32;   // LRU size of the scoring, not of any real hardware
+    static constexpr uint32_t AnalyzeCacheSize = 16;
+    // 124 keeps the packed triangles of a meshlet under 128 entries with 64 vertices
+    static constexpr uint32_t MeshletMaxVertices = 64;
+    static constexpr uint32_t MeshletMaxTriangles = 124;
+
+public:
+    static std::vector<uint32_t> OptimizeVertexCache(ArrayIn<uint32_t> indices, uint32_t vertexCount);
+    // Sorts cache clusters front to back from the mesh centre, threshold bounds the ACMR increase(1.05 = 5%)
+    static std::vector<uint32_t> OptimizeOverdraw(ArrayIn<uint32_t> indices, ArrayIn<glm::vec3> positions, float threshold = 1.05f);
+
+    // Remap from old to new vertex index so vertices are stored in first use order, unreferenced ones last
+    static std::vector<uint32_t> BuildVertexFetchRemap(ArrayIn<uint32_t> indices, uint32_t vertexCount);
+    static void RemapIndices(Ref<std::vector<uint32_t>> indices, ArrayIn<uint32_t> remap);
+    template<typename T>
+    static void RemapVertices(Ref<std::vector<T>> vertices, ArrayIn<uint32_t> remap)
+    {
+        std::vector<T> remapped(vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++)
+        {
+            remapped[remap[i]] = vertices[i];
+        }
+        vertices = std::move(remapped);
+    }
+
+    // Quadric error edge collapse towards targetIndexCount, vertices only move onto existing ones so the
+    // result shares the vertex buffer. UV seams collapse along themselves with both sides at once, open
+    // borders are kept. Stops early rather than exceed targetError, both errors are object space distances
+    static std::vector<uint32_t> Simplify(ArrayIn<uint32_t> indices, ArrayIn<glm::vec3> positions, uint32_t targetIndexCount,
+                                          float targetError, Out<float> error);
+
+    // Appends a simplified level per ratio(of the LOD 0 triangles) to indices and returns every level, LOD 0
+    // included. The chain stops at targetError or once a level no longer pays off
+    static std::vector<MeshLod> BuildLods(Ref<std::vector<uint32_t>> indices, ArrayIn<glm::vec3> positions, ArrayIn<float> ratios, float targetError);
+
+    // Greedy growth over the triangle adjacency, preferring triangles that add no vertex, then the ones
+    // close to the meshlet and facing the same way so spheres and cones stay tight. Meshlets are appended
+    static void BuildMeshlets(ArrayIn<uint32_t> indices, ArrayIn<glm::vec3> positions, uint32_t maxVertices, uint32_t maxTriangles,
+                              Out<MeshletData> meshletData);
+    // Cluster culling test, cameraPosition in the space of the mesh. Back facing if the camera is behind
+    // every triangle plane, which the cone bounds conservatively from the sphere
+    static bool IsMeshletBackFacing(In<Meshlet> meshlet, glm::vec3 cameraPosition) noexcept;
+
+    static VertexCacheStatistics AnalyzeVertexCache(ArrayIn<uint32_t> indices, uint32_t vertexCount, uint32_t cacheSize = AnalyzeCacheSize);
+};
+}
@@ -0,0 +1,385 @@
+﻿#include "ObjImporter.h"
+#include "Engine/Source/Runtime/Core/Log/Logger.h"
+#include "Engine/Source/Runtime/Core/Job/JobSystem.h"
+#include "Engine/Source/Runtime/Function/Global/GlobalContext.h"
+
+#include <atomic>
+#include <bit>
+#include <charconv>
+
+namespace Snowy::Ark
+{
+namespace
+{
+constexpr uint64_t Prime64_1 = 0x9E3779B185EBCA87ull;
+constexpr uint64_t Prime64_2 = 0xC2B2AE3D27D4EB4Full;
+constexpr uint64_t Prime64_3 = 0x165667B19E3779F9ull;
+constexpr uint64_t Prime64_4 = 0x85EBCA77C2B2AE63ull;
+
+constexpr uint64_t RotateLeft(uint64_t value, int shift) noexcept
+{
+    return (value << shift) | (value >> (64 - shift));
+}
+
+constexpr uint64_t HashRound(uint64_t acc, uint64_t lane) noexcept
+{
+    acc += lane * Prime64_2;
+    acc = RotateLeft(acc, 31);
+    return acc * Prime64_1;
+}
+
+constexpr uint64_t MergeRound(uint64_t acc, uint64_t value) noexcept
+{
+    acc ^= HashRound(0, value);
+    return acc * Prime64_1 + Prime64_4;
+}
+
+struct ObjChunk
+{
+    const char* begin;
+    const char* end;
+    uint32_t positionCount = 0;
+    uint32_t texcoordCount = 0;
+    uint32_t positionBase = 0;
+    uint32_t texcoordBase = 0;
+    std::vector<uint32_t> corners;  // position, texcoord(UINT32_MAX if absent) pairs, three corners per triangle
+};
+
+const char* SkipSpaces(const char* cursor, const char* end) noexcept
+{
+    while (cursor < end && (*cursor == ' ' || *cursor == '\t'))
+    {
+        cursor++;
+    }
+    return cursor;
+}
+
+const char* ParseFloats(const char* cursor, const char* end, Out<float> values, uint32_t count) noexcept
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        cursor = SkipSpaces(cursor, end);
+        auto [next, error] = std::from_chars(cursor, end, values[i]);
+        if (error != std::errc())
+        {
+            values[i] = 0.0f;
+            return cursor;
+        }
+        cursor = next;
+    }
+    return cursor;
+}
+
+// Returns the zero based index, relative indices count back from the elements defined so far
+bool ResolveIndex(int64_t index, uint32_t definedCount, uint32_t totalCount, Out<uint32_t> resolved) noexcept
+{
+    int64_t absolute = index > 0 ? index - 1 : static_cast<int64_t>(definedCount) + index;
+    if (index == 0 || absolute < 0 || absolute >= totalCount)
+    {
+        return false;
+    }
+    *resolved = static_cast<uint32_t>(absolute);
+    return true;
+}
+
+bool IsLine(const char* cursor, const char* end, char type) noexcept
+{
+    return end - cursor >= 2 && cursor[0] == type && (cursor[1] == ' ' || cursor[1] == '\t');
+}
+
+bool IsTexcoordLine(const char* cursor, const char* end) noexcept
+{
+    return end - cursor >= 3 && cursor[0] == 'v' && cursor[1] == 't' && (cursor[2] == ' ' || cursor[2] == '\t');
+}
+
+template<class LineFunc>
+void ForEachLine(const char* begin, const char* end, LineFunc&& func)
+{
+    while (begin < end)
+    {
+        auto lineEnd = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+        lineEnd = lineEnd ? lineEnd : end;
+        auto cursor = SkipSpaces(begin, lineEnd);
+        func(cursor, lineEnd > cursor && lineEnd[-1] == '\r' ? lineEnd - 1 : lineEnd);
+        begin = lineEnd + 1;
+    }
+}
+
+bool ParseChunk(Ref<ObjChunk> chunk, std::span<glm::vec3> positions, std::span<glm::vec2> texcoords)
+{
+    uint32_t positionCount = chunk.positionBase;
+    uint32_t texcoordCount = chunk.texcoordBase;
+    bool succeeded = true;
+    std::vector<std::pair<uint32_t, uint32_t>> polygon;
+
+    ForEachLine(chunk.begin, chunk.end, [&](const char* cursor, const char* end) {
+        if (IsLine(cursor, end, 'v'))
+        {
+            std::array<float, 3> values = {};
+            ParseFloats(cursor + 2, end, values.data(), 3);
+            positions[positionCount++] = glm::vec3(values[0], values[1], values[2]);
+        } else if (IsTexcoordLine(cursor, end))
+        {
+            std::array<float, 2> values = {};
+            ParseFloats(cursor + 3, end, values.data(), 2);
+            texcoords[texcoordCount++] = glm::vec2(values[0], 1.0f - values[1]);
+        } else if (IsLine(cursor, end, 'f'))
+        {
+            polygon.clear();
+            cursor += 2;
+            while (true)
+            {
+                cursor = SkipSpaces(cursor, end);
+                int64_t positionIndex = 0, texcoordIndex = 0;
+                auto [next, error] = std::from_chars(cursor, end, positionIndex);
+                if (error != std::errc())
+                {
+                    break;
+                }
+                cursor = next;
+                uint32_t position = 0, texcoord = UINT32_MAX;
+                succeeded &= ResolveIndex(positionIndex, positionCount, static_cast<uint32_t>(positions.size()), &position);
+                if (cursor < end && *cursor == '/')
+                {
+                    auto [texcoordNext, texcoordError] = std::from_chars(cursor + 1, end, texcoordIndex);
+                    if (texcoordError == std::errc())
+                    {
+                        succeeded &= ResolveIndex(texcoordIndex, texcoordCount, static_cast<uint32_t>(texcoords.size()), &texcoord);
+                        cursor = texcoordNext;
+                    }
+                    // Normals are not used, skip up to the next corner
+                    while (cursor < end && *cursor != ' ' && *cursor != '\t')
+                    {
+                        cursor++;
+                    }
+                }
+                polygon.emplace_back(position, texcoord);
+            }
+            for (size_t i = 2; i < polygon.size(); i++)
+            {
+                for (auto&& corner : { polygon[0], polygon[i - 1], polygon[i] })
+                {
+                    chunk.corners.emplace_back(corner.first);
+                    chunk.corners.emplace_back(corner.second);
+                }
+            }
+        }
+    });
+    return succeeded;
+}
+}
+
+bool ObjImporter::Import(In<std::filesystem::path> path, Out<std::vector<MeshVertex>> vertices, Out<std::vector<uint32_t>> indices)
+{
+    MappedFile file;
+    if (!file.Open(path))
+    {
+        SA_LOG_ERROR("Failed to open model: {}", PATH_TO_SSTR(path));
+        return false;
+    }
+
+    // Chunks end right after a line break so no line is split
+    std::vector<ObjChunk> chunks;
+    auto fileBegin = reinterpret_cast<const char*>(file.Data());
+    auto fileEnd = fileBegin + file.Size();
+    for (auto begin = fileBegin; begin < fileEnd;)
+    {
+        auto end = begin + std::min<size_t>(ChunkSize, fileEnd - begin);
+        auto lineEnd = end < fileEnd ? static_cast<const char*>(std::memchr(end, '\n', fileEnd - end)) : nullptr;
+        end = lineEnd ? lineEnd + 1 : fileEnd;
+        chunks.emplace_back(ObjChunk{ .begin = begin, .end = end });
+        begin = end;
+    }
+
+    auto& jobSys = *g_RuntimeContext.jobSys;
+    uint32_t chunkCount = static_cast<uint32_t>(chunks.size());
+    jobSys.ParallelFor(chunkCount, 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++)
+        {
+            auto& chunk = chunks[i];
+            ForEachLine(chunk.begin, chunk.end, [&](const char* cursor, const char* lineEnd) {
+                chunk.positionCount += IsLine(cursor, lineEnd, 'v') ? 1 : 0;
+                chunk.texcoordCount += IsTexcoordLine(cursor, lineEnd) ? 1 : 0;
+            });
+        }
+    });
+
+    uint32_t positionCount = 0, texcoordCount = 0;
+    for (auto&& chunk : chunks)
+    {
+        chunk.positionBase = positionCount;
+        chunk.texcoordBase = texcoordCount;
+        positionCount += chunk.positionCount;
+        texcoordCount += chunk.texcoordCount;
+    }
+
+    std::vector<glm::vec3> positions(positionCount);
+    std::vector<glm::vec2> texcoords(texcoordCount);
+    std::atomic<bool> succeeded = true;
+    jobSys.ParallelFor(chunkCount, 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++)
+        {
+            if (!ParseChunk(chunks[i], positions, texcoords))
+            {
+                succeeded.store(false, std::memory_order_relaxed);
+            }
+        }
+    });
+    if (!succeeded)
+    {
+        SA_LOG_ERROR("Load model error: index out of range in {}", PATH_TO_SSTR(path));
+        return false;
+    }
+
+    // Chunks are concatenated in file order
+    std::vector<size_t> cornerBases(chunkCount + 1, 0);
+    for (uint32_t i = 0; i < chunkCount; i++)
+    {
+        cornerBases[i + 1] = cornerBases[i] + chunks[i].corners.size() / 2;
+    }
+    std::vector<MeshVertex> corners(cornerBases.back());
+    jobSys.ParallelFor(chunkCount, 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++)
+        {
+            auto& chunkCorners = chunks[i].corners;
+            for (size_t j = 0; j < chunkCorners.size(); j += 2)
+            {
+                auto& corner = corners[cornerBases[i] + j / 2];
+                corner.position = positions[chunkCorners[j]];
+                corner.color = glm::vec3(1.0f);
+                corner.texcoord = chunkCorners[j + 1] == UINT32_MAX ? glm::vec2(0.0f) : texcoords[chunkCorners[j + 1]];
+            }
+            chunkCorners = {};
+        }
+    });
+
+    Deduplicate(corners, vertices, indices);
+    return true;
+}
+
+void ObjImporter::Deduplicate(ArrayIn<MeshVertex> corners, Out<std::vector<MeshVertex>> vertices, Out<std::vector<uint32_t>> indices)
+{
+    auto& jobSys = *g_RuntimeContext.jobSys;
+    uint32_t cornerCount = static_cast<uint32_t>(corners.size());
+    uint32_t grainSize = std::max(cornerCount / (jobSys.ThreadCount() * 4), 4096u);
+    uint32_t rangeCount = (cornerCount + grainSize - 1) / grainSize;
+
+    // Scatter corners by hash, every partition sees its corners in ascending order
+    std::vector<uint64_t> hashes(cornerCount);
+    std::vector<std::array<std::vector<uint32_t>, DedupPartitionCount>> rangePartitions(rangeCount);
+    jobSys.ParallelFor(cornerCount, grainSize, [&](uint32_t begin, uint32_t end) {
+        auto& partitions = rangePartitions[begin / grainSize];
+        for (uint32_t i = begin; i < end; i++)
+        {
+            hashes[i] = HashVertex(corners[i]);
+            partitions[hashes[i] >> 58].emplace_back(i);
+        }
+    });
+
+    // Open addressing per partition, firstCorners maps every corner to the first identical one
+    std::vector<uint32_t> firstCorners(cornerCount);
+    jobSys.ParallelFor(DedupPartitionCount, 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t partition = begin; partition < end; partition++)
+        {
+            size_t partitionSize = 0;
+            for (auto&& partitions : rangePartitions)
+            {
+                partitionSize += partitions[partition].size();
+            }
+            size_t capacity = std::bit_ceil(std::max<size_t>(partitionSize * 2, 16));
+            std::vector<uint32_t> table(capacity, UINT32_MAX);
+            for (auto&& partitions : rangePartitions)
+            {
+                for (auto corner : partitions[partition])
+                {
+                    size_t slot = hashes[corner] & (capacity - 1);
+                    while (true)
+                    {
+                        auto candidate = table[slot];
+                        if (candidate == UINT32_MAX)
+                        {
+                            table[slot] = corner;
+                            firstCorners[corner] = corner;
+                            break;
+                        }
+                        if (hashes[candidate] == hashes[corner] && std::memcmp(&corners[candidate], &corners[corner], sizeof(MeshVertex)) == 0)
+                        {
+                            firstCorners[corner] = candidate;
+                            break;
+                        }
+                        slot = (slot + 1) & (capacity - 1);
+                    }
+                }
+                partitions[partition] = {};
+            }
+        }
+    });
+
+    // Unique vertices are numbered in corner order, a prefix sum over the ranges keeps it deterministic
+    std::vector<uint32_t> rangeBases(rangeCount + 1, 0);
+    jobSys.ParallelFor(cornerCount, grainSize, [&](uint32_t begin, uint32_t end) {
+        uint32_t uniqueCount = 0;
+        for (uint32_t i = begin; i < end; i++)
+        {
+            uniqueCount += firstCorners[i] == i ? 1 : 0;
+        }
+        rangeBases[begin / grainSize + 1] = uniqueCount;
+    });
+    for (uint32_t i = 0; i < rangeCount; i++)
+    {
+        rangeBases[i + 1] += rangeBases[i];
+    }
+
+    vertices->resize(rangeBases.back());
+    indices->resize(cornerCount);
+    jobSys.ParallelFor(cornerCount, grainSize, [&](uint32_t begin, uint32_t end) {
+        uint32_t vertexIndex = rangeBases[begin / grainSize];
+        for (uint32_t i = begin; i < end; i++)
+        {
+            if (firstCorners[i] == i)
+            {
+                (*vertices)[vertexIndex] = corners[i];
+                (*indices)[i] = vertexIndex++;
+            }
+        }
+    });
+    // A later corner always refers to an earlier one, whose index is final after the pass above
+    jobSys.ParallelFor(cornerCount, grainSize, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++)
+        {
+            if (firstCorners[i] != i)
+            {
+                (*indices)[i] = (*indices)[firstCorners[i]];
+            }
+        }
+    });
+}
+
+uint64_t ObjImporter::HashVertex(In<MeshVertex> vertex) noexcept
+{
+    static_assert(sizeof(MeshVertex) == 32, "The hash consumes exactly one 32 byte stripe");
+    std::array<uint64_t, 4> lanes;
+    std::memcpy(lanes.data(), &vertex, sizeof(MeshVertex));
+
+    // Independent lanes, the compiler keeps them in vector registers
+    std::array<uint64_t, 4> acc = { Prime64_1 + Prime64_2, Prime64_2, 0, 0 - Prime64_1 };
+    for (size_t i = 0; i < 4; i++)
+    {
+        acc[i] = HashRound(acc[i], lanes[i]);
+    }
+
+    uint64_t hash = RotateLeft(acc[0], 1) + RotateLeft(acc[1], 7) + RotateLeft(acc[2], 12) + RotateLeft(acc[3], 18);
+    for (auto lane : acc)
+    {
+        hash = MergeRound(hash, lane);
+    }
+    hash += sizeof(MeshVertex);
+
+    hash ^= hash >> 33;
+    hash *= Prime64_2;
+    hash ^= hash >> 29;
+    hash *= Prime64_3;
+    hash ^= hash >> 32;
+    return hash;
+}
+}
@@ -0,0 +1,27 @@
+﻿#pragma once
+#include "Engine/Source/Runtime/Core/Base/Common.h"
+#include "Engine/Source/Runtime/Resource/MeshAsset.h"
+
+namespace Snowy::Ark
+{
+/// <summary>
+/// Multithreaded OBJ import on the job system. The mapped file is split into line aligned chunks,
+/// a counting pass gives every chunk its position/texcoord base so the parse pass writes in place
+/// and resolves relative indices. Polygons are fan triangulated, groups and materials are ignored.
+/// The result only depends on the file, never on the thread count or scheduling.
+/// </summary>
+class ObjImporter
+{
+public:
+    static constexpr size_t ChunkSize = 1 << 20;        // bytes of OBJ text per parse job
+    static constexpr uint32_t DedupPartitionCount = 64; // independent hash tables of the dedup
+
+public:
+    static bool Import(In<std::filesystem::path> path, Out<std::vector<MeshVertex>> vertices, Out<std::vector<uint32_t>> indices);
+
+    // Merges bitwise identical corners, unique vertices keep the order of their first corner
+    static void Deduplicate(ArrayIn<MeshVertex> corners, Out<std::vector<MeshVertex>> vertices, Out<std::vector<uint32_t>> indices);
+    // XXH64 of the 32 packed bytes, four independent lanes
+    static uint64_t HashVertex(In<MeshVertex> vertex) noexcept;
+};
+}
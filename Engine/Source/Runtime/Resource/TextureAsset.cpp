@@ -0,0 +1,192 @@
+﻿#include "TextureAsset.h"
+#include "Engine/Source/Runtime/Core/Log/Logger.h"
+
+#include <algorithm>
+#include <fstream>
+
+#include <stb/stb_image.h>
+
+namespace Snowy::Ark
+{
+namespace
+{
+uint64_t AlignUp(uint64_t value, uint64_t alignment) noexcept
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+int64_t SourceWriteTime(In<std::filesystem::path> path, Ref<std::error_code> error)
+{
+    return static_cast<int64_t>(std::filesystem::last_write_time(path, error).time_since_epoch().count());
+}
+}
+
+bool TextureAsset::Open(In<std::filesystem::path> path)
+{
+    if (!m_File.Open(path))
+    {
+        return false;
+    }
+    if (m_File.Size() < sizeof(TextureFileHeader))
+    {
+        SA_LOG_WARN("Cooked texture is truncated: {}", PATH_TO_SSTR(path));
+        m_File.Close();
+        return false;
+    }
+    std::memcpy(&m_Header, m_File.Data(), sizeof(TextureFileHeader));
+
+    if (m_Header.magic != TextureFileHeader::Magic || m_Header.version != TextureFileHeader::Version)
+    {
+        SA_LOG_INFO("Cooked texture has an outdated format: {}", PATH_TO_SSTR(path));
+        m_File.Close();
+        return false;
+    }
+    auto mipTableBytes = m_Header.mipCount * sizeof(TextureMip);
+    if (m_Header.format >= ETextureFormat::Count || m_Header.mipTableOffset % TextureFileHeader::MipAlignment != 0 || m_Header.mipCount == 0 ||
+        m_Header.mipTableOffset + mipTableBytes > m_File.Size())
+    {
+        SA_LOG_WARN("Cooked texture is corrupted: {}", PATH_TO_SSTR(path));
+        m_File.Close();
+        return false;
+    }
+    m_Mips = ArrayIn<TextureMip>(reinterpret_cast<const TextureMip*>(m_File.Data() + m_Header.mipTableOffset), m_Header.mipCount);
+
+    bool valid = m_Mips[0].width == m_Header.width && m_Mips[0].height == m_Header.height;
+    for (auto&& mip : m_Mips)
+    {
+        valid &= mip.dataOffset % TextureFileHeader::MipAlignment == 0 && mip.dataOffset + mip.dataSize <= m_File.Size() &&
+                 mip.dataSize == TextureEncoder::MipSize(m_Header.format, mip.width, mip.height);
+    }
+    if (!valid)
+    {
+        SA_LOG_WARN("Cooked texture is corrupted: {}", PATH_TO_SSTR(path));
+        m_Mips = {};
+        m_File.Close();
+        return false;
+    }
+    return true;
+}
+
+ArrayIn<uint8_t> TextureAsset::MipData(uint32_t mip) const noexcept
+{
+    auto& info = m_Mips[mip];
+    return ArrayIn<uint8_t>(m_File.Data() + info.dataOffset, info.dataSize);
+}
+
+uint64_t TextureAsset::MipChainSize(uint32_t firstMip) const noexcept
+{
+    uint64_t size = 0;
+    for (uint32_t mip = firstMip; mip < MipCount(); mip++)
+    {
+        size += m_Mips[mip].dataSize;
+    }
+    return size;
+}
+
+bool TextureCooker::IsUpToDate(In<std::filesystem::path> sourcePath, In<std::filesystem::path> cookedPath, ETextureFormat format)
+{
+    std::ifstream file(cookedPath, std::ios::binary);
+    TextureFileHeader header;
+    if (!file.is_open() || !file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+    {
+        return false;
+    }
+    std::error_code error;
+    auto sourceSize = std::filesystem::file_size(sourcePath, error);
+    auto sourceWriteTime = SourceWriteTime(sourcePath, error);
+    if (error)
+    {
+        // Shipped without sources, the cooked file is all there is
+        return true;
+    }
+    return header.magic == TextureFileHeader::Magic && header.version == TextureFileHeader::Version && header.format == format &&
+           header.sourceSize == sourceSize && header.sourceWriteTime == sourceWriteTime;
+}
+
+bool TextureCooker::Cook(In<std::filesystem::path> sourcePath, In<std::filesystem::path> cookedPath, ETextureFormat format)
+{
+    int width, height, channel;
+    stbi_uc* pixels = stbi_load(sourcePath.string().c_str(), &width, &height, &channel, STBI_rgb_alpha);
+    if (!pixels)
+    {
+        SA_LOG_WARN("Failed to decode texture: {}", PATH_TO_SSTR(sourcePath));
+        return false;
+    }
+
+    std::vector<std::vector<uint8_t>> mipData;
+    std::vector<TextureMip> mips;
+    mipData.emplace_back(pixels, pixels + size_t(width) * height * TextureEncoder::BytesPerTexel);
+    mips.emplace_back(TextureMip{ .width = static_cast<uint32_t>(width), .height = static_cast<uint32_t>(height) });
+    stbi_image_free(pixels);
+    for (auto&& data : TextureFilter::BuildMipChain(MipFilter, mipData.front(), mips.front().width, mips.front().height))
+    {
+        mips.emplace_back(TextureMip{ .width = TextureFilter::HalfSize(mips.back().width), .height = TextureFilter::HalfSize(mips.back().height) });
+        mipData.emplace_back(std::move(data));
+    }
+    if (TextureEncoder::IsBlockCompressed(format))
+    {
+        for (size_t i = 0; i < mips.size(); i++)
+        {
+            std::vector<uint8_t> blocks;
+            TextureEncoder::Encode(format, mipData[i], mips[i].width, mips[i].height, &blocks);
+            mipData[i] = std::move(blocks);
+        }
+    }
+
+    std::error_code error;
+    TextureFileHeader header = {
+        .magic = TextureFileHeader::Magic,
+        .version = TextureFileHeader::Version,
+        .width = mips.front().width,
+        .height = mips.front().height,
+        .mipCount = static_cast<uint32_t>(mips.size()),
+        .format = format,
+        .padding = {},
+        .mipTableOffset = AlignUp(sizeof(TextureFileHeader), TextureFileHeader::MipAlignment),
+        .sourceSize = std::filesystem::file_size(sourcePath, error),
+        .sourceWriteTime = SourceWriteTime(sourcePath, error),
+    };
+    uint64_t offset = header.mipTableOffset + mips.size() * sizeof(TextureMip);
+    for (size_t i = 0; i < mips.size(); i++)
+    {
+        mips[i].dataOffset = AlignUp(offset, TextureFileHeader::MipAlignment);
+        mips[i].dataSize = mipData[i].size();
+        offset = mips[i].dataOffset + mips[i].dataSize;
+    }
+
+    // Written aside and renamed so a crash never leaves a truncated texture behind
+    std::filesystem::create_directories(cookedPath.parent_path(), error);
+    auto tempPath = cookedPath;
+    tempPath += ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            SA_LOG_WARN("Failed to write cooked texture: {}", PATH_TO_SSTR(tempPath));
+            return false;
+        }
+        std::array<char, TextureFileHeader::MipAlignment> padding = {};
+        uint64_t written = 0;
+        auto write = [&](const void* data, uint64_t size) {
+            file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+            written += size;
+        };
+        write(&header, sizeof(header));
+        write(padding.data(), header.mipTableOffset - written);
+        write(mips.data(), mips.size() * sizeof(TextureMip));
+        for (size_t i = 0; i < mips.size(); i++)
+        {
+            write(padding.data(), mips[i].dataOffset - written);
+            write(mipData[i].data(), mipData[i].size());
+        }
+    }
+    std::filesystem::rename(tempPath, cookedPath, error);
+    if (error)
+    {
+        SA_LOG_WARN("Failed to write cooked texture: {}", PATH_TO_SSTR(cookedPath));
+        return false;
+    }
+    SA_LOG_INFO("Cook Texture, {}x{}, {} mips, {}.", header.width, header.height, header.mipCount, TextureEncoder::Name(format));
+    return true;
+}
+}
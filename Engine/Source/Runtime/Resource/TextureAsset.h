@@ -0,0 +1,88 @@
+﻿#pragma once
+#include "Engine/Source/Runtime/Core/Base/Common.h"
+#include "Engine/Source/Runtime/Core/File/MappedFile.h"
+#include "Engine/Source/Runtime/Resource/TextureFilter.h"
+#include "Engine/Source/Runtime/Resource/TextureEncoder.h"
+
+namespace Snowy::Ark
+{
+// Mip table entry of the cooked texture, mip 0 is the full resolution
+struct TextureMip
+{
+    uint32_t width;
+    uint32_t height;
+    uint64_t dataOffset;
+    uint64_t dataSize;
+};
+
+/// <summary>
+/// Cooked texture file, laid out like KTX2: header, mip table, then the texels of every mip back to back
+/// in the format of the header(RGBA8 or BC blocks, rows of blocks for the latter), each aligned to
+/// MipAlignment so a mip can be staged straight from a mapping of the file into a copy to the image.
+/// The source size and write time are kept to detect a stale cook.
+/// </summary>
+struct TextureFileHeader
+{
+    static constexpr uint32_t Magic = 0x58544153;   // "SATX"
+    static constexpr uint32_t Version = 3;  // 2: Kaiser filtered mips, 3: texel format
+    static constexpr uint64_t MipAlignment = 16;
+
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t mipCount;
+    ETextureFormat format;
+    uint8_t padding[3];
+    uint64_t mipTableOffset;
+    uint64_t sourceSize;
+    int64_t sourceWriteTime;
+};
+
+/// <summary>
+/// Read-only view of a cooked texture, the mips point into the file mapping and stay valid
+/// for the lifetime of the asset. Pages are only read once a mip is touched, so opening is
+/// cheap whatever the resolution and mips can be read from any thread.
+/// </summary>
+class TextureAsset
+{
+public:
+    TextureAsset() = default;
+    ~TextureAsset() = default;
+    TextureAsset(const TextureAsset&) = delete;
+    TextureAsset(TextureAsset&&) = delete;
+    TextureAsset& operator=(const TextureAsset&) = delete;
+    TextureAsset& operator=(TextureAsset&&) = delete;
+
+    // Fails on a missing, truncated or outdated file
+    bool Open(In<std::filesystem::path> path);
+
+    In<TextureFileHeader> Header() const noexcept { return m_Header; }
+    ETextureFormat Format() const noexcept { return m_Header.format; }
+    uint32_t MipCount() const noexcept { return m_Header.mipCount; }
+    In<TextureMip> Mip(uint32_t mip) const noexcept { return m_Mips[mip]; }
+    ArrayIn<uint8_t> MipData(uint32_t mip) const noexcept;
+    // Bytes of the mips [firstMip, MipCount())
+    uint64_t MipChainSize(uint32_t firstMip) const noexcept;
+
+private:
+    MappedFile m_File;
+    TextureFileHeader m_Header = {};
+    ArrayIn<TextureMip> m_Mips;
+};
+
+/// <summary>
+/// Converts source images(anything stb_image decodes) into the cooked format, run at first load
+/// or when the source changed. The image is expanded to RGBA8, filtered down to 1x1 by TextureFilter,
+/// then every mip is block compressed by TextureEncoder unless the format is RGBA8.
+/// </summary>
+class TextureCooker
+{
+public:
+    static constexpr ETextureMipFilter MipFilter = ETextureMipFilter::Kaiser;
+
+public:
+    static bool IsUpToDate(In<std::filesystem::path> sourcePath, In<std::filesystem::path> cookedPath, ETextureFormat format);
+    static bool Cook(In<std::filesystem::path> sourcePath, In<std::filesystem::path> cookedPath, ETextureFormat format);
+};
+}
@@ -0,0 +1,560 @@
+﻿#include "TextureEncoder.h"
+#include "Engine/Source/Runtime/Core/Job/JobSystem.h"
+#include "Engine/Source/Runtime/Function/Global/GlobalContext.h"
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define SA_TEXTURE_ENCODER_SSE2 1
+    #include <emmintrin.h>
+#else
+    #define SA_TEXTURE_ENCODER_SSE2 0
+#endif
+
+namespace Snowy::Ark
+{
+namespace
+{
+constexpr uint32_t TexelCount = TextureEncoder::BlockSize * TextureEncoder::BlockSize;
+
+using Color = std::array<float, 4>;
+using BlockIndices = std::array<uint8_t, TexelCount>;
+
+// Channels of the block laid out for the palette search, in [0, 255]
+struct BlockTexels
+{
+    alignas(16) float channels[4][TexelCount];
+};
+
+struct BitWriter
+{
+    uint8_t* data;
+    uint32_t offset = 0;
+
+    // Least significant bit first, as BC7 lays out its fields
+    void Write(uint32_t value, uint32_t bitCount) noexcept
+    {
+        for (uint32_t bit = 0; bit < bitCount; bit++, offset++)
+        {
+            data[offset / 8] |= static_cast<uint8_t>(((value >> bit) & 1) << (offset % 8));
+        }
+    }
+};
+
+// Mode 6 endpoint, 7 bits per channel and a lowest bit shared by the channels
+struct BC7Endpoint
+{
+    std::array<uint8_t, 4> values;
+    uint8_t pbit;
+};
+
+BlockTexels LoadBlock(const uint8_t* texels) noexcept
+{
+    BlockTexels block;
+    for (uint32_t i = 0; i < TexelCount; i++)
+    {
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            block.channels[c][i] = texels[i * TextureEncoder::BytesPerTexel + c];
+        }
+    }
+    return block;
+}
+
+// Mean of the texels and direction of their largest variance, a null axis for a single color block
+void PrincipalAxis(In<BlockTexels> block, uint32_t channelCount, Out<Color> mean, Out<Color> axis) noexcept
+{
+    Color minColor = {};
+    Color maxColor = {};
+    *mean = {};
+    for (uint32_t c = 0; c < channelCount; c++)
+    {
+        minColor[c] = *std::min_element(block.channels[c], block.channels[c] + TexelCount);
+        maxColor[c] = *std::max_element(block.channels[c], block.channels[c] + TexelCount);
+        for (uint32_t i = 0; i < TexelCount; i++)
+        {
+            (*mean)[c] += block.channels[c][i];
+        }
+        (*mean)[c] /= TexelCount;
+    }
+
+    float covariance[4][4] = {};
+    for (uint32_t i = 0; i < TexelCount; i++)
+    {
+        for (uint32_t a = 0; a < channelCount; a++)
+        {
+            for (uint32_t b = 0; b < channelCount; b++)
+            {
+                covariance[a][b] += (block.channels[a][i] - (*mean)[a]) * (block.channels[b][i] - (*mean)[b]);
+            }
+        }
+    }
+
+    // Power iteration, from the bounding box diagonal
+    Color direction = {};
+    for (uint32_t c = 0; c < channelCount; c++)
+    {
+        direction[c] = maxColor[c] - minColor[c];
+    }
+    *axis = {};
+    for (uint32_t iteration = 0; iteration < 8; iteration++)
+    {
+        Color next = {};
+        float length = 0.0f;
+        for (uint32_t a = 0; a < channelCount; a++)
+        {
+            for (uint32_t b = 0; b < channelCount; b++)
+            {
+                next[a] += covariance[a][b] * direction[b];
+            }
+            length = std::max(length, std::abs(next[a]));
+        }
+        if (length < 1e-6f)
+        {
+            return;
+        }
+        for (uint32_t c = 0; c < channelCount; c++)
+        {
+            direction[c] = next[c] / length;
+        }
+    }
+    float length = 0.0f;
+    for (uint32_t c = 0; c < channelCount; c++)
+    {
+        length += direction[c] * direction[c];
+    }
+    length = std::sqrt(length);
+    for (uint32_t c = 0; c < channelCount; c++)
+    {
+        (*axis)[c] = direction[c] / length;
+    }
+}
+
+// Extremes of the texels projected on the axis, clamped to the channel range
+void AxisEndpoints(In<BlockTexels> block, uint32_t channelCount, In<Color> mean, In<Color> axis, Out<Color> e0, Out<Color> e1) noexcept
+{
+    float tMin = FLT_MAX;
+    float tMax = -FLT_MAX;
+    for (uint32_t i = 0; i < TexelCount; i++)
+    {
+        float t = 0.0f;
+        for (uint32_t c = 0; c < channelCount; c++)
+        {
+            t += (block.channels[c][i] - mean[c]) * axis[c];
+        }
+        tMin = std::min(tMin, t);
+        tMax = std::max(tMax, t);
+    }
+    *e0 = {};
+    *e1 = {};
+    for (uint32_t c = 0; c < channelCount; c++)
+    {
+        (*e0)[c] = std::clamp(mean[c] + tMin * axis[c], 0.0f, 255.0f);
+        (*e1)[c] = std::clamp(mean[c] + tMax * axis[c], 0.0f, 255.0f);
+    }
+}
+
+// Endpoints minimizing the squared error for fixed interpolation weights(0 at e0, 1 at e1),
+// fails when every texel has the same weight
+bool FitEndpoints(In<BlockTexels> block, uint32_t channelCount, const float* weights, Out<Color> e0, Out<Color> e1) noexcept
+{
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    Color ax = {}, bx = {};
+    for (uint32_t i = 0; i < TexelCount; i++)
+    {
+        float a = 1.0f - weights[i];
+        float b = weights[i];
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (uint32_t c = 0; c < channelCount; c++)
+        {
+            ax[c] += a * block.channels[c][i];
+            bx[c] += b * block.channels[c][i];
+        }
+    }
+    float determinant = aa * bb - ab * ab;
+    if (std::abs(determinant) < 1e-6f)
+    {
+        return false;
+    }
+    for (uint32_t c = 0; c < channelCount; c++)
+    {
+        (*e0)[c] = std::clamp((ax[c] * bb - bx[c] * ab) / determinant, 0.0f, 255.0f);
+        (*e1)[c] = std::clamp((bx[c] * aa - ax[c] * ab) / determinant, 0.0f, 255.0f);
+    }
+    return true;
+}
+
+// Nearest palette entry of every texel, returns the summed squared error
+float SelectIndices(In<BlockTexels> block, uint32_t channelCount, const Color* palette, uint32_t paletteSize, bool simd,
+                    Out<BlockIndices> indices) noexcept
+{
+    float error = 0.0f;
+#if SA_TEXTURE_ENCODER_SSE2
+    for (uint32_t i = 0; simd && i < TexelCount; i += 4)
+    {
+        __m128 best = _mm_set1_ps(FLT_MAX);
+        __m128i bestIndex = _mm_setzero_si128();
+        for (uint32_t p = 0; p < paletteSize; p++)
+        {
+            __m128 distance = _mm_setzero_ps();
+            for (uint32_t c = 0; c < channelCount; c++)
+            {
+                __m128 delta = _mm_sub_ps(_mm_load_ps(&block.channels[c][i]), _mm_set1_ps(palette[p][c]));
+                distance = _mm_add_ps(distance, _mm_mul_ps(delta, delta));
+            }
+            __m128i closer = _mm_castps_si128(_mm_cmplt_ps(distance, best));
+            best = _mm_min_ps(distance, best);
+            bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(static_cast<int>(p))), _mm_andnot_si128(closer, bestIndex));
+        }
+        alignas(16) float bestErrors[4];
+        alignas(16) int32_t bestIndices[4];
+        _mm_store_ps(bestErrors, best);
+        _mm_store_si128(reinterpret_cast<__m128i*>(bestIndices), bestIndex);
+        for (uint32_t k = 0; k < 4; k++)
+        {
+            (*indices)[i + k] = static_cast<uint8_t>(bestIndices[k]);
+            error += bestErrors[k];
+        }
+    }
+    if (simd)
+    {
+        return error;
+    }
+#endif
+    for (uint32_t i = 0; i < TexelCount; i++)
+    {
+        float best = FLT_MAX;
+        uint32_t bestIndex = 0;
+        for (uint32_t p = 0; p < paletteSize; p++)
+        {
+            float distance = 0.0f;
+            for (uint32_t c = 0; c < channelCount; c++)
+            {
+                float delta = block.channels[c][i] - palette[p][c];
+                distance += delta * delta;
+            }
+            if (distance < best)
+            {
+                best = distance;
+                bestIndex = p;
+            }
+        }
+        (*indices)[i] = static_cast<uint8_t>(bestIndex);
+        error += best;
+    }
+    return error;
+}
+
+uint16_t To565(In<Color> color) noexcept
+{
+    auto quantize = [](float value, float maxValue) {
+        return static_cast<uint32_t>(std::clamp(std::nearbyint(value * maxValue / 255.0f), 0.0f, maxValue));
+    };
+    return static_cast<uint16_t>(quantize(color[0], 31.0f) << 11 | quantize(color[1], 63.0f) << 5 | quantize(color[2], 31.0f));
+}
+
+Color From565(uint16_t packed) noexcept
+{
+    uint32_t r = (packed >> 11) & 31;
+    uint32_t g = (packed >> 5) & 63;
+    uint32_t b = packed & 31;
+    return Color{ static_cast<float>(r << 3 | r >> 2), static_cast<float>(g << 2 | g >> 4), static_cast<float>(b << 3 | b >> 2), 255.0f };
+}
+
+BC7Endpoint QuantizeBC7(In<Color> color, Out<std::array<int32_t, 4>> expanded) noexcept
+{
+    BC7Endpoint best = {};
+    float bestError = FLT_MAX;
+    for (uint8_t pbit = 0; pbit < 2; pbit++)
+    {
+        BC7Endpoint endpoint = { .pbit = pbit };
+        float error = 0.0f;
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            endpoint.values[c] = static_cast<uint8_t>(std::clamp(std::nearbyint((color[c] - pbit) * 0.5f), 0.0f, 127.0f));
+            float delta = static_cast<float>(endpoint.values[c] << 1 | pbit) - color[c];
+            error += delta * delta;
+        }
+        if (error < bestError)
+        {
+            bestError = error;
+            best = endpoint;
+        }
+    }
+    for (uint32_t c = 0; c < 4; c++)
+    {
+        (*expanded)[c] = best.values[c] << 1 | best.pbit;
+    }
+    return best;
+}
+}
+
+uint32_t TextureEncoder::BytesPerBlock(ETextureFormat format) noexcept
+{
+    switch (format)
+    {
+        case ETextureFormat::BC1:
+        case ETextureFormat::BC4: return 8;
+        case ETextureFormat::BC3:
+        case ETextureFormat::BC5:
+        case ETextureFormat::BC7: return 16;
+        default: return BytesPerTexel;
+    }
+}
+
+uint64_t TextureEncoder::MipSize(ETextureFormat format, uint32_t width, uint32_t height) noexcept
+{
+    if (!IsBlockCompressed(format))
+    {
+        return uint64_t(width) * height * BytesPerTexel;
+    }
+    return uint64_t((width + BlockSize - 1) / BlockSize) * ((height + BlockSize - 1) / BlockSize) * BytesPerBlock(format);
+}
+
+std::string_view TextureEncoder::Name(ETextureFormat format) noexcept
+{
+    switch (format)
+    {
+        case ETextureFormat::BC1: return "bc1";
+        case ETextureFormat::BC3: return "bc3";
+        case ETextureFormat::BC4: return "bc4";
+        case ETextureFormat::BC5: return "bc5";
+        case ETextureFormat::BC7: return "bc7";
+        default: return "rgba8";
+    }
+}
+
+void TextureEncoder::Encode(ETextureFormat format, ArrayIn<uint8_t> src, uint32_t width, uint32_t height, Out<std::vector<uint8_t>> dst)
+{
+    EncodeMip(format, src, width, height, true, dst);
+}
+
+void TextureEncoder::EncodeScalar(ETextureFormat format, ArrayIn<uint8_t> src, uint32_t width, uint32_t height, Out<std::vector<uint8_t>> dst)
+{
+    EncodeMip(format, src, width, height, false, dst);
+}
+
+void TextureEncoder::EncodeMip(ETextureFormat format, ArrayIn<uint8_t> src, uint32_t width, uint32_t height, bool simd, Out<std::vector<uint8_t>> dst)
+{
+    dst->resize(static_cast<size_t>(MipSize(format, width, height)));
+    if (!IsBlockCompressed(format))
+    {
+        std::memcpy(dst->data(), src.data(), dst->size());
+        return;
+    }
+
+    uint32_t blocksX = (width + BlockSize - 1) / BlockSize;
+    uint32_t blocksY = (height + BlockSize - 1) / BlockSize;
+    uint32_t bytesPerBlock = BytesPerBlock(format);
+    auto& jobSys = *g_RuntimeContext.jobSys;
+    jobSys.ParallelFor(blocksY, 1, [&](uint32_t begin, uint32_t end) {
+        std::array<uint8_t, TexelCount * BytesPerTexel> texels;
+        for (uint32_t by = begin; by < end; by++)
+        {
+            for (uint32_t bx = 0; bx < blocksX; bx++)
+            {
+                // Partial blocks repeat the last row/column
+                for (uint32_t y = 0; y < BlockSize; y++)
+                {
+                    uint32_t srcY = std::min(by * BlockSize + y, height - 1);
+                    for (uint32_t x = 0; x < BlockSize; x++)
+                    {
+                        uint32_t srcX = std::min(bx * BlockSize + x, width - 1);
+                        std::memcpy(texels.data() + (y * BlockSize + x) * BytesPerTexel, src.data() + (size_t(srcY) * width + srcX) * BytesPerTexel,
+                                    BytesPerTexel);
+                    }
+                }
+                EncodeBlock(format, texels.data(), simd, dst->data() + (size_t(by) * blocksX + bx) * bytesPerBlock);
+            }
+        }
+    });
+}
+
+void TextureEncoder::EncodeBlock(ETextureFormat format, const uint8_t* texels, bool simd, uint8_t* block) noexcept
+{
+    switch (format)
+    {
+        case ETextureFormat::BC1:
+            EncodeBC1(texels, simd, block);
+            break;
+        case ETextureFormat::BC3:
+            EncodeBC4(texels, 3, block);
+            EncodeBC1(texels, simd, block + 8);
+            break;
+        case ETextureFormat::BC4:
+            EncodeBC4(texels, 0, block);
+            break;
+        case ETextureFormat::BC5:
+            EncodeBC4(texels, 0, block);
+            EncodeBC4(texels, 1, block + 8);
+            break;
+        case ETextureFormat::BC7:
+            EncodeBC7(texels, simd, block);
+            break;
+        default:
+            break;
+    }
+}
+
+void TextureEncoder::EncodeBC1(const uint8_t* texels, bool simd, uint8_t* block) noexcept
+{
+    auto texelBlock = LoadBlock(texels);
+    Color mean, axis, e0, e1;
+    PrincipalAxis(texelBlock, 3, &mean, &axis);
+    AxisEndpoints(texelBlock, 3, mean, axis, &e0, &e1);
+
+    std::array<uint16_t, 2> bestColors = {};
+    BlockIndices bestIndices = {};
+    float bestError = FLT_MAX;
+    for (uint32_t pass = 0; pass < 2; pass++)
+    {
+        // 4 color mode needs color0 > color1, equal endpoints decode through index 0 alone
+        uint16_t color0 = To565(e0);
+        uint16_t color1 = To565(e1);
+        if (color0 < color1)
+        {
+            std::swap(color0, color1);
+        }
+        std::array<Color, 4> palette = { From565(color0), From565(color1) };
+        for (uint32_t c = 0; c < 3; c++)
+        {
+            palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+            palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+        }
+        BlockIndices indices;
+        float error = SelectIndices(texelBlock, 3, palette.data(), color0 == color1 ? 1 : 4, simd, &indices);
+        if (error < bestError)
+        {
+            bestError = error;
+            bestColors = { color0, color1 };
+            bestIndices = indices;
+        }
+
+        constexpr std::array<float, 4> IndexWeights = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+        std::array<float, TexelCount> weights;
+        for (uint32_t i = 0; i < TexelCount; i++)
+        {
+            weights[i] = IndexWeights[indices[i]];
+        }
+        if (color0 == color1 || !FitEndpoints(texelBlock, 3, weights.data(), &e0, &e1))
+        {
+            break;
+        }
+    }
+
+    uint32_t packedIndices = 0;
+    for (uint32_t i = 0; i < TexelCount; i++)
+    {
+        packedIndices |= uint32_t(bestIndices[i]) << (i * 2);
+    }
+    std::memcpy(block, bestColors.data(), sizeof(bestColors));
+    std::memcpy(block + sizeof(bestColors), &packedIndices, sizeof(packedIndices));
+}
+
+void TextureEncoder::EncodeBC4(const uint8_t* texels, uint32_t channel, uint8_t* block) noexcept
+{
+    uint32_t minValue = 255;
+    uint32_t maxValue = 0;
+    for (uint32_t i = 0; i < TexelCount; i++)
+    {
+        minValue = std::min<uint32_t>(minValue, texels[i * BytesPerTexel + channel]);
+        maxValue = std::max<uint32_t>(maxValue, texels[i * BytesPerTexel + channel]);
+    }
+
+    // 8 value mode, index 0 and 1 are the endpoints and 2 to 7 step from max down to min.
+    // A single value block has both endpoints equal and every index 0
+    uint64_t packedIndices = 0;
+    if (maxValue > minValue)
+    {
+        float scale = 7.0f / static_cast<float>(maxValue - minValue);
+        for (uint32_t i = 0; i < TexelCount; i++)
+        {
+            auto step = static_cast<uint32_t>(std::nearbyint((texels[i * BytesPerTexel + channel] - minValue) * scale));
+            uint64_t index = step == 7 ? 0 : (step == 0 ? 1 : 8 - step);
+            packedIndices |= index << (i * 3);
+        }
+    }
+    block[0] = static_cast<uint8_t>(maxValue);
+    block[1] = static_cast<uint8_t>(minValue);
+    for (uint32_t i = 0; i < 6; i++)
+    {
+        block[2 + i] = static_cast<uint8_t>(packedIndices >> (i * 8));
+    }
+}
+
+void TextureEncoder::EncodeBC7(const uint8_t* texels, bool simd, uint8_t* block) noexcept
+{
+    constexpr std::array<int32_t, 16> IndexWeights = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    auto texelBlock = LoadBlock(texels);
+    Color mean, axis, e0, e1;
+    PrincipalAxis(texelBlock, 4, &mean, &axis);
+    AxisEndpoints(texelBlock, 4, mean, axis, &e0, &e1);
+
+    std::array<BC7Endpoint, 2> bestEndpoints = {};
+    BlockIndices bestIndices = {};
+    float bestError = FLT_MAX;
+    for (uint32_t pass = 0; pass < 2; pass++)
+    {
+        std::array<int32_t, 4> expanded0, expanded1;
+        std::array<BC7Endpoint, 2> endpoints = { QuantizeBC7(e0, &expanded0), QuantizeBC7(e1, &expanded1) };
+        std::array<Color, 16> palette;
+        for (uint32_t p = 0; p < palette.size(); p++)
+        {
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                palette[p][c] = static_cast<float>(((64 - IndexWeights[p]) * expanded0[c] + IndexWeights[p] * expanded1[c] + 32) >> 6);
+            }
+        }
+        BlockIndices indices;
+        float error = SelectIndices(texelBlock, 4, palette.data(), static_cast<uint32_t>(palette.size()), simd, &indices);
+        if (error < bestError)
+        {
+            bestError = error;
+            bestEndpoints = endpoints;
+            bestIndices = indices;
+        }
+
+        std::array<float, TexelCount> weights;
+        for (uint32_t i = 0; i < TexelCount; i++)
+        {
+            weights[i] = IndexWeights[indices[i]] / 64.0f;
+        }
+        if (!FitEndpoints(texelBlock, 4, weights.data(), &e0, &e1))
+        {
+            break;
+        }
+    }
+
+    // The top bit of the anchor(texel 0) index is implied 0, swapping the endpoints mirrors the indices
+    if (bestIndices[0] & 8)
+    {
+        std::swap(bestEndpoints[0], bestEndpoints[1]);
+        for (auto&& index : bestIndices)
+        {
+            index = static_cast<uint8_t>(15 - index);
+        }
+    }
+
+    std::memset(block, 0, 16);
+    BitWriter writer = { .data = block };
+    writer.Write(1 << 6, 7);
+    for (uint32_t c = 0; c < 4; c++)
+    {
+        writer.Write(bestEndpoints[0].values[c], 7);
+        writer.Write(bestEndpoints[1].values[c], 7);
+    }
+    writer.Write(bestEndpoints[0].pbit, 1);
+    writer.Write(bestEndpoints[1].pbit, 1);
+    writer.Write(bestIndices[0], 3);
+    for (uint32_t i = 1; i < TexelCount; i++)
+    {
+        writer.Write(bestIndices[i], 4);
+    }
+}
+}
@@ -0,0 +1,40 @@
+﻿#pragma once
+#include "Engine/Source/Runtime/Core/Base/Common.h"
+#include "Engine/Source/Runtime/Function/Global/GlobalTypedef.h"
+
+namespace Snowy::Ark
+{
+/// <summary>
+/// Block compression of RGBA8 images for the texture cooker. Each block is fitted along the principal axis
+/// of its texels, then refitted once by least squares on the chosen indices. BC7 only encodes mode 6(a single
+/// subset with RGBA endpoints), enough for color textures without the partition search.
+/// Block rows are spread over the job system, the palette search runs 4 texels at a time in SSE2.
+/// </summary>
+class TextureEncoder
+{
+public:
+    static constexpr uint32_t BlockSize = 4;        // texels on each side of a block
+    static constexpr uint32_t BytesPerTexel = 4;    // RGBA8
+
+public:
+    static bool IsBlockCompressed(ETextureFormat format) noexcept { return format != ETextureFormat::RGBA8; }
+    // Bytes of a 4x4 block, or of a texel for RGBA8
+    static uint32_t BytesPerBlock(ETextureFormat format) noexcept;
+    // Partial blocks on the edges are stored whole
+    static uint64_t MipSize(ETextureFormat format, uint32_t width, uint32_t height) noexcept;
+    static std::string_view Name(ETextureFormat format) noexcept;
+
+    // dst gets MipSize(format, width, height) bytes, RGBA8 is copied as is
+    static void Encode(ETextureFormat format, ArrayIn<uint8_t> src, uint32_t width, uint32_t height, Out<std::vector<uint8_t>> dst);
+    // The scalar palette search on every target, the reference the SSE2 one has to match bit for bit
+    static void EncodeScalar(ETextureFormat format, ArrayIn<uint8_t> src, uint32_t width, uint32_t height, Out<std::vector<uint8_t>> dst);
+
+private:
+    static void EncodeMip(ETextureFormat format, ArrayIn<uint8_t> src, uint32_t width, uint32_t height, bool simd, Out<std::vector<uint8_t>> dst);
+    // texels are the 16 RGBA8 texels of the block in row order
+    static void EncodeBlock(ETextureFormat format, const uint8_t* texels, bool simd, uint8_t* block) noexcept;
+    static void EncodeBC1(const uint8_t* texels, bool simd, uint8_t* block) noexcept;
+    static void EncodeBC4(const uint8_t* texels, uint32_t channel, uint8_t* block) noexcept;
+    static void EncodeBC7(const uint8_t* texels, bool simd, uint8_t* block) noexcept;
+};
+}
@@ -0,0 +1,263 @@
+﻿#include "TextureFilter.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <numbers>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define SA_TEXTURE_FILTER_SSE2 1
+    #include <emmintrin.h>
+#else
+    #define SA_TEXTURE_FILTER_SSE2 0
+#endif
+
+namespace Snowy::Ark
+{
+namespace
+{
+constexpr uint32_t KaiserTapCount = TextureFilter::KaiserRadius * 2;
+
+float BesselI0(float x) noexcept
+{
+    float sum = 1.0f;
+    float term = 1.0f;
+    for (int k = 1; k < 20; k++)
+    {
+        float half = x / (2.0f * k);
+        term *= half * half;
+        sum += term;
+    }
+    return sum;
+}
+
+// The taps of a 2:1 reduction sit at the same offsets for every destination texel, -3.5 to 3.5 source texels
+std::array<float, KaiserTapCount> KaiserWeights() noexcept
+{
+    std::array<float, KaiserTapCount> weights;
+    float sum = 0.0f;
+    for (uint32_t i = 0; i < KaiserTapCount; i++)
+    {
+        float offset = static_cast<float>(i) - TextureFilter::KaiserRadius + 0.5f;
+        // Cutoff at the destination Nyquist frequency, half the source one
+        float x = std::numbers::pi_v<float> * offset * 0.5f;
+        float sinc = std::sin(x) / x;
+        float ratio = offset / TextureFilter::KaiserRadius;
+        float window = BesselI0(TextureFilter::KaiserAlpha * std::sqrt(1.0f - ratio * ratio)) / BesselI0(TextureFilter::KaiserAlpha);
+        weights[i] = sinc * window;
+        sum += weights[i];
+    }
+    for (auto&& weight : weights)
+    {
+        weight /= sum;
+    }
+    return weights;
+}
+
+// Source texel of every tap of every destination texel, wrapped around the edges
+std::vector<uint32_t> KaiserTaps(uint32_t srcSize, uint32_t dstSize)
+{
+    std::vector<uint32_t> taps(size_t(dstSize) * KaiserTapCount);
+    for (uint32_t x = 0; x < dstSize; x++)
+    {
+        for (uint32_t i = 0; i < KaiserTapCount; i++)
+        {
+            int64_t texel = int64_t(x) * 2 + 1 - TextureFilter::KaiserRadius + i;
+            taps[size_t(x) * KaiserTapCount + i] = static_cast<uint32_t>((texel % srcSize + srcSize) % srcSize);
+        }
+    }
+    return taps;
+}
+
+void BoxTexel(const uint8_t* row0, const uint8_t* row1, uint32_t x0, uint32_t x1, uint8_t* out) noexcept
+{
+    for (uint32_t c = 0; c < TextureFilter::BytesPerTexel; c++)
+    {
+        out[c] = static_cast<uint8_t>((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+    }
+}
+
+#if SA_TEXTURE_FILTER_SSE2
+__m128 LoadTexel(const uint8_t* texel) noexcept
+{
+    int32_t packed;
+    std::memcpy(&packed, texel, sizeof(packed));
+    __m128i zero = _mm_setzero_si128();
+    return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero));
+}
+
+void StoreTexel(__m128 value, uint8_t* texel) noexcept
+{
+    // Round to nearest even, the packs saturate to [0, 255]
+    __m128i integer = _mm_cvtps_epi32(value);
+    __m128i packed = _mm_packus_epi16(_mm_packs_epi32(integer, integer), integer);
+    int32_t result = _mm_cvtsi128_si32(packed);
+    std::memcpy(texel, &result, sizeof(result));
+}
+#endif
+}
+
+uint32_t TextureFilter::MipCount(uint32_t width, uint32_t height) noexcept
+{
+    return static_cast<uint32_t>(std::bit_width(std::max({ width, height, 1u })));
+}
+
+void TextureFilter::Downsample(ETextureMipFilter filter, ArrayIn<uint8_t> src, uint32_t srcWidth, uint32_t srcHeight,
+                               Out<std::vector<uint8_t>> dst)
+{
+    if (filter == ETextureMipFilter::Kaiser)
+    {
+        DownsampleKaiser(src, srcWidth, srcHeight, true, dst);
+    } else
+    {
+        DownsampleBox(src, srcWidth, srcHeight, true, dst);
+    }
+}
+
+void TextureFilter::DownsampleScalar(ETextureMipFilter filter, ArrayIn<uint8_t> src, uint32_t srcWidth, uint32_t srcHeight,
+                                     Out<std::vector<uint8_t>> dst)
+{
+    if (filter == ETextureMipFilter::Kaiser)
+    {
+        DownsampleKaiser(src, srcWidth, srcHeight, false, dst);
+    } else
+    {
+        DownsampleBox(src, srcWidth, srcHeight, false, dst);
+    }
+}
+
+std::vector<std::vector<uint8_t>> TextureFilter::BuildMipChain(ETextureMipFilter filter, ArrayIn<uint8_t> src, uint32_t width, uint32_t height)
+{
+    std::vector<std::vector<uint8_t>> mips;
+    while (width > 1 || height > 1)
+    {
+        auto& mip = mips.emplace_back();
+        Downsample(filter, mips.size() > 1 ? ArrayIn<uint8_t>(mips[mips.size() - 2]) : src, width, height, &mip);
+        width = HalfSize(width);
+        height = HalfSize(height);
+    }
+    return mips;
+}
+
+void TextureFilter::DownsampleBox(ArrayIn<uint8_t> src, uint32_t srcWidth, uint32_t srcHeight, bool simd, Out<std::vector<uint8_t>> dst)
+{
+    uint32_t dstWidth = HalfSize(srcWidth);
+    uint32_t dstHeight = HalfSize(srcHeight);
+    dst->resize(size_t(dstWidth) * dstHeight * BytesPerTexel);
+    for (uint32_t y = 0; y < dstHeight; y++)
+    {
+        // Only a 1 texel wide side clamps, odd sides drop their last row/column
+        const uint8_t* row0 = src.data() + size_t(std::min(y * 2, srcHeight - 1)) * srcWidth * BytesPerTexel;
+        const uint8_t* row1 = src.data() + size_t(std::min(y * 2 + 1, srcHeight - 1)) * srcWidth * BytesPerTexel;
+        uint8_t* out = dst->data() + size_t(y) * dstWidth * BytesPerTexel;
+
+        uint32_t x = 0;
+#if SA_TEXTURE_FILTER_SSE2
+        // 8 source texels of each row to 4 destination texels, summed in 16 bits
+        __m128i zero = _mm_setzero_si128();
+        __m128i bias = _mm_set1_epi16(2);
+        for (; simd && srcWidth > 1 && x + 4 <= dstWidth; x += 4)
+        {
+            const uint8_t* src0 = row0 + size_t(x) * 2 * BytesPerTexel;
+            const uint8_t* src1 = row1 + size_t(x) * 2 * BytesPerTexel;
+            __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src0));
+            __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src0 + 16));
+            __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src1));
+            __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src1 + 16));
+
+            __m128i s0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+            __m128i s1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+            __m128i s2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+            __m128i s3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+            __m128i h01 = _mm_add_epi16(_mm_unpacklo_epi64(s0, s1), _mm_unpackhi_epi64(s0, s1));
+            __m128i h23 = _mm_add_epi16(_mm_unpacklo_epi64(s2, s3), _mm_unpackhi_epi64(s2, s3));
+            h01 = _mm_srli_epi16(_mm_add_epi16(h01, bias), 2);
+            h23 = _mm_srli_epi16(_mm_add_epi16(h23, bias), 2);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + size_t(x) * BytesPerTexel), _mm_packus_epi16(h01, h23));
+        }
+#endif
+        for (; x < dstWidth; x++)
+        {
+            uint32_t x0 = std::min(x * 2, srcWidth - 1) * BytesPerTexel;
+            uint32_t x1 = std::min(x * 2 + 1, srcWidth - 1) * BytesPerTexel;
+            BoxTexel(row0, row1, x0, x1, out + size_t(x) * BytesPerTexel);
+        }
+    }
+}
+
+void TextureFilter::DownsampleKaiser(ArrayIn<uint8_t> src, uint32_t srcWidth, uint32_t srcHeight, bool simd, Out<std::vector<uint8_t>> dst)
+{
+    static const auto weights = KaiserWeights();
+    uint32_t dstWidth = HalfSize(srcWidth);
+    uint32_t dstHeight = HalfSize(srcHeight);
+    auto columns = KaiserTaps(srcWidth, dstWidth);
+    auto rows = KaiserTaps(srcHeight, dstHeight);
+
+    // Separable, the horizontal pass keeps every source row in float
+    std::vector<float> horizontal(size_t(dstWidth) * srcHeight * BytesPerTexel);
+    for (uint32_t y = 0; y < srcHeight; y++)
+    {
+        const uint8_t* row = src.data() + size_t(y) * srcWidth * BytesPerTexel;
+        float* out = horizontal.data() + size_t(y) * dstWidth * BytesPerTexel;
+        for (uint32_t x = 0; x < dstWidth; x++)
+        {
+            const uint32_t* taps = columns.data() + size_t(x) * KaiserTapCount;
+#if SA_TEXTURE_FILTER_SSE2
+            if (simd)
+            {
+                __m128 sum = _mm_setzero_ps();
+                for (uint32_t i = 0; i < KaiserTapCount; i++)
+                {
+                    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[i]), LoadTexel(row + size_t(taps[i]) * BytesPerTexel)));
+                }
+                _mm_storeu_ps(out + size_t(x) * BytesPerTexel, sum);
+                continue;
+            }
+#endif
+            for (uint32_t c = 0; c < BytesPerTexel; c++)
+            {
+                float sum = 0.0f;
+                for (uint32_t i = 0; i < KaiserTapCount; i++)
+                {
+                    sum += weights[i] * row[size_t(taps[i]) * BytesPerTexel + c];
+                }
+                out[size_t(x) * BytesPerTexel + c] = sum;
+            }
+        }
+    }
+
+    dst->resize(size_t(dstWidth) * dstHeight * BytesPerTexel);
+    for (uint32_t y = 0; y < dstHeight; y++)
+    {
+        const uint32_t* taps = rows.data() + size_t(y) * KaiserTapCount;
+        uint8_t* out = dst->data() + size_t(y) * dstWidth * BytesPerTexel;
+        for (uint32_t x = 0; x < dstWidth; x++)
+        {
+#if SA_TEXTURE_FILTER_SSE2
+            if (simd)
+            {
+                __m128 sum = _mm_setzero_ps();
+                for (uint32_t i = 0; i < KaiserTapCount; i++)
+                {
+                    const float* texel = horizontal.data() + (size_t(taps[i]) * dstWidth + x) * BytesPerTexel;
+                    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[i]), _mm_loadu_ps(texel)));
+                }
+                StoreTexel(sum, out + size_t(x) * BytesPerTexel);
+                continue;
+            }
+#endif
+            for (uint32_t c = 0; c < BytesPerTexel; c++)
+            {
+                float sum = 0.0f;
+                for (uint32_t i = 0; i < KaiserTapCount; i++)
+                {
+                    sum += weights[i] * horizontal[(size_t(taps[i]) * dstWidth + x) * BytesPerTexel + c];
+                }
+                out[size_t(x) * BytesPerTexel + c] = static_cast<uint8_t>(std::clamp(std::nearbyint(sum), 0.0f, 255.0f));
+            }
+        }
+    }
+}
+}
@@ -0,0 +1,45 @@
+﻿#pragma once
+#include "Engine/Source/Runtime/Core/Base/Common.h"
+
+namespace Snowy::Ark
+{
+/// <summary>
+/// Reconstruction filter of a 2:1 mip reduction
+/// </summary>
+enum class ETextureMipFilter : uint8_t
+{
+    Box = 0,    // 2x2 average, what a linear blit does
+    Kaiser,     // Kaiser windowed sinc, sharper minification for offline cooking
+};
+
+/// <summary>
+/// CPU mip generation of RGBA8 images, for the texture cooker and for formats the GPU can't blit.
+/// Both filters have an SSE2 path, the scalar one is kept for other targets and 1 texel wide edges.
+/// Kaiser wraps around the edges like the repeat sampler the textures are drawn with.
+/// </summary>
+class TextureFilter
+{
+public:
+    static constexpr uint32_t BytesPerTexel = 4;
+    static constexpr uint32_t KaiserRadius = 4;         // taps on each side, in source texels
+    static constexpr float KaiserAlpha = 4.0f;
+
+public:
+    // Size of mip 1, each side halved and rounded down, at least 1
+    static uint32_t HalfSize(uint32_t size) noexcept { return std::max(size / 2, 1u); }
+    static uint32_t MipCount(uint32_t width, uint32_t height) noexcept;
+
+    // dst gets HalfSize(srcWidth) x HalfSize(srcHeight) texels
+    static void Downsample(ETextureMipFilter filter, ArrayIn<uint8_t> src, uint32_t srcWidth, uint32_t srcHeight,
+                           Out<std::vector<uint8_t>> dst);
+    // The scalar path on every target, the reference the SSE2 one has to match bit for bit
+    static void DownsampleScalar(ETextureMipFilter filter, ArrayIn<uint8_t> src, uint32_t srcWidth, uint32_t srcHeight,
+                                 Out<std::vector<uint8_t>> dst);
+    // Every mip after the source one, mip 1 first
+    static std::vector<std::vector<uint8_t>> BuildMipChain(ETextureMipFilter filter, ArrayIn<uint8_t> src, uint32_t width, uint32_t height);
+
+private:
+    static void DownsampleBox(ArrayIn<uint8_t> src, uint32_t srcWidth, uint32_t srcHeight, bool simd, Out<std::vector<uint8_t>> dst);
+    static void DownsampleKaiser(ArrayIn<uint8_t> src, uint32_t srcWidth, uint32_t srcHeight, bool simd, Out<std::vector<uint8_t>> dst);
+};
+}
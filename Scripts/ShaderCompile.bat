@@ -1,3 +1,6 @@
 "../Engine/ThirdParty/VulkanSDK/Bin/glslangValidator.exe" -V "../Engine/Shaders/GLSL/shader.vert" -o "../Engine/Shaders/SPIR-V/vert.spv"
 "../Engine/ThirdParty/VulkanSDK/Bin/glslangValidator.exe" -V "../Engine/Shaders/GLSL/shader.frag" -o "../Engine/Shaders/SPIR-V/frag.spv"
+"../Engine/ThirdParty/VulkanSDK/Bin/glslangValidator.exe" -V "../Engine/Shaders/GLSL/cull.comp" -o "../Engine/Shaders/SPIR-V/cull.spv"
+"../Engine/ThirdParty/VulkanSDK/Bin/glslangValidator.exe" -V "../Engine/Shaders/GLSL/cluster_cull.comp" -o "../Engine/Shaders/SPIR-V/cluster_cull.spv"
+"../Engine/ThirdParty/VulkanSDK/Bin/glslangValidator.exe" -V "../Engine/Shaders/GLSL/depth_pyramid.comp" -o "../Engine/Shaders/SPIR-V/depth_pyramid.spv"
 pause
\ No newline at end of file